@@ -1,2 +1,11 @@
 ((kelyphos . ((ed-enable-history . #t)
+              (history-file . "")
+              (log-async . #f)
+              (log-queue-size . 4096)
+              (log-overflow . "block")
+              (print-depth . 64)
+              (print-page-bytes . 65536)
+              (server-socket . "")
+              (server-port . 0)
+              (server-shared . #f)
 )))
@@ -0,0 +1,11 @@
+((test-cfg . ((name . "nested")
+              (display . ((width . 120)
+                          (colors . ((prompt . "green")
+                                     (error . "red")))
+                          (unknown-display-key . 1)))
+              (history . ((enabled . #t)
+                          (max-length . 500)))
+              (name . "shadowed")
+              (unregistered . 7)
+              (limits . 3)))
+ )
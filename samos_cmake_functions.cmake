@@ -76,3 +76,13 @@ function(add_samos_target ModuleName ModuleSource ModuleTestSource)
         EXTRA_INCS ${STM_EXTRA_INCS}
         SAMOS_DEPS ${STM_SAMOS_DEPS})
 endfunction()
+
+function(add_samos_benchmark BenchName)
+    GetSamosArgs(1 "SOURCES;EXTRA_LIBS;SAMOS_DEPS")
+
+    if (${BENCHMARKS})
+        add_executable(${BenchName} ${STM_SOURCES})
+        target_include_directories(${BenchName} PRIVATE ${CMAKE_SOURCE_DIR})
+        target_link_libraries(${BenchName} PRIVATE ${STM_SAMOS_DEPS} ${STM_EXTRA_LIBS})
+    endif()
+endfunction()
@@ -0,0 +1,563 @@
+#include "config_cache.hpp"
+#include "config_manager.hpp"
+#include "config_snapshot.hpp"
+#include "logger.hpp"
+#include "scheme.hpp"
+
+#include "spdlog/sinks/null_sink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fmt/core.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace config_manager = samos::config_manager;
+
+constexpr int repetitions = 20;
+
+constexpr const char* config_source = "data/tests/test_config.scm";
+
+constexpr int map_sections = 8;
+
+constexpr int keys_per_section = 32;
+
+constexpr int map_iterations = 2000;
+
+/*
+ * The previous ConfigMap layout, kept here as the baseline: a hash map plus a sorted key set per
+ * level, with nested maps deep-copied through raw pointers.
+ */
+class LegacyConfigMap {
+public:
+    using Value = std::variant<samos::scheme::SexpCppValue, LegacyConfigMap*>;
+
+    LegacyConfigMap() = default;
+
+    LegacyConfigMap(const LegacyConfigMap& rhs)
+    {
+        for (const auto& key : rhs.config_keys)
+        {
+            register_property(key, rhs.config_map.at(key));
+        }
+    }
+
+    LegacyConfigMap& operator=(const LegacyConfigMap&) = delete;
+
+    ~LegacyConfigMap()
+    {
+        for (auto& entry : config_map)
+        {
+            if (std::holds_alternative<LegacyConfigMap*>(entry.second))
+            {
+                delete std::get<LegacyConfigMap*>(entry.second);
+            }
+        }
+    }
+
+    void register_property(const std::string& key, const Value& value)
+    {
+        if (std::holds_alternative<LegacyConfigMap*>(value))
+        {
+            config_map.emplace(key, new LegacyConfigMap{*std::get<LegacyConfigMap*>(value)});
+        }
+        else
+        {
+            config_map.emplace(key, value);
+        }
+        config_keys.emplace(key);
+    }
+
+    Value copy_property(const std::string& key) const
+    {
+        const auto& value = config_map.at(key);
+
+        if (std::holds_alternative<LegacyConfigMap*>(value))
+        {
+            return new LegacyConfigMap{*std::get<LegacyConfigMap*>(value)};
+        }
+        return value;
+    }
+
+private:
+    std::unordered_map<std::string, Value> config_map;
+    std::set<std::string> config_keys;
+};
+
+samos::scheme::SexpCppValue sample_value(int idx)
+{
+    switch (idx % 4)
+    {
+    case 0:
+        return samos::scheme::SexpCppValue{idx};
+    case 1:
+        return samos::scheme::SexpCppValue{idx * 0.5};
+    case 2:
+        return samos::scheme::SexpCppValue{std::string{"short"}};
+    default:
+        return samos::scheme::SexpCppValue{std::string{"a value long enough to leave small string storage"}};
+    }
+}
+
+std::string section_key(int section)
+{
+    return fmt::format("section-{}", section);
+}
+
+std::string property_key(int idx)
+{
+    return fmt::format("property-{}", idx);
+}
+
+template <typename Map, typename Register>
+Map build_tree(Register&& register_nested)
+{
+    Map root;
+
+    for (int section = 0; section < map_sections; ++section)
+    {
+        Map nested;
+        for (int idx = 0; idx < keys_per_section; ++idx)
+        {
+            register_nested(nested, property_key(idx), sample_value(idx));
+        }
+        register_nested(root, section_key(section), nested);
+    }
+
+    return root;
+}
+
+double time_map_op(const std::function<void()>& op)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int rep = 0; rep < map_iterations; ++rep)
+    {
+        op();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / map_iterations;
+}
+
+void bench_map_storage()
+{
+    auto legacy = build_tree<LegacyConfigMap>(
+        [](LegacyConfigMap& map, const std::string& key, const auto& value)
+        {
+            if constexpr (std::is_same_v<std::decay_t<decltype(value)>, LegacyConfigMap>)
+            {
+                map.register_property(key, const_cast<LegacyConfigMap*>(&value));
+            }
+            else
+            {
+                map.register_property(key, value);
+            }
+        });
+
+    auto flat = build_tree<config_manager::ConfigMap>(
+        [](config_manager::ConfigMap& map, const std::string& key, const auto& value)
+        {
+            auto res = map.register_property(key, config_manager::ConfigValue{value});
+            (void)res;
+        });
+
+    std::vector<std::string> section_keys;
+    std::vector<std::string> property_keys;
+    for (int section = 0; section < map_sections; ++section)
+    {
+        section_keys.push_back(section_key(section));
+    }
+    for (int idx = 0; idx < keys_per_section; ++idx)
+    {
+        property_keys.push_back(property_key(idx));
+    }
+
+    size_t sink = 0;
+
+    double legacy_copy = time_map_op(
+        [&]()
+        {
+            LegacyConfigMap copy{legacy};
+            sink += sizeof(copy);
+        });
+    double flat_copy = time_map_op(
+        [&]()
+        {
+            config_manager::ConfigMap copy{flat};
+            sink += copy.size();
+        });
+
+    double legacy_lookup = time_map_op(
+        [&]()
+        {
+            for (const auto& section : section_keys)
+            {
+                auto nested = std::get<LegacyConfigMap*>(legacy.copy_property(section));
+                for (const auto& key : property_keys)
+                {
+                    sink += nested->copy_property(key).index();
+                }
+                delete nested;
+            }
+        });
+    double flat_lookup = time_map_op(
+        [&]()
+        {
+            for (const auto& section : section_keys)
+            {
+                auto nested = std::get<config_manager::ConfigMap>(flat.copy_property(section).get_ok());
+                for (const auto& key : property_keys)
+                {
+                    sink += nested.copy_property(key).get_ok().index();
+                }
+            }
+        });
+
+    fmt::print("\n{} sections x {} properties\n", map_sections, keys_per_section);
+    fmt::print("{:>8} {:>14} {:>14} {:>10}\n", "op", "legacy us", "flat us", "speedup");
+    fmt::print(
+        "{:>8} {:>14.2f} {:>14.2f} {:>9.1f}x\n",
+        "copy", legacy_copy * 1e6, flat_copy * 1e6, legacy_copy / flat_copy);
+    fmt::print(
+        "{:>8} {:>14.2f} {:>14.2f} {:>9.1f}x\n",
+        "lookup", legacy_lookup * 1e6, flat_lookup * 1e6, legacy_lookup / flat_lookup);
+
+    if (sink == 0)
+    {
+        fmt::print("\n");
+    }
+}
+
+template <typename F>
+double time_once(F&& run)
+{
+    auto start = std::chrono::steady_clock::now();
+    run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+// Single-pass loading against the old strategy of one assq scan per registered key.
+void bench_load_scaling()
+{
+    samos::scheme::Schemer reader{samos::scheme::SchemerEnv::ReaderOnly};
+
+    fmt::print("\n{:>8} {:>14} {:>14}\n", "keys", "per-key ms", "one-pass ms");
+
+    for (int num_keys : {100, 1000, 10000})
+    {
+        config_manager::ConfigMap defaults;
+        std::string alist_text{"("};
+
+        for (int idx = 0; idx < num_keys; ++idx)
+        {
+            auto key = property_key(idx);
+            auto res = defaults.register_property(key, 0);
+            (void)res;
+            alist_text += fmt::format("({} . {})", key, idx);
+        }
+        alist_text += ")";
+
+        sexp alist = reader.read(alist_text).get_ok();
+        reader.preserve(alist);
+
+        double per_key_seconds = time_once(
+            [&]()
+            {
+                config_manager::ConfigMap map{defaults};
+                for (const auto& key : defaults.keys())
+                {
+                    auto value_res = reader.assq(std::string{key}, alist);
+                    if (value_res.is_ok())
+                    {
+                        auto value = value_res.get_ok();
+                        auto cpp_value = reader.get_cpp_value(value);
+                        if (cpp_value.is_ok())
+                        {
+                            auto res = map.set_property(key, cpp_value.get_ok());
+                            (void)res;
+                        }
+                    }
+                }
+            });
+
+        double one_pass_seconds = time_once(
+            [&]()
+            {
+                config_manager::ConfigMap map{defaults};
+                auto res = map.load_from_sexp(alist, reader);
+                (void)res;
+            });
+
+        reader.release(alist);
+
+        fmt::print("{:>8} {:>14.2f} {:>14.2f}\n", num_keys, per_key_seconds * 1e3, one_pass_seconds * 1e3);
+    }
+}
+
+/*
+ * load_from_sexp logs each key it sets, and get_cpp_value each value it converts. Times a load
+ * with those messages formatted into a null sink and with the runtime level above them; rebuild
+ * with -DSAMOS_LOG_ACTIVE_LEVEL=WARN to compare against the calls compiled out.
+ */
+void bench_load_logging()
+{
+    namespace slog = samos::log::logger;
+
+    constexpr int num_keys = 10000;
+
+    samos::scheme::Schemer reader{samos::scheme::SchemerEnv::ReaderOnly};
+    config_manager::ConfigMap defaults;
+    std::string alist_text{"("};
+
+    for (int idx = 0; idx < num_keys; ++idx)
+    {
+        auto key = property_key(idx);
+        auto res = defaults.register_property(key, 0);
+        (void)res;
+        alist_text += fmt::format("({} . {})", key, idx);
+    }
+    alist_text += ")";
+
+    sexp alist = reader.read(alist_text).get_ok();
+    reader.preserve(alist);
+
+    auto previous = spdlog::default_logger();
+    spdlog::set_default_logger(std::make_shared<spdlog::logger>("bench", std::make_shared<spdlog::sinks::null_sink_mt>()));
+
+    auto time_load = [&](slog::LogLevel level)
+    {
+        slog::set_level(level);
+        double total = 0;
+
+        for (int rep = 0; rep < repetitions; ++rep)
+        {
+            total += time_once(
+                [&]()
+                {
+                    config_manager::ConfigMap map{defaults};
+                    auto res = map.load_from_sexp(alist, reader);
+                    (void)res;
+                });
+        }
+
+        return total / repetitions;
+    };
+
+    double trace_seconds = time_load(slog::LogLevel::Trace);
+    double off_seconds = time_load(slog::LogLevel::Off);
+
+    spdlog::set_default_logger(previous);
+    reader.release(alist);
+
+    fmt::print("\n{} keys, compiled down to level {}\n", num_keys, SAMOS_LOG_ACTIVE_LEVEL);
+    fmt::print("{:>8} {:>14}\n", "level", "ms per load");
+    fmt::print("{:>8} {:>14.2f}\n", "trace", trace_seconds * 1e3);
+    fmt::print("{:>8} {:>14.2f}\n", "off", off_seconds * 1e3);
+}
+
+constexpr int reads_per_thread = 200000;
+
+constexpr int publishes_during_reads = 200;
+
+/*
+ * Runs readers_count threads each doing reads_per_thread reads through read_one while the main
+ * thread publishes; returns nanoseconds per read.
+ */
+double time_concurrent_reads(
+    int readers_count,
+    const std::function<int()>& read_one,
+    const std::function<void(int)>& publish)
+{
+    std::atomic<bool> go{false};
+    std::atomic<long> sink{0};
+    std::vector<std::thread> readers;
+
+    for (int idx = 0; idx < readers_count; ++idx)
+    {
+        readers.emplace_back([&]()
+        {
+            while (!go.load())
+            {
+            }
+
+            long sum = 0;
+            for (int read = 0; read < reads_per_thread; ++read)
+            {
+                sum += read_one();
+            }
+            sink += sum;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+
+    for (int version = 0; version < publishes_during_reads; ++version)
+    {
+        publish(version);
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / reads_per_thread;
+}
+
+void bench_concurrent_reads()
+{
+    auto make_version = [](int version)
+    {
+        config_manager::ConfigMap map;
+        auto res = map.register_property("version", version);
+        (void)res;
+        return map;
+    };
+
+    auto version_of = [](const config_manager::ConfigMap& map)
+    {
+        return map.ref_property("version").get_ok().get_int().value_or(0);
+    };
+
+    fmt::print("\n{:>8} {:>14} {:>14} {:>14}\n", "readers", "mutex ns", "shared_ptr ns", "epoch ns");
+
+    unsigned max_readers = std::max(std::thread::hardware_concurrency(), 2u);
+
+    for (unsigned readers = 1; readers <= max_readers; readers *= 2)
+    {
+        std::mutex mutex;
+        auto locked = std::make_shared<const config_manager::ConfigMap>(make_version(0));
+        double mutex_ns = time_concurrent_reads(
+            static_cast<int>(readers),
+            [&]()
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                return version_of(*locked);
+            },
+            [&](int version)
+            {
+                auto next = std::make_shared<const config_manager::ConfigMap>(make_version(version));
+                std::lock_guard<std::mutex> lock{mutex};
+                locked = std::move(next);
+            });
+
+        std::atomic<std::shared_ptr<const config_manager::ConfigMap>> atomic_ptr{
+            std::make_shared<const config_manager::ConfigMap>(make_version(0))};
+        double atomic_ns = time_concurrent_reads(
+            static_cast<int>(readers),
+            [&]() { return version_of(*atomic_ptr.load()); },
+            [&](int version) { atomic_ptr.store(std::make_shared<const config_manager::ConfigMap>(make_version(version))); });
+
+        config_manager::ConfigPublisher publisher{make_version(0)};
+        double epoch_ns = time_concurrent_reads(
+            static_cast<int>(readers),
+            [&]() { return version_of(*publisher.read()); },
+            [&](int version) { publisher.publish(make_version(version)); });
+
+        fmt::print("{:>8} {:>14.1f} {:>14.1f} {:>14.1f}\n", readers, mutex_ns, atomic_ns, epoch_ns);
+    }
+}
+
+config_manager::ConfigNest make_nest()
+{
+    config_manager::ConfigMap default_map;
+    auto register_res = default_map.register_properties({
+        {"bool-prop", false},
+        {"int-prop", 1},
+        {"float-prop", 17.0},
+        {"string-prop", std::string{"default"}},
+        {"symbol-prop", samos::scheme::Symbol{"Iliad"}},
+    });
+
+    if (register_res.is_err())
+    {
+        fmt::print("failed to register defaults: {}\n", register_res.get_err().format());
+    }
+
+    return config_manager::ConfigNest{"test-cfg", default_map};
+}
+
+// Each run constructs a fresh manager, as a process start would.
+double time_per_load(const std::function<bool()>& load)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int rep = 0; rep < repetitions; ++rep)
+    {
+        if (!load())
+        {
+            return -1.0;
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / repetitions;
+}
+
+int main()
+{
+    auto cache_dir = std::filesystem::temp_directory_path() / fmt::format("samos_bench_cache_{}", ::getpid());
+    auto cache = std::make_shared<const config_manager::ConfigCache>(cache_dir);
+
+    double parse_seconds = time_per_load(
+        []()
+        {
+            config_manager::ConfigManager manager{make_nest()};
+            return manager.load_config_from_file(config_source).is_ok();
+        });
+
+    // Populate the cache once so every timed run below is a hit.
+    config_manager::ConfigManager warmup{make_nest(), cache};
+    auto warmup_res = warmup.load_config_from_file(config_source);
+
+    double cached_seconds = time_per_load(
+        [&cache]()
+        {
+            config_manager::ConfigManager manager{make_nest(), cache};
+            return manager.load_config_from_file(config_source).is_ok() && !manager.interpreter_started();
+        });
+
+    std::filesystem::remove_all(cache_dir);
+
+    if (warmup_res.is_err() || parse_seconds < 0 || cached_seconds < 0)
+    {
+        fmt::print("config load failed\n");
+        return 1;
+    }
+
+    fmt::print("{:>8} {:>14}\n", "path", "ms per load");
+    fmt::print("{:>8} {:>14.3f}\n", "parse", parse_seconds * 1e3);
+    fmt::print("{:>8} {:>14.3f}\n", "cached", cached_seconds * 1e3);
+    fmt::print("cache speedup: {:.1f}x\n", parse_seconds / cached_seconds);
+
+    bench_map_storage();
+
+    samos::log::logger::set_level(samos::log::logger::LogLevel::Warn);
+    bench_load_scaling();
+
+    bench_load_logging();
+    samos::log::logger::set_level(samos::log::logger::LogLevel::Warn);
+
+    bench_concurrent_reads();
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+#ifndef SAMOS_CONFIG_ARENA_HPP
+#define SAMOS_CONFIG_ARENA_HPP
+
+#include "scheme.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace samos::config_manager::detail
+{
+
+enum class ConfigNodeKind : uint8_t
+{
+    Map,
+    Bool,
+    Int,
+    Double,
+    String,
+    Symbol,
+};
+
+struct TextSpan
+{
+    uint32_t offset;
+    uint32_t size;
+};
+
+constexpr uint32_t npos = UINT32_MAX;
+
+constexpr size_t small_text_capacity = 16;
+
+// small_size value marking text that lives in the arena's text pool instead of inline.
+constexpr uint8_t pooled_text = UINT8_MAX;
+
+/*
+ * One property, or the root of a map. Children of a map form a singly linked sibling list in
+ * insertion order; strings up to small_text_capacity bytes are stored in the node itself.
+ */
+struct ConfigNode
+{
+    uint32_t key;
+    uint32_t parent;
+    uint32_t first_child;
+    uint32_t last_child;
+    uint32_t next_sibling;
+    ConfigNodeKind kind;
+    uint8_t small_size;
+    union
+    {
+        bool boolean;
+        int integer;
+        double flonum;
+        char small[small_text_capacity];
+        TextSpan pooled;
+    };
+};
+
+/*
+ * Backing store for a tree of ConfigMaps: every node lives in one vector, keys are interned once
+ * into a shared text pool, and (parent, key) lookups go through an open-addressing table, so
+ * building and copying a tree costs a handful of allocations regardless of its size. Removed
+ * nodes are left in place and dropped the next time the tree is copied.
+ */
+class ConfigArena {
+public:
+    ConfigArena();
+
+    [[nodiscard]] uint32_t make_root();
+
+    [[nodiscard]] uint32_t find_key(std::string_view key) const;
+
+    // key_hash must be fnv1a(key); callers with a compile-time key pass it to skip hashing.
+    [[nodiscard]] uint32_t find_key(std::string_view key, uint64_t key_hash) const;
+
+    [[nodiscard]] uint32_t find_child(uint32_t parent, std::string_view key) const;
+
+    [[nodiscard]] uint32_t find_child(uint32_t parent, std::string_view key, uint64_t key_hash) const;
+
+    // The key must not already be present under parent. The new node is an empty map.
+    [[nodiscard]] uint32_t add_child(uint32_t parent, std::string_view key);
+
+    void remove_child(uint32_t node);
+
+    void clear_children(uint32_t node);
+
+    void set_scalar(uint32_t node, const scheme::SexpCppValue& value);
+
+    [[nodiscard]] scheme::SexpCppValue get_scalar(uint32_t node) const;
+
+    [[nodiscard]] std::string_view key_of(uint32_t node) const;
+
+    [[nodiscard]] std::string_view text_of(uint32_t node) const;
+
+    // Deep copies the children of from_node in from into to_node, which must be an empty map.
+    void copy_children(const ConfigArena& from, uint32_t from_node, uint32_t to_node);
+
+    [[nodiscard]] const ConfigNode& at(uint32_t node) const
+    {
+        return nodes[node];
+    }
+
+    [[nodiscard]] size_t node_count() const
+    {
+        return nodes.size();
+    }
+
+private:
+    struct ChildSlot
+    {
+        uint32_t parent;
+        uint32_t key;
+        uint32_t node;
+    };
+
+    static constexpr uint32_t empty_slot = UINT32_MAX;
+
+    static constexpr uint32_t tombstone = UINT32_MAX - 1;
+
+    uint32_t intern(std::string_view key);
+
+    TextSpan append_text(std::string_view value);
+
+    void set_text(uint32_t node, std::string_view value, ConfigNodeKind kind);
+
+    [[nodiscard]] size_t child_slot_index(uint32_t parent, uint32_t key) const;
+
+    void insert_child_slot(uint32_t parent, uint32_t key, uint32_t node);
+
+    void erase_child_slot(uint32_t parent, uint32_t key);
+
+    void grow_child_slots();
+
+    void grow_key_slots();
+
+    std::vector<ConfigNode> nodes;
+
+    std::string text;
+
+    std::vector<TextSpan> keys;
+
+    // Interned key id + 1 per slot, 0 when empty.
+    std::vector<uint32_t> key_slots;
+
+    std::vector<ChildSlot> child_slots;
+
+    size_t child_slots_used;
+};
+
+} // namespace samos::config_manager::detail
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef SAMOS_CONFIG_CACHE_HPP
+#define SAMOS_CONFIG_CACHE_HPP
+
+#include "config_manager.hpp"
+#include "datum_codec.hpp"
+#include "fnv1a.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace samos::config_manager
+{
+
+/*
+ * Compact binary form of a ConfigMap: a varint property count followed by each property as
+ * key string, kind byte and payload, in insertion order. Nested maps are written inline.
+ */
+void encode_config_map(const ConfigMap& map, scheme::DatumBytes& out);
+
+[[nodiscard]] std::optional<ConfigMap> decode_config_map(std::span<const uint8_t> bytes);
+
+// Identity of a config source at the moment it was read.
+struct SourceStamp
+{
+    std::string path;
+    int64_t mtime;
+    uint64_t size;
+    uint64_t content_hash;
+
+    bool operator==(const SourceStamp&) const = default;
+};
+
+/*
+ * On-disk cache of resolved configuration. An entry is keyed by the canonical source path and
+ * records the source's stamp along with a fingerprint of the nest that produced it; any mismatch
+ * is a miss, so an unchanged file with unchanged defaults loads without starting an interpreter.
+ * Stamp the source before parsing it so that an edit racing the parse can only cause a miss.
+ */
+class ConfigCache {
+public:
+    ConfigCache();
+
+    explicit ConfigCache(std::filesystem::path cache_dir);
+
+    // $XDG_CACHE_HOME/samos, falling back to ~/.cache/samos.
+    [[nodiscard]] static std::filesystem::path default_cache_dir();
+
+    [[nodiscard]] static uint64_t fingerprint(const ConfigNest& nest);
+
+    [[nodiscard]] static std::optional<SourceStamp> stamp(const std::string& source);
+
+    [[nodiscard]] std::optional<ConfigMap> load(const SourceStamp& source, uint64_t nest_fingerprint) const;
+
+    [[nodiscard]] ConfigResult<> store(
+        const SourceStamp& source,
+        uint64_t nest_fingerprint,
+        const ConfigMap& map) const;
+
+    [[nodiscard]] const std::filesystem::path& get_cache_dir() const;
+
+private:
+    [[nodiscard]] std::filesystem::path entry_path(const SourceStamp& source) const;
+
+    std::filesystem::path cache_dir;
+};
+
+} // namespace samos::config_manager
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef SAMOS_CONFIG_LAYERS_HPP
+#define SAMOS_CONFIG_LAYERS_HPP
+
+#include "config_manager.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace samos::config_manager
+{
+
+// Where a resolved value came from, from lowest to highest precedence.
+enum class ConfigSource : uint8_t
+{
+    Default,
+    SystemFile,
+    UserFile,
+    Environment,
+    CommandLine,
+};
+
+[[nodiscard]] std::string_view source_name(ConfigSource source);
+
+class ResolvedConfig {
+public:
+    ResolvedConfig() = default;
+
+    ResolvedConfig(ConfigMap map, std::unordered_map<std::string, ConfigSource> provenance);
+
+    [[nodiscard]] const ConfigMap& get_map() const;
+
+    // The layer that set path, a dotted key such as "display.width".
+    [[nodiscard]] ConfigSource source_of(const std::string& path) const;
+
+private:
+    ConfigMap map;
+
+    // Only paths some layer overrode; everything else is a default.
+    std::unordered_map<std::string, ConfigSource> provenance;
+};
+
+/*
+ * Resolves a nest from, in increasing precedence: its defaults, a system file, a user file,
+ * environment variables and command line assignments. Layers are applied once, in order, onto a
+ * single map, so lookups in the result cost the same however many layers there were.
+ *
+ * Environment variables are named prefix + "_" + the dotted path upper-cased with '-' and '.'
+ * turned into '_', e.g. SAMOS_KELYPHOS_ED_ENABLE_HISTORY. Assignments are "nest.path=value",
+ * e.g. "kelyphos.ed-enable-history=#f"; assignments for other nests are ignored. Both kinds of
+ * value are parsed as the type of the default they replace.
+ */
+class ConfigLayers {
+public:
+    explicit ConfigLayers(ConfigNest root);
+
+    ConfigLayers(const ConfigLayers&) = delete;
+
+    ConfigLayers& operator=(const ConfigLayers&) = delete;
+
+    ConfigLayers(ConfigLayers&&) noexcept;
+
+    ConfigLayers& operator=(ConfigLayers&&) noexcept;
+
+    ~ConfigLayers();
+
+    // $XDG_CONFIG_HOME/samos, falling back to ~/.config/samos.
+    [[nodiscard]] static std::filesystem::path default_user_dir();
+
+    // A missing file is skipped; one that exists but cannot be read is an error.
+    ConfigLayers& add_file(ConfigSource source, std::string filename);
+
+    ConfigLayers& add_environment(std::string prefix);
+
+    ConfigLayers& add_assignments(std::vector<std::string> assignments);
+
+    [[nodiscard]] ConfigResult<ResolvedConfig> resolve(scheme::Schemer& schemer) const;
+
+    // Reads files with a reader-only interpreter started on first use.
+    [[nodiscard]] ConfigResult<ResolvedConfig> resolve();
+
+    [[nodiscard]] const ConfigNest& get_root() const;
+
+    [[nodiscard]] std::vector<std::string> get_files() const;
+
+private:
+    struct FileLayer
+    {
+        ConfigSource source;
+        std::string filename;
+    };
+
+    ConfigNest root;
+
+    std::vector<FileLayer> files;
+
+    std::string env_prefix;
+
+    std::vector<std::string> assignments;
+
+    std::unique_ptr<scheme::Schemer> owned_schemer;
+};
+
+} // namespace samos::config_manager
+
+#endif
@@ -1,12 +1,19 @@
+#ifndef SAMOS_CONFIG_MANAGER_HPP
+#define SAMOS_CONFIG_MANAGER_HPP
+
+#include "config_arena.hpp"
+#include "fnv1a.hpp"
 #include "result.hpp"
 #include "scheme.hpp"
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
-#include <set>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <variant>
+#include <vector>
 
 namespace samos::config_manager
 {
@@ -14,7 +21,7 @@ namespace samos::config_manager
 class PropertyAlreadyRegistered
 {
 public:
-    std::string format()
+    std::string format() const
     {
         return {"Property already registered"};
     }
@@ -23,7 +30,7 @@ public:
 class PropertyNotRegistered
 {
 public:
-    std::string format()
+    std::string format() const
     {
         return {"Property not registered"};
     }
@@ -36,7 +43,7 @@ public:
     {
     }
 
-    std::string format()
+    std::string format() const
     {
         return {"Not a config map"};
     }
@@ -48,12 +55,78 @@ private:
 class TypeError
 {
 public:
-    std::string format()
+    std::string format() const
     {
         return {"Type Error"};
     }
 };
 
+class FieldTypeError
+{
+public:
+    // expected names a type and must be a string literal; only the key is copied.
+    FieldTypeError(std::string_view key, std::string_view expected) : key{key}, expected{expected}
+    {
+    }
+
+    std::string format() const
+    {
+        return fmt::format("Config key {} expected a value of type {}", key, expected);
+    }
+
+private:
+    std::string key;
+    std::string_view expected;
+};
+
+class CacheError
+{
+public:
+    explicit CacheError(const std::string& reason) : reason{reason}
+    {
+    }
+
+    std::string format() const
+    {
+        return fmt::format("Config cache error: {}", reason);
+    }
+
+private:
+    std::string reason;
+};
+
+class OverrideError
+{
+public:
+    explicit OverrideError(const std::string& reason) : reason{reason}
+    {
+    }
+
+    std::string format() const
+    {
+        return fmt::format("Config override error: {}", reason);
+    }
+
+private:
+    std::string reason;
+};
+
+class WatchError
+{
+public:
+    explicit WatchError(const std::string& reason) : reason{reason}
+    {
+    }
+
+    std::string format() const
+    {
+        return fmt::format("Config watch error: {}", reason);
+    }
+
+private:
+    std::string reason;
+};
+
 namespace detail
 {
 
@@ -62,6 +135,10 @@ using CfgErrVar = std::variant<
     PropertyNotRegistered,
     NotConfigMap,
     TypeError,
+    FieldTypeError,
+    CacheError,
+    OverrideError,
+    WatchError,
     scheme::SchemerError>;
 
 }
@@ -70,29 +147,11 @@ class ConfigError : public detail::CfgErrVar
 {
     using detail::CfgErrVar::variant;
 public:
-    std::string format()
-    {
-        if (std::holds_alternative<PropertyAlreadyRegistered>(*this))
-        {
-            return std::get<PropertyAlreadyRegistered>(*this).format();
-        }
-        else if (std::holds_alternative<PropertyNotRegistered>(*this))
-        {
-            return std::get<PropertyNotRegistered>(*this).format();
-        }
-        else if (std::holds_alternative<NotConfigMap>(*this))
-        {
-            return std::get<NotConfigMap>(*this).format();
-        }
-        else if (std::holds_alternative<TypeError>(*this))
-        {
-            return std::get<TypeError>(*this).format();
-        }
-        else
-        {
-            assert(std::holds_alternative<scheme::SchemerError>(*this));
-            return std::get<scheme::SchemerError>(*this).format();
-        }
+    std::string format() const
+    {
+        return std::visit(
+            [](const auto& error) { return error.format(); },
+            static_cast<const detail::CfgErrVar&>(*this));
     }
 };
 
@@ -101,46 +160,144 @@ using ConfigResult = result::Result<T, ConfigError>;
 
 class ConfigMap;
 
-using ConfigValue = std::variant<scheme::SexpCppValue, ConfigMap*>;
+class ConfigValue;
+
+// A property key hashed at compile time, so lookups through it skip hashing the key text.
+class ConfigKey {
+public:
+    consteval explicit ConfigKey(std::string_view name) : name{name}, hash{fnv1a(name)}
+    {
+    }
+
+    std::string_view name;
 
+    uint64_t hash;
+};
+
+// Non-owning view of one property; valid until the map it was taken from is modified.
+class ConfigRef {
+public:
+    [[nodiscard]] bool is_map() const;
+
+    [[nodiscard]] std::optional<bool> get_bool() const;
+
+    [[nodiscard]] std::optional<int> get_int() const;
+
+    [[nodiscard]] std::optional<double> get_double() const;
+
+    [[nodiscard]] std::optional<std::string_view> get_string() const;
+
+    [[nodiscard]] std::optional<std::string_view> get_symbol() const;
+
+    [[nodiscard]] ConfigValue to_value() const;
+
+    // Deep comparison of the values, not of where they are stored.
+    [[nodiscard]] bool operator==(const ConfigRef& rhs) const;
+
+private:
+    friend class ConfigMap;
+
+    ConfigRef(const ConfigMap& map, uint32_t node);
+
+    const ConfigMap* map;
+
+    uint32_t node;
+};
+
+// Told the dotted path ("display.width") of each value a load assigns.
+using LoadObserver = std::function<void(std::string_view path)>;
+
+/*
+ * A tree of properties stored flat in a shared ConfigArena. Copies share the arena and are O(1);
+ * the first modification of a shared map copies out just its own subtree. Nested maps are values:
+ * registering one copies it in, and reading one back yields a snapshot that shares storage.
+ */
 class ConfigMap {
 public:
     ConfigMap();
     ~ConfigMap();
     ConfigMap(const ConfigMap& rhs);
-    ConfigMap(ConfigMap&& rhs);
+    ConfigMap(ConfigMap&& rhs) noexcept;
     ConfigMap& operator=(const ConfigMap& rhs);
-    ConfigMap& operator=(ConfigMap&& rhs);
+    ConfigMap& operator=(ConfigMap&& rhs) noexcept;
 
-    [[nodiscard]] ConfigResult<> register_property(std::string&& key, ConfigValue&& value);
+    [[nodiscard]] ConfigResult<> register_property(std::string_view key, ConfigValue&& value);
 
     [[nodiscard]] ConfigResult<> register_properties(
         std::vector<std::pair<std::string, ConfigValue>>&& key_value_pairs);
 
-    [[nodiscard]] ConfigResult<> set_property(const std::string& key, ConfigValue&& value);
+    [[nodiscard]] ConfigResult<> set_property(std::string_view key, ConfigValue&& value);
 
-    [[nodiscard]] ConfigResult<> load_from_sexp(sexp& sexp_config, scheme::Schemer& schemer);
+    [[nodiscard]] ConfigResult<> load_from_sexp(
+        sexp& sexp_config,
+        scheme::Schemer& schemer,
+        const LoadObserver& observer = {});
 
-    template <typename S>
-    [[nodiscard]] bool has_property(S&& ident)
-    {
-        return config_map.contains(std::forward<S>(ident));
-    }
+    [[nodiscard]] bool has_property(std::string_view key) const;
+
+    [[nodiscard]] ConfigResult<ConfigValue> pop_property(std::string_view key);
+
+    [[nodiscard]] ConfigResult<ConfigValue> copy_property(std::string_view key) const;
+
+    [[nodiscard]] ConfigResult<ConfigRef> ref_property(std::string_view key) const;
+
+    [[nodiscard]] ConfigResult<ConfigRef> ref_property(const ConfigKey& key) const;
+
+    [[nodiscard]] ConfigResult<bool> property_is_nested_map(std::string_view key) const;
 
-    [[nodiscard]] ConfigResult<ConfigValue> pop_property(std::string&& key);
+    // A property in a nested map by dotted path, e.g. "display.colors.prompt".
+    [[nodiscard]] ConfigResult<ConfigRef> ref_path(std::string_view path) const;
 
-    [[nodiscard]] ConfigResult<ConfigValue> copy_property(const std::string& key) const;
+    // Replaces the scalar at a dotted path; like set_property, the path must already exist.
+    [[nodiscard]] ConfigResult<> set_path(std::string_view path, scheme::SexpCppValue&& value);
 
-    [[nodiscard]] ConfigResult<const ConfigValue*> ref_property(const std::string& key) const;
+    // In insertion order; the views are valid until the map is next modified.
+    [[nodiscard]] std::vector<std::string_view> keys() const;
 
-    [[nodiscard]] ConfigResult<bool> property_is_nested_map(const std::string& key) const;
+    [[nodiscard]] size_t size() const;
 
-    [[nodiscard]] const std::set<std::string>& keys() const;
+    // Fails on the first property whose type differs from the property of the same key in
+    // reference. Nested keys are reported as "outer.inner"; keys absent from reference are skipped.
+    // An integer passes where reference has a double, as it does for a typed config.
+    [[nodiscard]] ConfigResult<> check_types(const ConfigMap& reference) const;
+
+    // check_types, then stores each such integer as a double, so readers find reference's types.
+    [[nodiscard]] ConfigResult<> conform_types(const ConfigMap& reference);
+
+    [[nodiscard]] bool operator==(const ConfigMap& rhs) const;
 
 private:
+    friend class ConfigRef;
+
+    ConfigMap(std::shared_ptr<detail::ConfigArena> arena, uint32_t root);
+
+    [[nodiscard]] uint32_t find(std::string_view key) const;
+
+    [[nodiscard]] ConfigValue value_at(uint32_t node) const;
+
+    detail::ConfigArena& mutable_arena();
+
+    void assign_value(uint32_t node, const ConfigValue& value);
 
-    std::unordered_map<std::string, ConfigValue> config_map;
-    std::set<std::string> config_keys;
+    [[nodiscard]] uint32_t find_path(std::string_view path) const;
+
+    void load_alist(
+        uint32_t node,
+        sexp alist,
+        scheme::Schemer& schemer,
+        std::vector<bool>& loaded,
+        int depth,
+        const LoadObserver& observer,
+        std::string& path);
+
+    std::shared_ptr<detail::ConfigArena> arena;
+
+    uint32_t root;
+};
+
+class ConfigValue : public std::variant<scheme::SexpCppValue, ConfigMap>
+{
+    using std::variant<scheme::SexpCppValue, ConfigMap>::variant;
 };
 
 class ConfigNest {
@@ -157,6 +314,8 @@ public:
 
     [[nodiscard]] const std::string& get_name() const;
 
+    [[nodiscard]] const ConfigMap& get_default_map() const;
+
     [[nodiscard]] ConfigResult<ConfigMap> load_config_from_sexp(sexp& config_alist, scheme::Schemer& schemer);
 
 private:
@@ -167,23 +326,40 @@ private:
     ConfigMap loaded_map;
 };
 
+class ConfigCache;
+
+/*
+ * Config files are only read, never evaluated, so a manager either borrows the caller's Schemer
+ * or lazily starts its own reader-only one. With a cache attached an unchanged config is served
+ * from disk without any interpreter at all.
+ */
 class ConfigManager {
 public:
     ConfigManager();
 
-    explicit ConfigManager(ConfigNest root)
-        :
-        root_map{root},
-        schemer{}
-    {
-    }
+    explicit ConfigManager(ConfigNest root, std::shared_ptr<const ConfigCache> cache = nullptr);
+
+    ConfigManager(ConfigNest root, scheme::Schemer& schemer, std::shared_ptr<const ConfigCache> cache = nullptr);
+
+    ~ConfigManager();
 
     [[nodiscard]] ConfigResult<ConfigMap> load_config_from_file(const std::string& filename);
 
+    // Whether this manager had to start an interpreter of its own.
+    [[nodiscard]] bool interpreter_started() const;
+
 private:
+    scheme::Schemer& get_schemer();
+
     ConfigNest root_map;
 
-    scheme::Schemer schemer;
+    std::shared_ptr<const ConfigCache> cache;
+
+    scheme::Schemer* schemer;
+
+    std::unique_ptr<scheme::Schemer> owned_schemer;
 };
 
 } // namespace samos::config_manager
+
+#endif
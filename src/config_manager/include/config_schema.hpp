@@ -0,0 +1,298 @@
+#ifndef SAMOS_CONFIG_SCHEMA_HPP
+#define SAMOS_CONFIG_SCHEMA_HPP
+
+#include "config_cache.hpp"
+#include "config_manager.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace samos::config_manager
+{
+
+template <size_t N>
+struct FixedString
+{
+    constexpr FixedString(const char (&str)[N])
+    {
+        std::copy_n(str, N, value);
+    }
+
+    [[nodiscard]] constexpr std::string_view view() const
+    {
+        return {value, N - 1};
+    }
+
+    char value[N];
+};
+
+// Binds a config key to a data member. The key and its hash are compile-time constants.
+template <FixedString Key, auto Member>
+struct Field
+{
+    static constexpr ConfigKey key{Key.view()};
+
+    static constexpr auto member = Member;
+};
+
+/*
+ * A config schema is a plain struct whose defaults are its member initializers, plus:
+ *
+ *     static constexpr std::string_view config_nest = "kelyphos";
+ *     static constexpr auto config_fields()
+ *     {
+ *         return std::tuple{Field<"ed-enable-history", &KelyphosConfig::enable_history>{}};
+ *     }
+ *
+ * Members may be bool, int, double, std::string, scheme::Symbol or another schema struct, which
+ * becomes a nested map. config_nest is only required of the top level struct.
+ */
+template <typename T>
+concept ConfigFields = requires {
+    T::config_fields();
+};
+
+template <typename T>
+concept ConfigSchema = ConfigFields<T> && requires {
+    { T::config_nest } -> std::convertible_to<std::string_view>;
+};
+
+namespace detail
+{
+
+template <typename V>
+constexpr std::string_view field_type_name()
+{
+    if constexpr (std::is_same_v<V, bool>)
+    {
+        return "bool";
+    }
+    else if constexpr (std::is_same_v<V, int>)
+    {
+        return "int";
+    }
+    else if constexpr (std::is_same_v<V, double>)
+    {
+        return "double";
+    }
+    else if constexpr (std::is_same_v<V, scheme::Symbol>)
+    {
+        return "symbol";
+    }
+    else if constexpr (std::is_same_v<V, std::string>)
+    {
+        return "string";
+    }
+    else
+    {
+        static_assert(ConfigFields<V>, "unsupported config field type");
+        return "map";
+    }
+}
+
+} // namespace detail
+
+template <ConfigFields T>
+[[nodiscard]] ConfigMap to_config_map(const T& config);
+
+template <ConfigFields T>
+[[nodiscard]] ConfigResult<> from_config_map(const ConfigMap& map, T& config);
+
+namespace detail
+{
+
+template <typename V>
+ConfigValue to_config_value(const V& value)
+{
+    if constexpr (ConfigFields<V>)
+    {
+        return ConfigValue{to_config_map(value)};
+    }
+    else
+    {
+        return ConfigValue{scheme::SexpCppValue{value}};
+    }
+}
+
+template <typename V>
+ConfigResult<> read_field(const ConfigRef& ref, std::string_view key, V& out)
+{
+    auto mismatch = [&]()
+    {
+        return ConfigResult<>::err(FieldTypeError{key, field_type_name<V>()});
+    };
+
+    if constexpr (ConfigFields<V>)
+    {
+        if (!ref.is_map())
+        {
+            return mismatch();
+        }
+        return from_config_map(std::get<ConfigMap>(ref.to_value()), out);
+    }
+    else
+    {
+        std::optional<V> value;
+
+        if constexpr (std::is_same_v<V, bool>)
+        {
+            value = ref.get_bool();
+        }
+        else if constexpr (std::is_same_v<V, int>)
+        {
+            value = ref.get_int();
+        }
+        else if constexpr (std::is_same_v<V, double>)
+        {
+            // Integers are accepted where a double is expected; "(scale . 2)" should just work.
+            if (auto integer = ref.get_int())
+            {
+                value = integer.value();
+            }
+            else
+            {
+                value = ref.get_double();
+            }
+        }
+        else if constexpr (std::is_same_v<V, scheme::Symbol>)
+        {
+            if (auto symbol = ref.get_symbol())
+            {
+                value = scheme::Symbol{symbol->data(), symbol->size()};
+            }
+        }
+        else
+        {
+            static_assert(std::is_same_v<V, std::string>, "unsupported config field type");
+            if (auto text = ref.get_string())
+            {
+                value = std::string{text.value()};
+            }
+        }
+
+        if (!value.has_value())
+        {
+            return mismatch();
+        }
+
+        out = std::move(value.value());
+        return ConfigResult<>::ok({});
+    }
+}
+
+} // namespace detail
+
+// The map a schema struct describes, with its current member values as the property values.
+template <ConfigFields T>
+ConfigMap to_config_map(const T& config)
+{
+    ConfigMap map;
+
+    std::apply(
+        [&](auto... fields)
+        {
+            (
+                [&]()
+                {
+                    auto res = map.register_property(
+                        decltype(fields)::key.name,
+                        detail::to_config_value(config.*decltype(fields)::member));
+                    assert(res.is_ok() && "duplicate key in config schema");
+                }(),
+                ...);
+        },
+        T::config_fields());
+
+    return map;
+}
+
+// Writes every present field of map into config. Absent keys keep config's current values.
+template <ConfigFields T>
+ConfigResult<> from_config_map(const ConfigMap& map, T& config)
+{
+    ConfigResult<> result = ConfigResult<>::ok({});
+
+    std::apply(
+        [&](auto... fields)
+        {
+            (
+                [&]()
+                {
+                    if (result.is_err())
+                    {
+                        return;
+                    }
+
+                    using F = decltype(fields);
+                    auto ref_res = map.ref_property(F::key);
+                    if (ref_res.is_ok())
+                    {
+                        result = detail::read_field(ref_res.get_ok(), F::key.name, config.*F::member);
+                    }
+                }(),
+                ...);
+        },
+        T::config_fields());
+
+    return result;
+}
+
+template <ConfigSchema T>
+[[nodiscard]] ConfigNest make_config_nest(const T& defaults = T{})
+{
+    return ConfigNest{std::string{T::config_nest}, to_config_map(defaults)};
+}
+
+template <ConfigSchema T>
+[[nodiscard]] ConfigResult<T> load_config(ConfigManager& manager, const std::string& filename, T config = T{})
+{
+    auto map_res = manager.load_config_from_file(filename);
+
+    if (map_res.is_err())
+    {
+        return ConfigResult<T>::err(map_res.get_err());
+    }
+
+    auto read_res = from_config_map(map_res.get_ok(), config);
+
+    if (read_res.is_err())
+    {
+        return ConfigResult<T>::err(read_res.get_err());
+    }
+
+    return ConfigResult<T>::ok(std::move(config));
+}
+
+// Loads filename into a T, parsing with the borrowed schemer.
+template <ConfigSchema T>
+[[nodiscard]] ConfigResult<T> load_config(
+    const std::string& filename,
+    scheme::Schemer& schemer,
+    std::shared_ptr<const ConfigCache> cache = nullptr,
+    const T& defaults = T{})
+{
+    ConfigManager manager{make_config_nest(defaults), schemer, std::move(cache)};
+    return load_config(manager, filename, defaults);
+}
+
+// Loads filename into a T, starting a reader-only interpreter only if the cache misses.
+template <ConfigSchema T>
+[[nodiscard]] ConfigResult<T> load_config(
+    const std::string& filename,
+    std::shared_ptr<const ConfigCache> cache = nullptr,
+    const T& defaults = T{})
+{
+    ConfigManager manager{make_config_nest(defaults), std::move(cache)};
+    return load_config(manager, filename, defaults);
+}
+
+} // namespace samos::config_manager
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef SAMOS_CONFIG_SNAPSHOT_HPP
+#define SAMOS_CONFIG_SNAPSHOT_HPP
+
+#include "config_manager.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace samos::config_manager
+{
+
+namespace detail
+{
+
+// One reader's pinned epoch, 0 when idle. Padded so readers on different cores don't share a line.
+struct alignas(64) ReaderSlot
+{
+    std::atomic<uint64_t> epoch{0};
+};
+
+} // namespace detail
+
+class ConfigPublisher;
+
+/*
+ * A pinned, immutable view of the config that was current when it was taken. While any snapshot
+ * of a version is alive the publisher will not free that version. Keep snapshots short lived;
+ * to hold on to a config copy the ConfigMap out instead, which is O(1).
+ */
+class ConfigSnapshot {
+public:
+    ConfigSnapshot(const ConfigSnapshot&) = delete;
+
+    ConfigSnapshot& operator=(const ConfigSnapshot&) = delete;
+
+    ConfigSnapshot(ConfigSnapshot&& rhs) noexcept;
+
+    ConfigSnapshot& operator=(ConfigSnapshot&& rhs) noexcept;
+
+    ~ConfigSnapshot();
+
+    [[nodiscard]] const ConfigMap& operator*() const
+    {
+        return *map;
+    }
+
+    [[nodiscard]] const ConfigMap* operator->() const
+    {
+        return map;
+    }
+
+private:
+    friend class ConfigPublisher;
+
+    ConfigSnapshot(const ConfigMap* map, detail::ReaderSlot* slot);
+
+    void unpin();
+
+    const ConfigMap* map;
+
+    detail::ReaderSlot* slot;
+};
+
+/*
+ * Single-writer, many-reader publication of ConfigMaps with epoch-based reclamation. A reader
+ * claims a slot, records the current epoch in it and loads the current pointer; no lock is
+ * taken and no reference count is touched. A writer swaps the pointer, advances the epoch and
+ * frees replaced versions once no slot is pinned at or before the epoch they were replaced in.
+ */
+class ConfigPublisher {
+public:
+    static constexpr size_t max_readers = 64;
+
+    explicit ConfigPublisher(ConfigMap initial = ConfigMap{});
+
+    ConfigPublisher(const ConfigPublisher&) = delete;
+
+    ConfigPublisher& operator=(const ConfigPublisher&) = delete;
+
+    // All snapshots must have been released.
+    ~ConfigPublisher();
+
+    // Wait-free unless more than max_readers snapshots are alive at once, in which case it spins.
+    [[nodiscard]] ConfigSnapshot read() const;
+
+    void publish(ConfigMap config);
+
+    // Frees replaced versions no reader can still see; publish() does this as well.
+    void collect();
+
+    // Replaced versions still waiting for their readers to finish.
+    [[nodiscard]] size_t retired_count() const;
+
+private:
+    struct Retired
+    {
+        std::unique_ptr<const ConfigMap> map;
+        uint64_t epoch;
+    };
+
+    [[nodiscard]] detail::ReaderSlot& claim_slot() const;
+
+    void collect_locked();
+
+    std::atomic<const ConfigMap*> current;
+
+    std::atomic<uint64_t> epoch;
+
+    mutable std::array<detail::ReaderSlot, max_readers> slots;
+
+    mutable std::mutex writer_mutex;
+
+    std::vector<Retired> retired;
+};
+
+} // namespace samos::config_manager
+
+#endif
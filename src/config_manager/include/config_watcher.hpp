@@ -0,0 +1,101 @@
+#ifndef SAMOS_CONFIG_WATCHER_HPP
+#define SAMOS_CONFIG_WATCHER_HPP
+
+#include "config_layers.hpp"
+#include "config_manager.hpp"
+#include "config_snapshot.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace samos::config_manager
+{
+
+/*
+ * Keeps a config file loaded while it is edited. A background thread waits on inotify for the
+ * file to be rewritten, reloads it, checks each value against the type of its default and
+ * publishes the result through a ConfigPublisher, so readers on any thread take no lock.
+ * A file that fails to load or validate leaves the previous config published. Given layers,
+ * every file layer is watched and any change re-resolves the whole stack.
+ */
+class ConfigWatcher {
+public:
+    // Called on the watcher thread with the property's new value, only when it changed.
+    using Callback = std::function<void(const ConfigRef& value)>;
+
+    ConfigWatcher(ConfigNest root, std::string filename, std::shared_ptr<const ConfigCache> cache = nullptr);
+
+    explicit ConfigWatcher(ConfigLayers layers);
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    ~ConfigWatcher();
+
+    /*
+     * Loads the file on the calling thread, falling back to the defaults if it cannot be loaded,
+     * then starts watching its directory. Only a failure to start watching is returned.
+     */
+    [[nodiscard]] ConfigResult<> start();
+
+    void stop();
+
+    [[nodiscard]] ConfigSnapshot current() const;
+
+    // Number of configs published so far, including the first.
+    [[nodiscard]] uint64_t get_generation() const;
+
+    void on_change(std::string key, Callback callback);
+
+    // Loads, validates and publishes the file now; the watcher thread calls this on each change.
+    ConfigResult<> reload();
+
+private:
+    void watch_loop();
+
+    [[nodiscard]] ConfigResult<ConfigMap> load();
+
+    void publish(const ConfigMap& config);
+
+    ConfigManager manager;
+
+    std::optional<ConfigLayers> layers;
+
+    ConfigMap defaults;
+
+    std::vector<std::string> filenames;
+
+    ConfigPublisher published;
+
+    std::atomic<uint64_t> generation;
+
+    // Serializes reloads and guards callbacks and latest.
+    std::mutex reload_mutex;
+
+    // What was last published, kept by the writer to diff reloads against without pinning.
+    ConfigMap latest;
+
+    std::vector<std::pair<std::string, Callback>> callbacks;
+
+    int inotify_fd;
+
+    // Watch descriptor of each file's directory, with the file's name within it.
+    std::vector<std::pair<int, std::string>> watched;
+
+    int stop_pipe[2];
+
+    std::thread watcher;
+};
+
+} // namespace samos::config_manager
+
+#endif
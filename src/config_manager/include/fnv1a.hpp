@@ -0,0 +1,39 @@
+#ifndef SAMOS_FNV1A_HPP
+#define SAMOS_FNV1A_HPP
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace samos::config_manager
+{
+
+constexpr uint64_t fnv1a_offset = 14695981039346656037ULL;
+
+constexpr uint64_t fnv1a_prime = 1099511628211ULL;
+
+constexpr uint64_t fnv1a(std::string_view data, uint64_t hash = fnv1a_offset)
+{
+    for (char byte : data)
+    {
+        hash ^= static_cast<uint8_t>(byte);
+        hash *= fnv1a_prime;
+    }
+
+    return hash;
+}
+
+constexpr uint64_t fnv1a(std::span<const uint8_t> data, uint64_t hash = fnv1a_offset)
+{
+    for (uint8_t byte : data)
+    {
+        hash ^= byte;
+        hash *= fnv1a_prime;
+    }
+
+    return hash;
+}
+
+} // namespace samos::config_manager
+
+#endif
@@ -0,0 +1,432 @@
+#include "config_arena.hpp"
+#include "fnv1a.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace samos::config_manager::detail
+{
+
+namespace
+{
+
+constexpr size_t initial_slots = 16;
+
+uint64_t mix(uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+uint64_t child_hash(uint32_t parent, uint32_t key)
+{
+    return mix((static_cast<uint64_t>(parent) << 32) | key);
+}
+
+} // namespace
+
+ConfigArena::ConfigArena()
+    :
+    nodes{},
+    text{},
+    keys{},
+    key_slots(initial_slots, 0),
+    child_slots(initial_slots, ChildSlot{0, 0, empty_slot}),
+    child_slots_used{0}
+{
+}
+
+uint32_t ConfigArena::make_root()
+{
+    ConfigNode root{};
+    root.key = npos;
+    root.parent = npos;
+    root.first_child = npos;
+    root.last_child = npos;
+    root.next_sibling = npos;
+    root.kind = ConfigNodeKind::Map;
+
+    nodes.push_back(root);
+
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+uint32_t ConfigArena::find_key(std::string_view key) const
+{
+    return find_key(key, fnv1a(key));
+}
+
+uint32_t ConfigArena::find_key(std::string_view key, uint64_t key_hash) const
+{
+    size_t mask = key_slots.size() - 1;
+
+    for (size_t idx = key_hash & mask; key_slots[idx] != 0; idx = (idx + 1) & mask)
+    {
+        const auto& span = keys[key_slots[idx] - 1];
+        if (std::string_view{text.data() + span.offset, span.size} == key)
+        {
+            return key_slots[idx] - 1;
+        }
+    }
+
+    return npos;
+}
+
+uint32_t ConfigArena::intern(std::string_view key)
+{
+    uint32_t key_id = find_key(key);
+
+    if (key_id != npos)
+    {
+        return key_id;
+    }
+
+    if ((keys.size() + 1) * 2 > key_slots.size())
+    {
+        grow_key_slots();
+    }
+
+    key_id = static_cast<uint32_t>(keys.size());
+    keys.push_back(append_text(key));
+
+    size_t mask = key_slots.size() - 1;
+    size_t idx = fnv1a(key) & mask;
+
+    while (key_slots[idx] != 0)
+    {
+        idx = (idx + 1) & mask;
+    }
+    key_slots[idx] = key_id + 1;
+
+    return key_id;
+}
+
+void ConfigArena::grow_key_slots()
+{
+    std::vector<uint32_t> grown(key_slots.size() * 2, 0);
+    size_t mask = grown.size() - 1;
+
+    for (uint32_t key_id = 0; key_id < keys.size(); ++key_id)
+    {
+        const auto& span = keys[key_id];
+        size_t idx = fnv1a(std::string_view{text.data() + span.offset, span.size}) & mask;
+
+        while (grown[idx] != 0)
+        {
+            idx = (idx + 1) & mask;
+        }
+        grown[idx] = key_id + 1;
+    }
+
+    key_slots = std::move(grown);
+}
+
+size_t ConfigArena::child_slot_index(uint32_t parent, uint32_t key) const
+{
+    size_t mask = child_slots.size() - 1;
+
+    for (size_t idx = child_hash(parent, key) & mask; child_slots[idx].node != empty_slot; idx = (idx + 1) & mask)
+    {
+        const auto& slot = child_slots[idx];
+        if (slot.node != tombstone && slot.parent == parent && slot.key == key)
+        {
+            return idx;
+        }
+    }
+
+    return child_slots.size();
+}
+
+void ConfigArena::insert_child_slot(uint32_t parent, uint32_t key, uint32_t node)
+{
+    if ((child_slots_used + 1) * 2 > child_slots.size())
+    {
+        grow_child_slots();
+    }
+
+    size_t mask = child_slots.size() - 1;
+    size_t idx = child_hash(parent, key) & mask;
+
+    while (child_slots[idx].node != empty_slot && child_slots[idx].node != tombstone)
+    {
+        idx = (idx + 1) & mask;
+    }
+
+    if (child_slots[idx].node == empty_slot)
+    {
+        ++child_slots_used;
+    }
+    child_slots[idx] = ChildSlot{parent, key, node};
+}
+
+void ConfigArena::erase_child_slot(uint32_t parent, uint32_t key)
+{
+    size_t idx = child_slot_index(parent, key);
+
+    assert(idx < child_slots.size());
+    child_slots[idx].node = tombstone;
+}
+
+void ConfigArena::grow_child_slots()
+{
+    size_t live = 0;
+
+    for (const auto& slot : child_slots)
+    {
+        if (slot.node != empty_slot && slot.node != tombstone)
+        {
+            ++live;
+        }
+    }
+
+    // Rehashing also drops tombstones, so a table full of removals is rebuilt at its current size.
+    size_t size = initial_slots;
+    while ((live + 1) * 4 > size)
+    {
+        size *= 2;
+    }
+
+    std::vector<ChildSlot> old = std::move(child_slots);
+    child_slots.assign(size, ChildSlot{0, 0, empty_slot});
+    child_slots_used = 0;
+
+    for (const auto& slot : old)
+    {
+        if (slot.node != empty_slot && slot.node != tombstone)
+        {
+            insert_child_slot(slot.parent, slot.key, slot.node);
+        }
+    }
+}
+
+uint32_t ConfigArena::find_child(uint32_t parent, std::string_view key) const
+{
+    return find_child(parent, key, fnv1a(key));
+}
+
+uint32_t ConfigArena::find_child(uint32_t parent, std::string_view key, uint64_t key_hash) const
+{
+    uint32_t key_id = find_key(key, key_hash);
+
+    if (key_id == npos)
+    {
+        return npos;
+    }
+
+    size_t idx = child_slot_index(parent, key_id);
+
+    return idx < child_slots.size() ? child_slots[idx].node : npos;
+}
+
+uint32_t ConfigArena::add_child(uint32_t parent, std::string_view key)
+{
+    assert(find_child(parent, key) == npos);
+
+    uint32_t key_id = intern(key);
+    uint32_t node = make_root();
+
+    nodes[node].key = key_id;
+    nodes[node].parent = parent;
+
+    if (nodes[parent].last_child == npos)
+    {
+        nodes[parent].first_child = node;
+    }
+    else
+    {
+        nodes[nodes[parent].last_child].next_sibling = node;
+    }
+    nodes[parent].last_child = node;
+
+    insert_child_slot(parent, key_id, node);
+
+    return node;
+}
+
+void ConfigArena::remove_child(uint32_t node)
+{
+    uint32_t parent = nodes[node].parent;
+    uint32_t prev = npos;
+
+    clear_children(node);
+    erase_child_slot(parent, nodes[node].key);
+
+    for (uint32_t child = nodes[parent].first_child; child != node; child = nodes[child].next_sibling)
+    {
+        prev = child;
+    }
+
+    if (prev == npos)
+    {
+        nodes[parent].first_child = nodes[node].next_sibling;
+    }
+    else
+    {
+        nodes[prev].next_sibling = nodes[node].next_sibling;
+    }
+
+    if (nodes[parent].last_child == node)
+    {
+        nodes[parent].last_child = prev;
+    }
+}
+
+void ConfigArena::clear_children(uint32_t node)
+{
+    for (uint32_t child = nodes[node].first_child; child != npos; child = nodes[child].next_sibling)
+    {
+        clear_children(child);
+        erase_child_slot(node, nodes[child].key);
+    }
+
+    nodes[node].first_child = npos;
+    nodes[node].last_child = npos;
+}
+
+TextSpan ConfigArena::append_text(std::string_view value)
+{
+    TextSpan span{static_cast<uint32_t>(text.size()), static_cast<uint32_t>(value.size())};
+
+    text.append(value);
+
+    return span;
+}
+
+void ConfigArena::set_text(uint32_t node, std::string_view value, ConfigNodeKind kind)
+{
+    if (value.size() <= small_text_capacity)
+    {
+        std::memcpy(nodes[node].small, value.data(), value.size());
+        nodes[node].small_size = static_cast<uint8_t>(value.size());
+    }
+    else
+    {
+        nodes[node].pooled = append_text(value);
+        nodes[node].small_size = pooled_text;
+    }
+
+    nodes[node].kind = kind;
+}
+
+void ConfigArena::set_scalar(uint32_t node, const scheme::SexpCppValue& value)
+{
+    assert(nodes[node].first_child == npos);
+
+    if (std::holds_alternative<bool>(value))
+    {
+        nodes[node].kind = ConfigNodeKind::Bool;
+        nodes[node].boolean = std::get<bool>(value);
+    }
+    else if (std::holds_alternative<int>(value))
+    {
+        nodes[node].kind = ConfigNodeKind::Int;
+        nodes[node].integer = std::get<int>(value);
+    }
+    else if (std::holds_alternative<double>(value))
+    {
+        nodes[node].kind = ConfigNodeKind::Double;
+        nodes[node].flonum = std::get<double>(value);
+    }
+    else if (std::holds_alternative<std::string>(value))
+    {
+        set_text(node, std::get<std::string>(value), ConfigNodeKind::String);
+    }
+    else
+    {
+        assert(std::holds_alternative<scheme::Symbol>(value));
+        set_text(node, std::get<scheme::Symbol>(value), ConfigNodeKind::Symbol);
+    }
+}
+
+scheme::SexpCppValue ConfigArena::get_scalar(uint32_t node) const
+{
+    const auto& config_node = nodes[node];
+
+    switch (config_node.kind)
+    {
+    case ConfigNodeKind::Bool:
+        return scheme::SexpCppValue{config_node.boolean};
+
+    case ConfigNodeKind::Int:
+        return scheme::SexpCppValue{config_node.integer};
+
+    case ConfigNodeKind::Double:
+        return scheme::SexpCppValue{config_node.flonum};
+
+    case ConfigNodeKind::String:
+        return scheme::SexpCppValue{std::string{text_of(node)}};
+
+    case ConfigNodeKind::Symbol:
+    {
+        auto symbol = text_of(node);
+        return scheme::SexpCppValue{scheme::Symbol{symbol.data(), symbol.size()}};
+    }
+
+    default:
+        assert(false && "get_scalar on a map node");
+        return scheme::SexpCppValue{false};
+    }
+}
+
+std::string_view ConfigArena::key_of(uint32_t node) const
+{
+    const auto& span = keys[nodes[node].key];
+
+    return std::string_view{text.data() + span.offset, span.size};
+}
+
+std::string_view ConfigArena::text_of(uint32_t node) const
+{
+    const auto& config_node = nodes[node];
+
+    if (config_node.small_size == pooled_text)
+    {
+        return std::string_view{text.data() + config_node.pooled.offset, config_node.pooled.size};
+    }
+
+    return std::string_view{config_node.small, config_node.small_size};
+}
+
+void ConfigArena::copy_children(const ConfigArena& from, uint32_t from_node, uint32_t to_node)
+{
+    assert(&from != this);
+
+    for (uint32_t child = from.nodes[from_node].first_child; child != npos; child = from.nodes[child].next_sibling)
+    {
+        uint32_t copy = add_child(to_node, from.key_of(child));
+        const auto& source = from.nodes[child];
+
+        switch (source.kind)
+        {
+        case ConfigNodeKind::Map:
+            copy_children(from, child, copy);
+            break;
+
+        case ConfigNodeKind::Bool:
+            nodes[copy].kind = source.kind;
+            nodes[copy].boolean = source.boolean;
+            break;
+
+        case ConfigNodeKind::Int:
+            nodes[copy].kind = source.kind;
+            nodes[copy].integer = source.integer;
+            break;
+
+        case ConfigNodeKind::Double:
+            nodes[copy].kind = source.kind;
+            nodes[copy].flonum = source.flonum;
+            break;
+
+        case ConfigNodeKind::String:
+        case ConfigNodeKind::Symbol:
+            set_text(copy, from.text_of(child), source.kind);
+            break;
+        }
+    }
+}
+
+} // namespace samos::config_manager::detail
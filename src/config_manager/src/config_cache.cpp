@@ -0,0 +1,391 @@
+#include "config_cache.hpp"
+#include "logger.hpp"
+
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+namespace samos::config_manager
+{
+
+using log::logger::log;
+using log::logger::LogLevel;
+
+namespace
+{
+
+enum class ConfigKind : uint8_t
+{
+    Bool = 0,
+    Int = 1,
+    Double = 2,
+    String = 3,
+    Symbol = 4,
+    Map = 5,
+};
+
+constexpr uint8_t cache_magic[2] = {'S', 'C'};
+
+constexpr uint8_t cache_version = 1;
+
+// Bounds recursion when decoding a corrupt or hostile entry.
+constexpr int max_map_depth = 64;
+
+void encode_map(const ConfigMap& map, scheme::ByteWriter& writer)
+{
+    writer.varint(map.size());
+
+    for (const auto& key : map.keys())
+    {
+        auto value = map.ref_property(key).get_ok();
+        writer.string(key);
+
+        if (value.is_map())
+        {
+            writer.u8(static_cast<uint8_t>(ConfigKind::Map));
+            encode_map(std::get<ConfigMap>(value.to_value()), writer);
+        }
+        else if (auto flag = value.get_bool())
+        {
+            writer.u8(static_cast<uint8_t>(ConfigKind::Bool));
+            writer.u8(flag.value() ? 1 : 0);
+        }
+        else if (auto integer = value.get_int())
+        {
+            writer.u8(static_cast<uint8_t>(ConfigKind::Int));
+            writer.svarint(integer.value());
+        }
+        else if (auto flonum = value.get_double())
+        {
+            writer.u8(static_cast<uint8_t>(ConfigKind::Double));
+            writer.f64(flonum.value());
+        }
+        else if (auto text = value.get_string())
+        {
+            writer.u8(static_cast<uint8_t>(ConfigKind::String));
+            writer.string(text.value());
+        }
+        else
+        {
+            assert(value.get_symbol().has_value());
+            writer.u8(static_cast<uint8_t>(ConfigKind::Symbol));
+            writer.string(value.get_symbol().value());
+        }
+    }
+}
+
+std::optional<ConfigMap> decode_map(scheme::ByteReader& reader, int depth)
+{
+    if (depth > max_map_depth)
+    {
+        return {};
+    }
+
+    auto count = reader.varint();
+    if (!count.has_value())
+    {
+        return {};
+    }
+
+    ConfigMap map;
+
+    for (uint64_t idx = 0; idx < count.value(); ++idx)
+    {
+        auto key = reader.string();
+        auto kind = reader.u8();
+        if (!key.has_value() || !kind.has_value())
+        {
+            return {};
+        }
+
+        std::optional<ConfigValue> value;
+
+        switch (static_cast<ConfigKind>(kind.value()))
+        {
+        case ConfigKind::Bool:
+        {
+            auto flag = reader.u8();
+            if (flag.has_value() && flag.value() <= 1)
+            {
+                value = ConfigValue{scheme::SexpCppValue{flag.value() == 1}};
+            }
+            break;
+        }
+        case ConfigKind::Int:
+        {
+            auto number = reader.svarint();
+            if (number.has_value())
+            {
+                value = ConfigValue{scheme::SexpCppValue{static_cast<int>(number.value())}};
+            }
+            break;
+        }
+        case ConfigKind::Double:
+        {
+            auto number = reader.f64();
+            if (number.has_value())
+            {
+                value = ConfigValue{scheme::SexpCppValue{number.value()}};
+            }
+            break;
+        }
+        case ConfigKind::String:
+        {
+            auto text = reader.string();
+            if (text.has_value())
+            {
+                value = ConfigValue{scheme::SexpCppValue{std::string{text.value()}}};
+            }
+            break;
+        }
+        case ConfigKind::Symbol:
+        {
+            auto text = reader.string();
+            if (text.has_value())
+            {
+                value = ConfigValue{scheme::SexpCppValue{scheme::Symbol{text->data(), text->size()}}};
+            }
+            break;
+        }
+        case ConfigKind::Map:
+        {
+            auto nested = decode_map(reader, depth + 1);
+            if (nested.has_value())
+            {
+                value = ConfigValue{std::move(nested.value())};
+            }
+            break;
+        }
+        }
+
+        if (!value.has_value())
+        {
+            return {};
+        }
+
+        auto res = map.register_property(key.value(), std::move(value.value()));
+        if (res.is_err())
+        {
+            return {};
+        }
+    }
+
+    return map;
+}
+
+std::optional<std::vector<uint8_t>> read_file(const std::filesystem::path& path)
+{
+    std::ifstream file{path, std::ios::binary};
+
+    if (!file)
+    {
+        return {};
+    }
+
+    std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (file.bad())
+    {
+        return {};
+    }
+
+    return contents;
+}
+
+} // namespace
+
+void encode_config_map(const ConfigMap& map, scheme::DatumBytes& out)
+{
+    scheme::ByteWriter writer{out};
+    encode_map(map, writer);
+}
+
+std::optional<ConfigMap> decode_config_map(std::span<const uint8_t> bytes)
+{
+    scheme::ByteReader reader{bytes};
+    auto map = decode_map(reader, 0);
+
+    if (reader.remaining() != 0)
+    {
+        return {};
+    }
+
+    return map;
+}
+
+ConfigCache::ConfigCache()
+    :
+    cache_dir{default_cache_dir()}
+{
+}
+
+ConfigCache::ConfigCache(std::filesystem::path cache_dir)
+    :
+    cache_dir{std::move(cache_dir)}
+{
+}
+
+std::filesystem::path ConfigCache::default_cache_dir()
+{
+    const char* xdg_cache = std::getenv("XDG_CACHE_HOME");
+
+    if (xdg_cache != nullptr && xdg_cache[0] != '\0')
+    {
+        return std::filesystem::path{xdg_cache} / "samos";
+    }
+
+    const char* home = std::getenv("HOME");
+
+    if (home != nullptr && home[0] != '\0')
+    {
+        return std::filesystem::path{home} / ".cache" / "samos";
+    }
+
+    return std::filesystem::temp_directory_path() / "samos";
+}
+
+uint64_t ConfigCache::fingerprint(const ConfigNest& nest)
+{
+    scheme::DatumBytes defaults;
+    encode_config_map(nest.get_default_map(), defaults);
+
+    return fnv1a(defaults, fnv1a(nest.get_name()));
+}
+
+std::optional<SourceStamp> ConfigCache::stamp(const std::string& source)
+{
+    std::error_code ec;
+    auto path = std::filesystem::weakly_canonical(source, ec);
+
+    if (ec)
+    {
+        return {};
+    }
+
+    auto mtime = std::filesystem::last_write_time(path, ec);
+
+    if (ec)
+    {
+        return {};
+    }
+
+    auto contents = read_file(path);
+
+    if (!contents.has_value())
+    {
+        return {};
+    }
+
+    return SourceStamp{
+        path.string(),
+        static_cast<int64_t>(mtime.time_since_epoch().count()),
+        contents->size(),
+        fnv1a(contents.value())};
+}
+
+std::optional<ConfigMap> ConfigCache::load(const SourceStamp& source, uint64_t nest_fingerprint) const
+{
+    auto entry = read_file(entry_path(source));
+
+    if (!entry.has_value())
+    {
+        return {};
+    }
+
+    scheme::ByteReader reader{entry.value()};
+    auto magic0 = reader.u8();
+    auto magic1 = reader.u8();
+    auto version = reader.u8();
+
+    if (magic0 != cache_magic[0] || magic1 != cache_magic[1] || version != cache_version)
+    {
+        return {};
+    }
+
+    auto path = reader.string();
+    auto mtime = reader.svarint();
+    auto size = reader.varint();
+    auto content_hash = reader.varint();
+    auto entry_fingerprint = reader.varint();
+
+    if (!path.has_value() || !mtime.has_value() || !size.has_value() || !content_hash.has_value())
+    {
+        return {};
+    }
+
+    SourceStamp entry_stamp{std::string{path.value()}, mtime.value(), size.value(), content_hash.value()};
+
+    if (entry_stamp != source || entry_fingerprint != nest_fingerprint)
+    {
+        log<LogLevel::Debug>("{} Config cache entry for {} is stale", __LINE__, source.path);
+        return {};
+    }
+
+    return decode_config_map(reader.bytes(reader.remaining()).value());
+}
+
+ConfigResult<> ConfigCache::store(
+    const SourceStamp& source,
+    uint64_t nest_fingerprint,
+    const ConfigMap& map) const
+{
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+
+    if (ec)
+    {
+        return ConfigResult<>::err(CacheError{fmt::format("creating {}: {}", cache_dir.string(), ec.message())});
+    }
+
+    scheme::DatumBytes entry;
+    scheme::ByteWriter writer{entry};
+
+    writer.bytes(cache_magic, sizeof(cache_magic));
+    writer.u8(cache_version);
+    writer.string(source.path);
+    writer.svarint(source.mtime);
+    writer.varint(source.size);
+    writer.varint(source.content_hash);
+    writer.varint(nest_fingerprint);
+    encode_map(map, writer);
+
+    // Write beside the entry and rename over it so concurrent readers never see a partial file.
+    auto path = entry_path(source);
+    auto tmp_path = path;
+    tmp_path += fmt::format(".{}.tmp", ::getpid());
+
+    {
+        std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+        file.write(reinterpret_cast<const char*>(entry.data()), static_cast<std::streamsize>(entry.size()));
+
+        if (!file)
+        {
+            std::filesystem::remove(tmp_path, ec);
+            return ConfigResult<>::err(CacheError{fmt::format("writing {}", tmp_path.string())});
+        }
+    }
+
+    std::filesystem::rename(tmp_path, path, ec);
+
+    if (ec)
+    {
+        std::filesystem::remove(tmp_path, ec);
+        return ConfigResult<>::err(CacheError{fmt::format("replacing {}: {}", path.string(), ec.message())});
+    }
+
+    return ConfigResult<>::ok({});
+}
+
+const std::filesystem::path& ConfigCache::get_cache_dir() const
+{
+    return cache_dir;
+}
+
+std::filesystem::path ConfigCache::entry_path(const SourceStamp& source) const
+{
+    return cache_dir / fmt::format("{:016x}.cfgcache", fnv1a(source.path));
+}
+
+} // namespace samos::config_manager
@@ -0,0 +1,380 @@
+#include "config_layers.hpp"
+#include "logger.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <filesystem>
+
+namespace samos::config_manager
+{
+
+using log::logger::log;
+using log::logger::LogLevel;
+
+namespace
+{
+
+std::optional<bool> parse_bool(std::string_view text)
+{
+    for (auto truthy : {"#t", "#true", "true", "1", "yes", "on"})
+    {
+        if (text == truthy)
+        {
+            return true;
+        }
+    }
+
+    for (auto falsy : {"#f", "#false", "false", "0", "no", "off"})
+    {
+        if (text == falsy)
+        {
+            return false;
+        }
+    }
+
+    return {};
+}
+
+template <typename T>
+std::optional<T> parse_number(std::string_view text)
+{
+    T value{};
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+    if (ec != std::errc{} || end != text.data() + text.size())
+    {
+        return {};
+    }
+
+    return value;
+}
+
+// Parses text as the type of the value it replaces.
+ConfigResult<scheme::SexpCppValue> parse_override(const ConfigRef& current, const std::string& path, std::string_view text)
+{
+    using ValueResult = ConfigResult<scheme::SexpCppValue>;
+    auto mismatch = [&](std::string_view expected)
+    {
+        return ValueResult::err(FieldTypeError{path, expected});
+    };
+
+    if (current.get_bool().has_value())
+    {
+        auto value = parse_bool(text);
+        return value.has_value() ? ValueResult::ok(scheme::SexpCppValue{value.value()}) : mismatch("bool");
+    }
+    else if (current.get_int().has_value())
+    {
+        auto value = parse_number<int>(text);
+        return value.has_value() ? ValueResult::ok(scheme::SexpCppValue{value.value()}) : mismatch("int");
+    }
+    else if (current.get_double().has_value())
+    {
+        auto value = parse_number<double>(text);
+        return value.has_value() ? ValueResult::ok(scheme::SexpCppValue{value.value()}) : mismatch("double");
+    }
+    else if (current.get_string().has_value())
+    {
+        return ValueResult::ok(scheme::SexpCppValue{std::string{text}});
+    }
+    else if (current.get_symbol().has_value() && !text.empty())
+    {
+        return ValueResult::ok(scheme::SexpCppValue{scheme::Symbol{text.data(), text.size()}});
+    }
+
+    return mismatch(current.is_map() ? "scalar" : "symbol");
+}
+
+void collect_leaf_paths(const ConfigMap& map, const std::string& prefix, std::vector<std::string>& paths)
+{
+    for (auto key : map.keys())
+    {
+        std::string path = prefix + std::string{key};
+
+        if (map.property_is_nested_map(key).get_ok())
+        {
+            collect_leaf_paths(std::get<ConfigMap>(map.copy_property(key).get_ok()), path + ".", paths);
+        }
+        else
+        {
+            paths.push_back(std::move(path));
+        }
+    }
+}
+
+std::string env_name(const std::string& prefix, const std::string& path)
+{
+    std::string name = prefix + "_";
+
+    for (char character : path)
+    {
+        bool separator = character == '-' || character == '.';
+        name.push_back(separator ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(character))));
+    }
+
+    return name;
+}
+
+} // namespace
+
+std::string_view source_name(ConfigSource source)
+{
+    switch (source)
+    {
+    case ConfigSource::Default:
+        return "default";
+    case ConfigSource::SystemFile:
+        return "system file";
+    case ConfigSource::UserFile:
+        return "user file";
+    case ConfigSource::Environment:
+        return "environment";
+    case ConfigSource::CommandLine:
+        return "command line";
+    }
+
+    return "unknown";
+}
+
+ResolvedConfig::ResolvedConfig(ConfigMap map, std::unordered_map<std::string, ConfigSource> provenance)
+    :
+    map{std::move(map)},
+    provenance{std::move(provenance)}
+{
+}
+
+const ConfigMap& ResolvedConfig::get_map() const
+{
+    return map;
+}
+
+ConfigSource ResolvedConfig::source_of(const std::string& path) const
+{
+    auto found = provenance.find(path);
+
+    return found == provenance.end() ? ConfigSource::Default : found->second;
+}
+
+ConfigLayers::ConfigLayers(ConfigNest root)
+    :
+    root{std::move(root)},
+    files{},
+    env_prefix{},
+    assignments{},
+    owned_schemer{}
+{
+}
+
+ConfigLayers::ConfigLayers(ConfigLayers&&) noexcept = default;
+
+ConfigLayers& ConfigLayers::operator=(ConfigLayers&&) noexcept = default;
+
+ConfigLayers::~ConfigLayers()
+{
+}
+
+std::filesystem::path ConfigLayers::default_user_dir()
+{
+    const char* xdg_config = std::getenv("XDG_CONFIG_HOME");
+
+    if (xdg_config != nullptr && xdg_config[0] != '\0')
+    {
+        return std::filesystem::path{xdg_config} / "samos";
+    }
+
+    const char* home = std::getenv("HOME");
+
+    if (home != nullptr && home[0] != '\0')
+    {
+        return std::filesystem::path{home} / ".config" / "samos";
+    }
+
+    return std::filesystem::current_path();
+}
+
+ConfigLayers& ConfigLayers::add_file(ConfigSource source, std::string filename)
+{
+    files.push_back({source, std::move(filename)});
+    return *this;
+}
+
+ConfigLayers& ConfigLayers::add_environment(std::string prefix)
+{
+    env_prefix = std::move(prefix);
+    return *this;
+}
+
+ConfigLayers& ConfigLayers::add_assignments(std::vector<std::string> new_assignments)
+{
+    for (auto& assignment : new_assignments)
+    {
+        assignments.push_back(std::move(assignment));
+    }
+    return *this;
+}
+
+ConfigResult<ResolvedConfig> ConfigLayers::resolve(scheme::Schemer& schemer) const
+{
+    using ResolvedResult = ConfigResult<ResolvedConfig>;
+    const ConfigMap& defaults = root.get_default_map();
+    ConfigMap map = defaults;
+    std::unordered_map<std::string, ConfigSource> provenance;
+
+    for (const auto& layer : files)
+    {
+        std::error_code ec;
+
+        if (!std::filesystem::exists(layer.filename, ec))
+        {
+            log<LogLevel::Debug>("{} Skipping missing {} {}", __LINE__, source_name(layer.source), layer.filename);
+            continue;
+        }
+
+        auto read_res = schemer.read_from_file(layer.filename);
+
+        if (read_res.is_err())
+        {
+            return ResolvedResult::err(read_res.get_err());
+        }
+
+        sexp config_alist = read_res.get_ok();
+        schemer.preserve(config_alist);
+        auto nest_res = schemer.assq(root.get_name(), config_alist);
+        sexp nest_alist = nest_res.is_ok() ? nest_res.get_ok() : SEXP_NULL;
+
+        if (nest_res.is_ok() && schemer.sexp_type(nest_alist) == scheme::SexpType::Pair)
+        {
+            auto load_res = map.load_from_sexp(
+                nest_alist,
+                schemer,
+                [&](std::string_view path) { provenance[std::string{path}] = layer.source; });
+
+            if (load_res.is_err())
+            {
+                schemer.release(config_alist);
+                return ResolvedResult::err(load_res.get_err());
+            }
+        }
+        else
+        {
+            log<LogLevel::Debug>("{} No {} section in {}", __LINE__, root.get_name(), layer.filename);
+        }
+
+        schemer.release(config_alist);
+    }
+
+    auto check_res = map.conform_types(defaults);
+
+    if (check_res.is_err())
+    {
+        return ResolvedResult::err(check_res.get_err());
+    }
+
+    auto apply = [&](const std::string& path, std::string_view text, ConfigSource source)
+    {
+        auto current_res = map.ref_path(path);
+
+        if (current_res.is_err())
+        {
+            return ConfigResult<>::err(OverrideError{fmt::format("no config key {}.{}", root.get_name(), path)});
+        }
+
+        auto value_res = parse_override(current_res.get_ok(), path, text);
+
+        if (value_res.is_err())
+        {
+            return ConfigResult<>::err(value_res.get_err());
+        }
+
+        auto set_res = map.set_path(path, std::move(value_res.get_ok()));
+
+        if (set_res.is_ok())
+        {
+            provenance[path] = source;
+        }
+
+        return set_res;
+    };
+
+    if (!env_prefix.empty())
+    {
+        std::vector<std::string> paths;
+        collect_leaf_paths(defaults, "", paths);
+
+        for (const auto& path : paths)
+        {
+            const char* value = std::getenv(env_name(env_prefix, path).c_str());
+
+            if (value == nullptr)
+            {
+                continue;
+            }
+
+            auto res = apply(path, value, ConfigSource::Environment);
+
+            if (res.is_err())
+            {
+                return ResolvedResult::err(res.get_err());
+            }
+        }
+    }
+
+    std::string nest_prefix = root.get_name() + ".";
+
+    for (const auto& assignment : assignments)
+    {
+        auto equals = assignment.find('=');
+
+        if (equals == std::string::npos)
+        {
+            return ResolvedResult::err(OverrideError{fmt::format("expected key=value, got {}", assignment)});
+        }
+
+        std::string_view key{assignment.data(), equals};
+
+        if (!key.starts_with(nest_prefix))
+        {
+            continue;
+        }
+
+        key.remove_prefix(nest_prefix.size());
+        auto res = apply(std::string{key}, std::string_view{assignment}.substr(equals + 1), ConfigSource::CommandLine);
+
+        if (res.is_err())
+        {
+            return ResolvedResult::err(res.get_err());
+        }
+    }
+
+    return ResolvedResult::ok(ResolvedConfig{std::move(map), std::move(provenance)});
+}
+
+ConfigResult<ResolvedConfig> ConfigLayers::resolve()
+{
+    if (!owned_schemer)
+    {
+        owned_schemer = std::make_unique<scheme::Schemer>(scheme::SchemerEnv::ReaderOnly);
+    }
+
+    return resolve(*owned_schemer);
+}
+
+const ConfigNest& ConfigLayers::get_root() const
+{
+    return root;
+}
+
+std::vector<std::string> ConfigLayers::get_files() const
+{
+    std::vector<std::string> filenames;
+
+    for (const auto& layer : files)
+    {
+        filenames.push_back(layer.filename);
+    }
+
+    return filenames;
+}
+
+} // namespace samos::config_manager
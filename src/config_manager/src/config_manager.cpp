@@ -1,4 +1,5 @@
 #include "config_manager.hpp"
+#include "config_cache.hpp"
 #include "logger.hpp"
 
 namespace samos::config_manager
@@ -7,101 +8,361 @@ namespace samos::config_manager
 using log::logger::log;
 using log::logger::LogLevel;
 
-ConfigMap::ConfigMap()
-    :
-    config_map{},
-    config_keys{}
+// Bounds recursion on pathologically nested config files.
+constexpr int max_load_depth = 64;
+
+namespace
 {
+
+std::string_view kind_name(detail::ConfigNodeKind kind)
+{
+    switch (kind)
+    {
+    case detail::ConfigNodeKind::Map:
+        return "map";
+    case detail::ConfigNodeKind::Bool:
+        return "bool";
+    case detail::ConfigNodeKind::Int:
+        return "int";
+    case detail::ConfigNodeKind::Double:
+        return "double";
+    case detail::ConfigNodeKind::String:
+        return "string";
+    case detail::ConfigNodeKind::Symbol:
+        return "symbol";
+    }
+
+    return "unknown";
 }
 
-ConfigMap::~ConfigMap()
+size_t child_count(const detail::ConfigArena& arena, uint32_t node)
 {
+    size_t count = 0;
+
+    for (uint32_t child = arena.at(node).first_child; child != detail::npos; child = arena.at(child).next_sibling)
+    {
+        ++count;
+    }
+
+    return count;
 }
 
-ConfigMap::ConfigMap(const ConfigMap& rhs)
-    :
-    config_map{},
-    config_keys{}
+bool nodes_equal(const detail::ConfigArena& lhs, uint32_t lhs_node, const detail::ConfigArena& rhs, uint32_t rhs_node)
 {
-    for (auto key_ref : rhs.config_keys)
+    const auto& lhs_config = lhs.at(lhs_node);
+    const auto& rhs_config = rhs.at(rhs_node);
+
+    if (lhs_config.kind != rhs_config.kind)
     {
-        std::string key{key_ref};
-        auto value_res = rhs.copy_property(key);
-        assert(value_res.is_ok());
-        auto value{std::move(value_res.get_ok())};
-        if (std::holds_alternative<ConfigMap*>(value))
-        {
-            auto res = register_property(std::move(key), std::move(value));
-            delete std::get<ConfigMap*>(value);
-            assert(res.is_ok());
-        }
-        else
+        return false;
+    }
+
+    switch (lhs_config.kind)
+    {
+    case detail::ConfigNodeKind::Map:
+        break;
+    case detail::ConfigNodeKind::Bool:
+        return lhs_config.boolean == rhs_config.boolean;
+    case detail::ConfigNodeKind::Int:
+        return lhs_config.integer == rhs_config.integer;
+    case detail::ConfigNodeKind::Double:
+        return lhs_config.flonum == rhs_config.flonum;
+    case detail::ConfigNodeKind::String:
+    case detail::ConfigNodeKind::Symbol:
+        return lhs.text_of(lhs_node) == rhs.text_of(rhs_node);
+    }
+
+    if (child_count(lhs, lhs_node) != child_count(rhs, rhs_node))
+    {
+        return false;
+    }
+
+    for (uint32_t child = lhs_config.first_child; child != detail::npos; child = lhs.at(child).next_sibling)
+    {
+        uint32_t other = rhs.find_child(rhs_node, lhs.key_of(child));
+
+        if (other == detail::npos || !nodes_equal(lhs, child, rhs, other))
         {
-            auto res = register_property(std::move(key), std::move(value));
-            assert(res.is_ok());
+            return false;
         }
     }
+
+    return true;
 }
 
-ConfigMap::ConfigMap(ConfigMap&& rhs)
-    :
-    config_map(std::move(rhs.config_map)),
-    config_keys(std::move(rhs.config_keys))
+bool widens(detail::ConfigNodeKind kind, detail::ConfigNodeKind expected_kind)
 {
+    return kind == detail::ConfigNodeKind::Int && expected_kind == detail::ConfigNodeKind::Double;
 }
 
-ConfigMap& ConfigMap::operator=(const ConfigMap& rhs)
+// Dotted paths of the integers that reference has as doubles.
+void collect_widened(
+    const detail::ConfigArena& arena,
+    uint32_t node,
+    const detail::ConfigArena& reference,
+    uint32_t reference_node,
+    const std::string& prefix,
+    std::vector<std::string>& paths)
 {
-    if (this == &rhs)
+    for (uint32_t child = arena.at(node).first_child; child != detail::npos; child = arena.at(child).next_sibling)
     {
-        return *this;
+        std::string key = prefix + std::string{arena.key_of(child)};
+        uint32_t expected = reference.find_child(reference_node, arena.key_of(child));
+
+        if (expected == detail::npos)
+        {
+            continue;
+        }
+
+        auto expected_kind = reference.at(expected).kind;
+
+        if (widens(arena.at(child).kind, expected_kind))
+        {
+            paths.push_back(key);
+        }
+        else if (expected_kind == detail::ConfigNodeKind::Map && arena.at(child).kind == expected_kind)
+        {
+            collect_widened(arena, child, reference, expected, key + ".", paths);
+        }
     }
-    config_map.clear();
-    config_keys.clear();
-    for (auto key_ref : rhs.config_keys)
+}
+
+ConfigResult<> check_node_types(
+    const detail::ConfigArena& arena,
+    uint32_t node,
+    const detail::ConfigArena& reference,
+    uint32_t reference_node,
+    const std::string& prefix)
+{
+    for (uint32_t child = arena.at(node).first_child; child != detail::npos; child = arena.at(child).next_sibling)
     {
-        std::string key{key_ref};
-        auto value_res = rhs.copy_property(key);
-        auto value{std::move(value_res.get_ok())};
-        if (std::holds_alternative<ConfigMap*>(value))
+        std::string key = prefix + std::string{arena.key_of(child)};
+        uint32_t expected = reference.find_child(reference_node, arena.key_of(child));
+
+        if (expected == detail::npos)
         {
-            auto res = register_property(std::move(key), std::move(value));
-            delete std::get<ConfigMap*>(value);
-            assert(res.is_ok());
+            continue;
         }
-        else
+
+        auto expected_kind = reference.at(expected).kind;
+        auto kind = arena.at(child).kind;
+
+        // As in read_field, an integer will do for a double.
+        if (kind != expected_kind && !widens(kind, expected_kind))
         {
-            auto res = register_property(std::move(key), std::move(value));
-            assert(res.is_ok());
+            return ConfigResult<>::err(FieldTypeError{key, kind_name(expected_kind)});
+        }
+
+        if (expected_kind == detail::ConfigNodeKind::Map)
+        {
+            auto res = check_node_types(arena, child, reference, expected, key + ".");
+
+            if (res.is_err())
+            {
+                return res;
+            }
         }
     }
+
+    return ConfigResult<>::ok({});
+}
+
+} // namespace
+
+ConfigRef::ConfigRef(const ConfigMap& map, uint32_t node)
+    :
+    map{&map},
+    node{node}
+{
+}
+
+bool ConfigRef::is_map() const
+{
+    return map->arena->at(node).kind == detail::ConfigNodeKind::Map;
+}
+
+std::optional<bool> ConfigRef::get_bool() const
+{
+    const auto& config_node = map->arena->at(node);
+
+    if (config_node.kind != detail::ConfigNodeKind::Bool)
+    {
+        return {};
+    }
+
+    return config_node.boolean;
+}
+
+std::optional<int> ConfigRef::get_int() const
+{
+    const auto& config_node = map->arena->at(node);
+
+    if (config_node.kind != detail::ConfigNodeKind::Int)
+    {
+        return {};
+    }
+
+    return config_node.integer;
+}
+
+std::optional<double> ConfigRef::get_double() const
+{
+    const auto& config_node = map->arena->at(node);
+
+    if (config_node.kind != detail::ConfigNodeKind::Double)
+    {
+        return {};
+    }
+
+    return config_node.flonum;
+}
+
+std::optional<std::string_view> ConfigRef::get_string() const
+{
+    if (map->arena->at(node).kind != detail::ConfigNodeKind::String)
+    {
+        return {};
+    }
+
+    return map->arena->text_of(node);
+}
+
+std::optional<std::string_view> ConfigRef::get_symbol() const
+{
+    if (map->arena->at(node).kind != detail::ConfigNodeKind::Symbol)
+    {
+        return {};
+    }
+
+    return map->arena->text_of(node);
+}
+
+ConfigValue ConfigRef::to_value() const
+{
+    return map->value_at(node);
+}
+
+bool ConfigRef::operator==(const ConfigRef& rhs) const
+{
+    return nodes_equal(*map->arena, node, *rhs.map->arena, rhs.node);
+}
+
+ConfigMap::ConfigMap()
+    :
+    arena{},
+    root{detail::npos}
+{
+}
+
+ConfigMap::ConfigMap(std::shared_ptr<detail::ConfigArena> arena, uint32_t root)
+    :
+    arena{std::move(arena)},
+    root{root}
+{
+}
+
+ConfigMap::~ConfigMap()
+{
+}
+
+ConfigMap::ConfigMap(const ConfigMap& rhs)
+    :
+    arena{rhs.arena},
+    root{rhs.root}
+{
+}
+
+ConfigMap::ConfigMap(ConfigMap&& rhs) noexcept
+    :
+    arena{std::move(rhs.arena)},
+    root{rhs.root}
+{
+    rhs.root = detail::npos;
+}
+
+ConfigMap& ConfigMap::operator=(const ConfigMap& rhs)
+{
+    arena = rhs.arena;
+    root = rhs.root;
     return *this;
 }
 
-ConfigMap& ConfigMap::operator=(ConfigMap&& rhs)
+ConfigMap& ConfigMap::operator=(ConfigMap&& rhs) noexcept
 {
-    config_map = std::move(rhs.config_map);
-    config_keys = std::move(rhs.config_keys);
+    arena = std::move(rhs.arena);
+    root = rhs.root;
+    rhs.root = detail::npos;
     return *this;
 }
 
-ConfigResult<> ConfigMap::register_property(std::string&& key, ConfigValue&& value)
+detail::ConfigArena& ConfigMap::mutable_arena()
 {
-    if (config_map.contains(key))
+    if (!arena)
     {
-        return ConfigResult<>::err(PropertyAlreadyRegistered{});
+        arena = std::make_shared<detail::ConfigArena>();
+        root = arena->make_root();
+    }
+    else if (arena.use_count() > 1)
+    {
+        // Copy on write: detach only this map's subtree, leaving other sharers untouched.
+        auto detached = std::make_shared<detail::ConfigArena>();
+        uint32_t detached_root = detached->make_root();
+        detached->copy_children(*arena, root, detached_root);
+        arena = std::move(detached);
+        root = detached_root;
     }
 
-    if (std::holds_alternative<ConfigMap*>(value))
+    return *arena;
+}
+
+uint32_t ConfigMap::find(std::string_view key) const
+{
+    if (!arena)
     {
-        config_map.emplace(std::make_pair(key, new ConfigMap{*std::get<ConfigMap*>(value)}));
+        return detail::npos;
+    }
+
+    return arena->find_child(root, key);
+}
+
+ConfigValue ConfigMap::value_at(uint32_t node) const
+{
+    if (arena->at(node).kind == detail::ConfigNodeKind::Map)
+    {
+        return ConfigValue{ConfigMap{arena, node}};
+    }
+
+    return ConfigValue{arena->get_scalar(node)};
+}
+
+void ConfigMap::assign_value(uint32_t node, const ConfigValue& value)
+{
+    if (std::holds_alternative<ConfigMap>(value))
+    {
+        const auto& nested = std::get<ConfigMap>(value);
+
+        // mutable_arena() has already detached from any arena the nested map shares with us.
+        assert(nested.arena != arena || !nested.arena);
+        if (nested.arena)
+        {
+            arena->copy_children(*nested.arena, nested.root, node);
+        }
     }
     else
     {
-        config_map.emplace(std::make_pair(key, std::move(ConfigValue{value})));
+        arena->set_scalar(node, std::get<scheme::SexpCppValue>(value));
+    }
+}
+
+ConfigResult<> ConfigMap::register_property(std::string_view key, ConfigValue&& value)
+{
+    if (has_property(key))
+    {
+        return ConfigResult<>::err(PropertyAlreadyRegistered{});
     }
 
-    config_keys.emplace(std::move(key));
+    uint32_t node = mutable_arena().add_child(root, key);
+    assign_value(node, value);
 
     return ConfigResult<>::ok({});
 }
@@ -109,10 +370,9 @@ ConfigResult<> ConfigMap::register_property(std::string&& key, ConfigValue&& val
 ConfigResult<> ConfigMap::register_properties(
     std::vector<std::pair<std::string, ConfigValue>>&& key_value_pairs)
 {
-    for (auto k_v : key_value_pairs)
+    for (auto& k_v : key_value_pairs)
     {
-        std::string key{k_v.first};
-        auto res = register_property(std::move(key), std::move(k_v.second));
+        auto res = register_property(k_v.first, std::move(k_v.second));
         if (res.is_err())
         {
             return res;
@@ -122,146 +382,359 @@ ConfigResult<> ConfigMap::register_properties(
     return ConfigResult<>::ok({});
 }
 
-ConfigResult<> ConfigMap::set_property(const std::string& key, ConfigValue&& value)
+ConfigResult<> ConfigMap::set_property(std::string_view key, ConfigValue&& value)
 {
-    if (!config_map.contains(key))
+    uint32_t node = find(key);
+
+    if (node == detail::npos)
     {
         return ConfigResult<>::err(PropertyNotRegistered{});
     }
 
-    if (config_map.at(key).index() != value.index())
+    bool is_map = arena->at(node).kind == detail::ConfigNodeKind::Map;
+
+    if (is_map != std::holds_alternative<ConfigMap>(value))
     {
         return ConfigResult<>::err(TypeError{});
     }
 
-    if (std::holds_alternative<ConfigMap*>(value))
-    {
-        delete std::get<ConfigMap*>(config_map.at(key));
-        // ConfigMap* new_value =
-        config_map.at(key) = new ConfigMap{*std::get<ConfigMap*>(value)};
-    }
-    else
+    auto& store = mutable_arena();
+    node = store.find_child(root, key);
+
+    if (is_map)
     {
-        config_map.at(key) = value;
+        store.clear_children(node);
     }
+    assign_value(node, value);
 
     return ConfigResult<>::ok({});
 }
 
-ConfigResult<ConfigValue> ConfigMap::pop_property(std::string&& key)
+ConfigResult<ConfigValue> ConfigMap::pop_property(std::string_view key)
 {
-    if (!config_map.contains(key))
+    uint32_t node = find(key);
+
+    if (node == detail::npos)
     {
         return ConfigResult<ConfigValue>::err(PropertyNotRegistered{});
     }
 
-    ConfigValue value = config_map.at(key);
+    ConfigValue value = value_at(node);
+
+    auto& store = mutable_arena();
+    store.remove_child(store.find_child(root, key));
 
-    config_map.erase(key);
-    config_keys.erase(std::move(key));
-    return ConfigResult<ConfigValue>::ok(value);
+    return ConfigResult<ConfigValue>::ok(std::move(value));
+}
+
+bool ConfigMap::has_property(std::string_view key) const
+{
+    return find(key) != detail::npos;
 }
 
-ConfigResult<bool> ConfigMap::property_is_nested_map(const std::string& key) const
+ConfigResult<bool> ConfigMap::property_is_nested_map(std::string_view key) const
 {
-    if (!config_map.contains(key))
+    uint32_t node = find(key);
+
+    if (node == detail::npos)
     {
         return ConfigResult<bool>::err(PropertyNotRegistered{});
     }
 
-    return ConfigResult<bool>::ok(std::holds_alternative<ConfigMap*>(config_map.at(key)));
+    return ConfigResult<bool>::ok(arena->at(node).kind == detail::ConfigNodeKind::Map);
 }
 
-ConfigResult<ConfigValue> ConfigMap::copy_property(const std::string& key) const
+ConfigResult<ConfigValue> ConfigMap::copy_property(std::string_view key) const
 {
-    if (!config_map.contains(key))
+    uint32_t node = find(key);
+
+    if (node == detail::npos)
     {
         return ConfigResult<ConfigValue>::err(PropertyNotRegistered{});
     }
 
-    ConfigValue value;
+    return ConfigResult<ConfigValue>::ok(value_at(node));
+}
+
+ConfigResult<ConfigRef> ConfigMap::ref_property(std::string_view key) const
+{
+    uint32_t node = find(key);
 
-    if (std::holds_alternative<ConfigMap*>(config_map.at(key)))
+    if (node == detail::npos)
     {
-        value = new ConfigMap{*std::get<ConfigMap*>(config_map.at(key))};
+        return ConfigResult<ConfigRef>::err(PropertyNotRegistered{});
     }
-    else
+
+    return ConfigResult<ConfigRef>::ok(ConfigRef{*this, node});
+}
+
+ConfigResult<ConfigRef> ConfigMap::ref_property(const ConfigKey& key) const
+{
+    uint32_t node = arena ? arena->find_child(root, key.name, key.hash) : detail::npos;
+
+    if (node == detail::npos)
     {
-        value = config_map.at(key);
+        return ConfigResult<ConfigRef>::err(PropertyNotRegistered{});
     }
 
-    return ConfigResult<ConfigValue>::ok(value);
+    return ConfigResult<ConfigRef>::ok(ConfigRef{*this, node});
 }
 
-ConfigResult<const ConfigValue*> ConfigMap::ref_property(const std::string& key) const
+ConfigResult<ConfigRef> ConfigMap::ref_path(std::string_view path) const
 {
-    if (!config_map.contains(key))
+    uint32_t node = find_path(path);
+
+    if (node == detail::npos)
     {
-        return ConfigResult<const ConfigValue*>::err(PropertyNotRegistered{});
+        return ConfigResult<ConfigRef>::err(PropertyNotRegistered{});
     }
 
-    return ConfigResult<const ConfigValue*>::ok(&config_map.at(key));
+    return ConfigResult<ConfigRef>::ok(ConfigRef{*this, node});
 }
 
-ConfigResult<> ConfigMap::load_from_sexp(sexp& sexp_config, scheme::Schemer& schemer)
+ConfigResult<> ConfigMap::set_path(std::string_view path, scheme::SexpCppValue&& value)
 {
-    for (auto key : config_keys)
+    uint32_t node = find_path(path);
+
+    if (node == detail::npos)
+    {
+        return ConfigResult<>::err(PropertyNotRegistered{});
+    }
+
+    if (arena->at(node).kind == detail::ConfigNodeKind::Map)
     {
-        if (property_is_nested_map(key).get_ok())
+        return ConfigResult<>::err(TypeError{});
+    }
+
+    // Copy on write renumbers the nodes, so look the path up again once detached.
+    mutable_arena().set_scalar(find_path(path), value);
+
+    return ConfigResult<>::ok({});
+}
+
+uint32_t ConfigMap::find_path(std::string_view path) const
+{
+    uint32_t node = root;
+
+    if (!arena)
+    {
+        return detail::npos;
+    }
+
+    while (true)
+    {
+        auto dot = path.find('.');
+        node = arena->find_child(node, path.substr(0, dot));
+
+        if (node == detail::npos || dot == std::string_view::npos)
         {
-            // ConfigMap* nested_map =
+            return node;
         }
-        else
+
+        if (arena->at(node).kind != detail::ConfigNodeKind::Map)
         {
-            auto new_value_res = schemer.assq(key, sexp_config);
-            if (new_value_res.is_err())
-            {
-                log(LogLevel::Error,
-                    "{} Error getting value for key {}: {}",
-                    __LINE__,
-                    key,
-                    new_value_res.get_err().format());
-                continue;
-            }
+            return detail::npos;
+        }
 
-            auto sexp_new_value = new_value_res.get_ok();
-            auto cpp_value_res = schemer.get_cpp_value(sexp_new_value);
-            if (cpp_value_res.is_err())
-            {
-                log(LogLevel::Error,
-                    "{}: Expected C++ type value for key {}: {}\nvalue={}",
-                    __LINE__,
-                    key,
-                    cpp_value_res.get_err().format(),
-                    schemer.sexp_to_string(sexp_new_value)
-                );
-                continue;
-            }
+        path.remove_prefix(dot + 1);
+    }
+}
+
+ConfigResult<> ConfigMap::load_from_sexp(sexp& sexp_config, scheme::Schemer& schemer, const LoadObserver& observer)
+{
+    // Detach up front so node indices stay stable while properties are updated below.
+    auto& store = mutable_arena();
+    std::vector<bool> loaded(store.node_count(), false);
+    std::string path;
 
-            auto cpp_value = cpp_value_res.get_ok();
-            auto update_res = set_property(key, cpp_value);
-            if (update_res.is_err())
+    load_alist(root, sexp_config, schemer, loaded, 0, observer, path);
+
+    return ConfigResult<>::ok({});
+}
+
+void ConfigMap::load_alist(
+    uint32_t node,
+    sexp alist,
+    scheme::Schemer& schemer,
+    std::vector<bool>& loaded,
+    int depth,
+    const LoadObserver& observer,
+    std::string& path)
+{
+    if (depth > max_load_depth)
+    {
+        log<LogLevel::Error>(
+            "{} Config nested deeper than {} levels, ignoring the rest",
+            __LINE__,
+            max_load_depth);
+        return;
+    }
+
+    // One pass over the alist; each entry is dispatched through the arena's (parent, key) table.
+    for (sexp entries = alist; sexp_pairp(entries); entries = sexp_cdr(entries))
+    {
+        sexp entry = sexp_car(entries);
+
+        if (!sexp_pairp(entry))
+        {
+            log<LogLevel::Error>(
+                "{} Expected a (key . value) entry, got {}",
+                __LINE__,
+                schemer.sexp_to_string(entry));
+            continue;
+        }
+
+        sexp sexp_key = sexp_car(entry);
+        auto key_res = schemer.get_symbol(sexp_key);
+
+        if (key_res.is_err())
+        {
+            log<LogLevel::Error>("{} Expected a symbol key, got {}", __LINE__, schemer.sexp_to_string(sexp_key));
+            continue;
+        }
+
+        std::string key{key_res.get_ok()};
+        uint32_t child = arena->find_child(node, key);
+
+        if (child == detail::npos)
+        {
+            log<LogLevel::Debug>("{} Ignoring unregistered key {}", __LINE__, key);
+            continue;
+        }
+
+        // Like assq, the first occurrence of a key wins.
+        if (loaded[child])
+        {
+            continue;
+        }
+        loaded[child] = true;
+
+        sexp sexp_new_value = sexp_cdr(entry);
+
+        if (arena->at(child).kind == detail::ConfigNodeKind::Map)
+        {
+            if (!sexp_pairp(sexp_new_value) && !sexp_nullp(sexp_new_value))
             {
-                log(LogLevel::Error,
-                    "{} Error updating property for key {}: {}",
+                log<LogLevel::Error>(
+                    "{} Expected a nested config for key {}, got {}",
                     __LINE__,
                     key,
-                    update_res.get_err().format());
+                    schemer.sexp_to_string(sexp_new_value));
                 continue;
             }
-            else
+
+            size_t path_size = path.size();
+            if (observer)
             {
-                log(LogLevel::Info, "{} Updated property for key {}", __LINE__, key);
+                path.append(key).push_back('.');
             }
+
+            load_alist(child, sexp_new_value, schemer, loaded, depth + 1, observer, path);
+            path.resize(path_size);
+            continue;
+        }
+
+        auto cpp_value_res = schemer.get_cpp_value(sexp_new_value);
+        if (cpp_value_res.is_err())
+        {
+            log<LogLevel::Error>(
+                "{}: Expected C++ type value for key {}: {}\nvalue={}",
+                __LINE__,
+                key,
+                cpp_value_res.get_err().format(),
+                schemer.sexp_to_string(sexp_new_value)
+            );
+            continue;
+        }
+
+        arena->set_scalar(child, cpp_value_res.get_ok());
+        log<LogLevel::Info>("{} Updated property for key {}", __LINE__, key);
+
+        if (observer)
+        {
+            observer(path + key);
+        }
+    }
+}
+
+std::vector<std::string_view> ConfigMap::keys() const
+{
+    std::vector<std::string_view> config_keys;
+
+    if (!arena)
+    {
+        return config_keys;
+    }
+
+    for (uint32_t node = arena->at(root).first_child; node != detail::npos; node = arena->at(node).next_sibling)
+    {
+        config_keys.push_back(arena->key_of(node));
+    }
+
+    return config_keys;
+}
+
+size_t ConfigMap::size() const
+{
+    size_t count = 0;
+
+    if (!arena)
+    {
+        return count;
+    }
+
+    for (uint32_t node = arena->at(root).first_child; node != detail::npos; node = arena->at(node).next_sibling)
+    {
+        ++count;
+    }
+
+    return count;
+}
+
+ConfigResult<> ConfigMap::check_types(const ConfigMap& reference) const
+{
+    if (!arena || !reference.arena)
+    {
+        return ConfigResult<>::ok({});
+    }
+
+    return check_node_types(*arena, root, *reference.arena, reference.root, "");
+}
+
+ConfigResult<> ConfigMap::conform_types(const ConfigMap& reference)
+{
+    auto check_res = check_types(reference);
+
+    if (check_res.is_err() || !arena || !reference.arena)
+    {
+        return check_res;
+    }
+
+    std::vector<std::string> paths;
+    collect_widened(*arena, root, *reference.arena, reference.root, "", paths);
+
+    for (const auto& path : paths)
+    {
+        auto integer = ref_path(path).get_ok().get_int();
+        auto set_res = set_path(path, static_cast<double>(integer.value()));
+
+        if (set_res.is_err())
+        {
+            return set_res;
         }
     }
 
     return ConfigResult<>::ok({});
 }
 
-const std::set<std::string>& ConfigMap::keys() const
+bool ConfigMap::operator==(const ConfigMap& rhs) const
 {
-    return config_keys;
+    if (!arena || !rhs.arena)
+    {
+        return size() == 0 && rhs.size() == 0;
+    }
+
+    return nodes_equal(*arena, root, *rhs.arena, rhs.root);
 }
 
 ConfigNest::ConfigNest()
@@ -277,6 +750,11 @@ const std::string& ConfigNest::get_name() const
     return name;
 }
 
+const ConfigMap& ConfigNest::get_default_map() const
+{
+    return default_map;
+}
+
 ConfigResult<ConfigMap> ConfigNest::load_config_from_sexp(sexp& config_alist, scheme::Schemer& schemer)
 {
     using ConfigMapResult = ConfigResult<ConfigMap>;
@@ -285,7 +763,7 @@ ConfigResult<ConfigMap> ConfigNest::load_config_from_sexp(sexp& config_alist, sc
     if (sexp_res.is_err())
     {
         auto err = sexp_res.get_err();
-        log(LogLevel::Error, "{} Error loading config from sexp {}", __LINE__, err.format());
+        log<LogLevel::Error>("{} Error loading config from sexp {}", __LINE__, err);
         schemer.print_exception(config_alist);
         return ConfigMapResult::err(err);
     }
@@ -298,6 +776,8 @@ ConfigResult<ConfigMap> ConfigNest::load_config_from_sexp(sexp& config_alist, sc
         return ConfigMapResult::err(NotConfigMap{sexp_config});
     }
 
+    // Start over from the defaults so a key dropped from the file since the last load reverts.
+    loaded_map = default_map;
     auto config_result = loaded_map.load_from_sexp(sexp_config, schemer);
 
     if (config_result.is_err())
@@ -311,15 +791,74 @@ ConfigResult<ConfigMap> ConfigNest::load_config_from_sexp(sexp& config_alist, sc
 ConfigManager::ConfigManager()
     :
     root_map{},
-    schemer{}
+    cache{},
+    schemer{nullptr},
+    owned_schemer{}
 {
-    schemer.import_module(scheme::SrfiType::Srfi_ListLibrary);
+}
+
+ConfigManager::ConfigManager(ConfigNest root, std::shared_ptr<const ConfigCache> cache)
+    :
+    root_map{root},
+    cache{cache},
+    schemer{nullptr},
+    owned_schemer{}
+{
+}
+
+ConfigManager::ConfigManager(ConfigNest root, scheme::Schemer& schemer, std::shared_ptr<const ConfigCache> cache)
+    :
+    root_map{root},
+    cache{cache},
+    schemer{&schemer},
+    owned_schemer{}
+{
+}
+
+ConfigManager::~ConfigManager()
+{
+}
+
+scheme::Schemer& ConfigManager::get_schemer()
+{
+    if (schemer == nullptr)
+    {
+        owned_schemer = std::make_unique<scheme::Schemer>(scheme::SchemerEnv::ReaderOnly);
+        schemer = owned_schemer.get();
+    }
+
+    return *schemer;
+}
+
+bool ConfigManager::interpreter_started() const
+{
+    return owned_schemer != nullptr;
 }
 
 ConfigResult<ConfigMap> ConfigManager::load_config_from_file(const std::string& filename)
 {
     using ConfigMapResult = ConfigResult<ConfigMap>;
-    auto res = schemer.read_from_file(filename);
+    uint64_t nest_fingerprint = 0;
+    std::optional<SourceStamp> stamp;
+
+    if (cache)
+    {
+        nest_fingerprint = ConfigCache::fingerprint(root_map);
+        stamp = ConfigCache::stamp(filename);
+    }
+
+    if (stamp.has_value())
+    {
+        auto cached = cache->load(stamp.value(), nest_fingerprint);
+        if (cached.has_value())
+        {
+            log<LogLevel::Debug>("{} Loaded {} from config cache", __LINE__, filename);
+            return ConfigMapResult::ok(std::move(cached.value()));
+        }
+    }
+
+    auto& reader = get_schemer();
+    auto res = reader.read_from_file(filename);
 
     if (res.is_err())
     {
@@ -328,7 +867,20 @@ ConfigResult<ConfigMap> ConfigManager::load_config_from_file(const std::string&
 
     sexp config_alist = res.get_ok();
 
-    return root_map.load_config_from_sexp(config_alist, schemer);
+    reader.preserve(config_alist);
+    auto map_res = root_map.load_config_from_sexp(config_alist, reader);
+    reader.release(config_alist);
+
+    if (stamp.has_value() && map_res.is_ok())
+    {
+        auto store_res = cache->store(stamp.value(), nest_fingerprint, map_res.get_ok());
+        if (store_res.is_err())
+        {
+            log<LogLevel::Warn>("{} {}", __LINE__, store_res.get_err());
+        }
+    }
+
+    return map_res;
 }
 
 } // namespace samos::config_manager
@@ -0,0 +1,143 @@
+#include "config_snapshot.hpp"
+
+#include <functional>
+#include <limits>
+#include <thread>
+
+namespace samos::config_manager
+{
+
+ConfigSnapshot::ConfigSnapshot(const ConfigMap* map, detail::ReaderSlot* slot)
+    :
+    map{map},
+    slot{slot}
+{
+}
+
+ConfigSnapshot::ConfigSnapshot(ConfigSnapshot&& rhs) noexcept
+    :
+    map{rhs.map},
+    slot{rhs.slot}
+{
+    rhs.map = nullptr;
+    rhs.slot = nullptr;
+}
+
+ConfigSnapshot& ConfigSnapshot::operator=(ConfigSnapshot&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        unpin();
+        map = std::exchange(rhs.map, nullptr);
+        slot = std::exchange(rhs.slot, nullptr);
+    }
+
+    return *this;
+}
+
+ConfigSnapshot::~ConfigSnapshot()
+{
+    unpin();
+}
+
+void ConfigSnapshot::unpin()
+{
+    if (slot != nullptr)
+    {
+        slot->epoch.store(0, std::memory_order_release);
+        slot = nullptr;
+    }
+}
+
+ConfigPublisher::ConfigPublisher(ConfigMap initial)
+    :
+    current{new ConfigMap(std::move(initial))},
+    epoch{1},
+    slots{},
+    writer_mutex{},
+    retired{}
+{
+}
+
+ConfigPublisher::~ConfigPublisher()
+{
+    delete current.load();
+}
+
+detail::ReaderSlot& ConfigPublisher::claim_slot() const
+{
+    // Start where this thread last found a free slot so uncontended readers keep one cache line.
+    thread_local size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+
+    while (true)
+    {
+        for (size_t probe = 0; probe < max_readers; ++probe)
+        {
+            auto& slot = slots[(hint + probe) % max_readers];
+            uint64_t idle = 0;
+
+            /*
+             * seq_cst so that a writer scanning slots after swapping the pointer either sees this
+             * pin or this reader loads the new pointer.
+             */
+            if (slot.epoch.compare_exchange_strong(idle, epoch.load()))
+            {
+                hint = (hint + probe) % max_readers;
+                return slot;
+            }
+        }
+
+        std::this_thread::yield();
+    }
+}
+
+ConfigSnapshot ConfigPublisher::read() const
+{
+    auto& slot = claim_slot();
+
+    return ConfigSnapshot{current.load(), &slot};
+}
+
+void ConfigPublisher::publish(ConfigMap config)
+{
+    auto next = std::make_unique<const ConfigMap>(std::move(config));
+    std::lock_guard<std::mutex> lock{writer_mutex};
+
+    const ConfigMap* previous = current.exchange(next.release());
+    uint64_t replaced_in = epoch.fetch_add(1);
+
+    retired.push_back({std::unique_ptr<const ConfigMap>{previous}, replaced_in});
+    collect_locked();
+}
+
+void ConfigPublisher::collect()
+{
+    std::lock_guard<std::mutex> lock{writer_mutex};
+    collect_locked();
+}
+
+size_t ConfigPublisher::retired_count() const
+{
+    std::lock_guard<std::mutex> lock{writer_mutex};
+    return retired.size();
+}
+
+void ConfigPublisher::collect_locked()
+{
+    uint64_t oldest_pinned = std::numeric_limits<uint64_t>::max();
+
+    for (const auto& slot : slots)
+    {
+        uint64_t pinned = slot.epoch.load();
+
+        if (pinned != 0 && pinned < oldest_pinned)
+        {
+            oldest_pinned = pinned;
+        }
+    }
+
+    // A reader pinned at epoch e may hold any version replaced in epoch e or later.
+    std::erase_if(retired, [oldest_pinned](const Retired& entry) { return entry.epoch < oldest_pinned; });
+}
+
+} // namespace samos::config_manager
@@ -0,0 +1,297 @@
+#include "config_watcher.hpp"
+#include "logger.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace samos::config_manager
+{
+
+using log::logger::log;
+using log::logger::LogLevel;
+
+namespace
+{
+
+// Editors often save in several steps; wait for the directory to go quiet before reloading.
+constexpr int settle_ms = 50;
+
+} // namespace
+
+ConfigWatcher::ConfigWatcher(ConfigNest root, std::string filename, std::shared_ptr<const ConfigCache> cache)
+    :
+    manager{root, std::move(cache)},
+    layers{},
+    defaults{root.get_default_map()},
+    filenames{std::move(filename)},
+    published{},
+    generation{0},
+    reload_mutex{},
+    latest{},
+    callbacks{},
+    inotify_fd{-1},
+    watched{},
+    stop_pipe{-1, -1},
+    watcher{}
+{
+}
+
+ConfigWatcher::ConfigWatcher(ConfigLayers config_layers)
+    :
+    manager{},
+    layers{std::move(config_layers)},
+    defaults{layers->get_root().get_default_map()},
+    filenames{layers->get_files()},
+    published{},
+    generation{0},
+    reload_mutex{},
+    latest{},
+    callbacks{},
+    inotify_fd{-1},
+    watched{},
+    stop_pipe{-1, -1},
+    watcher{}
+{
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    stop();
+}
+
+ConfigResult<> ConfigWatcher::start()
+{
+    auto load_res = reload();
+
+    if (load_res.is_err())
+    {
+        log<LogLevel::Warn>("{} Using default config: {}", __LINE__, load_res.get_err());
+        std::lock_guard<std::mutex> lock{reload_mutex};
+        publish(defaults);
+    }
+
+    if (watcher.joinable() || filenames.empty())
+    {
+        return ConfigResult<>::ok({});
+    }
+
+    inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (inotify_fd < 0)
+    {
+        return ConfigResult<>::err(WatchError{fmt::format("inotify_init1: {}", std::strerror(errno))});
+    }
+
+    for (const auto& filename : filenames)
+    {
+        std::filesystem::path path{filename};
+        auto directory = path.parent_path().empty() ? std::filesystem::path{"."} : path.parent_path();
+
+        // Watch the directory rather than the file, which editors replace by renaming over it.
+        int watch = ::inotify_add_watch(
+            inotify_fd,
+            directory.c_str(),
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+
+        // A layer whose directory doesn't exist yet just isn't watched.
+        if (watch < 0)
+        {
+            log<LogLevel::Debug>("{} Not watching {}: {}", __LINE__, directory.string(), std::strerror(errno));
+            continue;
+        }
+
+        watched.push_back({watch, path.filename().string()});
+    }
+
+    if (watched.empty() || ::pipe2(stop_pipe, O_CLOEXEC) < 0)
+    {
+        auto reason = watched.empty() ? std::string{"no config directory to watch"} : std::strerror(errno);
+        ::close(inotify_fd);
+        inotify_fd = -1;
+        watched.clear();
+        return ConfigResult<>::err(WatchError{reason});
+    }
+
+    watcher = std::thread{&ConfigWatcher::watch_loop, this};
+
+    return ConfigResult<>::ok({});
+}
+
+void ConfigWatcher::stop()
+{
+    if (watcher.joinable())
+    {
+        char wake = 0;
+        [[maybe_unused]] auto written = ::write(stop_pipe[1], &wake, 1);
+        watcher.join();
+    }
+
+    watched.clear();
+
+    for (int* fd : {&inotify_fd, &stop_pipe[0], &stop_pipe[1]})
+    {
+        if (*fd >= 0)
+        {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+ConfigSnapshot ConfigWatcher::current() const
+{
+    return published.read();
+}
+
+uint64_t ConfigWatcher::get_generation() const
+{
+    return generation.load(std::memory_order_acquire);
+}
+
+void ConfigWatcher::on_change(std::string key, Callback callback)
+{
+    std::lock_guard<std::mutex> lock{reload_mutex};
+    callbacks.emplace_back(std::move(key), std::move(callback));
+}
+
+ConfigResult<> ConfigWatcher::reload()
+{
+    std::lock_guard<std::mutex> lock{reload_mutex};
+    auto map_res = load();
+
+    if (map_res.is_err())
+    {
+        return ConfigResult<>::err(map_res.get_err());
+    }
+
+    auto config = map_res.get_ok();
+    auto check_res = config.conform_types(defaults);
+
+    if (check_res.is_err())
+    {
+        return check_res;
+    }
+
+    bool first = get_generation() == 0;
+
+    if (!first && latest == config)
+    {
+        return ConfigResult<>::ok({});
+    }
+
+    ConfigMap previous = latest;
+    publish(config);
+    log<LogLevel::Info>("{} Published config generation {}", __LINE__, get_generation());
+
+    if (first)
+    {
+        return ConfigResult<>::ok({});
+    }
+
+    for (const auto& [key, callback] : callbacks)
+    {
+        auto new_res = config.ref_property(key);
+        auto old_res = previous.ref_property(key);
+
+        if (new_res.is_err() || (old_res.is_ok() && old_res.get_ok() == new_res.get_ok()))
+        {
+            continue;
+        }
+
+        callback(new_res.get_ok());
+    }
+
+    return ConfigResult<>::ok({});
+}
+
+ConfigResult<ConfigMap> ConfigWatcher::load()
+{
+    if (!layers.has_value())
+    {
+        return manager.load_config_from_file(filenames.front());
+    }
+
+    auto resolve_res = layers->resolve();
+
+    if (resolve_res.is_err())
+    {
+        return ConfigResult<ConfigMap>::err(resolve_res.get_err());
+    }
+
+    return ConfigResult<ConfigMap>::ok(resolve_res.get_ok().get_map());
+}
+
+void ConfigWatcher::publish(const ConfigMap& config)
+{
+    latest = config;
+    published.publish(config);
+    generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void ConfigWatcher::watch_loop()
+{
+    std::array<pollfd, 2> fds{{{inotify_fd, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}}};
+    alignas(inotify_event) char buffer[4096];
+    bool pending = false;
+
+    while (true)
+    {
+        int ready = ::poll(fds.data(), fds.size(), pending ? settle_ms : -1);
+
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            log<LogLevel::Error>("{} Stopped watching config: {}", __LINE__, std::strerror(errno));
+            return;
+        }
+
+        if (fds[1].revents != 0)
+        {
+            return;
+        }
+
+        if (ready == 0)
+        {
+            pending = false;
+            auto res = reload();
+
+            if (res.is_err())
+            {
+                log<LogLevel::Warn>("{} Keeping previous config: {}", __LINE__, res.get_err());
+            }
+            continue;
+        }
+
+        ssize_t length;
+
+        while ((length = ::read(inotify_fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* ptr = buffer; ptr < buffer + length;)
+            {
+                auto* event = reinterpret_cast<inotify_event*>(ptr);
+
+                for (const auto& [watch, name] : watched)
+                {
+                    if (event->len > 0 && event->wd == watch && name == event->name)
+                    {
+                        pending = true;
+                    }
+                }
+
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+}
+
+} // namespace samos::config_manager
@@ -1,7 +1,17 @@
 #include "config_manager.hpp"
+#include "config_cache.hpp"
+#include "config_layers.hpp"
+#include "config_schema.hpp"
+#include "config_snapshot.hpp"
+#include "config_watcher.hpp"
 #include "logger.hpp"
 
+#include <filesystem>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
 #include <gtest/gtest.h>
+#include <unistd.h>
 
 namespace samos::config_manager
 {
@@ -158,79 +168,7 @@ TEST(TestConfigMap, TestPopPropertyFail)
     ASSERT_TRUE(test_value_res.is_err());
 }
 
-TEST(TestConfigMap, TestNestedHeap)
-{
-    ConfigMap root_map;
-    ConfigMap* nested_1 = new ConfigMap;
-    ConfigMap* nested_2 = new ConfigMap;
-
-    auto register_res = nested_1->register_property("n1_prop", ConfigValue{true});
-
-    ASSERT_TRUE(register_res.is_ok());
-    ASSERT_TRUE(nested_1->has_property("n1_prop"));
-
-    register_res = nested_2->register_property("n2_prop", ConfigValue{2});
-    ASSERT_TRUE(register_res.is_ok());
-    ASSERT_TRUE(nested_2->has_property("n2_prop"));
-
-    register_res = root_map.register_property("root_prop", ConfigValue{3.0});
-    ASSERT_TRUE(root_map.has_property("root_prop"));
-
-    register_res = nested_1->register_property("nested_2", ConfigValue{nested_2});
-    ASSERT_TRUE(register_res.is_ok());
-
-    register_res = root_map.register_property("nested_1", nested_1);
-    ASSERT_TRUE(register_res.is_ok());
-
-    ASSERT_TRUE(root_map.has_property("nested_1"));
-    ASSERT_TRUE(root_map.has_property("root_prop"));
-
-    auto pop_res = root_map.pop_property("root_prop");
-
-    ASSERT_TRUE(pop_res.is_ok());
-
-    auto popped = pop_res.get_ok();
-
-    ASSERT_TRUE(std::holds_alternative<SexpCppValue>(popped));
-    ASSERT_TRUE(std::holds_alternative<double>(std::get<SexpCppValue>(popped)));
-    ASSERT_EQ(std::get<double>(std::get<SexpCppValue>(popped)), 3.0);
-
-    pop_res = root_map.pop_property("nested_1");
-    ASSERT_TRUE(pop_res.is_ok());
-    popped = pop_res.get_ok();
-    ASSERT_TRUE(std::holds_alternative<ConfigMap*>(popped));
-
-    auto v = *std::get<ConfigMap*>(popped);
-
-    ASSERT_TRUE(v.has_property("n1_prop"));
-    pop_res = v.pop_property("n1_prop");
-    ASSERT_TRUE(pop_res.is_ok());
-    popped = pop_res.get_ok();
-    ASSERT_TRUE(std::holds_alternative<SexpCppValue>(popped));
-    ASSERT_TRUE(std::holds_alternative<bool>(std::get<SexpCppValue>(popped)));
-    ASSERT_TRUE(std::get<bool>(std::get<SexpCppValue>(popped)));
-
-    ASSERT_TRUE(v.has_property("nested_2"));
-    pop_res = v.pop_property("nested_2");
-    ASSERT_TRUE(pop_res.is_ok());
-    popped = pop_res.get_ok();
-    ASSERT_TRUE(std::holds_alternative<ConfigMap*>(popped));
-
-    auto v2{*std::get<ConfigMap*>(popped)};
-
-    ASSERT_TRUE(v2.has_property("n2_prop"));
-    pop_res = v2.pop_property("n2_prop");
-    ASSERT_TRUE(pop_res.is_ok());
-    popped = pop_res.get_ok();
-    ASSERT_TRUE(std::holds_alternative<SexpCppValue>(popped));
-    ASSERT_TRUE(std::holds_alternative<int>(std::get<SexpCppValue>(popped)));
-    ASSERT_EQ(std::get<int>(std::get<SexpCppValue>(popped)), 2);
-
-    delete nested_2;
-    delete nested_1;
-}
-
-TEST(TestConfigMap, TestNestedStack)
+TEST(TestConfigMap, TestNestedMove)
 {
     ConfigMap root_map;
     ConfigMap nested_1;
@@ -248,10 +186,10 @@ TEST(TestConfigMap, TestNestedStack)
     register_res = root_map.register_property("root_prop", ConfigValue{3.0});
     ASSERT_TRUE(root_map.has_property("root_prop"));
 
-    register_res = nested_1.register_property("nested_2", ConfigValue{&nested_2});
+    register_res = nested_1.register_property("nested_2", ConfigValue{std::move(nested_2)});
     ASSERT_TRUE(register_res.is_ok());
 
-    register_res = root_map.register_property("nested_1", &nested_1);
+    register_res = root_map.register_property("nested_1", std::move(nested_1));
     ASSERT_TRUE(register_res.is_ok());
 
     ASSERT_TRUE(root_map.has_property("nested_1"));
@@ -270,9 +208,11 @@ TEST(TestConfigMap, TestNestedStack)
     pop_res = root_map.pop_property("nested_1");
     ASSERT_TRUE(pop_res.is_ok());
     popped = pop_res.get_ok();
-    ASSERT_TRUE(std::holds_alternative<ConfigMap*>(popped));
+    ASSERT_TRUE(std::holds_alternative<ConfigMap>(popped));
+    ASSERT_FALSE(root_map.has_property("nested_1"));
+    ASSERT_EQ(root_map.size(), 0u);
 
-    auto v = *std::get<ConfigMap*>(popped);
+    auto v = std::get<ConfigMap>(popped);
 
     ASSERT_TRUE(v.has_property("n1_prop"));
     pop_res = v.pop_property("n1_prop");
@@ -286,9 +226,9 @@ TEST(TestConfigMap, TestNestedStack)
     pop_res = v.pop_property("nested_2");
     ASSERT_TRUE(pop_res.is_ok());
     popped = pop_res.get_ok();
-    ASSERT_TRUE(std::holds_alternative<ConfigMap*>(popped));
+    ASSERT_TRUE(std::holds_alternative<ConfigMap>(popped));
 
-    auto v2{*std::get<ConfigMap*>(popped)};
+    auto v2{std::get<ConfigMap>(popped)};
 
     ASSERT_TRUE(v2.has_property("n2_prop"));
     pop_res = v2.pop_property("n2_prop");
@@ -299,6 +239,76 @@ TEST(TestConfigMap, TestNestedStack)
     ASSERT_EQ(std::get<int>(std::get<SexpCppValue>(popped)), 2);
 }
 
+TEST(TestConfigMap, TestNestedSnapshots)
+{
+    ConfigMap root_map;
+    ConfigMap nested;
+
+    ASSERT_TRUE(nested.register_property("n_prop", ConfigValue{1}).is_ok());
+    ASSERT_TRUE(root_map.register_property("nested", nested).is_ok());
+
+    // Registering copies the nested map in; later changes to the original are not seen.
+    ASSERT_TRUE(nested.set_property("n_prop", ConfigValue{2}).is_ok());
+
+    auto copy_res = root_map.copy_property("nested");
+    ASSERT_TRUE(copy_res.is_ok());
+    auto snapshot = std::get<ConfigMap>(copy_res.get_ok());
+    auto value = snapshot.copy_property("n_prop").get_ok();
+    ASSERT_EQ(std::get<int>(std::get<SexpCppValue>(value)), 1);
+
+    // A snapshot is independent of the map it was taken from, in both directions.
+    ConfigMap root_copy{root_map};
+    ASSERT_TRUE(snapshot.set_property("n_prop", ConfigValue{3}).is_ok());
+    ASSERT_TRUE(root_map.set_property("nested", nested).is_ok());
+
+    value = std::get<ConfigMap>(root_copy.copy_property("nested").get_ok()).copy_property("n_prop").get_ok();
+    ASSERT_EQ(std::get<int>(std::get<SexpCppValue>(value)), 1);
+    value = std::get<ConfigMap>(root_map.copy_property("nested").get_ok()).copy_property("n_prop").get_ok();
+    ASSERT_EQ(std::get<int>(std::get<SexpCppValue>(value)), 2);
+    value = snapshot.copy_property("n_prop").get_ok();
+    ASSERT_EQ(std::get<int>(std::get<SexpCppValue>(value)), 3);
+
+    ASSERT_TRUE(root_map.set_property("nested", ConfigValue{4}).is_err());
+    ASSERT_TRUE(root_copy.set_property("nested", ConfigMap{}).is_ok());
+    ASSERT_EQ(std::get<ConfigMap>(root_copy.copy_property("nested").get_ok()).size(), 0u);
+}
+
+TEST(TestConfigMap, TestRefProperty)
+{
+    ConfigMap root_map;
+    std::string long_text(64, 'x');
+
+    ASSERT_TRUE(root_map.register_properties({
+        {"flag", true},
+        {"count", 7},
+        {"ratio", 0.5},
+        {"short", std::string{"inline"}},
+        {"long", long_text},
+        {"name", scheme::Symbol{"Odyssey"}},
+    }).is_ok());
+
+    std::vector<std::string_view> expected_keys{"flag", "count", "ratio", "short", "long", "name"};
+    ASSERT_EQ(root_map.keys(), expected_keys);
+
+    EXPECT_EQ(root_map.ref_property("flag").get_ok().get_bool(), true);
+    EXPECT_EQ(root_map.ref_property("count").get_ok().get_int(), 7);
+    EXPECT_FALSE(root_map.ref_property("count").get_ok().get_double().has_value());
+    EXPECT_EQ(root_map.ref_property("ratio").get_ok().get_double(), 0.5);
+    EXPECT_EQ(root_map.ref_property("short").get_ok().get_string(), "inline");
+    EXPECT_EQ(root_map.ref_property("long").get_ok().get_string(), long_text);
+    EXPECT_FALSE(root_map.ref_property("name").get_ok().get_string().has_value());
+    EXPECT_EQ(root_map.ref_property("name").get_ok().get_symbol(), "Odyssey");
+    EXPECT_TRUE(root_map.ref_property("missing").is_err());
+
+    // Removing and re-adding keys many times must not disturb the remaining properties.
+    for (int idx = 0; idx < 1000; ++idx)
+    {
+        ASSERT_TRUE(root_map.register_property(fmt::format("tmp-{}", idx % 7), idx).is_ok());
+        ASSERT_TRUE(root_map.pop_property(fmt::format("tmp-{}", idx % 7)).is_ok());
+    }
+    ASSERT_EQ(root_map.keys(), expected_keys);
+}
+
 TEST(TestConfigNest, TestConstructors)
 {
     ConfigNest anonymous;
@@ -359,4 +369,672 @@ TEST(TestConfigManager, TestLoadConfig)
     ASSERT_TRUE(new_config.has_property("float-prop"));
 }
 
+TEST(TestConfigManager, TestLoadNestedConfig)
+{
+    ConfigMap colors;
+    ASSERT_TRUE(colors.register_property("prompt", std::string{"white"}).is_ok());
+    ASSERT_TRUE(colors.register_property("error", std::string{"white"}).is_ok());
+    ASSERT_TRUE(colors.register_property("warning", std::string{"yellow"}).is_ok());
+
+    ConfigMap display;
+    ASSERT_TRUE(display.register_property("width", 80).is_ok());
+    ASSERT_TRUE(display.register_property("colors", colors).is_ok());
+
+    ConfigMap history;
+    ASSERT_TRUE(history.register_property("enabled", false).is_ok());
+    ASSERT_TRUE(history.register_property("max-length", 100).is_ok());
+
+    ConfigMap limits;
+    ASSERT_TRUE(limits.register_property("depth", 4).is_ok());
+
+    ConfigMap default_map;
+    ASSERT_TRUE(default_map.register_property("name", std::string{"default"}).is_ok());
+    ASSERT_TRUE(default_map.register_property("display", display).is_ok());
+    ASSERT_TRUE(default_map.register_property("history", history).is_ok());
+    ASSERT_TRUE(default_map.register_property("limits", limits).is_ok());
+
+    ConfigManager manager{ConfigNest{"test-cfg", default_map}};
+    auto map_res = manager.load_config_from_file("data/tests/test_nested_config.scm");
+
+    ASSERT_TRUE(map_res.is_ok());
+    auto config = map_res.get_ok();
+
+    // The first occurrence of a duplicated key wins, as with assq.
+    EXPECT_EQ(config.ref_property("name").get_ok().get_string(), "nested");
+    EXPECT_FALSE(config.has_property("unregistered"));
+
+    auto loaded_display = std::get<ConfigMap>(config.copy_property("display").get_ok());
+    EXPECT_EQ(loaded_display.ref_property("width").get_ok().get_int(), 120);
+    EXPECT_FALSE(loaded_display.has_property("unknown-display-key"));
+
+    auto loaded_colors = std::get<ConfigMap>(loaded_display.copy_property("colors").get_ok());
+    EXPECT_EQ(loaded_colors.ref_property("prompt").get_ok().get_string(), "green");
+    EXPECT_EQ(loaded_colors.ref_property("error").get_ok().get_string(), "red");
+    EXPECT_EQ(loaded_colors.ref_property("warning").get_ok().get_string(), "yellow");
+
+    auto loaded_history = std::get<ConfigMap>(config.copy_property("history").get_ok());
+    EXPECT_EQ(loaded_history.ref_property("enabled").get_ok().get_bool(), true);
+    EXPECT_EQ(loaded_history.ref_property("max-length").get_ok().get_int(), 500);
+
+    // A scalar where a nested map is expected leaves the defaults in place.
+    auto loaded_limits = std::get<ConfigMap>(config.copy_property("limits").get_ok());
+    EXPECT_EQ(loaded_limits.ref_property("depth").get_ok().get_int(), 4);
+
+    // The defaults the manager was built from are untouched.
+    auto default_display = std::get<ConfigMap>(default_map.copy_property("display").get_ok());
+    EXPECT_EQ(default_display.ref_property("width").get_ok().get_int(), 80);
+}
+
+TEST(TestConfigManager, TestLoadConfigBorrowedSchemer)
+{
+    ConfigMap default_map;
+    ASSERT_TRUE(default_map.register_property("int-prop", 1).is_ok());
+    ASSERT_TRUE(default_map.register_property("string-prop", std::string{"default"}).is_ok());
+
+    scheme::Schemer schemer;
+    ConfigManager borrowing{ConfigNest{"test-cfg", default_map}, schemer};
+    auto map_res = borrowing.load_config_from_file("data/tests/test_config.scm");
+
+    ASSERT_TRUE(map_res.is_ok());
+    EXPECT_FALSE(borrowing.interpreter_started());
+    auto value = map_res.get_ok().copy_property("int-prop").get_ok();
+    EXPECT_EQ(std::get<int>(std::get<SexpCppValue>(value)), 42);
+
+    ConfigManager owning{ConfigNest{"test-cfg", default_map}};
+    map_res = owning.load_config_from_file("data/tests/test_config.scm");
+
+    ASSERT_TRUE(map_res.is_ok());
+    EXPECT_TRUE(owning.interpreter_started());
+    value = map_res.get_ok().copy_property("string-prop").get_ok();
+    EXPECT_EQ(std::get<std::string>(std::get<SexpCppValue>(value)), "customized property");
+
+    EXPECT_TRUE(owning.load_config_from_file("data/tests/does_not_exist.scm").is_err());
+}
+
+struct ColorsSchema
+{
+    std::string prompt = "white";
+    std::string error = "white";
+    std::string warning = "yellow";
+
+    static constexpr auto config_fields()
+    {
+        return std::tuple{
+            Field<"prompt", &ColorsSchema::prompt>{},
+            Field<"error", &ColorsSchema::error>{},
+            Field<"warning", &ColorsSchema::warning>{}};
+    }
+};
+
+struct DisplaySchema
+{
+    int width = 80;
+    ColorsSchema colors;
+
+    static constexpr auto config_fields()
+    {
+        return std::tuple{Field<"width", &DisplaySchema::width>{}, Field<"colors", &DisplaySchema::colors>{}};
+    }
+};
+
+struct NestedSchema
+{
+    std::string name = "default";
+    DisplaySchema display;
+
+    static constexpr std::string_view config_nest = "test-cfg";
+
+    static constexpr auto config_fields()
+    {
+        return std::tuple{Field<"name", &NestedSchema::name>{}, Field<"display", &NestedSchema::display>{}};
+    }
+};
+
+struct FlatSchema
+{
+    int int_prop = 1;
+    double float_prop = 17.0;
+    std::string string_prop = "default";
+    scheme::Symbol symbol_prop{"Iliad"};
+
+    static constexpr std::string_view config_nest = "test-cfg";
+
+    static constexpr auto config_fields()
+    {
+        return std::tuple{
+            Field<"int-prop", &FlatSchema::int_prop>{},
+            Field<"float-prop", &FlatSchema::float_prop>{},
+            Field<"string-prop", &FlatSchema::string_prop>{},
+            Field<"symbol-prop", &FlatSchema::symbol_prop>{}};
+    }
+};
+
+struct BoolSchema
+{
+    bool bool_prop = true;
+
+    static constexpr std::string_view config_nest = "test-cfg";
+
+    static constexpr auto config_fields()
+    {
+        return std::tuple{Field<"bool-prop", &BoolSchema::bool_prop>{}};
+    }
+};
+
+static_assert(ConfigSchema<NestedSchema>);
+static_assert(!ConfigSchema<DisplaySchema>);
+static_assert(Field<"int-prop", &FlatSchema::int_prop>::key.hash == fnv1a("int-prop"));
+
+TEST(TestConfigSchema, TestToConfigMap)
+{
+    NestedSchema defaults;
+    defaults.display.width = 100;
+    auto map = to_config_map(defaults);
+
+    EXPECT_EQ(map.size(), 2u);
+    EXPECT_EQ(map.ref_property("name").get_ok().get_string(), "default");
+    ASSERT_TRUE(map.property_is_nested_map("display").get_ok());
+
+    auto display = std::get<ConfigMap>(map.copy_property("display").get_ok());
+    EXPECT_EQ(display.ref_property("width").get_ok().get_int(), 100);
+
+    NestedSchema round_trip;
+    ASSERT_TRUE(from_config_map(map, round_trip).is_ok());
+    EXPECT_EQ(round_trip.display.width, 100);
+    EXPECT_EQ(round_trip.display.colors.warning, "yellow");
+}
+
+TEST(TestConfigSchema, TestLoadConfig)
+{
+    auto flat_res = load_config<FlatSchema>("data/tests/test_config.scm");
+
+    ASSERT_TRUE(flat_res.is_ok());
+    auto flat = flat_res.get_ok();
+    EXPECT_EQ(flat.int_prop, 42);
+    EXPECT_DOUBLE_EQ(flat.float_prop, 3.1415);
+    EXPECT_EQ(flat.string_prop, "customized property");
+    EXPECT_EQ(flat.symbol_prop, "Odyssey");
+
+    scheme::Schemer schemer;
+    auto nested_res = load_config<NestedSchema>("data/tests/test_nested_config.scm", schemer);
+
+    ASSERT_TRUE(nested_res.is_ok());
+    auto nested = nested_res.get_ok();
+    EXPECT_EQ(nested.name, "nested");
+    EXPECT_EQ(nested.display.width, 120);
+    EXPECT_EQ(nested.display.colors.prompt, "green");
+    EXPECT_EQ(nested.display.colors.error, "red");
+    EXPECT_EQ(nested.display.colors.warning, "yellow");
+}
+
+TEST(TestConfigSchema, TestFieldTypeError)
+{
+    // bool-prop is the symbol false in the fixture, not #f.
+    auto bool_res = load_config<BoolSchema>("data/tests/test_config.scm");
+
+    ASSERT_TRUE(bool_res.is_err());
+    EXPECT_EQ(bool_res.get_err().format(), FieldTypeError("bool-prop", "bool").format());
+
+    // An int is accepted for a double, but not the reverse.
+    ConfigMap map;
+    ASSERT_TRUE(map.register_property("float-prop", 3).is_ok());
+
+    FlatSchema flat;
+    ASSERT_TRUE(from_config_map(map, flat).is_ok());
+    EXPECT_DOUBLE_EQ(flat.float_prop, 3.0);
+
+    ASSERT_TRUE(map.register_property("int-prop", 2.5).is_ok());
+    EXPECT_TRUE(from_config_map(map, flat).is_err());
+    EXPECT_EQ(flat.int_prop, 1);
+}
+
+TEST(TestConfigPublisher, TestSnapshotsOutlivePublish)
+{
+    ConfigMap first;
+    ASSERT_TRUE(first.register_property("version", 1).is_ok());
+    ConfigPublisher publisher{first};
+
+    {
+        auto pinned = publisher.read();
+
+        ConfigMap second = first;
+        ASSERT_TRUE(second.set_property("version", 2).is_ok());
+        publisher.publish(second);
+
+        // The replaced version stays readable, and allocated, while it is pinned.
+        EXPECT_EQ(pinned->ref_property("version").get_ok().get_int(), 1);
+        EXPECT_EQ(publisher.read()->ref_property("version").get_ok().get_int(), 2);
+        EXPECT_EQ(publisher.retired_count(), 1u);
+    }
+
+    publisher.collect();
+    EXPECT_EQ(publisher.retired_count(), 0u);
+}
+
+TEST(TestConfigPublisher, TestConcurrentReaders)
+{
+    auto make_version = [](int version)
+    {
+        ConfigMap map;
+        auto res = map.register_properties({{"lhs", version}, {"rhs", version}});
+        assert(res.is_ok());
+        return map;
+    };
+
+    constexpr int versions = 500;
+    ConfigPublisher publisher{make_version(0)};
+    std::atomic<bool> done{false};
+    std::atomic<int> torn_reads{0};
+    std::vector<std::thread> readers;
+
+    for (int idx = 0; idx < 4; ++idx)
+    {
+        readers.emplace_back([&]()
+        {
+            int last_seen = 0;
+            while (!done.load())
+            {
+                auto snapshot = publisher.read();
+                auto lhs = snapshot->ref_property("lhs").get_ok().get_int();
+                auto rhs = snapshot->ref_property("rhs").get_ok().get_int();
+
+                // Every snapshot is internally consistent and versions never go backwards.
+                if (lhs != rhs || lhs.value() < last_seen)
+                {
+                    ++torn_reads;
+                }
+                last_seen = lhs.value();
+            }
+        });
+    }
+
+    for (int version = 1; version <= versions; ++version)
+    {
+        publisher.publish(make_version(version));
+    }
+
+    done = true;
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    EXPECT_EQ(torn_reads, 0);
+    EXPECT_EQ(publisher.read()->ref_property("lhs").get_ok().get_int(), versions);
+
+    publisher.collect();
+    EXPECT_EQ(publisher.retired_count(), 0u);
+}
+
+class TestConfigCache : public ::testing::Test
+{
+protected:
+    TestConfigCache()
+        :
+        cache_dir{std::filesystem::temp_directory_path() / fmt::format("samos_cache_test_{}", ::getpid())},
+        source{cache_dir / "source.scm"}
+    {
+        std::filesystem::create_directories(cache_dir);
+        std::filesystem::copy_file(
+            "data/tests/test_config.scm",
+            source,
+            std::filesystem::copy_options::overwrite_existing);
+    }
+
+    ~TestConfigCache()
+    {
+        std::filesystem::remove_all(cache_dir);
+    }
+
+    static ConfigNest make_nest()
+    {
+        ConfigMap default_map;
+        auto register_res = default_map.register_properties({
+            {"bool-prop", true},
+            {"int-prop", 1},
+            {"float-prop", 17.0},
+            {"string-prop", std::string{"default"}},
+            {"symbol-prop", scheme::Symbol{"Iliad"}},
+        });
+        assert(register_res.is_ok());
+
+        return ConfigNest{"test-cfg", default_map};
+    }
+
+    std::filesystem::path cache_dir;
+    std::filesystem::path source;
+};
+
+TEST_F(TestConfigCache, TestEncodeRoundTrip)
+{
+    ConfigMap nested;
+    ASSERT_TRUE(nested.register_property("depth", 2).is_ok());
+    ASSERT_TRUE(nested.register_property("label", std::string{"inner"}).is_ok());
+
+    ConfigMap root = make_nest().get_default_map();
+    ASSERT_TRUE(root.register_property("nested", nested).is_ok());
+
+    scheme::DatumBytes bytes;
+    encode_config_map(root, bytes);
+
+    auto decoded = decode_config_map(bytes);
+    ASSERT_TRUE(decoded.has_value());
+    ASSERT_EQ(decoded->keys(), root.keys());
+
+    auto value = decoded->copy_property("symbol-prop").get_ok();
+    ASSERT_TRUE(std::holds_alternative<SexpCppValue>(value));
+    ASSERT_TRUE(std::holds_alternative<scheme::Symbol>(std::get<SexpCppValue>(value)));
+    EXPECT_EQ(std::get<scheme::Symbol>(std::get<SexpCppValue>(value)), "Iliad");
+
+    value = decoded->copy_property("float-prop").get_ok();
+    EXPECT_EQ(std::get<double>(std::get<SexpCppValue>(value)), 17.0);
+
+    value = decoded->copy_property("nested").get_ok();
+    ASSERT_TRUE(std::holds_alternative<ConfigMap>(value));
+    auto decoded_nested = std::get<ConfigMap>(value);
+    value = decoded_nested.copy_property("depth").get_ok();
+    EXPECT_EQ(std::get<int>(std::get<SexpCppValue>(value)), 2);
+
+    bytes.push_back(0);
+    EXPECT_FALSE(decode_config_map(bytes).has_value());
+    bytes.resize(bytes.size() / 2);
+    EXPECT_FALSE(decode_config_map(bytes).has_value());
+}
+
+TEST_F(TestConfigCache, TestStoreAndLoad)
+{
+    ConfigCache cache{cache_dir / "cache"};
+    auto nest = make_nest();
+    auto fingerprint = ConfigCache::fingerprint(nest);
+
+    auto stamp = ConfigCache::stamp(source.string());
+    ASSERT_TRUE(stamp.has_value());
+    EXPECT_FALSE(cache.load(stamp.value(), fingerprint).has_value());
+
+    ASSERT_TRUE(cache.store(stamp.value(), fingerprint, nest.get_default_map()).is_ok());
+
+    auto loaded = cache.load(stamp.value(), fingerprint);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->keys(), nest.get_default_map().keys());
+
+    // Different defaults must not be served a map resolved against the old ones.
+    EXPECT_FALSE(cache.load(stamp.value(), fingerprint + 1).has_value());
+
+    std::ofstream{source, std::ios::app} << "\n";
+    auto new_stamp = ConfigCache::stamp(source.string());
+    ASSERT_TRUE(new_stamp.has_value());
+    EXPECT_NE(new_stamp->content_hash, stamp->content_hash);
+    EXPECT_FALSE(cache.load(new_stamp.value(), fingerprint).has_value());
+
+    EXPECT_FALSE(ConfigCache::stamp((cache_dir / "missing.scm").string()).has_value());
+}
+
+TEST_F(TestConfigCache, TestManagerSkipsInterpreterOnHit)
+{
+    auto cache = std::make_shared<const ConfigCache>(cache_dir / "cache");
+
+    ConfigManager cold{make_nest(), cache};
+    auto cold_res = cold.load_config_from_file(source.string());
+
+    ASSERT_TRUE(cold_res.is_ok());
+    EXPECT_TRUE(cold.interpreter_started());
+
+    ConfigManager warm{make_nest(), cache};
+    auto warm_res = warm.load_config_from_file(source.string());
+
+    ASSERT_TRUE(warm_res.is_ok());
+    EXPECT_FALSE(warm.interpreter_started());
+
+    auto cold_map = cold_res.get_ok();
+    auto warm_map = warm_res.get_ok();
+    ASSERT_EQ(cold_map.keys(), warm_map.keys());
+
+    auto value = warm_map.copy_property("int-prop").get_ok();
+    EXPECT_EQ(std::get<int>(std::get<SexpCppValue>(value)), 42);
+    value = warm_map.copy_property("symbol-prop").get_ok();
+    EXPECT_EQ(std::get<scheme::Symbol>(std::get<SexpCppValue>(value)), "Odyssey");
+}
+
+TEST(TestConfigMap, TestEqualityAndCheckTypes)
+{
+    ConfigMap nested;
+    ASSERT_TRUE(nested.register_property("depth", 4).is_ok());
+
+    ConfigMap lhs;
+    ASSERT_TRUE(lhs.register_property("name", std::string{"a"}).is_ok());
+    ASSERT_TRUE(lhs.register_property("limits", nested).is_ok());
+
+    ConfigMap rhs = lhs;
+    EXPECT_TRUE(lhs == rhs);
+    EXPECT_TRUE(lhs.ref_property("limits").get_ok() == rhs.ref_property("limits").get_ok());
+
+    ConfigMap deeper;
+    ASSERT_TRUE(deeper.register_property("depth", 5).is_ok());
+    ASSERT_TRUE(rhs.set_property("limits", deeper).is_ok());
+    EXPECT_FALSE(lhs == rhs);
+    EXPECT_TRUE(lhs.ref_property("name").get_ok() == rhs.ref_property("name").get_ok());
+    EXPECT_TRUE(rhs.check_types(lhs).is_ok());
+
+    ConfigMap wrong_type;
+    ASSERT_TRUE(wrong_type.register_property("depth", std::string{"deep"}).is_ok());
+    ConfigMap wrong = lhs;
+    ASSERT_TRUE(wrong.pop_property("limits").is_ok());
+    ASSERT_TRUE(wrong.register_property("limits", wrong_type).is_ok());
+
+    auto check_res = wrong.check_types(lhs);
+    ASSERT_TRUE(check_res.is_err());
+    EXPECT_EQ(check_res.get_err().format(), FieldTypeError("limits.depth", "int").format());
+}
+
+class TestConfigWatcher : public TestConfigCache
+{
+protected:
+    static constexpr const char* initial_source =
+        "((test-cfg . ((bool-prop . #f)\n"
+        "              (int-prop . 42)\n"
+        "              (float-prop . 3.1415)\n"
+        "              (string-prop . \"customized property\")\n"
+        "              (symbol-prop . Odyssey))))\n";
+
+    TestConfigWatcher()
+    {
+        write_source(initial_source);
+    }
+
+    void write_source(const std::string& contents)
+    {
+        // Replace the file the way editors do, so the watcher never sees it half written.
+        auto tmp = cache_dir / "source.scm.tmp";
+        std::ofstream{tmp} << contents;
+        std::filesystem::rename(tmp, source);
+    }
+
+    static bool wait_for(const std::function<bool()>& done)
+    {
+        for (int attempt = 0; attempt < 200; ++attempt)
+        {
+            if (done())
+            {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return done();
+    }
+};
+
+TEST_F(TestConfigWatcher, TestReloadOnChange)
+{
+    ConfigWatcher watcher{make_nest(), source.string()};
+    std::atomic<int> int_changes{0};
+    std::atomic<int> string_changes{0};
+
+    watcher.on_change("int-prop", [&](const ConfigRef& value)
+    {
+        EXPECT_EQ(value.get_int(), 7);
+        ++int_changes;
+    });
+    watcher.on_change("string-prop", [&](const ConfigRef&) { ++string_changes; });
+
+    ASSERT_TRUE(watcher.start().is_ok());
+    ASSERT_EQ(watcher.get_generation(), 1u);
+    auto initial = watcher.current();
+    EXPECT_EQ(initial->ref_property("int-prop").get_ok().get_int(), 42);
+
+    write_source(
+        "((test-cfg . ((int-prop . 7)\n"
+        "              (string-prop . \"customized property\"))))\n");
+
+    // Callbacks run after the new generation is published, so wait for them rather than it.
+    ASSERT_TRUE(wait_for([&]() { return int_changes == 1; }));
+    EXPECT_EQ(watcher.get_generation(), 2u);
+    auto reloaded = watcher.current();
+    EXPECT_EQ(reloaded->ref_property("int-prop").get_ok().get_int(), 7);
+    // Keys dropped from the file fall back to their defaults.
+    EXPECT_EQ(reloaded->ref_property("float-prop").get_ok().get_double(), 17.0);
+    EXPECT_EQ(string_changes, 0);
+
+    // Readers holding the old snapshot are unaffected.
+    EXPECT_EQ(initial->ref_property("int-prop").get_ok().get_int(), 42);
+
+    watcher.stop();
+}
+
+TEST_F(TestConfigWatcher, TestRejectInvalidReload)
+{
+    ConfigWatcher watcher{make_nest(), source.string()};
+
+    ASSERT_TRUE(watcher.start().is_ok());
+    watcher.stop();
+
+    write_source("((test-cfg . ((int-prop . \"not a number\"))))\n");
+
+    auto reload_res = watcher.reload();
+    ASSERT_TRUE(reload_res.is_err());
+    EXPECT_EQ(reload_res.get_err().format(), FieldTypeError("int-prop", "int").format());
+    EXPECT_EQ(watcher.get_generation(), 1u);
+    EXPECT_EQ(watcher.current()->ref_property("int-prop").get_ok().get_int(), 42);
+
+    write_source(initial_source);
+
+    // Reloading an equivalent config publishes nothing.
+    ASSERT_TRUE(watcher.reload().is_ok());
+    EXPECT_EQ(watcher.get_generation(), 1u);
+}
+
+TEST_F(TestConfigWatcher, TestReloadWidensIntegers)
+{
+    ConfigWatcher watcher{make_nest(), source.string()};
+
+    ASSERT_TRUE(watcher.start().is_ok());
+    watcher.stop();
+
+    write_source("((test-cfg . ((float-prop . 2))))\n");
+
+    auto reload_res = watcher.reload();
+    ASSERT_TRUE(reload_res.is_ok()) << reload_res.get_err().format();
+    EXPECT_EQ(watcher.get_generation(), 2u);
+    EXPECT_EQ(watcher.current()->ref_property("float-prop").get_ok().get_double(), 2.0);
+}
+
+class TestConfigLayers : public TestConfigCache
+{
+protected:
+    static ConfigNest make_layered_nest()
+    {
+        ConfigMap display;
+        auto register_res = display.register_properties({{"width", 80}, {"scale", 1.0}});
+        assert(register_res.is_ok());
+
+        ConfigMap default_map;
+        register_res = default_map.register_properties({
+            {"name", std::string{"default"}},
+            {"history", true},
+            {"theme", scheme::Symbol{"light"}},
+            {"display", display},
+        });
+        assert(register_res.is_ok());
+
+        return ConfigNest{"layered", default_map};
+    }
+
+    std::string write_layer(const std::string& name, const std::string& contents)
+    {
+        auto path = cache_dir / name;
+        std::ofstream{path} << contents;
+        return path.string();
+    }
+};
+
+TEST_F(TestConfigLayers, TestPrecedenceAndProvenance)
+{
+    auto system_file = write_layer(
+        "system.scm",
+        "((layered . ((name . \"system\") (history . #f) (display . ((width . 100) (scale . 2))))))");
+    auto user_file = write_layer("user.scm", "((layered . ((name . \"user\") (display . ((width . 120))))))");
+
+    ::setenv("SAMOS_TEST_LAYERS_DISPLAY_WIDTH", "140", 1);
+    ::setenv("SAMOS_TEST_LAYERS_THEME", "dark", 1);
+
+    ConfigLayers layers{make_layered_nest()};
+    layers.add_file(ConfigSource::SystemFile, system_file)
+        .add_file(ConfigSource::UserFile, user_file)
+        .add_file(ConfigSource::UserFile, (cache_dir / "missing.scm").string())
+        .add_environment("SAMOS_TEST_LAYERS")
+        .add_assignments({"layered.theme=solarized", "other-nest.theme=ignored"});
+
+    auto resolve_res = layers.resolve();
+
+    ::unsetenv("SAMOS_TEST_LAYERS_DISPLAY_WIDTH");
+    ::unsetenv("SAMOS_TEST_LAYERS_THEME");
+
+    ASSERT_TRUE(resolve_res.is_ok()) << resolve_res.get_err().format();
+    auto resolved = resolve_res.get_ok();
+    const auto& map = resolved.get_map();
+
+    EXPECT_EQ(map.ref_path("name").get_ok().get_string(), "user");
+    EXPECT_EQ(map.ref_path("history").get_ok().get_bool(), false);
+    EXPECT_EQ(map.ref_path("display.width").get_ok().get_int(), 140);
+    EXPECT_EQ(map.ref_path("display.scale").get_ok().get_double(), 2.0);
+    EXPECT_EQ(map.ref_path("theme").get_ok().get_symbol(), "solarized");
+
+    EXPECT_EQ(resolved.source_of("name"), ConfigSource::UserFile);
+    EXPECT_EQ(resolved.source_of("history"), ConfigSource::SystemFile);
+    EXPECT_EQ(resolved.source_of("display.width"), ConfigSource::Environment);
+    EXPECT_EQ(resolved.source_of("display.scale"), ConfigSource::SystemFile);
+    EXPECT_EQ(resolved.source_of("theme"), ConfigSource::CommandLine);
+
+    ConfigLayers defaults_only{make_layered_nest()};
+    auto defaults_res = defaults_only.resolve();
+
+    ASSERT_TRUE(defaults_res.is_ok());
+    EXPECT_EQ(defaults_res.get_ok().get_map().ref_path("display.width").get_ok().get_int(), 80);
+    EXPECT_EQ(defaults_res.get_ok().source_of("display.width"), ConfigSource::Default);
+}
+
+TEST_F(TestConfigLayers, TestBadOverrides)
+{
+    auto resolve_with = [](std::vector<std::string> assignments)
+    {
+        ConfigLayers layers{make_layered_nest()};
+        layers.add_assignments(std::move(assignments));
+        return layers.resolve();
+    };
+
+    EXPECT_TRUE(resolve_with({"layered.display.width=120"}).is_ok());
+    EXPECT_TRUE(resolve_with({"layered.display.width=wide"}).is_err());
+    EXPECT_TRUE(resolve_with({"layered.history=maybe"}).is_err());
+    EXPECT_TRUE(resolve_with({"layered.display=3"}).is_err());
+    EXPECT_TRUE(resolve_with({"layered.unknown=3"}).is_err());
+    EXPECT_TRUE(resolve_with({"layered.history"}).is_err());
+
+    auto bad_file = write_layer("bad.scm", "((layered . ((history . 3))))");
+    ConfigLayers layers{make_layered_nest()};
+    layers.add_file(ConfigSource::UserFile, bad_file);
+
+    auto resolve_res = layers.resolve();
+    ASSERT_TRUE(resolve_res.is_err());
+    EXPECT_EQ(resolve_res.get_err().format(), FieldTypeError("history", "bool").format());
+}
+
 }
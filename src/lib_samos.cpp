@@ -1,11 +1,54 @@
 #include "lib_samos.hpp"
 #include "ed_line.hpp"
 #include "kelyphos.hpp"
+#include "logger.hpp"
+#include "repl_server.hpp"
 
-void run_kelyphos()
+#include <csignal>
+#include <fmt/core.h>
+
+void run_kelyphos(std::vector<std::string> config_overrides)
 {
     samos::user_interface::ed_line::EdLine editor("kelyphos> ");
-    samos::user_interface::kelyphos::Kelyphos shell(&editor);
+    samos::user_interface::kelyphos::Kelyphos shell(&editor, std::move(config_overrides));
 
     shell.repl();
 }
+
+void run_kelyphos_server(std::vector<std::string> config_overrides)
+{
+    namespace kelyphos = samos::user_interface::kelyphos;
+
+    auto config = kelyphos::load_config(config_overrides);
+
+    kelyphos::ReplServerConfig server_config{};
+    server_config.socket_path = config.server_socket.empty() ? kelyphos::default_server_socket() : config.server_socket;
+    server_config.shared = config.server_shared;
+
+    if (config.server_port > 0 && config.server_port <= 0xffff)
+    {
+        server_config.tcp_port = static_cast<uint16_t>(config.server_port);
+    }
+
+    // Blocked before the server thread starts, so it inherits the mask and only sigwait sees them.
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+
+    kelyphos::ReplServer server{server_config, std::move(config_overrides)};
+    auto start_res = server.start();
+
+    if (start_res.is_err())
+    {
+        fmt::print(stderr, "{}\n", start_res.get_err().format());
+        return;
+    }
+
+    fmt::print("Serving Kelyphos on {}\n", server_config.socket_path);
+
+    int signal = 0;
+    sigwait(&stop_signals, &signal);
+    server.stop();
+}
@@ -1 +1,7 @@
-void run_kelyphos();
+#include <string>
+#include <vector>
+
+void run_kelyphos(std::vector<std::string> config_overrides = {});
+
+// Serves the shell on a local socket until SIGINT or SIGTERM.
+void run_kelyphos_server(std::vector<std::string> config_overrides = {});
@@ -0,0 +1,104 @@
+#include "event_log.hpp"
+#include "logger.hpp"
+
+#include "spdlog/sinks/basic_file_sink.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fmt/core.h>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+namespace event_log = samos::log::event_log;
+namespace slog = samos::log::logger;
+
+using event_log::field;
+
+constexpr int steps = 1000000;
+
+struct StepEvent
+{
+    uint64_t step;
+    int body;
+    double x;
+    double y;
+    double z;
+
+    static constexpr std::string_view event_name = "step";
+
+    static constexpr auto event_fields()
+    {
+        return std::tuple{
+            field<&StepEvent::step>("step"),
+            field<&StepEvent::body>("body"),
+            field<&StepEvent::x>("x"),
+            field<&StepEvent::y>("y"),
+            field<&StepEvent::z>("z")};
+    }
+};
+
+StepEvent make_step(int idx)
+{
+    double t = idx * 1e-3;
+    return StepEvent{static_cast<uint64_t>(idx), idx % 8, t * 1.5, t * -0.5, t * 0.25};
+}
+
+template<typename F>
+double ns_per_step(F&& record)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int idx = 0; idx < steps; ++idx)
+    {
+        record(make_step(idx));
+    }
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / steps;
+}
+
+// One per-step record of a body's position, as a text log line and as a binary event.
+int main()
+{
+    auto dir = std::filesystem::temp_directory_path();
+    auto text_path = dir / fmt::format("samos_bench_events_{}.log", ::getpid());
+    auto event_path = dir / fmt::format("samos_bench_events_{}.sel", ::getpid());
+
+    auto sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(text_path.string(), true);
+    spdlog::set_default_logger(std::make_shared<spdlog::logger>("bench", sink));
+    slog::set_level(slog::LogLevel::Info);
+
+    double text_ns = ns_per_step(
+        [](const StepEvent& event)
+        {
+            slog::log<slog::LogLevel::Info>(
+                "step {} body {} at ({}, {}, {})", event.step, event.body, event.x, event.y, event.z);
+        });
+    spdlog::default_logger_raw()->flush();
+
+    auto log_res = event_log::EventLog::open(event_path);
+    if (log_res.is_err())
+    {
+        fmt::print("{}\n", log_res.get_err().format());
+        return 1;
+    }
+
+    auto log = std::move(log_res).get_ok();
+    auto step = log->register_event<StepEvent>().get_ok();
+
+    double event_ns = ns_per_step([&log, &step](const StepEvent& event) { log->record(step, event); });
+    auto flush_res = log->flush();
+
+    fmt::print("{:>8} {:>14} {:>14}\n", "format", "ns per step", "bytes");
+    fmt::print("{:>8} {:>14.1f} {:>14}\n", "text", text_ns, std::filesystem::file_size(text_path));
+    fmt::print("{:>8} {:>14.1f} {:>14}\n", "event", event_ns, std::filesystem::file_size(event_path));
+    fmt::print("speedup: {:.1f}x\n", text_ns / event_ns);
+
+    spdlog::drop_all();
+    std::filesystem::remove(text_path);
+    std::filesystem::remove(event_path);
+
+    return flush_res.is_ok() ? 0 : 1;
+}
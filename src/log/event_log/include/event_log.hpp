@@ -0,0 +1,371 @@
+#ifndef SAMOS_EVENT_LOG_HPP
+#define SAMOS_EVENT_LOG_HPP
+
+#include "result.hpp"
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace samos::log::event_log
+{
+
+/*
+ * Event log format, version 1. All integers are little endian.
+ *
+ *   log     := "SE" version:u8 start:u64 frame*
+ *   frame   := kind:u8 size:u32 payload
+ *   schema  := id:u16 name:str count:u8 (field_name:str type:u8)*      (FrameKind::Schema)
+ *   records := thread:u64 (id:u16 time:u64 value*)*                    (FrameKind::Records)
+ *   str     := size:u32 bytes
+ *
+ * start is the wall clock time the log was opened in nanoseconds since the Unix epoch, and each
+ * record's time is steady clock nanoseconds since then. A value is 8 bytes for integer and
+ * double fields, 1 byte for bool and a str for strings. A schema frame always precedes the
+ * records that use it; a file cut short by a crash decodes up to its last whole frame.
+ */
+enum class FrameKind : uint8_t
+{
+    Schema = 1,
+    Records = 2,
+};
+
+enum class FieldType : uint8_t
+{
+    Int = 1,
+    UInt = 2,
+    Double = 3,
+    Bool = 4,
+    String = 5,
+};
+
+constexpr uint8_t event_log_magic[2] = {'S', 'E'};
+
+constexpr uint8_t event_log_version = 1;
+
+std::string_view format_field_type(FieldType type);
+
+template<typename V>
+constexpr FieldType field_type_of()
+{
+    if constexpr (std::is_same_v<V, bool>)
+    {
+        return FieldType::Bool;
+    }
+    else if constexpr (std::is_integral_v<V> && std::is_signed_v<V>)
+    {
+        return FieldType::Int;
+    }
+    else if constexpr (std::is_integral_v<V>)
+    {
+        return FieldType::UInt;
+    }
+    else if constexpr (std::is_floating_point_v<V>)
+    {
+        return FieldType::Double;
+    }
+    else
+    {
+        static_assert(
+            std::is_same_v<V, std::string> || std::is_same_v<V, std::string_view>,
+            "unsupported event field type");
+        return FieldType::String;
+    }
+}
+
+// Binds a field name to a data member of an event struct.
+template<auto Member>
+struct EventField
+{
+    static constexpr auto member = Member;
+
+    std::string_view name;
+};
+
+template<auto Member>
+constexpr EventField<Member> field(std::string_view name)
+{
+    return EventField<Member>{name};
+}
+
+/*
+ * An event is a plain struct describing one kind of record:
+ *
+ *     struct StepEvent
+ *     {
+ *         uint64_t step;
+ *         double dt;
+ *
+ *         static constexpr std::string_view event_name = "step";
+ *         static constexpr auto event_fields()
+ *         {
+ *             return std::tuple{field<&StepEvent::step>("step"), field<&StepEvent::dt>("dt")};
+ *         }
+ *     };
+ *
+ * Members may be bool, any integer or floating point type, std::string or std::string_view.
+ */
+template<typename T>
+concept EventRecord = requires {
+    { T::event_name } -> std::convertible_to<std::string_view>;
+    T::event_fields();
+};
+
+struct FieldSchema
+{
+    std::string name;
+    FieldType type;
+
+    bool operator==(const FieldSchema&) const = default;
+};
+
+struct EventSchema
+{
+    uint16_t id;
+    std::string name;
+    std::vector<FieldSchema> fields;
+};
+
+class EventLogError
+{
+public:
+    explicit EventLogError(const std::string& reason) : reason{reason}
+    {
+    }
+
+    std::string format() const
+    {
+        return fmt::format("Event log error: {}", reason);
+    }
+
+private:
+    std::string reason;
+};
+
+template <typename T = std::monostate>
+using EventLogResult = result::Result<T, EventLogError>;
+
+// Handle for recording one registered event type, obtained from EventLog::register_event.
+template<EventRecord T>
+class EventType {
+public:
+    [[nodiscard]] uint16_t id() const
+    {
+        return type_id;
+    }
+
+private:
+    friend class EventLog;
+
+    explicit EventType(uint16_t type_id) : type_id{type_id}
+    {
+    }
+
+    uint16_t type_id;
+};
+
+namespace detail
+{
+
+template<typename V>
+void put_le(std::vector<uint8_t>& out, V value)
+{
+    uint8_t bytes[sizeof(V)];
+
+    if constexpr (std::endian::native == std::endian::little)
+    {
+        std::memcpy(bytes, &value, sizeof(V));
+    }
+    else
+    {
+        for (size_t idx = 0; idx < sizeof(V); ++idx)
+        {
+            bytes[idx] = static_cast<uint8_t>(value >> (8 * idx));
+        }
+    }
+
+    size_t end = out.size();
+    out.resize(end + sizeof(V));
+    std::memcpy(out.data() + end, bytes, sizeof(V));
+}
+
+void put_string(std::vector<uint8_t>& out, std::string_view value);
+
+template<typename V>
+void put_value(std::vector<uint8_t>& out, const V& value)
+{
+    constexpr FieldType type = field_type_of<V>();
+
+    if constexpr (type == FieldType::Bool)
+    {
+        out.push_back(value ? 1 : 0);
+    }
+    else if constexpr (type == FieldType::Int)
+    {
+        put_le(out, static_cast<uint64_t>(static_cast<int64_t>(value)));
+    }
+    else if constexpr (type == FieldType::UInt)
+    {
+        put_le(out, static_cast<uint64_t>(value));
+    }
+    else if constexpr (type == FieldType::Double)
+    {
+        uint64_t bits;
+        double wide = value;
+        std::memcpy(&bits, &wide, sizeof(bits));
+        put_le(out, bits);
+    }
+    else
+    {
+        put_string(out, value);
+    }
+}
+
+// The type of the member that Field binds in Event.
+template<typename Event, typename Field>
+using member_type = std::remove_cvref_t<decltype(std::declval<const Event&>().*(Field::member))>;
+
+} // namespace detail
+
+/*
+ * Append-only binary log of typed events, for recording far more often than text logging
+ * allows. Each thread encodes records into its own buffer and hands whole buffers to the file,
+ * so recording never formats text and only takes a lock that no other thread holds unless the
+ * log is being flushed. Records from different threads are ordered by time only once decoded.
+ */
+class EventLog {
+public:
+    static constexpr size_t default_buffer_size = 64 * 1024;
+
+    [[nodiscard]] static EventLogResult<std::unique_ptr<EventLog>> open(
+        const std::filesystem::path& path,
+        size_t buffer_size = default_buffer_size);
+
+    // Flushes every thread's buffer.
+    ~EventLog();
+
+    EventLog(const EventLog&) = delete;
+
+    EventLog& operator=(const EventLog&) = delete;
+
+    /*
+     * Writes T's schema to the log. Registering the same event twice returns the same id; a
+     * different event under an existing name is an error.
+     */
+    template<EventRecord T>
+    [[nodiscard]] EventLogResult<EventType<T>> register_event()
+    {
+        EventSchema schema{0, std::string{T::event_name}, {}};
+
+        std::apply(
+            [&schema](const auto&... fields)
+            {
+                (schema.fields.push_back(FieldSchema{
+                    std::string{fields.name},
+                    field_type_of<detail::member_type<T, std::remove_cvref_t<decltype(fields)>>>()}), ...);
+            },
+            T::event_fields());
+
+        auto id_res = add_schema(std::move(schema));
+
+        if (id_res.is_err())
+        {
+            return std::move(id_res).template forward_err<EventType<T>>();
+        }
+
+        return EventLogResult<EventType<T>>::ok(EventType<T>{id_res.get_ok()});
+    }
+
+    template<EventRecord T>
+    void record(const EventType<T>& type, const T& event)
+    {
+        auto& buffer = local_buffer();
+        std::lock_guard<std::mutex> lock{buffer.lock};
+        auto& out = buffer.bytes;
+
+        detail::put_le(out, type.id());
+        detail::put_le(out, elapsed_ns());
+        std::apply(
+            [&out, &event](const auto&... fields)
+            {
+                (detail::put_value(out, event.*(std::remove_cvref_t<decltype(fields)>::member)), ...);
+            },
+            T::event_fields());
+
+        if (out.size() >= buffer_size)
+        {
+            flush_buffer(buffer);
+        }
+    }
+
+    // Writes out every thread's buffer; reports any write that failed since the last flush.
+    [[nodiscard]] EventLogResult<> flush();
+
+    [[nodiscard]] const std::filesystem::path& get_path() const;
+
+private:
+    struct ThreadBuffer
+    {
+        std::mutex lock;
+        uint64_t thread_id;
+        std::vector<uint8_t> bytes;
+    };
+
+    EventLog(std::ofstream&& file, std::filesystem::path path, size_t buffer_size);
+
+    [[nodiscard]] EventLogResult<uint16_t> add_schema(EventSchema&& schema);
+
+    [[nodiscard]] uint64_t elapsed_ns() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    ThreadBuffer& local_buffer();
+
+    ThreadBuffer& add_buffer();
+
+    // buffer.lock must be held.
+    void flush_buffer(ThreadBuffer& buffer);
+
+    // file_lock must be held.
+    void write_frame(FrameKind kind, const std::vector<uint8_t>& payload);
+
+    const uint64_t serial;
+
+    const std::filesystem::path path;
+
+    const size_t buffer_size;
+
+    const std::chrono::steady_clock::time_point start;
+
+    std::mutex file_lock;
+
+    std::ofstream file;
+
+    std::atomic<bool> write_failed;
+
+    std::mutex buffers_lock;
+
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    std::vector<EventSchema> schemas;
+};
+
+} // namespace samos::log::event_log
+
+#endif // SAMOS_EVENT_LOG_HPP
@@ -0,0 +1,51 @@
+#ifndef SAMOS_EVENT_LOG_READER_HPP
+#define SAMOS_EVENT_LOG_READER_HPP
+
+#include "event_log.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace samos::log::event_log
+{
+
+using FieldValue = std::variant<int64_t, uint64_t, double, bool, std::string>;
+
+struct DecodedEvent
+{
+    // Index into DecodedLog::schemas.
+    size_t schema;
+    uint64_t thread_id;
+    // Nanoseconds since DecodedLog::start_ns.
+    uint64_t time_ns;
+    std::vector<FieldValue> values;
+};
+
+struct DecodedLog
+{
+    uint64_t start_ns;
+    std::vector<EventSchema> schemas;
+    // Ordered by time; records with equal times keep their order in the file.
+    std::vector<DecodedEvent> events;
+    // The file ended part way through a frame, as it does if the writer crashed.
+    bool truncated;
+};
+
+[[nodiscard]] EventLogResult<DecodedLog> decode_event_log(std::span<const uint8_t> bytes);
+
+[[nodiscard]] EventLogResult<DecodedLog> read_event_log(const std::filesystem::path& path);
+
+// One line per event: offset in microseconds, thread, event name and name=value fields.
+void write_text(const DecodedLog& log, std::ostream& out);
+
+// JSON Lines: one object per event with time_ns, thread, event and a fields object.
+void write_json(const DecodedLog& log, std::ostream& out);
+
+} // namespace samos::log::event_log
+
+#endif // SAMOS_EVENT_LOG_READER_HPP
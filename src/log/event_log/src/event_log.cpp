@@ -0,0 +1,253 @@
+#include "event_log.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace samos::log::event_log
+{
+
+namespace
+{
+
+std::atomic<uint64_t> next_serial{1};
+
+// The buffer this thread used last, so recording to one log skips the registry lookup.
+struct BufferCache
+{
+    uint64_t serial = 0;
+    void* buffer = nullptr;
+};
+
+thread_local BufferCache buffer_cache;
+
+uint64_t current_thread_id()
+{
+    return static_cast<uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+}
+
+} // namespace
+
+std::string_view format_field_type(FieldType type)
+{
+    switch (type)
+    {
+    case FieldType::Int:
+        return "int";
+
+    case FieldType::UInt:
+        return "uint";
+
+    case FieldType::Double:
+        return "double";
+
+    case FieldType::Bool:
+        return "bool";
+
+    case FieldType::String:
+        return "string";
+    }
+
+    return "unknown";
+}
+
+namespace detail
+{
+
+void put_string(std::vector<uint8_t>& out, std::string_view value)
+{
+    auto size = static_cast<uint32_t>(std::min<size_t>(value.size(), std::numeric_limits<uint32_t>::max()));
+    put_le(out, size);
+    out.insert(out.end(), value.begin(), value.begin() + size);
+}
+
+} // namespace detail
+
+EventLogResult<std::unique_ptr<EventLog>> EventLog::open(const std::filesystem::path& path, size_t buffer_size)
+{
+    using OpenResult = EventLogResult<std::unique_ptr<EventLog>>;
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+
+    if (!file)
+    {
+        return OpenResult::err(EventLogError{fmt::format("opening {}", path.string())});
+    }
+
+    auto wall_start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::vector<uint8_t> header{event_log_magic[0], event_log_magic[1], event_log_version};
+    detail::put_le(header, static_cast<uint64_t>(wall_start));
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+
+    if (!file)
+    {
+        return OpenResult::err(EventLogError{fmt::format("writing {}", path.string())});
+    }
+
+    return OpenResult::ok(std::unique_ptr<EventLog>{new EventLog{std::move(file), path, buffer_size}});
+}
+
+EventLog::EventLog(std::ofstream&& file, std::filesystem::path path, size_t buffer_size)
+    :
+    serial{next_serial.fetch_add(1)},
+    path{std::move(path)},
+    buffer_size{buffer_size},
+    start{std::chrono::steady_clock::now()},
+    file{std::move(file)},
+    write_failed{false}
+{
+}
+
+EventLog::~EventLog()
+{
+    auto res = flush();
+    (void)res;
+}
+
+EventLogResult<uint16_t> EventLog::add_schema(EventSchema&& schema)
+{
+    std::lock_guard<std::mutex> lock{file_lock};
+
+    auto existing = std::find_if(
+        schemas.begin(),
+        schemas.end(),
+        [&schema](const EventSchema& known) { return known.name == schema.name; });
+
+    if (existing != schemas.end())
+    {
+        if (existing->fields != schema.fields)
+        {
+            return EventLogResult<uint16_t>::err(
+                EventLogError{fmt::format("event {} registered with different fields", schema.name)});
+        }
+
+        return EventLogResult<uint16_t>::ok(existing->id);
+    }
+
+    if (schemas.size() > std::numeric_limits<uint16_t>::max() || schema.fields.size() > UINT8_MAX)
+    {
+        return EventLogResult<uint16_t>::err(EventLogError{fmt::format("too many events or fields for {}", schema.name)});
+    }
+
+    schema.id = static_cast<uint16_t>(schemas.size());
+
+    std::vector<uint8_t> payload;
+    detail::put_le(payload, schema.id);
+    detail::put_string(payload, schema.name);
+    payload.push_back(static_cast<uint8_t>(schema.fields.size()));
+
+    for (const auto& field : schema.fields)
+    {
+        detail::put_string(payload, field.name);
+        payload.push_back(static_cast<uint8_t>(field.type));
+    }
+
+    write_frame(FrameKind::Schema, payload);
+    schemas.push_back(std::move(schema));
+
+    return EventLogResult<uint16_t>::ok(schemas.back().id);
+}
+
+EventLog::ThreadBuffer& EventLog::local_buffer()
+{
+    if (buffer_cache.serial == serial)
+    {
+        return *static_cast<ThreadBuffer*>(buffer_cache.buffer);
+    }
+
+    auto& buffer = add_buffer();
+    buffer_cache = BufferCache{serial, &buffer};
+
+    return buffer;
+}
+
+EventLog::ThreadBuffer& EventLog::add_buffer()
+{
+    uint64_t thread_id = current_thread_id();
+    std::lock_guard<std::mutex> lock{buffers_lock};
+
+    // Found when this thread alternates between logs and the cache has moved on.
+    for (auto& buffer : buffers)
+    {
+        if (buffer->thread_id == thread_id)
+        {
+            return *buffer;
+        }
+    }
+
+    auto& buffer = buffers.emplace_back(std::make_unique<ThreadBuffer>());
+    buffer->thread_id = thread_id;
+    buffer->bytes.reserve(buffer_size + buffer_size / 4);
+    // The buffer is the payload of a records frame, so it always starts with the thread id.
+    detail::put_le(buffer->bytes, thread_id);
+
+    return *buffer;
+}
+
+void EventLog::flush_buffer(ThreadBuffer& buffer)
+{
+    if (buffer.bytes.size() <= sizeof(buffer.thread_id))
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{file_lock};
+        write_frame(FrameKind::Records, buffer.bytes);
+    }
+
+    buffer.bytes.resize(sizeof(buffer.thread_id));
+}
+
+void EventLog::write_frame(FrameKind kind, const std::vector<uint8_t>& payload)
+{
+    std::vector<uint8_t> header{static_cast<uint8_t>(kind)};
+    detail::put_le(header, static_cast<uint32_t>(payload.size()));
+
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+    file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+
+    if (!file)
+    {
+        write_failed.store(true);
+    }
+}
+
+EventLogResult<> EventLog::flush()
+{
+    {
+        std::lock_guard<std::mutex> lock{buffers_lock};
+
+        for (auto& buffer : buffers)
+        {
+            std::lock_guard<std::mutex> buffer_lock{buffer->lock};
+            flush_buffer(*buffer);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{file_lock};
+        file.flush();
+
+        if (!file)
+        {
+            write_failed.store(true);
+        }
+    }
+
+    if (write_failed.exchange(false))
+    {
+        return EventLogResult<>::err(EventLogError{fmt::format("writing {}", path.string())});
+    }
+
+    return EventLogResult<>::ok({});
+}
+
+const std::filesystem::path& EventLog::get_path() const
+{
+    return path;
+}
+
+} // namespace samos::log::event_log
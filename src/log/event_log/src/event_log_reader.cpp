@@ -0,0 +1,390 @@
+#include "event_log_reader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+namespace samos::log::event_log
+{
+
+namespace
+{
+
+// Bounds checked little endian reads; a short buffer yields std::nullopt.
+class FrameReader {
+public:
+    explicit FrameReader(std::span<const uint8_t> in) : in{in}, pos{0}
+    {
+    }
+
+    template<typename V>
+    std::optional<V> le()
+    {
+        if (remaining() < sizeof(V))
+        {
+            return {};
+        }
+
+        uint64_t value = 0;
+        for (size_t idx = 0; idx < sizeof(V); ++idx)
+        {
+            value |= static_cast<uint64_t>(in[pos++]) << (8 * idx);
+        }
+
+        return static_cast<V>(value);
+    }
+
+    std::optional<std::string_view> string()
+    {
+        auto size = le<uint32_t>();
+        if (!size.has_value() || remaining() < size.value())
+        {
+            return {};
+        }
+
+        std::string_view view{reinterpret_cast<const char*>(in.data() + pos), size.value()};
+        pos += size.value();
+
+        return view;
+    }
+
+    std::optional<std::span<const uint8_t>> bytes(size_t size)
+    {
+        if (remaining() < size)
+        {
+            return {};
+        }
+
+        auto view = in.subspan(pos, size);
+        pos += size;
+
+        return view;
+    }
+
+    [[nodiscard]] size_t remaining() const
+    {
+        return in.size() - pos;
+    }
+
+private:
+    std::span<const uint8_t> in;
+
+    size_t pos;
+};
+
+std::optional<FieldValue> read_value(FrameReader& reader, FieldType type)
+{
+    switch (type)
+    {
+    case FieldType::Int:
+        if (auto value = reader.le<uint64_t>())
+        {
+            return FieldValue{static_cast<int64_t>(value.value())};
+        }
+        break;
+
+    case FieldType::UInt:
+        if (auto value = reader.le<uint64_t>())
+        {
+            return FieldValue{value.value()};
+        }
+        break;
+
+    case FieldType::Double:
+        if (auto bits = reader.le<uint64_t>())
+        {
+            double value;
+            std::memcpy(&value, &bits.value(), sizeof(value));
+            return FieldValue{value};
+        }
+        break;
+
+    case FieldType::Bool:
+        if (auto value = reader.le<uint8_t>())
+        {
+            return FieldValue{value.value() != 0};
+        }
+        break;
+
+    case FieldType::String:
+        if (auto value = reader.string())
+        {
+            return FieldValue{std::string{value.value()}};
+        }
+        break;
+    }
+
+    return {};
+}
+
+std::optional<EventSchema> read_schema(FrameReader& reader)
+{
+    auto id = reader.le<uint16_t>();
+    auto name = reader.string();
+    auto count = reader.le<uint8_t>();
+
+    if (!id.has_value() || !name.has_value() || !count.has_value())
+    {
+        return {};
+    }
+
+    EventSchema schema{id.value(), std::string{name.value()}, {}};
+
+    for (uint8_t idx = 0; idx < count.value(); ++idx)
+    {
+        auto field_name = reader.string();
+        auto type = reader.le<uint8_t>();
+
+        if (!field_name.has_value() || !type.has_value() || type.value() < 1 || type.value() > 5)
+        {
+            return {};
+        }
+
+        schema.fields.push_back(FieldSchema{std::string{field_name.value()}, static_cast<FieldType>(type.value())});
+    }
+
+    return schema;
+}
+
+std::string malformed(std::string_view what, size_t offset)
+{
+    return fmt::format("malformed {} at byte {}", what, offset);
+}
+
+void write_value(std::ostream& out, const FieldValue& value, bool json)
+{
+    std::visit(
+        [&out, json](const auto& v)
+        {
+            using V = std::decay_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<V, bool>)
+            {
+                out << (v ? "true" : "false");
+            }
+            else if constexpr (std::is_same_v<V, double>)
+            {
+                if (json && !std::isfinite(v))
+                {
+                    out << "null";
+                }
+                else
+                {
+                    out << fmt::format("{}", v);
+                }
+            }
+            else if constexpr (std::is_same_v<V, std::string>)
+            {
+                if (!json)
+                {
+                    out << fmt::format("\"{}\"", v);
+                    return;
+                }
+
+                out << '"';
+                for (char c : v)
+                {
+                    switch (c)
+                    {
+                    case '"':
+                        out << "\\\"";
+                        break;
+                    case '\\':
+                        out << "\\\\";
+                        break;
+                    case '\n':
+                        out << "\\n";
+                        break;
+                    case '\t':
+                        out << "\\t";
+                        break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20)
+                        {
+                            out << fmt::format("\\u{:04x}", static_cast<int>(c));
+                        }
+                        else
+                        {
+                            out << c;
+                        }
+                    }
+                }
+                out << '"';
+            }
+            else
+            {
+                out << v;
+            }
+        },
+        value);
+}
+
+} // namespace
+
+EventLogResult<DecodedLog> decode_event_log(std::span<const uint8_t> bytes)
+{
+    using DecodeResult = EventLogResult<DecodedLog>;
+
+    FrameReader reader{bytes};
+    auto magic0 = reader.le<uint8_t>();
+    auto magic1 = reader.le<uint8_t>();
+    auto version = reader.le<uint8_t>();
+    auto start = reader.le<uint64_t>();
+
+    if (magic0 != event_log_magic[0] || magic1 != event_log_magic[1] || !start.has_value())
+    {
+        return DecodeResult::err(EventLogError{"not an event log"});
+    }
+
+    if (version != event_log_version)
+    {
+        return DecodeResult::err(EventLogError{fmt::format("unsupported event log version {}", version.value())});
+    }
+
+    DecodedLog log{start.value(), {}, {}, false};
+    // Schema ids index this table; a gap left by a missing schema frame stays npos.
+    std::vector<size_t> schema_index;
+
+    while (reader.remaining() > 0)
+    {
+        size_t frame_offset = bytes.size() - reader.remaining();
+        auto kind = reader.le<uint8_t>();
+        auto size = reader.le<uint32_t>();
+        auto payload = size.has_value() ? reader.bytes(size.value()) : std::nullopt;
+
+        if (!kind.has_value() || !payload.has_value())
+        {
+            log.truncated = true;
+            break;
+        }
+
+        FrameReader frame{payload.value()};
+
+        if (kind.value() == static_cast<uint8_t>(FrameKind::Schema))
+        {
+            auto schema = read_schema(frame);
+            if (!schema.has_value())
+            {
+                return DecodeResult::err(EventLogError{malformed("schema", frame_offset)});
+            }
+
+            if (schema_index.size() <= schema->id)
+            {
+                schema_index.resize(schema->id + 1, std::string::npos);
+            }
+            schema_index[schema->id] = log.schemas.size();
+            log.schemas.push_back(std::move(schema.value()));
+        }
+        else if (kind.value() == static_cast<uint8_t>(FrameKind::Records))
+        {
+            auto thread_id = frame.le<uint64_t>();
+            if (!thread_id.has_value())
+            {
+                return DecodeResult::err(EventLogError{malformed("records", frame_offset)});
+            }
+
+            while (frame.remaining() > 0)
+            {
+                auto id = frame.le<uint16_t>();
+                auto time = frame.le<uint64_t>();
+
+                if (!id.has_value() || !time.has_value()
+                    || id.value() >= schema_index.size() || schema_index[id.value()] == std::string::npos)
+                {
+                    return DecodeResult::err(EventLogError{malformed("record", frame_offset)});
+                }
+
+                DecodedEvent event{schema_index[id.value()], thread_id.value(), time.value(), {}};
+                const auto& schema = log.schemas[event.schema];
+                event.values.reserve(schema.fields.size());
+
+                for (const auto& field : schema.fields)
+                {
+                    auto value = read_value(frame, field.type);
+                    if (!value.has_value())
+                    {
+                        return DecodeResult::err(EventLogError{malformed("record", frame_offset)});
+                    }
+                    event.values.push_back(std::move(value.value()));
+                }
+
+                log.events.push_back(std::move(event));
+            }
+        }
+        else
+        {
+            return DecodeResult::err(EventLogError{malformed("frame", frame_offset)});
+        }
+    }
+
+    std::stable_sort(
+        log.events.begin(),
+        log.events.end(),
+        [](const DecodedEvent& lhs, const DecodedEvent& rhs) { return lhs.time_ns < rhs.time_ns; });
+
+    return DecodeResult::ok(std::move(log));
+}
+
+EventLogResult<DecodedLog> read_event_log(const std::filesystem::path& path)
+{
+    std::ifstream file{path, std::ios::binary};
+
+    if (!file)
+    {
+        return EventLogResult<DecodedLog>::err(EventLogError{fmt::format("opening {}", path.string())});
+    }
+
+    std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    return decode_event_log(contents);
+}
+
+void write_text(const DecodedLog& log, std::ostream& out)
+{
+    for (const auto& event : log.events)
+    {
+        const auto& schema = log.schemas[event.schema];
+        out << fmt::format("{:>14.3f}us [thread {}] {}", static_cast<double>(event.time_ns) / 1e3, event.thread_id, schema.name);
+
+        for (size_t idx = 0; idx < event.values.size(); ++idx)
+        {
+            out << ' ' << schema.fields[idx].name << '=';
+            write_value(out, event.values[idx], false);
+        }
+
+        out << '\n';
+    }
+}
+
+void write_json(const DecodedLog& log, std::ostream& out)
+{
+    for (const auto& event : log.events)
+    {
+        const auto& schema = log.schemas[event.schema];
+        out << fmt::format(
+            "{{\"time_ns\":{},\"thread\":{},\"event\":",
+            log.start_ns + event.time_ns,
+            event.thread_id);
+        write_value(out, FieldValue{schema.name}, true);
+        out << ",\"fields\":{";
+
+        for (size_t idx = 0; idx < event.values.size(); ++idx)
+        {
+            if (idx > 0)
+            {
+                out << ',';
+            }
+            write_value(out, FieldValue{schema.fields[idx].name}, true);
+            out << ':';
+            write_value(out, event.values[idx], true);
+        }
+
+        out << "}}\n";
+    }
+}
+
+} // namespace samos::log::event_log
@@ -0,0 +1,207 @@
+#include "gtest/gtest.h"
+#include "event_log.hpp"
+#include "event_log_reader.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace event_log = samos::log::event_log;
+
+using event_log::field;
+
+namespace
+{
+
+struct StepEvent
+{
+    uint64_t step;
+    double dt;
+    bool converged;
+
+    static constexpr std::string_view event_name = "step";
+
+    static constexpr auto event_fields()
+    {
+        return std::tuple{
+            field<&StepEvent::step>("step"),
+            field<&StepEvent::dt>("dt"),
+            field<&StepEvent::converged>("converged")};
+    }
+};
+
+struct BodyEvent
+{
+    int body;
+    std::string name;
+    double x;
+
+    static constexpr std::string_view event_name = "body";
+
+    static constexpr auto event_fields()
+    {
+        return std::tuple{
+            field<&BodyEvent::body>("body"),
+            field<&BodyEvent::name>("name"),
+            field<&BodyEvent::x>("x")};
+    }
+};
+
+// Same name as StepEvent with different fields.
+struct OtherStepEvent
+{
+    int step;
+
+    static constexpr std::string_view event_name = "step";
+
+    static constexpr auto event_fields()
+    {
+        return std::tuple{field<&OtherStepEvent::step>("step")};
+    }
+};
+
+} // namespace
+
+class TestEventLog : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        path = std::filesystem::temp_directory_path() / fmt::format("samos_event_log_{}.sel", ::getpid());
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(path);
+    }
+
+    std::vector<uint8_t> read_bytes() const
+    {
+        std::ifstream file{path, std::ios::binary};
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    std::filesystem::path path;
+};
+
+TEST_F(TestEventLog, RoundTripsTypedRecords)
+{
+    {
+        auto log = event_log::EventLog::open(path).get_ok();
+        auto step = log->register_event<StepEvent>().get_ok();
+        auto body = log->register_event<BodyEvent>().get_ok();
+
+        EXPECT_EQ(log->register_event<StepEvent>().get_ok().id(), step.id());
+        EXPECT_TRUE(log->register_event<OtherStepEvent>().is_err());
+
+        log->record(step, StepEvent{1, 0.5, false});
+        log->record(body, BodyEvent{-3, "moon \"luna\"", 1.25});
+        log->record(step, StepEvent{2, 0.25, true});
+        EXPECT_TRUE(log->flush().is_ok());
+    }
+
+    auto decoded = event_log::read_event_log(path).get_ok();
+
+    EXPECT_FALSE(decoded.truncated);
+    ASSERT_EQ(decoded.schemas.size(), 2);
+    EXPECT_EQ(decoded.schemas[0].name, "step");
+    EXPECT_EQ(decoded.schemas[0].fields[1].type, event_log::FieldType::Double);
+    EXPECT_EQ(decoded.schemas[1].fields[1].type, event_log::FieldType::String);
+
+    ASSERT_EQ(decoded.events.size(), 3);
+    EXPECT_EQ(decoded.schemas[decoded.events[1].schema].name, "body");
+    EXPECT_EQ(std::get<int64_t>(decoded.events[1].values[0]), -3);
+    EXPECT_EQ(std::get<std::string>(decoded.events[1].values[1]), "moon \"luna\"");
+    EXPECT_EQ(std::get<uint64_t>(decoded.events[2].values[0]), 2);
+    EXPECT_EQ(std::get<bool>(decoded.events[2].values[2]), true);
+    EXPECT_LE(decoded.events[0].time_ns, decoded.events[2].time_ns);
+
+    std::ostringstream text;
+    event_log::write_text(decoded, text);
+    EXPECT_NE(text.str().find("step step=1 dt=0.5 converged=false"), std::string::npos);
+
+    std::ostringstream json;
+    event_log::write_json(decoded, json);
+    EXPECT_NE(
+        json.str().find("\"event\":\"body\",\"fields\":{\"body\":-3,\"name\":\"moon \\\"luna\\\"\",\"x\":1.25}"),
+        std::string::npos);
+}
+
+TEST_F(TestEventLog, MergesThreadsInTimeOrder)
+{
+    constexpr int threads = 4;
+    constexpr int per_thread = 5000;
+
+    {
+        // Small buffers so every thread hands over several frames.
+        auto log = event_log::EventLog::open(path, 512).get_ok();
+        auto step = log->register_event<StepEvent>().get_ok();
+
+        std::vector<std::thread> workers;
+        for (int thread = 0; thread < threads; ++thread)
+        {
+            workers.emplace_back([&log, step]()
+            {
+                for (int idx = 0; idx < per_thread; ++idx)
+                {
+                    log->record(step, StepEvent{static_cast<uint64_t>(idx), 0.0, false});
+                }
+            });
+        }
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    auto decoded = event_log::read_event_log(path).get_ok();
+    ASSERT_EQ(decoded.events.size(), threads * per_thread);
+
+    std::map<uint64_t, uint64_t> next_step;
+    for (size_t idx = 0; idx < decoded.events.size(); ++idx)
+    {
+        const auto& event = decoded.events[idx];
+        if (idx > 0)
+        {
+            EXPECT_LE(decoded.events[idx - 1].time_ns, event.time_ns);
+        }
+
+        auto step = std::get<uint64_t>(event.values[0]);
+        EXPECT_EQ(step, next_step[event.thread_id]);
+        next_step[event.thread_id] = step + 1;
+    }
+    EXPECT_EQ(next_step.size(), threads);
+}
+
+TEST_F(TestEventLog, DecodesUpToATruncatedFrame)
+{
+    {
+        auto log = event_log::EventLog::open(path, 64).get_ok();
+        auto body = log->register_event<BodyEvent>().get_ok();
+
+        for (int idx = 0; idx < 20; ++idx)
+        {
+            log->record(body, BodyEvent{idx, "io", 0.0});
+        }
+    }
+
+    auto bytes = read_bytes();
+    auto whole = event_log::decode_event_log(bytes).get_ok();
+    ASSERT_EQ(whole.events.size(), 20);
+
+    bytes.resize(bytes.size() - 3);
+    auto cut = event_log::decode_event_log(bytes).get_ok();
+    EXPECT_TRUE(cut.truncated);
+    EXPECT_LT(cut.events.size(), 20);
+    EXPECT_GT(cut.events.size(), 0);
+
+    std::vector<uint8_t> garbage{'n', 'o', 'p', 'e'};
+    EXPECT_TRUE(event_log::decode_event_log(garbage).is_err());
+}
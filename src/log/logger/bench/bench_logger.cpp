@@ -0,0 +1,153 @@
+#include "logger.hpp"
+
+#include "spdlog/sinks/basic_file_sink.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fmt/core.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace slog = samos::log::logger;
+
+// Bursts sized to fit the default queue, with a pause after each for the writer to catch up.
+constexpr int bursts = 20;
+
+constexpr int burst_size = 1000;
+
+constexpr std::chrono::milliseconds burst_pause{30};
+
+double thread_cpu_ns()
+{
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) * 1e9 + static_cast<double>(now.tv_nsec);
+}
+
+/*
+ * CPU time spent inside log() by the calling threads during bursts, which is what a hot path
+ * pays. Thread CPU time rather than wall time, so the writer thread's share of a shared core is
+ * not charged to the callers. A sustained flood is bounded by the file sink in every mode.
+ */
+double ns_per_call(int threads)
+{
+    std::atomic<double> logging{0};
+
+    for (int burst = 0; burst < bursts; ++burst)
+    {
+        std::vector<std::thread> workers;
+
+        for (int thread = 0; thread < threads; ++thread)
+        {
+            workers.emplace_back([thread, &logging]()
+            {
+                double start = thread_cpu_ns();
+
+                for (int idx = 0; idx < burst_size; ++idx)
+                {
+                    slog::log(slog::LogLevel::Info, "{} worker {} finished step {} of {}", __LINE__, thread, idx, 3.25);
+                }
+
+                logging.fetch_add(thread_cpu_ns() - start);
+            });
+        }
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        std::this_thread::sleep_for(burst_pause);
+    }
+
+    return logging.load() / (bursts * burst_size * threads);
+}
+
+constexpr int disabled_calls = 10000000;
+
+template<typename F>
+double ns_per_disabled_call(F&& call)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int idx = 0; idx < disabled_calls; ++idx)
+    {
+        call(idx);
+    }
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / disabled_calls;
+}
+
+// Calls on a hot path whose messages are not wanted.
+void bench_disabled_calls()
+{
+    slog::set_level(slog::LogLevel::Error);
+    std::string key{"a-config-key-long-enough-to-allocate"};
+
+    double runtime_level = ns_per_disabled_call(
+        [&key](int idx) { slog::log(slog::LogLevel::Warn, "{} Updated property for key {}", idx, key); });
+    double runtime_filtered = ns_per_disabled_call(
+        [&key](int idx) { slog::log<slog::LogLevel::Warn>("{} Updated property for key {}", idx, key); });
+    double compiled_out = ns_per_disabled_call(
+        [&key](int idx) { slog::log<slog::LogLevel::Debug>("{} Updated property for key {}", idx, key); });
+
+    fmt::print("\n{:>22} {:>14}\n", "disabled call", "ns per call");
+    fmt::print("{:>22} {:>14.2f}\n", "runtime level", runtime_level);
+    fmt::print("{:>22} {:>14.2f}\n", "filtered at run time", runtime_filtered);
+    fmt::print("{:>22} {:>14.2f}\n", "compiled out", compiled_out);
+}
+
+int main()
+{
+    auto path = std::filesystem::temp_directory_path() / "samos_bench_logger.log";
+    auto sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(path.string(), true);
+    spdlog::set_default_logger(std::make_shared<spdlog::logger>("bench", sink));
+    slog::set_level(slog::LogLevel::Info);
+
+    struct Mode
+    {
+        const char* name;
+        bool async;
+        slog::OverflowPolicy overflow;
+    };
+
+    const std::vector<Mode> modes = {
+        {"sync", false, slog::OverflowPolicy::Block},
+        {"block", true, slog::OverflowPolicy::Block},
+        {"drop", true, slog::OverflowPolicy::Drop},
+        {"drop-oldest", true, slog::OverflowPolicy::DropOldest},
+    };
+
+    fmt::print("{:>12} {:>8} {:>14} {:>10}\n", "mode", "threads", "cpu ns/call", "dropped");
+
+    for (int threads : {1, 4})
+    {
+        for (const auto& mode : modes)
+        {
+            if (mode.async)
+            {
+                slog::start_async({4096, mode.overflow, std::chrono::milliseconds{50}});
+            }
+
+            double latency = ns_per_call(threads);
+            slog::stop_async();
+
+            uint64_t dropped = mode.async ? slog::async_stats().dropped : 0;
+            fmt::print("{:>12} {:>8} {:>14.1f} {:>10}\n", mode.name, threads, latency, dropped);
+        }
+    }
+
+    bench_disabled_calls();
+
+    spdlog::drop_all();
+    std::filesystem::remove(path);
+
+    return 0;
+}
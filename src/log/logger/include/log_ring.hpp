@@ -0,0 +1,147 @@
+#ifndef SAMOS_LOG_RING_HPP
+#define SAMOS_LOG_RING_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+
+namespace samos::log::logger::detail
+{
+
+constexpr size_t cache_line_size = 64;
+
+/*
+ * Bounded lock-free queue of preallocated slots. Each slot carries a sequence number that tells
+ * producers and consumers whose turn it is, so claiming a slot is a single CAS on the head or
+ * tail and the payload is written in place without copying. Any number of threads may push and
+ * pop; the logger has many producers, one writer thread, and producers that pop to discard the
+ * oldest record when the queue is full.
+ */
+template<typename T>
+class LogRing {
+public:
+    explicit LogRing(size_t min_capacity)
+        :
+        mask{std::bit_ceil(min_capacity < 2 ? size_t{2} : min_capacity) - 1},
+        cells{std::make_unique<Cell[]>(mask + 1)}
+    {
+        for (size_t idx = 0; idx <= mask; ++idx)
+        {
+            cells[idx].sequence.store(idx, std::memory_order_relaxed);
+        }
+    }
+
+    LogRing(const LogRing&) = delete;
+
+    LogRing& operator=(const LogRing&) = delete;
+
+    /*
+     * Calls fill(T&) on a claimed slot and publishes it; false when the queue is full. The slot is
+     * published even if fill throws, holding whatever fill left in it, since an unpublished slot
+     * would stall every consumer behind it.
+     */
+    template<typename F>
+    bool try_push(F&& fill)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto lag = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+
+            if (lag == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    Publish publish{cell.sequence, pos + 1};
+                    fill(cell.value);
+                    return true;
+                }
+            }
+            else if (lag < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Calls drain(T&) on the oldest slot and releases it; false when the queue is empty.
+    template<typename F>
+    bool try_pop(F&& drain)
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto lag = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+
+            if (lag == 0)
+            {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    drain(cell.value);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lag < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    [[nodiscard]] size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+    // Approximate while other threads are pushing or popping.
+    [[nodiscard]] bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Publish
+    {
+        ~Publish()
+        {
+            sequence.store(value, std::memory_order_release);
+        }
+
+        std::atomic<size_t>& sequence;
+        size_t value;
+    };
+
+    struct alignas(cache_line_size) Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t mask;
+
+    std::unique_ptr<Cell[]> cells;
+
+    alignas(cache_line_size) std::atomic<size_t> tail{0};
+
+    alignas(cache_line_size) std::atomic<size_t> head{0};
+};
+
+} // namespace samos::log::logger::detail
+
+#endif // SAMOS_LOG_RING_HPP
@@ -8,11 +8,46 @@
 #include "spdlog/spdlog.h"
 #include "spdlog/common.h"
 #include "fmt/core.h"
+#include "fmt/format.h"
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace samos::log::logger
 {
 
+/*
+ * An error or other value that knows how to describe itself. Passing one to log() rather than
+ * calling format() at the call site defers building the message until a sink actually wants it,
+ * so a message below the active level costs nothing.
+ */
+template<typename T>
+concept SelfFormatting = requires(const T& value)
+{
+    { value.format() } -> std::convertible_to<std::string>;
+} && !std::is_convertible_v<const T&, std::string_view>;
+
+// Values of SAMOS_LOG_ACTIVE_LEVEL, matching LogLevel.
+#define SAMOS_LOG_LEVEL_TRACE 0
+#define SAMOS_LOG_LEVEL_DEBUG 1
+#define SAMOS_LOG_LEVEL_INFO 2
+#define SAMOS_LOG_LEVEL_WARN 3
+#define SAMOS_LOG_LEVEL_ERROR 4
+#define SAMOS_LOG_LEVEL_CRITICAL 5
+#define SAMOS_LOG_LEVEL_OFF 6
+
+// Lowest level compiled in; set with the SAMOS_LOG_ACTIVE_LEVEL cache variable.
+#ifndef SAMOS_LOG_ACTIVE_LEVEL
+#define SAMOS_LOG_ACTIVE_LEVEL SAMOS_LOG_LEVEL_TRACE
+#endif
+
 enum class LogLevel
 {
     Trace = spdlog::level::trace,
@@ -24,37 +59,110 @@ enum class LogLevel
     Off = spdlog::level::off
 };
 
+// What a producer does when the async queue is full.
+enum class OverflowPolicy
+{
+    // Wait for the writer thread to make room; nothing is lost.
+    Block,
+    // Discard the new message.
+    Drop,
+    // Discard the oldest queued message to make room for the new one.
+    DropOldest,
+};
 
-template<typename FormatString, typename ... Args>
-void log(LogLevel level, const FormatString& fmt, Args&&... args)
+struct AsyncConfig
 {
-    switch (level)
-    {
-    case LogLevel::Info:
-        spdlog::info(fmt, std::forward<Args>(args)...);
-        break;
+    // Rounded up to a power of two.
+    size_t queue_size = 4096;
+    OverflowPolicy overflow = OverflowPolicy::Block;
+    // Longest the writer thread sleeps before checking for messages again.
+    std::chrono::milliseconds flush_interval{50};
+};
 
-    case LogLevel::Debug:
-        spdlog::debug(fmt, std::forward<Args>(args)...);
-        break;
+struct AsyncStats
+{
+    uint64_t written;
+    uint64_t dropped;
+    size_t queue_size;
+};
 
-    case LogLevel::Warn:
-        spdlog::warn(fmt, std::forward<Args>(args)...);
-        break;
+constexpr LogLevel active_level = static_cast<LogLevel>(SAMOS_LOG_ACTIVE_LEVEL);
 
-    case LogLevel::Error:
-        spdlog::error(fmt, std::forward<Args>(args)...);
-        break;
+/*
+ * A message that builds its own text from arguments it captured. With async logging on, render
+ * runs on the writer thread, so the caller only pays for the capture; otherwise it runs at once.
+ * render must not log.
+ */
+class DeferredMessage {
+public:
+    virtual ~DeferredMessage() = default;
 
-    case LogLevel::Critical:
-        spdlog::critical(fmt, std::forward<Args>(args)...);
-        break;
+    virtual void render(fmt::memory_buffer& out) const = 0;
+};
+
+namespace detail
+{
+
+extern std::atomic<bool> async_active;
+
+void enqueue(LogLevel level, fmt::string_view fmt, fmt::format_args args);
+
+// Formats and writes synchronously, or queues when async logging is on.
+void dispatch(LogLevel level, fmt::string_view fmt, fmt::format_args args);
+
+void write(LogLevel level, fmt::string_view fmt, fmt::format_args args);
+
+void enqueue_deferred(LogLevel level, std::unique_ptr<DeferredMessage> message);
+
+void write_deferred(LogLevel level, const DeferredMessage& message);
+
+inline bool enabled(LogLevel level)
+{
+    return level >= active_level
+        && level != LogLevel::Off
+        && spdlog::default_logger_raw()->should_log(static_cast<spdlog::level::level_enum>(level));
+}
 
-    default:
-        break;
+} // namespace detail
+
+/*
+ * Preferred form for a level known at the call site: below active_level the call compiles to
+ * nothing, and otherwise the arguments are only formatted once the runtime level allows it.
+ * Format strings are checked against the arguments at compile time; wrap one built at run time
+ * in fmt::runtime.
+ *
+ *     log<LogLevel::Debug>("{} Loaded {}", __LINE__, filename);
+ */
+template<LogLevel Level, typename ... Args>
+void log(fmt::format_string<const Args&...> fmt, const Args&... args)
+{
+    if constexpr (Level >= active_level && Level != LogLevel::Off)
+    {
+        if (detail::enabled(Level))
+        {
+            detail::dispatch(Level, fmt, fmt::make_format_args(args...));
+        }
     }
 }
 
+// For levels chosen at run time.
+template<typename ... Args>
+void log(LogLevel level, fmt::format_string<const Args&...> fmt, const Args&... args)
+{
+    if (detail::enabled(level))
+    {
+        detail::dispatch(level, fmt, fmt::make_format_args(args...));
+    }
+}
+
+// True if a message at level would be written; check it before capturing a DeferredMessage.
+[[nodiscard]] inline bool should_log(LogLevel level)
+{
+    return detail::enabled(level);
+}
+
+void log_deferred(LogLevel level, std::unique_ptr<DeferredMessage> message);
+
 template<typename FormatString>
 void set_pattern(const FormatString& fmt)
 {
@@ -63,6 +171,35 @@ void set_pattern(const FormatString& fmt)
 
 void set_level(LogLevel level);
 
+/*
+ * Hands formatted messages to a lock-free queue drained by a background thread, so logging
+ * from a hot path costs a format and a slot claim instead of a synchronous sink write. Messages
+ * keep the time and thread id of the call. Restarting with a new config drains the old queue
+ * first.
+ */
+void start_async(const AsyncConfig& config = {});
+
+// Drains the queue and returns to synchronous logging. Also runs at exit.
+void stop_async();
+
+[[nodiscard]] bool is_async();
+
+// Counters for the current or most recent async session.
+[[nodiscard]] AsyncStats async_stats();
+
+// "block", "drop" or "drop-oldest".
+[[nodiscard]] std::optional<OverflowPolicy> parse_overflow_policy(std::string_view name);
+
 }
 
+template<samos::log::logger::SelfFormatting T>
+struct fmt::formatter<T> : fmt::formatter<std::string_view>
+{
+    template<typename FormatContext>
+    auto format(const T& value, FormatContext& ctx) const
+    {
+        return fmt::formatter<std::string_view>::format(value.format(), ctx);
+    }
+};
+
 #endif // SAMOS_LOGGER_HPP
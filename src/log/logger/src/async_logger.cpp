@@ -0,0 +1,420 @@
+#include "logger.hpp"
+#include "log_ring.hpp"
+
+#include "spdlog/details/log_msg.h"
+#include "spdlog/details/os.h"
+#include "spdlog/sinks/sink.h"
+#include "fmt/format.h"
+
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace samos::log::logger
+{
+
+namespace detail
+{
+
+std::atomic<bool> async_active{false};
+
+} // namespace detail
+
+namespace
+{
+
+// Messages up to this size are formatted straight into the queue slot; longer ones allocate.
+constexpr size_t inline_text_size = 256;
+
+struct LogRecord
+{
+    spdlog::log_clock::time_point time;
+    size_t thread_id;
+    spdlog::level::level_enum level;
+    fmt::basic_memory_buffer<char, inline_text_size> text;
+    // Rendered by the writer in place of text when set.
+    std::unique_ptr<DeferredMessage> deferred;
+};
+
+class AsyncBackend {
+public:
+    explicit AsyncBackend(const AsyncConfig& config)
+        :
+        config{config},
+        ring{config.queue_size},
+        writer{[this]() { run(); }}
+    {
+    }
+
+    ~AsyncBackend()
+    {
+        stop();
+    }
+
+    AsyncBackend(const AsyncBackend&) = delete;
+
+    AsyncBackend& operator=(const AsyncBackend&) = delete;
+
+    void enqueue(LogLevel level, fmt::string_view fmt, fmt::format_args args)
+    {
+        producers.fetch_add(1);
+
+        if (accepting.load())
+        {
+            push(level, [&](LogRecord& record)
+            {
+                record.text.clear();
+                fmt::vformat_to(std::back_inserter(record.text), fmt, args);
+            });
+        }
+        else
+        {
+            detail::write(level, fmt, args);
+        }
+
+        producers.fetch_sub(1);
+    }
+
+    void enqueue_deferred(LogLevel level, std::unique_ptr<DeferredMessage> message)
+    {
+        producers.fetch_add(1);
+
+        if (accepting.load())
+        {
+            // Ownership only moves once a slot is claimed, so a failed attempt keeps the message.
+            push(level, [&](LogRecord& record) { record.deferred = std::move(message); });
+        }
+        else
+        {
+            detail::write_deferred(level, *message);
+        }
+
+        producers.fetch_sub(1);
+    }
+
+    // Refuses new messages, waits out producers mid-push, then drains and joins the writer.
+    void stop()
+    {
+        accepting.store(false);
+
+        while (producers.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{wake_mutex};
+            running = false;
+        }
+        wake.notify_one();
+
+        if (writer.joinable())
+        {
+            writer.join();
+        }
+    }
+
+    [[nodiscard]] AsyncStats stats() const
+    {
+        return AsyncStats{written.load(), dropped.load(), ring.capacity()};
+    }
+
+private:
+    template<typename FillMessage>
+    void push(LogLevel level, FillMessage&& fill_message)
+    {
+        auto fill = [&](LogRecord& record)
+        {
+            record.time = spdlog::log_clock::now();
+            record.thread_id = spdlog::details::os::thread_id();
+            record.level = static_cast<spdlog::level::level_enum>(level);
+
+            // The slot is published either way, so a message that fails to format leaves a note.
+            try
+            {
+                fill_message(record);
+            }
+            catch (const std::exception& error)
+            {
+                record.deferred.reset();
+                record.text.clear();
+                fmt::format_to(
+                    std::back_inserter(record.text),
+                    "log message failed to format: {}",
+                    error.what());
+            }
+        };
+
+        while (!ring.try_push(fill))
+        {
+            switch (config.overflow)
+            {
+            case OverflowPolicy::Drop:
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+
+            case OverflowPolicy::DropOldest:
+                if (ring.try_pop([](LogRecord& record) { record.deferred.reset(); }))
+                {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+
+            case OverflowPolicy::Block:
+                notify_writer();
+                std::this_thread::yield();
+                break;
+            }
+        }
+
+        if (writer_idle.load(std::memory_order_relaxed))
+        {
+            notify_writer();
+        }
+    }
+
+    void notify_writer()
+    {
+        writer_idle.store(false, std::memory_order_relaxed);
+        wake.notify_one();
+    }
+
+    void write(LogRecord& record)
+    {
+        spdlog::string_view_t text{record.text.data(), record.text.size()};
+
+        if (record.deferred)
+        {
+            rendered.clear();
+            record.deferred->render(rendered);
+            record.deferred.reset();
+            text = spdlog::string_view_t{rendered.data(), rendered.size()};
+        }
+
+        auto* logger = spdlog::default_logger_raw();
+        spdlog::details::log_msg msg{
+            record.time,
+            spdlog::source_loc{},
+            logger->name(),
+            record.level,
+            text};
+        msg.thread_id = record.thread_id;
+
+        for (auto& sink : logger->sinks())
+        {
+            if (sink->should_log(msg.level))
+            {
+                sink->log(msg);
+            }
+        }
+    }
+
+    static void flush_sinks()
+    {
+        for (auto& sink : spdlog::default_logger_raw()->sinks())
+        {
+            sink->flush();
+        }
+    }
+
+    size_t drain()
+    {
+        size_t count = 0;
+
+        while (ring.try_pop([this](LogRecord& record) { write(record); }))
+        {
+            ++count;
+        }
+
+        written.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock{wake_mutex};
+
+        while (running)
+        {
+            lock.unlock();
+            if (drain() > 0)
+            {
+                flush_sinks();
+            }
+            lock.lock();
+
+            // A push racing this store at worst waits out one flush interval.
+            writer_idle.store(true, std::memory_order_relaxed);
+            if (running && ring.empty())
+            {
+                wake.wait_for(lock, config.flush_interval);
+            }
+            writer_idle.store(false, std::memory_order_relaxed);
+        }
+
+        lock.unlock();
+        drain();
+        flush_sinks();
+    }
+
+    const AsyncConfig config;
+
+    detail::LogRing<LogRecord> ring;
+
+    std::atomic<bool> accepting{true};
+
+    std::atomic<int> producers{0};
+
+    std::atomic<bool> writer_idle{false};
+
+    std::atomic<uint64_t> written{0};
+
+    std::atomic<uint64_t> dropped{0};
+
+    std::mutex wake_mutex;
+
+    std::condition_variable wake;
+
+    bool running{true};
+
+    // Only touched by the writer thread.
+    fmt::memory_buffer rendered;
+
+    // Last member, so the thread starts only once everything it touches is constructed.
+    std::thread writer;
+};
+
+struct AsyncState
+{
+    ~AsyncState()
+    {
+        detail::async_active.store(false);
+        current.store(nullptr);
+    }
+
+    std::mutex lock;
+
+    std::atomic<AsyncBackend*> current{nullptr};
+
+    /*
+     * A producer may have read async_active just before a stop, so stopped backends are kept
+     * rather than freed; they are small once drained and restarts are rare.
+     */
+    std::vector<std::unique_ptr<AsyncBackend>> backends;
+};
+
+AsyncState& async_state()
+{
+    // Created after spdlog's registry, so it is destroyed, draining the queue, before it.
+    (void)spdlog::default_logger_raw();
+    static AsyncState state;
+    return state;
+}
+
+void stop_locked(AsyncState& state)
+{
+    detail::async_active.store(false);
+
+    if (auto* backend = state.current.exchange(nullptr))
+    {
+        backend->stop();
+    }
+}
+
+} // namespace
+
+namespace detail
+{
+
+void enqueue(LogLevel level, fmt::string_view fmt, fmt::format_args args)
+{
+    // async_active is only set once current is published, but a stop may have cleared it since.
+    auto* backend = async_state().current.load();
+
+    if (backend != nullptr)
+    {
+        backend->enqueue(level, fmt, args);
+    }
+    else
+    {
+        write(level, fmt, args);
+    }
+}
+
+void enqueue_deferred(LogLevel level, std::unique_ptr<DeferredMessage> message)
+{
+    auto* backend = async_state().current.load();
+
+    if (backend != nullptr)
+    {
+        backend->enqueue_deferred(level, std::move(message));
+    }
+    else
+    {
+        write_deferred(level, *message);
+    }
+}
+
+} // namespace detail
+
+void start_async(const AsyncConfig& config)
+{
+    auto& state = async_state();
+    std::lock_guard<std::mutex> lock{state.lock};
+
+    stop_locked(state);
+
+    state.backends.push_back(std::make_unique<AsyncBackend>(config));
+    state.current.store(state.backends.back().get());
+    detail::async_active.store(true);
+}
+
+void stop_async()
+{
+    auto& state = async_state();
+    std::lock_guard<std::mutex> lock{state.lock};
+
+    stop_locked(state);
+}
+
+bool is_async()
+{
+    return detail::async_active.load();
+}
+
+AsyncStats async_stats()
+{
+    auto& state = async_state();
+    std::lock_guard<std::mutex> lock{state.lock};
+
+    if (state.backends.empty())
+    {
+        return AsyncStats{0, 0, 0};
+    }
+
+    return state.backends.back()->stats();
+}
+
+std::optional<OverflowPolicy> parse_overflow_policy(std::string_view name)
+{
+    if (name == "block")
+    {
+        return OverflowPolicy::Block;
+    }
+    else if (name == "drop")
+    {
+        return OverflowPolicy::Drop;
+    }
+    else if (name == "drop-oldest")
+    {
+        return OverflowPolicy::DropOldest;
+    }
+
+    return {};
+}
+
+} // namespace samos::log::logger
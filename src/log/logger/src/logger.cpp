@@ -1,5 +1,9 @@
 #include "logger.hpp"
 
+#include "fmt/format.h"
+
+#include <iterator>
+
 namespace samos::log::logger
 {
 
@@ -8,4 +12,59 @@ void set_level(LogLevel level)
     spdlog::set_level(static_cast<spdlog::level::level_enum>(level));
 }
 
+void log_deferred(LogLevel level, std::unique_ptr<DeferredMessage> message)
+{
+    if (!detail::enabled(level))
+    {
+        return;
+    }
+
+    if (detail::async_active.load(std::memory_order_relaxed))
+    {
+        detail::enqueue_deferred(level, std::move(message));
+    }
+    else
+    {
+        detail::write_deferred(level, *message);
+    }
+}
+
+namespace detail
+{
+
+static_assert(static_cast<int>(LogLevel::Trace) == SAMOS_LOG_LEVEL_TRACE);
+static_assert(static_cast<int>(LogLevel::Off) == SAMOS_LOG_LEVEL_OFF);
+
+void dispatch(LogLevel level, fmt::string_view fmt, fmt::format_args args)
+{
+    if (async_active.load(std::memory_order_relaxed))
+    {
+        enqueue(level, fmt, args);
+    }
+    else
+    {
+        write(level, fmt, args);
+    }
+}
+
+void write(LogLevel level, fmt::string_view fmt, fmt::format_args args)
+{
+    fmt::memory_buffer text;
+    fmt::vformat_to(std::back_inserter(text), fmt, args);
+    spdlog::default_logger_raw()->log(
+        static_cast<spdlog::level::level_enum>(level),
+        spdlog::string_view_t{text.data(), text.size()});
+}
+
+void write_deferred(LogLevel level, const DeferredMessage& message)
+{
+    fmt::memory_buffer text;
+    message.render(text);
+    spdlog::default_logger_raw()->log(
+        static_cast<spdlog::level::level_enum>(level),
+        spdlog::string_view_t{text.data(), text.size()});
+}
+
+} // namespace detail
+
 } // namespace samos::log::logger
@@ -1,7 +1,288 @@
 #include "gtest/gtest.h"
 #include "logger.hpp"
+#include "log_ring.hpp"
+
+#include "spdlog/sinks/ostream_sink.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 TEST(TestLogger, BasicAssertions)
 {
     ASSERT_TRUE(true);
 }
+
+namespace
+{
+
+struct CountingError
+{
+    mutable int calls = 0;
+
+    std::string format() const
+    {
+        ++calls;
+        return "counted";
+    }
+};
+
+} // namespace
+
+TEST(TestLogger, SelfFormattingIsLazy)
+{
+    using namespace samos::log::logger;
+
+    static_assert(SelfFormatting<CountingError>);
+    static_assert(!SelfFormatting<std::string>);
+
+    CountingError error{};
+    EXPECT_EQ(fmt::format("error: {}", error), "error: counted");
+    EXPECT_EQ(error.calls, 1);
+
+    set_level(LogLevel::Error);
+    log(LogLevel::Debug, "{}", error);
+    EXPECT_EQ(error.calls, 1);
+}
+
+TEST(TestLogger, LevelIsCheckedBeforeFormatting)
+{
+    using namespace samos::log::logger;
+
+    std::ostringstream output;
+    auto previous = spdlog::default_logger();
+    auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(output);
+    spdlog::set_default_logger(std::make_shared<spdlog::logger>("level-test", sink));
+    spdlog::set_pattern("%v");
+    set_level(LogLevel::Warn);
+
+    CountingError error{};
+    log<LogLevel::Trace>("{}", error);
+    log<LogLevel::Info>("{}", error);
+    log<LogLevel::Off>("{}", error);
+    EXPECT_EQ(error.calls, 0);
+
+    log<LogLevel::Warn>("{} {}", 1, error);
+    log(LogLevel::Error, "{} {}", 2, error);
+    EXPECT_EQ(error.calls, 2);
+
+    std::string built{"{} built"};
+    log<LogLevel::Error>(fmt::runtime(built), 3);
+    EXPECT_EQ(output.str(), "1 counted\n2 counted\n3 built\n");
+
+    spdlog::set_default_logger(previous);
+}
+
+TEST(TestLogRing, FifoAndFull)
+{
+    samos::log::logger::detail::LogRing<int> ring{3};
+    ASSERT_EQ(ring.capacity(), 4);
+    EXPECT_TRUE(ring.empty());
+
+    for (int idx = 0; idx < 4; ++idx)
+    {
+        EXPECT_TRUE(ring.try_push([idx](int& slot) { slot = idx; }));
+    }
+    EXPECT_FALSE(ring.try_push([](int& slot) { slot = -1; }));
+
+    int value = -1;
+    EXPECT_TRUE(ring.try_pop([&value](int& slot) { value = slot; }));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(ring.try_push([](int& slot) { slot = 4; }));
+
+    std::vector<int> drained;
+    while (ring.try_pop([&drained](int& slot) { drained.push_back(slot); }))
+    {
+    }
+    EXPECT_EQ(drained, (std::vector<int>{1, 2, 3, 4}));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(TestLogRing, ThrowingFillStillPublishes)
+{
+    samos::log::logger::detail::LogRing<int> ring{2};
+
+    EXPECT_THROW(
+        ring.try_push([](int& slot) { slot = 7; throw std::runtime_error{"fill failed"}; }),
+        std::runtime_error);
+    EXPECT_TRUE(ring.try_push([](int& slot) { slot = 8; }));
+
+    std::vector<int> drained;
+    while (ring.try_pop([&drained](int& slot) { drained.push_back(slot); }))
+    {
+    }
+    EXPECT_EQ(drained, (std::vector<int>{7, 8}));
+}
+
+TEST(TestLogRing, ConcurrentProducersKeepTheirOrder)
+{
+    constexpr int producers = 4;
+    constexpr int per_producer = 20000;
+
+    samos::log::logger::detail::LogRing<std::pair<int, int>> ring{64};
+    std::vector<std::thread> threads;
+
+    for (int producer = 0; producer < producers; ++producer)
+    {
+        threads.emplace_back([&ring, producer]()
+        {
+            for (int idx = 0; idx < per_producer; ++idx)
+            {
+                while (!ring.try_push([&](std::pair<int, int>& slot) { slot = {producer, idx}; }))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    bool ordered = true;
+
+    while (received < producers * per_producer)
+    {
+        bool popped = ring.try_pop([&](std::pair<int, int>& slot)
+        {
+            ordered = ordered && slot.second == next[slot.first];
+            next[slot.first] = slot.second + 1;
+        });
+
+        if (popped)
+        {
+            ++received;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_TRUE(ordered);
+    EXPECT_TRUE(std::all_of(next.begin(), next.end(), [](int count) { return count == per_producer; }));
+}
+
+TEST(TestAsyncLogger, WritesEveryMessageThroughTheSinks)
+{
+    using namespace samos::log::logger;
+
+    constexpr int threads = 4;
+    constexpr int per_thread = 500;
+
+    std::ostringstream output;
+    auto previous = spdlog::default_logger();
+    auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(output);
+    spdlog::set_default_logger(std::make_shared<spdlog::logger>("async-test", sink));
+    spdlog::set_pattern("%v");
+    set_level(LogLevel::Info);
+
+    start_async({16, OverflowPolicy::Block, std::chrono::milliseconds{5}});
+    EXPECT_TRUE(is_async());
+
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < threads; ++thread)
+    {
+        workers.emplace_back([thread]()
+        {
+            for (int idx = 0; idx < per_thread; ++idx)
+            {
+                log(LogLevel::Info, "{} {}", thread, idx);
+            }
+            log(LogLevel::Debug, "filtered before it is queued");
+        });
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    stop_async();
+    EXPECT_FALSE(is_async());
+
+    auto stats = async_stats();
+    EXPECT_EQ(stats.written, threads * per_thread);
+    EXPECT_EQ(stats.dropped, 0);
+    EXPECT_EQ(stats.queue_size, 16);
+
+    auto text = output.str();
+    EXPECT_EQ(std::count(text.begin(), text.end(), '\n'), threads * per_thread);
+    EXPECT_EQ(text.find("filtered"), std::string::npos);
+
+    spdlog::set_default_logger(previous);
+}
+
+namespace
+{
+
+struct ThreadRecordingMessage : samos::log::logger::DeferredMessage
+{
+    ThreadRecordingMessage(int number, std::vector<std::thread::id>& rendered_on)
+        :
+        number{number},
+        rendered_on{rendered_on}
+    {
+    }
+
+    void render(fmt::memory_buffer& out) const override
+    {
+        rendered_on.push_back(std::this_thread::get_id());
+        fmt::format_to(std::back_inserter(out), "deferred {}", number);
+    }
+
+    int number;
+    std::vector<std::thread::id>& rendered_on;
+};
+
+} // namespace
+
+TEST(TestAsyncLogger, DeferredMessagesRenderOnTheWriterThread)
+{
+    using namespace samos::log::logger;
+
+    std::ostringstream output;
+    auto previous = spdlog::default_logger();
+    auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(output);
+    spdlog::set_default_logger(std::make_shared<spdlog::logger>("deferred-test", sink));
+    spdlog::set_pattern("%v");
+    set_level(LogLevel::Info);
+
+    std::vector<std::thread::id> rendered_on;
+
+    log_deferred(LogLevel::Info, std::make_unique<ThreadRecordingMessage>(1, rendered_on));
+    log_deferred(LogLevel::Debug, std::make_unique<ThreadRecordingMessage>(2, rendered_on));
+    ASSERT_EQ(rendered_on.size(), 1);
+    EXPECT_EQ(rendered_on[0], std::this_thread::get_id());
+
+    start_async({16, OverflowPolicy::Block, std::chrono::milliseconds{5}});
+    log_deferred(LogLevel::Warn, std::make_unique<ThreadRecordingMessage>(3, rendered_on));
+    log(LogLevel::Info, "formatted {}", 4);
+    stop_async();
+
+    ASSERT_EQ(rendered_on.size(), 2);
+    EXPECT_NE(rendered_on[1], std::this_thread::get_id());
+    EXPECT_EQ(output.str(), "deferred 1\ndeferred 3\nformatted 4\n");
+
+    spdlog::set_default_logger(previous);
+}
+
+TEST(TestAsyncLogger, ParseOverflowPolicy)
+{
+    using samos::log::logger::OverflowPolicy;
+    using samos::log::logger::parse_overflow_policy;
+
+    EXPECT_EQ(parse_overflow_policy("block"), OverflowPolicy::Block);
+    EXPECT_EQ(parse_overflow_policy("drop"), OverflowPolicy::Drop);
+    EXPECT_EQ(parse_overflow_policy("drop-oldest"), OverflowPolicy::DropOldest);
+    EXPECT_FALSE(parse_overflow_policy("sometimes").has_value());
+}
@@ -0,0 +1,78 @@
+#include "schemer_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fmt/core.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace parallel = samos::parallel;
+
+// A stand-in for one point of a mission design sweep: pure arithmetic on a single parameter.
+constexpr const char* sweep_proc =
+    "(lambda (n)"
+    "  (let loop ((i 0) (acc 0.0))"
+    "    (if (= i n) acc (loop (+ i 1) (+ acc (/ 1.0 (+ 1.0 (* i i))))))))";
+
+constexpr size_t sweep_points = 512;
+
+constexpr size_t iterations_per_point = 20000;
+
+int main()
+{
+    samos::scheme::Schemer schemer;
+    auto proc_expr = schemer.serialize(schemer.read(sweep_proc).get_ok()).get_ok();
+    std::vector<samos::scheme::DatumBytes> inputs(
+        sweep_points,
+        schemer.serialize(sexp_make_fixnum(iterations_per_point)).get_ok());
+    size_t max_workers = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+
+    fmt::print("{:>8} {:>8} {:>12} {:>14} {:>8}\n", "workers", "chunk", "seconds", "points/sec", "speedup");
+
+    double baseline = 0.0;
+
+    // Doubling, then every core even when that is not a power of two.
+    std::vector<size_t> worker_counts;
+
+    for (size_t workers = 1; workers < max_workers; workers *= 2)
+    {
+        worker_counts.push_back(workers);
+    }
+    worker_counts.push_back(max_workers);
+
+    for (size_t workers : worker_counts)
+    {
+        parallel::SchemerPool pool{workers};
+
+        for (size_t chunk_size : {size_t{0}, size_t{1}, size_t{64}})
+        {
+            auto start = std::chrono::steady_clock::now();
+            auto res = pool.map(proc_expr, inputs, chunk_size);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            if (res.is_err())
+            {
+                fmt::print("error: {}\n", res.get_err().format());
+                return 1;
+            }
+
+            double rate = sweep_points / elapsed.count();
+
+            if (baseline == 0.0)
+            {
+                baseline = rate;
+            }
+
+            fmt::print(
+                "{:>8} {:>8} {:>12.4f} {:>14.1f} {:>8.2f}\n",
+                workers,
+                chunk_size == 0 ? std::string{"auto"} : std::to_string(chunk_size),
+                elapsed.count(),
+                rate,
+                rate / baseline);
+        }
+    }
+
+    return 0;
+}
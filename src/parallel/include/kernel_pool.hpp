@@ -0,0 +1,91 @@
+#ifndef SAMOS_KERNEL_POOL_HPP
+#define SAMOS_KERNEL_POOL_HPP
+
+#include "parallel_error.hpp"
+#include "result.hpp"
+#include "scheme.hpp"
+#include "thread_pool.hpp"
+
+#include <chibi/eval.h>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace samos::parallel
+{
+
+class KernelPool;
+
+} // namespace samos::parallel
+
+extern "C" {
+struct KernelPoolPOD
+{
+    samos::parallel::KernelPool* pool;
+};
+
+sexp sexp_kernel_spawn_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1, sexp arg2);
+sexp sexp_kernel_ready_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1);
+sexp sexp_kernel_join_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1);
+}
+
+namespace samos::parallel
+{
+
+// A kernel is a pure numeric function. It runs on a pool thread and must not touch any scheme heap.
+using Kernel = std::function<double(const std::vector<double>&)>;
+
+using KernelTicket = uint64_t;
+
+/*
+ * Dispatches named C++ kernels onto a ThreadPool and hands back tickets that act as promises.
+ *
+ * Scheme never shares its heap with the pool: arguments are unboxed into doubles on the
+ * interpreter thread before dispatch, and the result is boxed again when the ticket is joined.
+ * After install() a Schemer can use:
+ *
+ *   (kernel-spawn 'name arg ...) => ticket
+ *   (kernel-ready? ticket)       => #t once the result is available
+ *   (kernel-join ticket)         => the flonum result, blocking until it is available
+ */
+class KernelPool {
+public:
+
+    explicit KernelPool(ThreadPool& pool = ThreadPool::shared());
+
+    KernelPool(const KernelPool&) = delete;
+    KernelPool(KernelPool&&) = delete;
+    KernelPool& operator=(const KernelPool&) = delete;
+    KernelPool& operator=(KernelPool&&) = delete;
+
+    [[nodiscard]] ParallelResult<> register_kernel(std::string&& name, Kernel kernel);
+
+    [[nodiscard]] ParallelResult<KernelTicket> spawn(const std::string& name, std::vector<double>&& args);
+
+    [[nodiscard]] ParallelResult<bool> ready(KernelTicket ticket) const;
+
+    [[nodiscard]] ParallelResult<double> join(KernelTicket ticket);
+
+    [[nodiscard]] ParallelResult<> install(scheme::Schemer& schemer);
+
+private:
+
+    ThreadPool& pool;
+
+    KernelPoolPOD pod;
+
+    std::unordered_map<std::string, std::shared_ptr<const Kernel>> kernels;
+
+    std::unordered_map<KernelTicket, std::future<double>> pending;
+
+    KernelTicket next_ticket;
+};
+
+} // namespace samos::parallel
+
+#endif // SAMOS_KERNEL_POOL_HPP
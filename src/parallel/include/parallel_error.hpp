@@ -0,0 +1,110 @@
+#ifndef SAMOS_PARALLEL_ERROR_HPP
+#define SAMOS_PARALLEL_ERROR_HPP
+
+#include "result.hpp"
+#include "scheme.hpp"
+
+#include <cassert>
+#include <string>
+#include <variant>
+
+namespace samos::parallel
+{
+
+class KernelNotFound
+{
+public:
+    explicit KernelNotFound(const std::string& name) : name{name}
+    {
+    }
+
+    std::string format() const
+    {
+        return fmt::format("Kernel {} not found", name);
+    }
+
+private:
+    std::string name;
+};
+
+class KernelAlreadyRegistered
+{
+public:
+    std::string format() const
+    {
+        return {"Kernel already registered"};
+    }
+};
+
+class TicketNotFound
+{
+public:
+    std::string format() const
+    {
+        return {"Kernel ticket not found"};
+    }
+};
+
+class KernelFailed
+{
+public:
+    explicit KernelFailed(const std::string& what) : what{what}
+    {
+    }
+
+    std::string format() const
+    {
+        return fmt::format("Kernel failed: {}", what);
+    }
+
+private:
+    std::string what;
+};
+
+class MapProcedureError
+{
+public:
+    explicit MapProcedureError(const std::string& message) : message{message}
+    {
+    }
+
+    std::string format() const
+    {
+        return fmt::format("parallel-map failed: {}", message);
+    }
+
+private:
+    std::string message;
+};
+
+namespace detail
+{
+
+using ParallelErrVar = std::variant<
+    KernelNotFound,
+    KernelAlreadyRegistered,
+    TicketNotFound,
+    KernelFailed,
+    MapProcedureError,
+    scheme::SchemerError>;
+
+}
+
+class ParallelError : public detail::ParallelErrVar
+{
+    using detail::ParallelErrVar::variant;
+public:
+    std::string format() const
+    {
+        return std::visit(
+            [](const auto& error) { return error.format(); },
+            static_cast<const detail::ParallelErrVar&>(*this));
+    }
+};
+
+template <typename T = std::monostate>
+using ParallelResult = result::Result<T, ParallelError>;
+
+} // namespace samos::parallel
+
+#endif // SAMOS_PARALLEL_ERROR_HPP
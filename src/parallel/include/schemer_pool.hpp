@@ -0,0 +1,94 @@
+#ifndef SAMOS_SCHEMER_POOL_HPP
+#define SAMOS_SCHEMER_POOL_HPP
+
+#include "parallel_error.hpp"
+#include "result.hpp"
+#include "scheme.hpp"
+#include "thread_pool.hpp"
+
+#include <chibi/eval.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace samos::parallel
+{
+
+class SchemerPool;
+
+} // namespace samos::parallel
+
+extern "C" {
+struct SchemerPoolPOD
+{
+    samos::parallel::SchemerPool* pool;
+};
+
+sexp sexp_parallel_map_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1, sexp arg2, sexp arg3);
+}
+
+namespace samos::parallel
+{
+
+/*
+ * A fixed set of worker Schemers, each owned by the pool and used by one thread at a time.
+ *
+ * Work items cross between interpreters in the binary datum format, so the mapped procedure is
+ * passed as an expression (e.g. '(lambda (x) (* x x)) or a symbol bound in the workers) and is
+ * evaluated once per chunk inside the worker. After install() a Schemer can use:
+ *
+ *   (parallel-map proc-expr list [chunk-size]) => list of results, in input order
+ */
+class SchemerPool {
+public:
+
+    SchemerPool() = delete;
+
+    explicit SchemerPool(size_t num_workers, const std::vector<scheme::SchemeModule>& modules = {});
+
+    SchemerPool(const SchemerPool&) = delete;
+    SchemerPool(SchemerPool&&) = delete;
+    SchemerPool& operator=(const SchemerPool&) = delete;
+    SchemerPool& operator=(SchemerPool&&) = delete;
+
+    // chunk_size == 0 picks a chunk size that gives every worker a few chunks to balance load.
+    [[nodiscard]] ParallelResult<std::vector<scheme::DatumBytes>> map(
+        const scheme::DatumBytes& proc_expr,
+        const std::vector<scheme::DatumBytes>& inputs,
+        size_t chunk_size = 0);
+
+    [[nodiscard]] ParallelResult<> install(scheme::Schemer& schemer);
+
+    [[nodiscard]] size_t size() const;
+
+private:
+
+    ParallelResult<std::vector<scheme::DatumBytes>> map_chunk(
+        scheme::Schemer& worker,
+        const scheme::DatumBytes& proc_expr,
+        const std::vector<scheme::DatumBytes>& inputs,
+        size_t begin,
+        size_t end);
+
+    scheme::Schemer& acquire();
+
+    void release(scheme::Schemer& worker);
+
+    std::vector<std::unique_ptr<scheme::Schemer>> workers;
+
+    std::vector<scheme::Schemer*> idle_workers;
+
+    std::mutex idle_mutex;
+
+    std::condition_variable idle_cv;
+
+    ThreadPool thread_pool;
+
+    SchemerPoolPOD pod;
+};
+
+} // namespace samos::parallel
+
+#endif // SAMOS_SCHEMER_POOL_HPP
@@ -0,0 +1,69 @@
+#ifndef SAMOS_THREAD_POOL_HPP
+#define SAMOS_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace samos::parallel
+{
+
+class ThreadPool {
+public:
+
+    ThreadPool() = delete;
+
+    explicit ThreadPool(size_t num_threads);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    // Process wide pool sized to the hardware concurrency, created on first use.
+    static ThreadPool& shared();
+
+    template <typename F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<F>>
+    {
+        using R = std::invoke_result_t<F>;
+
+        auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+        auto future = packaged->get_future();
+
+        enqueue([packaged]() {(*packaged)();});
+
+        return future;
+    }
+
+    [[nodiscard]] size_t size() const;
+
+private:
+
+    void enqueue(std::function<void()>&& job);
+
+    void worker_loop();
+
+    std::vector<std::thread> workers;
+
+    std::deque<std::function<void()>> jobs;
+
+    std::mutex jobs_mutex;
+
+    std::condition_variable jobs_cv;
+
+    bool stopping;
+};
+
+} // namespace samos::parallel
+
+#endif // SAMOS_THREAD_POOL_HPP
@@ -0,0 +1,285 @@
+#include "kernel_pool.hpp"
+#include "logger.hpp"
+
+#include <chibi/sexp.h>
+#include <exception>
+#include <string>
+
+namespace
+{
+
+bool is_kernel_pool(sexp self, sexp arg)
+{
+    return sexp_pointerp(arg) && (sexp_pointer_tag(arg) == sexp_unbox_fixnum(sexp_opcode_arg1_type(self)));
+}
+
+samos::parallel::KernelPool* kernel_pool(sexp arg)
+{
+    return static_cast<KernelPoolPOD*>(sexp_cpointer_value(arg))->pool;
+}
+
+sexp kernel_error(sexp ctx, sexp self, samos::parallel::ParallelError err, sexp irritant)
+{
+    return sexp_user_exception(ctx, self, err.format().c_str(), irritant);
+}
+
+} // namespace
+
+sexp sexp_kernel_spawn_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1, sexp arg2)
+{
+    (void)n;
+
+    if (!is_kernel_pool(self, arg0))
+    {
+        return sexp_type_exception(ctx, self, sexp_unbox_fixnum(sexp_opcode_arg1_type(self)), arg0);
+    }
+
+    std::string name;
+
+    if (sexp_symbolp(arg1))
+    {
+        name = sexp_string_data(sexp_symbol_to_string(ctx, arg1));
+    }
+    else if (sexp_stringp(arg1))
+    {
+        name = sexp_string_data(arg1);
+    }
+    else
+    {
+        return sexp_type_exception(ctx, self, SEXP_SYMBOL, arg1);
+    }
+
+    std::vector<double> args;
+
+    for (sexp ls = arg2; sexp_pairp(ls); ls = sexp_cdr(ls))
+    {
+        sexp value = sexp_car(ls);
+
+        if (sexp_fixnump(value))
+        {
+            args.push_back(static_cast<double>(sexp_unbox_fixnum(value)));
+        }
+        else if (sexp_flonump(value))
+        {
+            args.push_back(sexp_flonum_value(value));
+        }
+        else
+        {
+            return sexp_type_exception(ctx, self, SEXP_NUMBER, value);
+        }
+    }
+
+    auto res = kernel_pool(arg0)->spawn(name, std::move(args));
+
+    if (res.is_err())
+    {
+        return kernel_error(ctx, self, res.get_err(), arg1);
+    }
+
+    return sexp_make_fixnum(static_cast<sexp_sint_t>(res.get_ok()));
+}
+
+sexp sexp_kernel_ready_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1)
+{
+    (void)n;
+
+    if (!is_kernel_pool(self, arg0))
+    {
+        return sexp_type_exception(ctx, self, sexp_unbox_fixnum(sexp_opcode_arg1_type(self)), arg0);
+    }
+
+    if (!sexp_fixnump(arg1))
+    {
+        return sexp_type_exception(ctx, self, SEXP_FIXNUM, arg1);
+    }
+
+    auto res = kernel_pool(arg0)->ready(static_cast<samos::parallel::KernelTicket>(sexp_unbox_fixnum(arg1)));
+
+    if (res.is_err())
+    {
+        return kernel_error(ctx, self, res.get_err(), arg1);
+    }
+
+    return sexp_make_boolean(res.get_ok());
+}
+
+sexp sexp_kernel_join_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1)
+{
+    (void)n;
+
+    if (!is_kernel_pool(self, arg0))
+    {
+        return sexp_type_exception(ctx, self, sexp_unbox_fixnum(sexp_opcode_arg1_type(self)), arg0);
+    }
+
+    if (!sexp_fixnump(arg1))
+    {
+        return sexp_type_exception(ctx, self, SEXP_FIXNUM, arg1);
+    }
+
+    auto res = kernel_pool(arg0)->join(static_cast<samos::parallel::KernelTicket>(sexp_unbox_fixnum(arg1)));
+
+    if (res.is_err())
+    {
+        return kernel_error(ctx, self, res.get_err(), arg1);
+    }
+
+    return sexp_make_flonum(ctx, res.get_ok());
+}
+
+namespace samos::parallel
+{
+
+using log::logger::log;
+using log::logger::LogLevel;
+
+constexpr const char* kernel_wrappers =
+    "(begin"
+    " (define (kernel-spawn name . args) (%kernel-spawn kernel-pool name args))"
+    " (define (kernel-ready? ticket) (%kernel-ready? kernel-pool ticket))"
+    " (define (kernel-join ticket) (%kernel-join kernel-pool ticket)))";
+
+KernelPool::KernelPool(ThreadPool& pool)
+    :
+    pool{pool},
+    pod{this},
+    kernels{},
+    pending{},
+    next_ticket{0}
+{
+}
+
+ParallelResult<> KernelPool::register_kernel(std::string&& name, Kernel kernel)
+{
+    if (kernels.contains(name))
+    {
+        return ParallelResult<>::err(KernelAlreadyRegistered{});
+    }
+
+    kernels.emplace(std::move(name), std::make_shared<const Kernel>(std::move(kernel)));
+
+    return ParallelResult<>::ok({});
+}
+
+ParallelResult<KernelTicket> KernelPool::spawn(const std::string& name, std::vector<double>&& args)
+{
+    auto kernel_it = kernels.find(name);
+
+    if (kernel_it == kernels.end())
+    {
+        return ParallelResult<KernelTicket>::err(KernelNotFound{name});
+    }
+
+    // The task owns both the kernel and its arguments, so nothing it touches can change under it.
+    auto kernel = kernel_it->second;
+    KernelTicket ticket = next_ticket++;
+
+    pending.emplace(ticket, pool.submit(
+        [kernel, args = std::move(args)]()
+        {
+            return (*kernel)(args);
+        }));
+
+    return ParallelResult<KernelTicket>::ok(ticket);
+}
+
+ParallelResult<bool> KernelPool::ready(KernelTicket ticket) const
+{
+    auto pending_it = pending.find(ticket);
+
+    if (pending_it == pending.end())
+    {
+        return ParallelResult<bool>::err(TicketNotFound{});
+    }
+
+    auto status = pending_it->second.wait_for(std::chrono::seconds{0});
+
+    return ParallelResult<bool>::ok(status == std::future_status::ready);
+}
+
+ParallelResult<double> KernelPool::join(KernelTicket ticket)
+{
+    auto pending_it = pending.find(ticket);
+
+    if (pending_it == pending.end())
+    {
+        return ParallelResult<double>::err(TicketNotFound{});
+    }
+
+    auto future = std::move(pending_it->second);
+    pending.erase(pending_it);
+
+    try
+    {
+        return ParallelResult<double>::ok(future.get());
+    }
+    catch (const std::exception& e)
+    {
+        log<LogLevel::Error>("Kernel for ticket {} failed: {}", ticket, e.what());
+        return ParallelResult<double>::err(KernelFailed{e.what()});
+    }
+}
+
+ParallelResult<> KernelPool::install(scheme::Schemer& schemer)
+{
+    auto type_res = schemer.register_c_type<KernelPoolPOD>();
+
+    if (type_res.is_err())
+    {
+        return ParallelResult<>::err(type_res.get_err());
+    }
+
+    sexp pod_type = sexp_make_fixnum(sexp_type_tag(type_res.get_ok()));
+
+    auto res = schemer.bind_symbol_to_c_object("kernel-pool", &pod);
+
+    if (res.is_err())
+    {
+        return ParallelResult<>::err(res.get_err());
+    }
+
+    res = schemer.define_ffi_op(
+        "%kernel-spawn",
+        sexp_make_fixnum(SEXP_FIXNUM),
+        {pod_type, sexp_make_fixnum(SEXP_OBJECT), sexp_make_fixnum(SEXP_OBJECT)},
+        sexp_kernel_spawn_stub);
+
+    if (res.is_err())
+    {
+        return ParallelResult<>::err(res.get_err());
+    }
+
+    res = schemer.define_ffi_op(
+        "%kernel-ready?",
+        sexp_make_fixnum(SEXP_BOOLEAN),
+        {pod_type, sexp_make_fixnum(SEXP_FIXNUM)},
+        sexp_kernel_ready_stub);
+
+    if (res.is_err())
+    {
+        return ParallelResult<>::err(res.get_err());
+    }
+
+    res = schemer.define_ffi_op(
+        "%kernel-join",
+        sexp_make_fixnum(SEXP_FLONUM),
+        {pod_type, sexp_make_fixnum(SEXP_FIXNUM)},
+        sexp_kernel_join_stub);
+
+    if (res.is_err())
+    {
+        return ParallelResult<>::err(res.get_err());
+    }
+
+    sexp wrappers = schemer.eval(kernel_wrappers);
+
+    if (sexp_exceptionp(wrappers))
+    {
+        schemer.print_exception(wrappers);
+        return ParallelResult<>::err(scheme::SchemeException{});
+    }
+
+    return ParallelResult<>::ok({});
+}
+
+} // namespace samos::parallel
@@ -0,0 +1,307 @@
+#include "schemer_pool.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <chibi/sexp.h>
+#include <future>
+#include <iterator>
+#include <optional>
+#include <string>
+
+sexp sexp_parallel_map_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1, sexp arg2, sexp arg3)
+{
+    (void)n;
+
+    if (!(sexp_pointerp(arg0) && (sexp_pointer_tag(arg0) == sexp_unbox_fixnum(sexp_opcode_arg1_type(self)))))
+    {
+        return sexp_type_exception(ctx, self, sexp_unbox_fixnum(sexp_opcode_arg1_type(self)), arg0);
+    }
+
+    if (!sexp_fixnump(arg3) || sexp_unbox_fixnum(arg3) < 0)
+    {
+        return sexp_type_exception(ctx, self, SEXP_FIXNUM, arg3);
+    }
+
+    auto* pool = static_cast<SchemerPoolPOD*>(sexp_cpointer_value(arg0))->pool;
+    samos::scheme::DatumBytes proc_expr;
+    std::vector<samos::scheme::DatumBytes> inputs;
+
+    if (!samos::scheme::encode_datum(ctx, arg1, proc_expr))
+    {
+        return sexp_user_exception(ctx, self, "parallel-map: procedure is not serializable", arg1);
+    }
+
+    for (sexp ls = arg2; sexp_pairp(ls); ls = sexp_cdr(ls))
+    {
+        if (!samos::scheme::encode_datum(ctx, sexp_car(ls), inputs.emplace_back()))
+        {
+            return sexp_user_exception(ctx, self, "parallel-map: input is not serializable", sexp_car(ls));
+        }
+    }
+
+    auto res = pool->map(proc_expr, inputs, static_cast<size_t>(sexp_unbox_fixnum(arg3)));
+
+    if (res.is_err())
+    {
+        return sexp_user_exception(ctx, self, res.get_err().format().c_str(), arg1);
+    }
+
+    auto outputs = res.get_ok();
+
+    sexp_gc_var2(results, value);
+    sexp_gc_preserve2(ctx, results, value);
+
+    results = SEXP_NULL;
+
+    for (auto output = outputs.rbegin(); output != outputs.rend(); ++output)
+    {
+        auto decoded = samos::scheme::decode_datum(ctx, *output);
+        if (!decoded.has_value())
+        {
+            sexp_gc_release2(ctx);
+            return sexp_user_exception(ctx, self, "parallel-map: malformed result", arg1);
+        }
+        value = decoded.value();
+        results = sexp_cons(ctx, value, results);
+    }
+
+    sexp_gc_release2(ctx);
+
+    return results;
+}
+
+namespace samos::parallel
+{
+
+using log::logger::log;
+using log::logger::LogLevel;
+
+constexpr const char* parallel_map_wrapper =
+    "(define (parallel-map proc lst . chunk-size)"
+    " (%parallel-map schemer-pool proc lst (if (pair? chunk-size) (car chunk-size) 0)))";
+
+// Enough chunks per worker that one slow chunk does not leave the others idle.
+constexpr size_t chunks_per_worker = 4;
+
+SchemerPool::SchemerPool(size_t num_workers, const std::vector<scheme::SchemeModule>& modules)
+    :
+    workers{},
+    idle_workers{},
+    idle_mutex{},
+    idle_cv{},
+    thread_pool{std::max<size_t>(num_workers, 1)},
+    pod{this}
+{
+    // Interpreters are built here, on one thread, because chibi's one-time initialisation is not
+    // safe to race; afterwards each is only ever driven by the pool thread that acquired it.
+    for (size_t idx = 0; idx < thread_pool.size(); ++idx)
+    {
+        auto worker = std::make_unique<scheme::Schemer>();
+
+        for (const auto& mod : modules)
+        {
+            auto res = worker->import_module(mod);
+            if (res.is_err())
+            {
+                log<LogLevel::Error>("Worker {} failed to import module: {}", idx, res.get_err());
+            }
+        }
+
+        idle_workers.push_back(worker.get());
+        workers.emplace_back(std::move(worker));
+    }
+}
+
+size_t SchemerPool::size() const
+{
+    return workers.size();
+}
+
+ParallelResult<std::vector<scheme::DatumBytes>> SchemerPool::map(
+    const scheme::DatumBytes& proc_expr,
+    const std::vector<scheme::DatumBytes>& inputs,
+    size_t chunk_size)
+{
+    using MapResult = ParallelResult<std::vector<scheme::DatumBytes>>;
+
+    if (chunk_size == 0)
+    {
+        size_t num_chunks = workers.size() * chunks_per_worker;
+        chunk_size = std::max<size_t>((inputs.size() + num_chunks - 1) / num_chunks, 1);
+    }
+
+    std::vector<std::future<MapResult>> chunks;
+
+    for (size_t begin = 0; begin < inputs.size(); begin += chunk_size)
+    {
+        size_t end = std::min(begin + chunk_size, inputs.size());
+
+        chunks.push_back(thread_pool.submit(
+            [this, &proc_expr, &inputs, begin, end]()
+            {
+                auto& worker = acquire();
+                auto res = map_chunk(worker, proc_expr, inputs, begin, end);
+                release(worker);
+                return res;
+            }));
+    }
+
+    std::vector<scheme::DatumBytes> outputs;
+    std::optional<ParallelError> error;
+
+    outputs.reserve(inputs.size());
+
+    // Every chunk is waited on, even after a failure, since they all borrow the inputs.
+    for (auto& chunk : chunks)
+    {
+        auto res = chunk.get();
+
+        if (res.is_err())
+        {
+            if (!error.has_value())
+            {
+                error = res.get_err();
+            }
+            continue;
+        }
+
+        auto chunk_outputs = res.get_ok();
+        std::move(chunk_outputs.begin(), chunk_outputs.end(), std::back_inserter(outputs));
+    }
+
+    if (error.has_value())
+    {
+        return MapResult::err(error.value());
+    }
+
+    return MapResult::ok(std::move(outputs));
+}
+
+ParallelResult<std::vector<scheme::DatumBytes>> SchemerPool::map_chunk(
+    scheme::Schemer& worker,
+    const scheme::DatumBytes& proc_expr,
+    const std::vector<scheme::DatumBytes>& inputs,
+    size_t begin,
+    size_t end)
+{
+    using MapResult = ParallelResult<std::vector<scheme::DatumBytes>>;
+
+    auto expr_res = worker.deserialize(proc_expr);
+
+    if (expr_res.is_err())
+    {
+        return MapResult::err(expr_res.get_err());
+    }
+
+    sexp proc = worker.eval_datum(expr_res.get_ok());
+
+    if (sexp_exceptionp(proc))
+    {
+        return MapResult::err(MapProcedureError{worker.sexp_to_string(proc)});
+    }
+
+    std::vector<scheme::DatumBytes> outputs;
+
+    outputs.reserve(end - begin);
+    worker.preserve(proc);
+
+    for (size_t idx = begin; idx < end; ++idx)
+    {
+        auto datum_res = worker.deserialize(inputs[idx]);
+
+        if (datum_res.is_err())
+        {
+            worker.release(proc);
+            return MapResult::err(datum_res.get_err());
+        }
+
+        sexp result = worker.apply(proc, datum_res.get_ok());
+
+        if (sexp_exceptionp(result))
+        {
+            worker.release(proc);
+            return MapResult::err(MapProcedureError{worker.sexp_to_string(result)});
+        }
+
+        auto output_res = worker.serialize(result);
+
+        if (output_res.is_err())
+        {
+            worker.release(proc);
+            return MapResult::err(output_res.get_err());
+        }
+
+        outputs.emplace_back(output_res.get_ok());
+    }
+
+    worker.release(proc);
+
+    return MapResult::ok(std::move(outputs));
+}
+
+scheme::Schemer& SchemerPool::acquire()
+{
+    std::unique_lock<std::mutex> lock{idle_mutex};
+
+    idle_cv.wait(lock, [this]() {return !idle_workers.empty();});
+
+    auto* worker = idle_workers.back();
+    idle_workers.pop_back();
+
+    return *worker;
+}
+
+void SchemerPool::release(scheme::Schemer& worker)
+{
+    {
+        std::lock_guard<std::mutex> lock{idle_mutex};
+        idle_workers.push_back(&worker);
+    }
+
+    idle_cv.notify_one();
+}
+
+ParallelResult<> SchemerPool::install(scheme::Schemer& schemer)
+{
+    auto type_res = schemer.register_c_type<SchemerPoolPOD>();
+
+    if (type_res.is_err())
+    {
+        return ParallelResult<>::err(type_res.get_err());
+    }
+
+    auto res = schemer.bind_symbol_to_c_object("schemer-pool", &pod);
+
+    if (res.is_err())
+    {
+        return ParallelResult<>::err(res.get_err());
+    }
+
+    res = schemer.define_ffi_op(
+        "%parallel-map",
+        sexp_make_fixnum(SEXP_PAIR),
+        {
+            sexp_make_fixnum(sexp_type_tag(type_res.get_ok())),
+            sexp_make_fixnum(SEXP_OBJECT),
+            sexp_make_fixnum(SEXP_OBJECT),
+            sexp_make_fixnum(SEXP_FIXNUM)
+        },
+        sexp_parallel_map_stub);
+
+    if (res.is_err())
+    {
+        return ParallelResult<>::err(res.get_err());
+    }
+
+    sexp wrapper = schemer.eval(parallel_map_wrapper);
+
+    if (sexp_exceptionp(wrapper))
+    {
+        schemer.print_exception(wrapper);
+        return ParallelResult<>::err(scheme::SchemeException{});
+    }
+
+    return ParallelResult<>::ok({});
+}
+
+} // namespace samos::parallel
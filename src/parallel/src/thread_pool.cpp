@@ -0,0 +1,86 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace samos::parallel
+{
+
+ThreadPool::ThreadPool(size_t num_threads)
+    :
+    workers{},
+    jobs{},
+    jobs_mutex{},
+    jobs_cv{},
+    stopping{false}
+{
+    num_threads = std::max<size_t>(num_threads, 1);
+    workers.reserve(num_threads);
+
+    for (size_t idx = 0; idx < num_threads; ++idx)
+    {
+        workers.emplace_back([this]() {worker_loop();});
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{jobs_mutex};
+        stopping = true;
+    }
+
+    jobs_cv.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool{std::thread::hardware_concurrency()};
+
+    return pool;
+}
+
+size_t ThreadPool::size() const
+{
+    return workers.size();
+}
+
+void ThreadPool::enqueue(std::function<void()>&& job)
+{
+    {
+        std::lock_guard<std::mutex> lock{jobs_mutex};
+        jobs.emplace_back(std::move(job));
+    }
+
+    jobs_cv.notify_one();
+}
+
+void ThreadPool::worker_loop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+
+        {
+            std::unique_lock<std::mutex> lock{jobs_mutex};
+            jobs_cv.wait(lock, [this]() {return stopping || !jobs.empty();});
+
+            // Drain the queue before honouring a stop request so no future is left unsatisfied.
+            if (jobs.empty())
+            {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        job();
+    }
+}
+
+} // namespace samos::parallel
@@ -0,0 +1,204 @@
+#include "kernel_pool.hpp"
+#include "schemer_pool.hpp"
+#include "thread_pool.hpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace samos::parallel
+{
+
+TEST(TestThreadPool, SubmitReturnsFutures)
+{
+    ThreadPool pool{4};
+    std::vector<std::future<int>> futures;
+
+    for (int idx = 0; idx < 100; ++idx)
+    {
+        futures.push_back(pool.submit([idx]() {return idx * idx;}));
+    }
+
+    for (int idx = 0; idx < 100; ++idx)
+    {
+        EXPECT_EQ(futures[idx].get(), idx * idx);
+    }
+}
+
+TEST(TestThreadPool, DrainsQueueOnDestruction)
+{
+    std::atomic<int> counter{0};
+
+    {
+        ThreadPool pool{2};
+
+        for (int idx = 0; idx < 50; ++idx)
+        {
+            (void)pool.submit([&counter]() {counter++;});
+        }
+    }
+
+    EXPECT_EQ(counter.load(), 50);
+}
+
+TEST(TestThreadPool, SharedPool)
+{
+    auto& pool = ThreadPool::shared();
+
+    EXPECT_GE(pool.size(), 1);
+    EXPECT_EQ(&pool, &ThreadPool::shared());
+}
+
+class TestKernelPool : public ::testing::Test
+{
+protected:
+    TestKernelPool()
+        :
+        thread_pool{2},
+        kernel_pool{thread_pool}
+    {
+        auto res = kernel_pool.register_kernel(
+            "sum",
+            [](const std::vector<double>& args)
+            {
+                return std::accumulate(args.begin(), args.end(), 0.0);
+            });
+
+        EXPECT_TRUE(res.is_ok());
+        res = kernel_pool.register_kernel(
+            "fail",
+            [](const std::vector<double>&) -> double
+            {
+                throw std::runtime_error("kernel failure");
+            });
+        EXPECT_TRUE(res.is_ok());
+    }
+
+    ThreadPool thread_pool;
+
+    KernelPool kernel_pool;
+};
+
+TEST_F(TestKernelPool, SpawnJoin)
+{
+    auto spawn_res = kernel_pool.spawn("sum", {1.0, 2.0, 3.5});
+
+    ASSERT_TRUE(spawn_res.is_ok());
+    auto ticket = spawn_res.get_ok();
+
+    auto join_res = kernel_pool.join(ticket);
+
+    ASSERT_TRUE(join_res.is_ok());
+    EXPECT_DOUBLE_EQ(join_res.get_ok(), 6.5);
+
+    // A ticket can only be joined once.
+    EXPECT_TRUE(kernel_pool.join(ticket).is_err());
+    EXPECT_TRUE(kernel_pool.ready(ticket).is_err());
+}
+
+TEST_F(TestKernelPool, Errors)
+{
+    EXPECT_TRUE(kernel_pool.register_kernel("sum", [](const std::vector<double>&) {return 0.0;}).is_err());
+    EXPECT_TRUE(kernel_pool.spawn("missing", {}).is_err());
+
+    auto spawn_res = kernel_pool.spawn("fail", {});
+
+    ASSERT_TRUE(spawn_res.is_ok());
+    EXPECT_TRUE(kernel_pool.join(spawn_res.get_ok()).is_err());
+}
+
+TEST_F(TestKernelPool, SchemeInterface)
+{
+    scheme::Schemer schemer;
+
+    ASSERT_TRUE(kernel_pool.install(schemer).is_ok());
+
+    sexp result = schemer.eval("(kernel-join (kernel-spawn 'sum 1 2 3.5))");
+    auto value_res = schemer.get_flonum(result);
+
+    ASSERT_TRUE(value_res.is_ok());
+    EXPECT_DOUBLE_EQ(value_res.get_ok(), 6.5);
+
+    result = schemer.eval(
+        "(let ((tickets (map (lambda (x) (kernel-spawn 'sum x x)) '(1 2 3 4))))"
+        "  (apply + (map kernel-join tickets)))");
+    value_res = schemer.get_flonum(result);
+    ASSERT_TRUE(value_res.is_ok());
+    EXPECT_DOUBLE_EQ(value_res.get_ok(), 20.0);
+
+    result = schemer.eval("(kernel-spawn 'missing 1)");
+    EXPECT_TRUE(sexp_exceptionp(result));
+}
+
+class TestSchemerPool : public ::testing::Test
+{
+protected:
+    scheme::DatumBytes encode(const std::string& text)
+    {
+        sexp datum = schemer.read(text).get_ok();
+        return schemer.serialize(datum).get_ok();
+    }
+
+    std::string decode(const scheme::DatumBytes& bytes)
+    {
+        return schemer.sexp_to_string(schemer.deserialize(bytes).get_ok());
+    }
+
+    scheme::Schemer schemer;
+};
+
+TEST_F(TestSchemerPool, MapPreservesOrder)
+{
+    SchemerPool pool{3};
+    std::vector<scheme::DatumBytes> inputs;
+
+    for (int idx = 0; idx < 50; ++idx)
+    {
+        inputs.push_back(encode(std::to_string(idx)));
+    }
+
+    for (size_t chunk_size : {0, 1, 7, 100})
+    {
+        auto res = pool.map(encode("(lambda (x) (* x x))"), inputs, chunk_size);
+
+        ASSERT_TRUE(res.is_ok());
+        auto outputs = res.get_ok();
+
+        ASSERT_EQ(outputs.size(), inputs.size());
+        for (int idx = 0; idx < 50; ++idx)
+        {
+            EXPECT_EQ(decode(outputs[idx]), std::to_string(idx * idx));
+        }
+    }
+}
+
+TEST_F(TestSchemerPool, MapErrors)
+{
+    SchemerPool pool{2};
+
+    EXPECT_TRUE(pool.map(encode("(lambda (x) (car x))"), {encode("1"), encode("2")}).is_err());
+    EXPECT_TRUE(pool.map(encode("undefined-procedure"), {encode("1")}).is_err());
+    EXPECT_TRUE(pool.map(encode("(lambda (x) car)"), {encode("1")}).is_err());
+    EXPECT_TRUE(pool.map(encode("(lambda (x) x)"), {}).is_ok());
+}
+
+TEST_F(TestSchemerPool, SchemeInterface)
+{
+    SchemerPool pool{2, {scheme::SrfiType::Srfi_1}};
+
+    ASSERT_TRUE(pool.install(schemer).is_ok());
+
+    sexp result = schemer.eval("(parallel-map '(lambda (x) (list x (* 2 x))) '(1 2 3) 2)");
+    sexp expected = schemer.eval("'((1 2) (2 4) (3 6))");
+
+    EXPECT_TRUE(schemer.sexp_equal(result, expected));
+
+    // Modules imported into the pool are visible to the mapped procedure.
+    result = schemer.eval("(parallel-map '(lambda (x) (iota x)) '(3))");
+    expected = schemer.eval("'((0 1 2))");
+    EXPECT_TRUE(schemer.sexp_equal(result, expected));
+}
+
+} // namespace samos::parallel
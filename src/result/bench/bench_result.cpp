@@ -0,0 +1,145 @@
+#include "result.hpp"
+
+#include <chrono>
+#include <fmt/core.h>
+#include <functional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace result = samos::result;
+
+constexpr int repetitions = 20;
+
+constexpr int values = 100000;
+
+/*
+ * The previous Result, kept here as the baseline: non-const queries and accessors that copy the
+ * payload out on every call.
+ */
+template<typename T, typename E>
+class LegacyResult {
+public:
+    static auto ok(T&& ok) -> LegacyResult<T, E>
+    {
+        return LegacyResult<T, E>{std::variant<T, E>{std::in_place_index<0>, std::move(ok)}};
+    }
+
+    static auto err(E&& error) -> LegacyResult<T, E>
+    {
+        return LegacyResult<T, E>{std::variant<T, E>{std::in_place_index<1>, std::move(error)}};
+    }
+
+    auto is_ok() -> bool
+    {
+        return(value.index() == 0);
+    }
+
+    auto get_ok() -> T
+    {
+        return std::get<0>(value);
+    }
+
+    auto get_err() -> E
+    {
+        return std::get<1>(value);
+    }
+
+private:
+    explicit LegacyResult(std::variant<T, E>&& v) : value(std::move(v))
+    {
+    }
+
+    std::variant<T, E> value;
+};
+
+// Shaped like a scheme value: mostly strings long enough to defeat the small string buffer.
+using Value = std::variant<bool, int, double, std::string>;
+
+struct Error
+{
+    int code;
+};
+
+double time_per_run(const std::function<size_t()>& run)
+{
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int rep = 0; rep < repetitions; ++rep)
+    {
+        sink += run();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (sink == 0)
+    {
+        fmt::print("no work done\n");
+    }
+
+    return elapsed.count() / repetitions;
+}
+
+std::string make_text(int idx)
+{
+    return fmt::format("a config string long enough to allocate {}", idx);
+}
+
+// The get_cpp_value path: a typed getter's result rewrapped into the value variant.
+template<template<typename, typename> class R>
+R<std::string, Error> get_string(int idx)
+{
+    return idx % 16 == 0 ? R<std::string, Error>::err(Error{idx}) : R<std::string, Error>::ok(make_text(idx));
+}
+
+size_t legacy_probe()
+{
+    size_t total = 0;
+
+    for (int idx = 0; idx < values; ++idx)
+    {
+        auto res = get_string<LegacyResult>(idx);
+        auto value = res.is_ok()
+            ? LegacyResult<Value, Error>::ok(Value{res.get_ok()})
+            : LegacyResult<Value, Error>::err(res.get_err());
+
+        // Call sites checked and unwrapped the same result more than once.
+        if (value.is_ok() && std::holds_alternative<std::string>(value.get_ok()))
+        {
+            total += std::get<std::string>(value.get_ok()).size();
+        }
+    }
+
+    return total;
+}
+
+size_t current_probe()
+{
+    size_t total = 0;
+
+    for (int idx = 0; idx < values; ++idx)
+    {
+        auto value = get_string<result::Result>(idx).map([](std::string text) { return Value{std::move(text)}; });
+
+        if (value.is_ok() && std::holds_alternative<std::string>(value.get_ok()))
+        {
+            total += std::get<std::string>(value.get_ok()).size();
+        }
+    }
+
+    return total;
+}
+
+int main()
+{
+    double legacy_seconds = time_per_run(legacy_probe);
+    double current_seconds = time_per_run(current_probe);
+
+    fmt::print("{:>8} {:>14}\n", "result", "ns per value");
+    fmt::print("{:>8} {:>14.1f}\n", "legacy", legacy_seconds / values * 1e9);
+    fmt::print("{:>8} {:>14.1f}\n", "current", current_seconds / values * 1e9);
+    fmt::print("speedup: {:.2f}x\n", legacy_seconds / current_seconds);
+
+    return 0;
+}
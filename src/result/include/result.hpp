@@ -1,13 +1,41 @@
 #ifndef SAMOS_RESULT_HPP
 #define SAMOS_RESULT_HPP
 
+#include <cassert>
+#include <functional>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
 namespace samos::result {
 
 template<typename T, typename E>
-class Result {
+class Result;
+
+namespace detail {
+
+template<typename R>
+struct is_result : std::false_type {};
+
+template<typename T, typename E>
+struct is_result<Result<T, E>> : std::true_type {};
+
+} // namespace detail
+
+/*
+ * Either a T or an E, stored in a std::variant so it is no larger than std::expected<T, E>.
+ *
+ * Accessors on an lvalue return references; on an rvalue they move the payload out, so
+ * `f().get_ok()` never copies. take_ok() and take_err() move out of a named result explicitly.
+ * map, and_then and or_else chain fallible steps without unwrapping at every call site.
+ */
+template<typename T, typename E>
+class [[nodiscard]] Result {
 public:
+    using ok_type = T;
+
+    using err_type = E;
+
     static auto ok(const T& ok) -> Result<T, E>
     {
         return Result<T, E>{std::variant<T, E>{std::in_place_index<0>, ok}};
@@ -28,26 +56,129 @@ public:
         return Result<T, E>{std::variant<T, E>{std::in_place_index<1>, std::move(error)}};
     }
 
-    auto is_ok() -> bool
+    [[nodiscard]] auto is_ok() const -> bool
     {
         return(value.index() == 0);
     }
 
-    auto is_err() -> bool
+    [[nodiscard]] auto is_err() const -> bool
     {
         return(value.index() == 1);
     }
 
-    auto get_ok() -> T
+    auto get_ok() & -> T&
     {
         return std::get<0>(value);
     }
 
-    auto get_err() -> E
+    auto get_ok() const& -> const T&
+    {
+        return std::get<0>(value);
+    }
+
+    auto get_ok() && -> T
+    {
+        return std::get<0>(std::move(value));
+    }
+
+    auto get_err() & -> E&
     {
         return std::get<1>(value);
     }
 
+    auto get_err() const& -> const E&
+    {
+        return std::get<1>(value);
+    }
+
+    auto get_err() && -> E
+    {
+        return std::get<1>(std::move(value));
+    }
+
+    // Moves the payload out; the result is left holding a moved-from value.
+    [[nodiscard]] auto take_ok() -> T
+    {
+        return std::get<0>(std::move(value));
+    }
+
+    [[nodiscard]] auto take_err() -> E
+    {
+        return std::get<1>(std::move(value));
+    }
+
+    // f(T) -> U, giving Result<U, E>.
+    template<typename F>
+    [[nodiscard]] auto map(F&& f) const& -> Result<std::invoke_result_t<F, const T&>, E>
+    {
+        using Mapped = Result<std::invoke_result_t<F, const T&>, E>;
+        return is_ok() ? Mapped::ok(std::invoke(std::forward<F>(f), get_ok())) : Mapped::err(get_err());
+    }
+
+    template<typename F>
+    [[nodiscard]] auto map(F&& f) && -> Result<std::invoke_result_t<F, T&&>, E>
+    {
+        using Mapped = Result<std::invoke_result_t<F, T&&>, E>;
+        return is_ok() ? Mapped::ok(std::invoke(std::forward<F>(f), take_ok())) : Mapped::err(take_err());
+    }
+
+    // f(E) -> E2, giving Result<T, E2>.
+    template<typename F>
+    [[nodiscard]] auto map_err(F&& f) && -> Result<T, std::invoke_result_t<F, E&&>>
+    {
+        using Mapped = Result<T, std::invoke_result_t<F, E&&>>;
+        return is_ok() ? Mapped::ok(take_ok()) : Mapped::err(std::invoke(std::forward<F>(f), take_err()));
+    }
+
+    // f(T) -> Result<U, E>.
+    template<typename F>
+    [[nodiscard]] auto and_then(F&& f) const& -> std::invoke_result_t<F, const T&>
+    {
+        using Next = std::invoke_result_t<F, const T&>;
+        static_assert(detail::is_result<Next>::value, "and_then must return a Result");
+        static_assert(std::is_same_v<typename Next::err_type, E>, "and_then must keep the error type");
+        return is_ok() ? std::invoke(std::forward<F>(f), get_ok()) : Next::err(get_err());
+    }
+
+    template<typename F>
+    [[nodiscard]] auto and_then(F&& f) && -> std::invoke_result_t<F, T&&>
+    {
+        using Next = std::invoke_result_t<F, T&&>;
+        static_assert(detail::is_result<Next>::value, "and_then must return a Result");
+        static_assert(std::is_same_v<typename Next::err_type, E>, "and_then must keep the error type");
+        return is_ok() ? std::invoke(std::forward<F>(f), take_ok()) : Next::err(take_err());
+    }
+
+    // f(E) -> Result<T, E2>, typically recovering with a fallback value.
+    template<typename F>
+    [[nodiscard]] auto or_else(F&& f) && -> std::invoke_result_t<F, E&&>
+    {
+        using Next = std::invoke_result_t<F, E&&>;
+        static_assert(detail::is_result<Next>::value, "or_else must return a Result");
+        static_assert(std::is_same_v<typename Next::ok_type, T>, "or_else must keep the ok type");
+        return is_ok() ? Next::ok(take_ok()) : std::invoke(std::forward<F>(f), take_err());
+    }
+
+    [[nodiscard]] auto ok_or(T fallback) && -> T
+    {
+        return is_ok() ? take_ok() : std::move(fallback);
+    }
+
+    /*
+     * Re-types an error for returning from a function with a different ok type:
+     *
+     *     if (res.is_err())
+     *     {
+     *         return std::move(res).template forward_err<U>();
+     *     }
+     */
+    template<typename U>
+    [[nodiscard]] auto forward_err() && -> Result<U, E>
+    {
+        assert(is_err());
+        return Result<U, E>::err(take_err());
+    }
+
 private:
     explicit Result(std::variant<T, E>&& v) : value(std::move(v))
     {
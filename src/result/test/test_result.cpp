@@ -26,3 +26,52 @@ TEST(ResultTest, ErrResult)
     ASSERT_STREQ(err.c_str(), "Error");
     EXPECT_THROW({err_res.get_ok();}, std::bad_variant_access);
 }
+
+using SResult = result::Result<std::string, std::string>;
+
+// No bigger than the variant it wraps, as with std::expected.
+static_assert(sizeof(SResult) == sizeof(std::variant<std::string, std::string>));
+
+TEST(ResultTest, Accessors)
+{
+    SResult ok_res = SResult::ok(std::string(64, 'x'));
+    const SResult& const_res = ok_res;
+
+    // Lvalue access hands out the stored value rather than a copy.
+    EXPECT_EQ(&ok_res.get_ok(), &const_res.get_ok());
+    ok_res.get_ok().push_back('y');
+    EXPECT_EQ(const_res.get_ok().size(), 65u);
+
+    std::string taken = ok_res.take_ok();
+    EXPECT_EQ(taken.size(), 65u);
+
+    EXPECT_EQ(SResult::err("temporary").get_err(), "temporary");
+}
+
+TEST(ResultTest, Combinators)
+{
+    auto parse = [](const std::string& text)
+    {
+        return text.empty() ? GResult::err("empty") : GResult::ok(static_cast<uint>(text.size()));
+    };
+
+    auto doubled = SResult::ok("abc").and_then(parse).map([](uint size) { return size * 2; });
+    ASSERT_TRUE(doubled.is_ok());
+    EXPECT_EQ(doubled.get_ok(), 6u);
+
+    auto failed = SResult::ok("").and_then(parse).map([](uint size) { return size * 2; });
+    ASSERT_TRUE(failed.is_err());
+    EXPECT_EQ(failed.get_err(), "empty");
+
+    auto recovered = std::move(failed).or_else([](std::string) { return GResult::ok(0); });
+    ASSERT_TRUE(recovered.is_ok());
+    EXPECT_EQ(recovered.get_ok(), 0u);
+
+    auto sized = SResult::err("bad").map_err([](std::string err) { return err.size(); });
+    EXPECT_EQ(sized.get_err(), 3u);
+
+    EXPECT_EQ(GResult::err("bad").ok_or(7), 7u);
+
+    auto forwarded = SResult::err("bad").forward_err<int>();
+    EXPECT_EQ(forwarded.get_err(), "bad");
+}
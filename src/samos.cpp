@@ -6,6 +6,7 @@
 #include "kelyphos.hpp"
 
 #include <string>
+#include <vector>
 #include <type_traits>
 #include <fmt/core.h>
 
@@ -24,17 +25,35 @@ int main(int argc, char** argv)
     slog::set_pattern("[%H:%M:%S %z] [%n] [%^---%L---%$] [thread %t] %v");
     samos_args::OptionParser samos_opts(argc, argv, "samos", "High fidelity interactive orbital simulation tool");
 
+    auto run_shell = [&samos_opts]()
+    {
+        run_kelyphos(samos_opts.flag_value<std::vector<std::string>>("set").value_or(std::vector<std::string>{}));
+    };
+
+    auto run_server = [&samos_opts]()
+    {
+        run_kelyphos_server(samos_opts.flag_value<std::vector<std::string>>("set").value_or(std::vector<std::string>{}));
+    };
+
     auto flags_added = samos_opts.add_flag_set({
-        {"k", "kelyphos", "Run The Kelyphos Shell", run_kelyphos},
+        {"k", "kelyphos", "Run The Kelyphos Shell", run_shell},
+        {"r", "serve", "Serve The Kelyphos Shell on a local socket", run_server},
+        {"a", "async-log", "Write log messages from a background thread", []() { slog::start_async(); }},
         {"v", "version", "Param version", version_callback},
         {"h", "help", "Print usage", samos_opts.create_help_callback(version_callback)}
     });
 
+    if (flags_added.is_ok())
+    {
+        flags_added = samos_opts.add_container_flag<std::string>(
+            {"s", "set", "Override a config value, e.g. kelyphos.ed-enable-history=#f", {}});
+    }
+
     if (flags_added.is_err())
     {
         auto err = flags_added.get_err().format();
         fmt::print(stderr, "Failed to add flags {}\n", err);
-        slog::log(SLogLevel::Critical, "Failed to add flags: {}", err);
+        slog::log<SLogLevel::Critical>("Failed to add flags: {}", err);
         std::exit(1);
     }
 
@@ -44,7 +63,7 @@ int main(int argc, char** argv)
     {
         auto err = parsed_res.get_err().format();
         fmt::print(stderr, "Failed to parse arguments: {}\n", err);
-        slog::log(SLogLevel::Critical, "Failed to parse arguments: {}", err);
+        slog::log<SLogLevel::Critical>("Failed to parse arguments: {}", err);
         std::exit(1);
     }
 
@@ -53,7 +72,9 @@ int main(int argc, char** argv)
         std::exit(0);
     }
 
+    samos_opts.handle_flag("async-log");
     samos_opts.handle_flag("kelyphos");
+    samos_opts.handle_flag("serve");
 
     return 0;
 }
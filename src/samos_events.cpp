@@ -0,0 +1,82 @@
+#include "event_log_reader.hpp"
+#include "option_parser.hpp"
+#include "../samos_config.hpp"
+
+#include <fmt/core.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace samos_args = samos::user_interface::option_parser;
+namespace event_log = samos::log::event_log;
+
+void version_callback()
+{
+    std::cout << PROJECT_NAME << " " << PROJECT_VER << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    samos_args::OptionParser opts(argc, argv, "samos_events", "Decode samos binary event logs to text or JSON");
+
+    auto flags_added = opts.add_flag_set({
+        {"j", "json", "Write JSON Lines instead of text", {}},
+        {"h", "help", "Print usage", opts.create_help_callback(version_callback)}
+    });
+
+    if (flags_added.is_ok())
+    {
+        flags_added = opts.add_container_flag<std::string>({"f", "file", "Event log to decode", {}});
+    }
+
+    if (flags_added.is_err())
+    {
+        fmt::print(stderr, "Failed to add flags {}\n", flags_added.get_err());
+        return 1;
+    }
+
+    auto parsed_res = opts.parse();
+
+    if (parsed_res.is_err())
+    {
+        fmt::print(stderr, "Failed to parse arguments: {}\n", parsed_res.get_err());
+        return 1;
+    }
+
+    if (opts.handle_flag("help"))
+    {
+        return 0;
+    }
+
+    bool json = opts.flag_value<bool>("json").value_or(false);
+    auto filenames = opts.flag_value<std::vector<std::string>>("file").value_or(std::vector<std::string>{});
+
+    for (const auto& filename : filenames)
+    {
+        auto log_res = event_log::read_event_log(filename);
+
+        if (log_res.is_err())
+        {
+            fmt::print(stderr, "{}: {}\n", filename, log_res.get_err());
+            return 1;
+        }
+
+        const auto& log = log_res.get_ok();
+
+        if (log.truncated)
+        {
+            fmt::print(stderr, "{}: truncated, decoded {} events\n", filename, log.events.size());
+        }
+
+        if (json)
+        {
+            event_log::write_json(log, std::cout);
+        }
+        else
+        {
+            event_log::write_text(log, std::cout);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "scheme.hpp"
+
+#include <chrono>
+#include <fmt/core.h>
+#include <functional>
+#include <string>
+
+namespace scheme = samos::scheme;
+
+constexpr int repetitions = 10;
+
+// A sweep-result shaped datum: a long list of small records mixing every common atom type.
+constexpr const char* datum_source =
+    "(let loop ((i 0) (acc '()))"
+    "  (if (= i 100000)"
+    "      acc"
+    "      (loop (+ i 1) (cons (list i (* i 1.5) \"label\" 'burn (vector i (- i))) acc))))";
+
+constexpr const char* atoms_source =
+    "(let loop ((i 0) (acc '()))"
+    "  (if (= i 10000)"
+    "      acc"
+    "      (loop (+ i 1) (cons i (cons (* i 1.5) (cons \"label\" (cons 'burn acc)))))))";
+
+double time_per_run(const std::function<bool()>& run)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int rep = 0; rep < repetitions; ++rep)
+    {
+        if (!run())
+        {
+            return -1.0;
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / repetitions;
+}
+
+int main()
+{
+    scheme::Schemer source;
+    scheme::Schemer destination;
+
+    sexp datum = source.eval(datum_source);
+    source.preserve(datum);
+
+    size_t text_size = 0;
+    size_t binary_size = 0;
+
+    double text_seconds = time_per_run(
+        [&]()
+        {
+            std::string text = source.sexp_to_string(datum);
+            text_size = text.size();
+            return destination.read(text).is_ok();
+        });
+
+    double binary_seconds = time_per_run(
+        [&]()
+        {
+            auto bytes_res = source.serialize(datum);
+            if (bytes_res.is_err())
+            {
+                return false;
+            }
+            auto bytes = bytes_res.get_ok();
+            binary_size = bytes.size();
+            return destination.deserialize(bytes).is_ok();
+        });
+
+    fmt::print("{:>8} {:>12} {:>12} {:>12}\n", "format", "bytes", "seconds", "MB/s");
+    fmt::print(
+        "{:>8} {:>12} {:>12.4f} {:>12.1f}\n",
+        "text", text_size, text_seconds, text_size / text_seconds / 1e6);
+    fmt::print(
+        "{:>8} {:>12} {:>12.4f} {:>12.1f}\n",
+        "binary", binary_size, binary_seconds, binary_size / binary_seconds / 1e6);
+    fmt::print("binary round trip speedup: {:.2f}x\n", text_seconds / binary_seconds);
+
+    // The first page of a large result, which is all the shell prints before ,more.
+    size_t page_size = 0;
+
+    double page_seconds = time_per_run(
+        [&]()
+        {
+            auto printer = source.printer(datum);
+            std::string page;
+            while (printer->next_chunk(page) == scheme::PrintStatus::More)
+            {
+            }
+            page_size = page.size();
+            return page_size > 0;
+        });
+
+    fmt::print(
+        "first page: {} bytes in {:.1f} us, text round trip: {:.1f} ms\n",
+        page_size,
+        page_seconds * 1e6,
+        text_seconds * 1e3);
+
+    // get_cpp_value over a flat list of mixed atoms: the typed getter plus the result mapping.
+    samos::log::logger::set_level(samos::log::logger::LogLevel::Warn);
+    sexp atoms = source.eval(atoms_source);
+    source.preserve(atoms);
+    size_t atom_count = 0;
+
+    double cpp_value_seconds = time_per_run(
+        [&]()
+        {
+            atom_count = 0;
+            for (sexp rest = atoms; sexp_pairp(rest); rest = sexp_cdr(rest))
+            {
+                sexp atom = sexp_car(rest);
+                atom_count += source.get_cpp_value(atom).is_ok() ? 1 : 0;
+            }
+            return atom_count > 0;
+        });
+
+    fmt::print("get_cpp_value: {:.1f} ns per atom\n", cpp_value_seconds / atom_count * 1e9);
+
+    source.release(atoms);
+    source.release(datum);
+
+    return 0;
+}
@@ -0,0 +1,259 @@
+#ifndef SAMOS_DATUM_CODEC_HPP
+#define SAMOS_DATUM_CODEC_HPP
+
+#include <chibi/sexp.h>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace samos::scheme
+{
+
+using DatumBytes = std::vector<uint8_t>;
+
+/*
+ * Binary datum format, version 1:
+ *
+ *   datum  := "SD" version:u8 value
+ *   value  := tag:u8 payload
+ *
+ * Integers are LEB128 varints (signed values zigzag encoded first) and flonums are IEEE-754
+ * doubles in little endian order. Strings, pairs, vectors, bytevectors and uniform vectors are
+ * numbered in the order they are first written; a later occurrence of the same object is written
+ * as a Ref to that number, which preserves both sharing and cycles.
+ */
+enum class DatumTag : uint8_t
+{
+    Null = 0,
+    True = 1,
+    False = 2,
+    Void = 3,
+    Eof = 4,
+    Fixnum = 5,
+    Flonum = 6,
+    Char = 7,
+    String = 8,
+    Symbol = 9,
+    Pair = 10,
+    Vector = 11,
+    Bytevector = 12,
+    UniformVector = 13,
+    Ref = 14,
+};
+
+constexpr uint8_t datum_magic[2] = {'S', 'D'};
+
+constexpr uint8_t datum_version = 1;
+
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<uint8_t>& out) : out{out}
+    {
+    }
+
+    void u8(uint8_t value)
+    {
+        out.push_back(value);
+    }
+
+    void varint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void svarint(int64_t value)
+    {
+        varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void f64(double value)
+    {
+        uint64_t bits = std::bit_cast<uint64_t>(value);
+
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            out.push_back(static_cast<uint8_t>(bits >> shift));
+        }
+    }
+
+    void bytes(const void* data, size_t size)
+    {
+        auto* begin = static_cast<const uint8_t*>(data);
+        out.insert(out.end(), begin, begin + size);
+    }
+
+    void string(std::string_view value)
+    {
+        varint(value.size());
+        bytes(value.data(), value.size());
+    }
+
+private:
+    std::vector<uint8_t>& out;
+};
+
+// Every read is bounds checked; a short or malformed buffer yields std::nullopt, never a fault.
+class ByteReader {
+public:
+    explicit ByteReader(std::span<const uint8_t> in) : in{in}, pos{0}
+    {
+    }
+
+    std::optional<uint8_t> u8()
+    {
+        if (pos >= in.size())
+        {
+            return {};
+        }
+        return in[pos++];
+    }
+
+    std::optional<uint64_t> varint()
+    {
+        uint64_t value = 0;
+
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            auto byte = u8();
+            if (!byte.has_value())
+            {
+                return {};
+            }
+
+            value |= static_cast<uint64_t>(byte.value() & 0x7f) << shift;
+            if ((byte.value() & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+
+        return {};
+    }
+
+    std::optional<int64_t> svarint()
+    {
+        auto value = varint();
+        if (!value.has_value())
+        {
+            return {};
+        }
+        return static_cast<int64_t>((value.value() >> 1) ^ (~(value.value() & 1) + 1));
+    }
+
+    std::optional<double> f64()
+    {
+        if (remaining() < 8)
+        {
+            return {};
+        }
+
+        uint64_t bits = 0;
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            bits |= static_cast<uint64_t>(in[pos++]) << shift;
+        }
+
+        return std::bit_cast<double>(bits);
+    }
+
+    std::optional<std::span<const uint8_t>> bytes(size_t size)
+    {
+        if (remaining() < size)
+        {
+            return {};
+        }
+
+        auto view = in.subspan(pos, size);
+        pos += size;
+        return view;
+    }
+
+    std::optional<std::string_view> string()
+    {
+        auto size = varint();
+        if (!size.has_value())
+        {
+            return {};
+        }
+
+        auto view = bytes(size.value());
+        if (!view.has_value())
+        {
+            return {};
+        }
+
+        return std::string_view{reinterpret_cast<const char*>(view->data()), view->size()};
+    }
+
+    [[nodiscard]] size_t remaining() const
+    {
+        return in.size() - pos;
+    }
+
+private:
+    std::span<const uint8_t> in;
+
+    size_t pos;
+};
+
+/*
+ * One value of an encoded datum with its payload read and checked but nothing built from it, so
+ * decoders with and without a scheme context parse alike. A Pair or Vector is followed by its
+ * count children, depth first.
+ */
+struct DatumToken
+{
+    DatumTag tag;
+
+    // Fixnum value or character code point.
+    int64_t integer = 0;
+
+    double flonum = 0.0;
+
+    // Contents of a string, symbol or bytevector, or a uniform vector's storage; points into the
+    // encoded bytes.
+    std::string_view text;
+
+    uint64_t count = 0;
+
+    // The number of the object a Ref repeats.
+    uint64_t ref = 0;
+
+    uint8_t element_type = 0;
+
+    // Elements of a uniform vector.
+    uint64_t length = 0;
+};
+
+// Objects that are numbered as they are read, for Refs to name.
+constexpr bool is_numbered(DatumTag tag)
+{
+    return tag == DatumTag::String || tag == DatumTag::Pair || tag == DatumTag::Vector
+        || tag == DatumTag::Bytevector || tag == DatumTag::UniformVector;
+}
+
+// Reads the magic and version; false if either is wrong.
+bool read_datum_header(ByteReader& reader);
+
+// Reads the next value; std::nullopt for an unknown tag or a payload the buffer cuts short.
+std::optional<DatumToken> read_datum_token(ByteReader& reader);
+
+// Appends the encoding of obj to out. Returns false, leaving out unspecified, if obj contains
+// something without an external representation (procedures, ports, bignums...).
+bool encode_datum(sexp ctx, sexp obj, DatumBytes& out);
+
+// Rebuilds a datum in ctx. Returns std::nullopt if the buffer is malformed.
+std::optional<sexp> decode_datum(sexp ctx, std::span<const uint8_t> in);
+
+} // namespace samos::scheme
+
+#endif // SAMOS_DATUM_CODEC_HPP
@@ -0,0 +1,120 @@
+#ifndef SAMOS_DATUM_PRINTER_HPP
+#define SAMOS_DATUM_PRINTER_HPP
+
+#include <chibi/sexp.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace samos::scheme
+{
+
+struct PrintLimits
+{
+    // Lists and vectors nested deeper than this are written as (...) and #(...).
+    size_t max_depth = 64;
+
+    // Output written before the printer pauses for the caller to ask for more.
+    size_t page_bytes = 64 * 1024;
+
+    // Output handed over at a time.
+    size_t chunk_bytes = 4096;
+};
+
+enum class PrintStatus
+{
+    // The chunk is full and the page has room for more.
+    More,
+    // The page is written; next_page continues the datum.
+    PageFull,
+    Done,
+};
+
+/*
+ * Writes a datum in write's notation a chunk at a time, so a result of any size costs a chunk of
+ * memory rather than its whole text. The walk keeps its own stack, as the encoder does, and can
+ * stop between any two characters: long strings are split too. A cycle through cdrs pages on
+ * without end and one through cars stops at the depth limit.
+ *
+ * The datum is preserved while the printer lives, and so is whatever it has still to visit
+ * while paused, in case scheme code mutates the datum between pages.
+ */
+class DatumPrinter {
+public:
+    DatumPrinter(sexp ctx, sexp datum, PrintLimits limits);
+
+    ~DatumPrinter();
+
+    DatumPrinter(const DatumPrinter&) = delete;
+
+    DatumPrinter& operator=(const DatumPrinter&) = delete;
+
+    // Appends up to chunk_bytes of output to out, a little more if an atom is written whole.
+    PrintStatus next_chunk(std::string& out);
+
+    // Starts a new page after PageFull.
+    void next_page();
+
+    // Output written so far, over every page.
+    [[nodiscard]] size_t written() const;
+
+    [[nodiscard]] bool done() const;
+
+private:
+    enum class Step
+    {
+        Value,
+        // The rest of a list after its first element.
+        ListRest,
+        VectorRest,
+        StringRest,
+        Text,
+    };
+
+    struct Frame
+    {
+        Step step;
+
+        sexp obj;
+
+        size_t depth;
+
+        // The next element of a vector or byte of a string.
+        size_t index;
+
+        // For Text.
+        const char* text;
+    };
+
+    void write_value(sexp obj, size_t depth, std::string& out);
+
+    void write_list_rest(const Frame& frame, std::string& out);
+
+    void write_vector_rest(const Frame& frame, std::string& out);
+
+    void write_string_rest(const Frame& frame, std::string& out, size_t budget);
+
+    void write_atom(sexp obj, std::string& out);
+
+    void hold_pending();
+
+    void release_held();
+
+    sexp ctx;
+
+    sexp root;
+
+    PrintLimits limits;
+
+    std::vector<Frame> pending;
+
+    std::vector<sexp> held;
+
+    size_t page_written;
+
+    size_t total_written;
+};
+
+} // namespace samos::scheme
+
+#endif // SAMOS_DATUM_PRINTER_HPP
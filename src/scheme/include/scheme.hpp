@@ -1,12 +1,18 @@
 #ifndef SAMOS_SCHEME_HPP
 #define SAMOS_SCHEME_HPP
 
+#include "datum_codec.hpp"
+#include "datum_printer.hpp"
 #include "scheme_module.hpp"
 #include "logger.hpp"
 #include "result.hpp"
 
 #include <chibi/eval.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <typeinfo>
 #include <unordered_map>
 #include <vector>
@@ -27,7 +33,7 @@ enum class SexpType
     Pair,
 };
 
-std::string format_sexp_type(SexpType t);
+std::string_view format_sexp_type(SexpType t);
 
 class Symbol : public std::string
 {
@@ -49,7 +55,7 @@ using SexpCVVar = std::variant<
 class OpRegistrationError
 {
 public:
-    std::string format()
+    std::string format() const
     {
         return {"Error registering op"};
     }
@@ -58,7 +64,7 @@ public:
 class TypeAlreadyRegistered
 {
 public:
-    std::string format()
+    std::string format() const
     {
         return {"Type already registered"};
     }
@@ -67,7 +73,7 @@ public:
 class TypeRegistrationError
 {
 public:
-    std::string format()
+    std::string format() const
     {
         return {"Type registration error"};
     }
@@ -76,7 +82,7 @@ public:
 class TypeNotFound
 {
 public:
-    std::string format()
+    std::string format() const
     {
         return {"Type not found"};
     }
@@ -85,7 +91,7 @@ public:
 class BadTypeError
 {
 public:
-    std::string format()
+    std::string format() const
     {
         return {"Bad type for operation"};
     }
@@ -101,7 +107,7 @@ public:
     {
     }
 
-    std::string format()
+    std::string format() const
     {
         return fmt::format(
             "Bad type: expected {}, got {} for operation",
@@ -117,7 +123,7 @@ private:
 class FilenameError
 {
 public:
-    std::string format()
+    std::string format() const
     {
         return {"filename error"};
     }
@@ -130,7 +136,7 @@ public:
     {
     }
 
-    std::string format()
+    std::string format() const
     {
         return fmt::format("Key {} not found", key);
     }
@@ -139,8 +145,28 @@ private:
     std::string key;
 };
 
-class SchemeException {
-    std::string format()
+class DatumEncodeError
+{
+public:
+    std::string format() const
+    {
+        return {"Datum has no serializable representation"};
+    }
+};
+
+class DatumDecodeError
+{
+public:
+    std::string format() const
+    {
+        return {"Malformed serialized datum"};
+    }
+};
+
+class SchemeException
+{
+public:
+    std::string format() const
     {
         return "Exception";
     }
@@ -156,6 +182,8 @@ using SchemeErrVariant = std::variant<
     FilenameError,
     BadTypeError,
     AssocKeyNotFound,
+    DatumEncodeError,
+    DatumDecodeError,
     SchemeException>;
 
 }
@@ -164,37 +192,12 @@ class SchemerError : public detail::SchemeErrVariant
 {
     using detail::SchemeErrVariant::variant;
 public:
-    std::string format()
+    std::string format() const
     {
-        if (std::holds_alternative<OpRegistrationError>(*this))
-        {
-            return std::get<OpRegistrationError>(*this).format();
-        }
-        else if (std::holds_alternative<TypeAlreadyRegistered>(*this))
-        {
-            return std::get<TypeAlreadyRegistered>(*this).format();
-        }
-        else if (std::holds_alternative<TypeNotFound>(*this))
-        {
-            return std::get<TypeNotFound>(*this).format();
-        }
-        else if (std::holds_alternative<SexpTypeError>(*this))
-        {
-            return std::get<SexpTypeError>(*this).format();
-        }
-        else if (std::holds_alternative<FilenameError>(*this))
-        {
-            return std::get<FilenameError>(*this).format();
-        }
-        else if (std::holds_alternative<BadTypeError>(*this))
-        {
-            return std::get<BadTypeError>(*this).format();
-        }
-        else
-        {
-            assert(std::holds_alternative<AssocKeyNotFound>(*this));
-            return std::get<AssocKeyNotFound>(*this).format();
-        }
+        // One indexed jump rather than a holds_alternative test per alternative.
+        return std::visit(
+            [](const auto& error) { return error.format(); },
+            static_cast<const detail::SchemeErrVariant&>(*this));
     }
 };
 
@@ -218,11 +221,50 @@ public:
 template <typename T = std::monostate>
 using SchemerResult = result::Result<T, SchemerError>;
 
+/*
+ * Standard loads the full R7RS environment and standard ports. ReaderOnly keeps the bare context
+ * environment: enough to read datums and walk them from C++, at a fraction of the startup cost.
+ */
+enum class SchemerEnv
+{
+    Standard,
+    ReaderOnly,
+};
+
+/*
+ * How much of an environment's bindings a caller has already seen. chibi pushes every
+ * definition, import and foreign op onto the front of the environment's binding list, so what
+ * was added since the last look is whatever lies in front of the remembered head.
+ */
+struct BindingCursor
+{
+    // Preserved from collection while held; nullptr before the first look.
+    sexp head = nullptr;
+};
+
+/*
+ * What the heap holds and what the collector has done. chibi counts collections on the context
+ * that ran them, so these only include collections run while the root context itself was
+ * evaluating, as in apply and call, and are zero unless chibi was built with SEXP_USE_TIME_GC.
+ */
+struct HeapStats
+{
+    size_t heap_bytes = 0;
+
+    size_t free_bytes = 0;
+
+    uint64_t collections = 0;
+
+    uint64_t gc_usecs = 0;
+};
+
 class Schemer {
 public:
 
     Schemer();
 
+    explicit Schemer(SchemerEnv env);
+
     ~Schemer();
 
     template <typename F>
@@ -270,7 +312,7 @@ public:
 
         sexp_env_define(context, environment, sym, ptr);
 
-        log(LogLevel::Info, "Bound symbol: {} to pointer of type {}", symbol, type_name);
+        log<LogLevel::Info>("Bound symbol: {} to pointer of type {}", symbol, type_name);
 
         return SchemerResult<>::ok({});
     }
@@ -309,16 +351,49 @@ public:
 
     sexp eval(const std::string& input);
 
+    sexp eval_datum(sexp expr);
+
     void load(const std::string& filename);
 
     SchemerResult<sexp> read_from_file(const std::string& filename);
 
+    SchemerResult<sexp> read(const std::string& input);
+
+    [[nodiscard]] SchemerEnv get_env_kind() const;
+
+    sexp apply(sexp proc, sexp arg);
+
+    // Calls a procedure of no arguments.
+    sexp call(sexp proc);
+
+    void preserve(sexp obj);
+
+    void release(sexp obj);
+
     void print_exception(const sexp& result);
 
     std::string sexp_to_string(const sexp& result, bool print_exception = false);
 
+    // Writes obj a chunk and a page at a time; the printer must not outlive this Schemer.
+    std::unique_ptr<DatumPrinter> printer(sexp obj, PrintLimits limits = {});
+
+    SchemerResult<DatumBytes> serialize(sexp obj);
+
+    SchemerResult<sexp> deserialize(std::span<const uint8_t> bytes);
+
     SchemerResult<> import_module(SchemeModule mod);
 
+    [[nodiscard]] const std::vector<SchemeModule>& imported_modules() const;
+
+    /*
+     * Appends the names bound since cursor was last used and moves it up to date. The first call
+     * reports every binding, parent environments included; later calls only walk the new ones.
+     */
+    void collect_new_bindings(BindingCursor& cursor, std::vector<std::string>& names);
+
+    // Walks the heap's free lists, so the cost grows with fragmentation.
+    [[nodiscard]] HeapStats heap_stats() const;
+
     bool sexp_equal(sexp& a, sexp& b) const;
 
     SexpType sexp_type(sexp& obj) const;
@@ -384,6 +459,10 @@ private:
     sexp environment;
 
     std::unordered_map<size_t, sexp_uint_t> registered_c_types;
+
+    std::vector<SchemeModule> modules;
+
+    SchemerEnv env_kind;
 };
 
 } // namespace samos::scheme
@@ -0,0 +1,38 @@
+#ifndef SAMOS_SCHEME_LOG_HPP
+#define SAMOS_SCHEME_LOG_HPP
+
+#include "scheme.hpp"
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace samos::scheme
+{
+
+// Rendering stops at this size and ends the message with "...".
+constexpr size_t max_log_message_size = 16 * 1024;
+
+/*
+ * Appends format to out with its SRFI 28 directives expanded: ~a displays and ~s writes the next
+ * argument, ~% is a newline and ~~ a tilde. args holds one encoded datum per argument, back to
+ * back, as written by encode_datum. Shared structure is printed in full and a cycle as "...".
+ * Works on the bytes alone, so it is safe to call from any thread.
+ */
+void render_log_format(std::string_view format, std::span<const uint8_t> args, fmt::memory_buffer& out);
+
+/*
+ * Defines log-trace, log-debug, log-info, log-warn, log-error and log-critical:
+ *
+ *     (log-info "step ~a: state ~s" step state)
+ *
+ * Below the logger's level a call returns at once. Otherwise the arguments are copied in the
+ * binary datum encoding and the text is built by the logger, on its writer thread when async
+ * logging is on, so the interpreter never formats or writes strings for a log call.
+ */
+[[nodiscard]] SchemerResult<> install_log_ops(Schemer& schemer);
+
+} // namespace samos::scheme
+
+#endif // SAMOS_SCHEME_LOG_HPP
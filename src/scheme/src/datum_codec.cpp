@@ -0,0 +1,614 @@
+#include "datum_codec.hpp"
+
+#include <unordered_map>
+
+namespace samos::scheme
+{
+
+namespace
+{
+
+class DatumEncoder {
+public:
+    DatumEncoder(sexp ctx, DatumBytes& out)
+        :
+        ctx{ctx},
+        writer{out},
+        seen{},
+        pending{}
+    {
+    }
+
+    // Walks the datum with an explicit stack, so neither long lists nor deep nesting can
+    // overflow the C stack. Children are pushed in reverse so they are written in order.
+    bool encode(sexp root)
+    {
+        pending.push_back(root);
+
+        while (!pending.empty())
+        {
+            sexp obj = pending.back();
+            pending.pop_back();
+
+            if (!encode_one(obj))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+
+    // Writes a Ref and returns true if obj was written before, otherwise numbers it.
+    bool write_ref(sexp obj)
+    {
+        auto [it, inserted] = seen.try_emplace(obj, seen.size());
+
+        if (inserted)
+        {
+            return false;
+        }
+
+        writer.u8(static_cast<uint8_t>(DatumTag::Ref));
+        writer.varint(it->second);
+        return true;
+    }
+
+    bool encode_one(sexp obj)
+    {
+        if (sexp_nullp(obj))
+        {
+            writer.u8(static_cast<uint8_t>(DatumTag::Null));
+        }
+        else if (obj == SEXP_TRUE)
+        {
+            writer.u8(static_cast<uint8_t>(DatumTag::True));
+        }
+        else if (obj == SEXP_FALSE)
+        {
+            writer.u8(static_cast<uint8_t>(DatumTag::False));
+        }
+        else if (obj == SEXP_VOID)
+        {
+            writer.u8(static_cast<uint8_t>(DatumTag::Void));
+        }
+        else if (obj == SEXP_EOF)
+        {
+            writer.u8(static_cast<uint8_t>(DatumTag::Eof));
+        }
+        else if (sexp_fixnump(obj))
+        {
+            writer.u8(static_cast<uint8_t>(DatumTag::Fixnum));
+            writer.svarint(sexp_unbox_fixnum(obj));
+        }
+        else if (sexp_flonump(obj))
+        {
+            writer.u8(static_cast<uint8_t>(DatumTag::Flonum));
+            writer.f64(sexp_flonum_value(obj));
+        }
+        else if (sexp_charp(obj))
+        {
+            writer.u8(static_cast<uint8_t>(DatumTag::Char));
+            writer.varint(static_cast<uint64_t>(sexp_unbox_character(obj)));
+        }
+        else if (sexp_symbolp(obj))
+        {
+            sexp name = sexp_symbol_to_string(ctx, obj);
+            writer.u8(static_cast<uint8_t>(DatumTag::Symbol));
+            writer.string({sexp_string_data(name), sexp_string_size(name)});
+        }
+        else if (sexp_stringp(obj))
+        {
+            if (!write_ref(obj))
+            {
+                writer.u8(static_cast<uint8_t>(DatumTag::String));
+                writer.string({sexp_string_data(obj), sexp_string_size(obj)});
+            }
+        }
+        else if (sexp_pairp(obj))
+        {
+            if (!write_ref(obj))
+            {
+                writer.u8(static_cast<uint8_t>(DatumTag::Pair));
+                pending.push_back(sexp_cdr(obj));
+                pending.push_back(sexp_car(obj));
+            }
+        }
+        else if (sexp_vectorp(obj))
+        {
+            if (!write_ref(obj))
+            {
+                sexp_uint_t length = sexp_vector_length(obj);
+                sexp* data = sexp_vector_data(obj);
+
+                writer.u8(static_cast<uint8_t>(DatumTag::Vector));
+                writer.varint(length);
+                for (sexp_uint_t idx = length; idx > 0; --idx)
+                {
+                    pending.push_back(data[idx - 1]);
+                }
+            }
+        }
+        else if (sexp_bytesp(obj))
+        {
+            if (!write_ref(obj))
+            {
+                writer.u8(static_cast<uint8_t>(DatumTag::Bytevector));
+                writer.varint(sexp_bytes_length(obj));
+                writer.bytes(sexp_bytes_data(obj), sexp_bytes_length(obj));
+            }
+        }
+#if SEXP_USE_UNIFORM_VECTOR_LITERALS
+        else if (sexp_uvectorp(obj))
+        {
+            if (!write_ref(obj))
+            {
+                sexp storage = sexp_uvector_bytes(obj);
+
+                writer.u8(static_cast<uint8_t>(DatumTag::UniformVector));
+                writer.u8(static_cast<uint8_t>(sexp_uvector_type(obj)));
+                writer.varint(sexp_uvector_length(obj));
+                writer.varint(sexp_bytes_length(storage));
+                writer.bytes(sexp_bytes_data(storage), sexp_bytes_length(storage));
+            }
+        }
+#endif
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    sexp ctx;
+
+    ByteWriter writer;
+
+    std::unordered_map<sexp, uint64_t> seen;
+
+    std::vector<sexp> pending;
+};
+
+/*
+ * Decoding fills a tree of destination slots. Every compound object is allocated empty, stored in
+ * its parent's slot, and only then are its children read, so all partially built objects stay
+ * reachable from the root. Numbered objects are also kept in a scheme vector that is itself
+ * rooted, which keeps them alive across allocations and resolves Refs.
+ */
+class DatumDecoder {
+public:
+    DatumDecoder(sexp ctx, std::span<const uint8_t> in)
+        :
+        ctx{ctx},
+        reader{in},
+        objects{nullptr},
+        num_objects{0},
+        slots{}
+    {
+    }
+
+    std::optional<sexp> decode()
+    {
+        sexp_gc_var3(root, table, value);
+        sexp_gc_preserve3(ctx, root, table, value);
+
+        root = sexp_cons(ctx, SEXP_FALSE, SEXP_NULL);
+        table = sexp_make_vector(ctx, sexp_make_fixnum(initial_table_size), SEXP_FALSE);
+        objects = &table;
+
+        bool ok = true;
+        slots.push_back({root, car_slot});
+
+        while (ok && !slots.empty())
+        {
+            Slot slot = slots.back();
+            slots.pop_back();
+            ok = decode_one(slot, value);
+        }
+
+        std::optional<sexp> result;
+
+        if (ok && reader.remaining() == 0)
+        {
+            result = sexp_car(root);
+        }
+
+        sexp_gc_release3(ctx);
+
+        return result;
+    }
+
+private:
+
+    static constexpr sexp_sint_t car_slot = -1;
+
+    static constexpr sexp_sint_t cdr_slot = -2;
+
+    static constexpr sexp_uint_t initial_table_size = 64;
+
+    struct Slot
+    {
+        sexp parent;
+        sexp_sint_t index;
+    };
+
+    void store(const Slot& slot, sexp value)
+    {
+        if (slot.index == car_slot)
+        {
+            sexp_car(slot.parent) = value;
+        }
+        else if (slot.index == cdr_slot)
+        {
+            sexp_cdr(slot.parent) = value;
+        }
+        else
+        {
+            sexp_vector_data(slot.parent)[slot.index] = value;
+        }
+    }
+
+    // Grows the object table ahead of allocating the object it will hold, so a fresh object is
+    // never left unrooted while the table itself is being reallocated.
+    void reserve_object()
+    {
+        sexp_uint_t capacity = sexp_vector_length(*objects);
+
+        if (num_objects < capacity)
+        {
+            return;
+        }
+
+        sexp grown = sexp_make_vector(ctx, sexp_make_fixnum(capacity * 2), SEXP_FALSE);
+        std::memcpy(sexp_vector_data(grown), sexp_vector_data(*objects), capacity * sizeof(sexp));
+        *objects = grown;
+    }
+
+    void register_object(sexp obj)
+    {
+        sexp_vector_data(*objects)[num_objects++] = obj;
+    }
+
+    bool decode_one(const Slot& slot, sexp& value)
+    {
+        auto token = read_datum_token(reader);
+
+        if (!token.has_value())
+        {
+            return false;
+        }
+
+        if (token->tag == DatumTag::Ref)
+        {
+            if (token->ref >= num_objects)
+            {
+                return false;
+            }
+            store(slot, sexp_vector_data(*objects)[token->ref]);
+            return true;
+        }
+
+        bool numbered = is_numbered(token->tag);
+
+        if (numbered)
+        {
+            reserve_object();
+        }
+
+        switch (token->tag)
+        {
+        case DatumTag::Null:
+            value = SEXP_NULL;
+            break;
+
+        case DatumTag::True:
+            value = SEXP_TRUE;
+            break;
+
+        case DatumTag::False:
+            value = SEXP_FALSE;
+            break;
+
+        case DatumTag::Void:
+            value = SEXP_VOID;
+            break;
+
+        case DatumTag::Eof:
+            value = SEXP_EOF;
+            break;
+
+        case DatumTag::Fixnum:
+            value = sexp_make_fixnum(token->integer);
+            break;
+
+        case DatumTag::Flonum:
+            value = sexp_make_flonum(ctx, token->flonum);
+            break;
+
+        case DatumTag::Char:
+            value = sexp_make_character(static_cast<int>(token->integer));
+            break;
+
+        case DatumTag::Symbol:
+            value = sexp_intern(ctx, token->text.data(), token->text.size());
+            break;
+
+        case DatumTag::String:
+            value = sexp_c_string(ctx, token->text.data(), token->text.size());
+            break;
+
+        case DatumTag::Pair:
+            value = sexp_cons(ctx, SEXP_FALSE, SEXP_FALSE);
+            break;
+
+        case DatumTag::Vector:
+            value = sexp_make_vector(ctx, sexp_make_fixnum(token->count), SEXP_FALSE);
+            break;
+
+        case DatumTag::Bytevector:
+            value = sexp_make_bytes(ctx, sexp_make_fixnum(token->text.size()), sexp_make_fixnum(0));
+            std::memcpy(sexp_bytes_data(value), token->text.data(), token->text.size());
+            break;
+
+#if SEXP_USE_UNIFORM_VECTOR_LITERALS
+        case DatumTag::UniformVector:
+            value = sexp_make_uvector(
+                ctx,
+                sexp_make_fixnum(token->element_type),
+                sexp_make_fixnum(token->length));
+            if (sexp_exceptionp(value) || sexp_bytes_length(sexp_uvector_bytes(value)) != token->text.size())
+            {
+                return false;
+            }
+            std::memcpy(sexp_uvector_data(value), token->text.data(), token->text.size());
+            break;
+#endif
+
+        default:
+            return false;
+        }
+
+        if (numbered)
+        {
+            register_object(value);
+        }
+
+        store(slot, value);
+
+        if (token->tag == DatumTag::Pair)
+        {
+            slots.push_back({value, cdr_slot});
+            slots.push_back({value, car_slot});
+        }
+        else if (token->tag == DatumTag::Vector)
+        {
+            for (sexp_uint_t idx = token->count; idx > 0; --idx)
+            {
+                slots.push_back({value, static_cast<sexp_sint_t>(idx - 1)});
+            }
+        }
+
+        return true;
+    }
+
+    sexp ctx;
+
+    ByteReader reader;
+
+    sexp* objects;
+
+    sexp_uint_t num_objects;
+
+    std::vector<Slot> slots;
+};
+
+// Bits per element of a uniform vector type, or 0 for a type a datum cannot carry. chibi makes
+// a plain bytevector for U8, which is encoded as a Bytevector instead.
+constexpr uint64_t uvector_element_bits(uint8_t element_type)
+{
+    switch (element_type)
+    {
+#if SEXP_USE_UNIFORM_VECTOR_LITERALS
+    case SEXP_U1:
+        return 1;
+    case SEXP_S8:
+        return 8;
+    case SEXP_S16:
+    case SEXP_U16:
+        return 16;
+    case SEXP_S32:
+    case SEXP_U32:
+    case SEXP_F32:
+        return 32;
+    case SEXP_S64:
+    case SEXP_U64:
+    case SEXP_F64:
+    case SEXP_C64:
+        return 64;
+    case SEXP_C128:
+        return 128;
+#endif
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+bool read_datum_header(ByteReader& reader)
+{
+    auto header = reader.bytes(sizeof(datum_magic));
+    auto version = reader.u8();
+
+    return header.has_value() && std::memcmp(header->data(), datum_magic, sizeof(datum_magic)) == 0
+        && version == datum_version;
+}
+
+std::optional<DatumToken> read_datum_token(ByteReader& reader)
+{
+    auto tag = reader.u8();
+
+    if (!tag.has_value())
+    {
+        return {};
+    }
+
+    DatumToken token{};
+    token.tag = static_cast<DatumTag>(tag.value());
+
+    switch (token.tag)
+    {
+    case DatumTag::Null:
+    case DatumTag::True:
+    case DatumTag::False:
+    case DatumTag::Void:
+    case DatumTag::Eof:
+        return token;
+
+    case DatumTag::Fixnum:
+    {
+        auto fixnum = reader.svarint();
+        if (!fixnum.has_value())
+        {
+            return {};
+        }
+        token.integer = fixnum.value();
+        return token;
+    }
+
+    case DatumTag::Flonum:
+    {
+        auto flonum = reader.f64();
+        if (!flonum.has_value())
+        {
+            return {};
+        }
+        token.flonum = flonum.value();
+        return token;
+    }
+
+    case DatumTag::Char:
+    {
+        auto code_point = reader.varint();
+        if (!code_point.has_value())
+        {
+            return {};
+        }
+        token.integer = static_cast<int64_t>(code_point.value());
+        return token;
+    }
+
+    case DatumTag::Symbol:
+    case DatumTag::String:
+    {
+        auto text = reader.string();
+        if (!text.has_value())
+        {
+            return {};
+        }
+        token.text = text.value();
+        return token;
+    }
+
+    case DatumTag::Pair:
+        token.count = 2;
+        return token;
+
+    case DatumTag::Vector:
+    {
+        auto length = reader.varint();
+        // Each element takes at least one byte, which bounds the allocation by the input.
+        if (!length.has_value() || length.value() > reader.remaining())
+        {
+            return {};
+        }
+        token.count = length.value();
+        return token;
+    }
+
+    case DatumTag::Bytevector:
+    {
+        auto length = reader.varint();
+        auto data = length.has_value() ? reader.bytes(length.value()) : std::nullopt;
+        if (!data.has_value())
+        {
+            return {};
+        }
+        token.text = {reinterpret_cast<const char*>(data->data()), data->size()};
+        return token;
+    }
+
+    case DatumTag::UniformVector:
+    {
+        auto element_type = reader.u8();
+        auto length = reader.varint();
+        auto size = reader.varint();
+        if (!element_type.has_value() || !length.has_value() || !size.has_value())
+        {
+            return {};
+        }
+        auto data = reader.bytes(size.value());
+        if (!data.has_value())
+        {
+            return {};
+        }
+        // Checked here so the decoder never asks chibi for a vector the bytes cannot fill. size
+        // is bounded by the buffer, so once length is too, the product cannot overflow.
+        uint64_t bits = uvector_element_bits(element_type.value());
+        if (bits == 0 || length.value() > size.value() * 8
+            || (length.value() * bits + 7) / 8 != size.value())
+        {
+            return {};
+        }
+        token.element_type = element_type.value();
+        token.length = length.value();
+        token.text = {reinterpret_cast<const char*>(data->data()), data->size()};
+        return token;
+    }
+
+    case DatumTag::Ref:
+    {
+        auto index = reader.varint();
+        if (!index.has_value())
+        {
+            return {};
+        }
+        token.ref = index.value();
+        return token;
+    }
+
+    default:
+        return {};
+    }
+}
+
+bool encode_datum(sexp ctx, sexp obj, DatumBytes& out)
+{
+    ByteWriter writer{out};
+
+    writer.bytes(datum_magic, sizeof(datum_magic));
+    writer.u8(datum_version);
+
+    DatumEncoder encoder{ctx, out};
+
+    return encoder.encode(obj);
+}
+
+std::optional<sexp> decode_datum(sexp ctx, std::span<const uint8_t> in)
+{
+    ByteReader reader{in};
+
+    if (!read_datum_header(reader))
+    {
+        return {};
+    }
+
+    DatumDecoder decoder{ctx, in.subspan(sizeof(datum_magic) + 1)};
+
+    return decoder.decode();
+}
+
+} // namespace samos::scheme
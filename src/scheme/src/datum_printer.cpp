@@ -0,0 +1,259 @@
+#include "datum_printer.hpp"
+
+#include <algorithm>
+#include <fmt/core.h>
+
+namespace samos::scheme
+{
+
+DatumPrinter::DatumPrinter(sexp ctx, sexp datum, PrintLimits limits)
+    :
+    ctx{ctx},
+    root{datum},
+    limits{limits},
+    pending{},
+    held{},
+    page_written{0},
+    total_written{0}
+{
+    sexp_preserve_object(ctx, root);
+    pending.push_back({Step::Value, root, 0, 0, nullptr});
+}
+
+DatumPrinter::~DatumPrinter()
+{
+    release_held();
+    sexp_release_object(ctx, root);
+}
+
+PrintStatus DatumPrinter::next_chunk(std::string& out)
+{
+    release_held();
+
+    size_t start = out.size();
+    size_t page_left = limits.page_bytes - std::min(page_written, limits.page_bytes);
+    size_t chunk_left = std::min(std::max<size_t>(limits.chunk_bytes, 1), page_left);
+
+    while (!pending.empty() && out.size() - start < chunk_left)
+    {
+        Frame frame = pending.back();
+        pending.pop_back();
+
+        switch (frame.step)
+        {
+        case Step::Value:
+            write_value(frame.obj, frame.depth, out);
+            break;
+        case Step::ListRest:
+            write_list_rest(frame, out);
+            break;
+        case Step::VectorRest:
+            write_vector_rest(frame, out);
+            break;
+        case Step::StringRest:
+            write_string_rest(frame, out, chunk_left - (out.size() - start));
+            break;
+        case Step::Text:
+            out += frame.text;
+            break;
+        }
+    }
+
+    page_written += out.size() - start;
+    total_written += out.size() - start;
+
+    if (pending.empty())
+    {
+        return PrintStatus::Done;
+    }
+    else if (page_written >= limits.page_bytes)
+    {
+        hold_pending();
+        return PrintStatus::PageFull;
+    }
+
+    return PrintStatus::More;
+}
+
+void DatumPrinter::next_page()
+{
+    page_written = 0;
+}
+
+size_t DatumPrinter::written() const
+{
+    return total_written;
+}
+
+bool DatumPrinter::done() const
+{
+    return pending.empty();
+}
+
+void DatumPrinter::write_value(sexp obj, size_t depth, std::string& out)
+{
+    if (sexp_pairp(obj))
+    {
+        if (depth >= limits.max_depth)
+        {
+            out += "(...)";
+            return;
+        }
+
+        out.push_back('(');
+        pending.push_back({Step::Text, nullptr, 0, 0, ")"});
+        pending.push_back({Step::ListRest, sexp_cdr(obj), depth + 1, 0, nullptr});
+        pending.push_back({Step::Value, sexp_car(obj), depth + 1, 0, nullptr});
+    }
+    else if (sexp_vectorp(obj) && sexp_vector_length(obj) > 0)
+    {
+        if (depth >= limits.max_depth)
+        {
+            out += "#(...)";
+            return;
+        }
+
+        out += "#(";
+        pending.push_back({Step::Text, nullptr, 0, 0, ")"});
+        pending.push_back({Step::VectorRest, obj, depth + 1, 1, nullptr});
+        pending.push_back({Step::Value, sexp_vector_data(obj)[0], depth + 1, 0, nullptr});
+    }
+    else if (sexp_stringp(obj))
+    {
+        out.push_back('"');
+        pending.push_back({Step::Text, nullptr, 0, 0, "\""});
+        pending.push_back({Step::StringRest, obj, depth, 0, nullptr});
+    }
+    else
+    {
+        write_atom(obj, out);
+    }
+}
+
+void DatumPrinter::write_list_rest(const Frame& frame, std::string& out)
+{
+    if (sexp_nullp(frame.obj))
+    {
+        return;
+    }
+    else if (sexp_pairp(frame.obj))
+    {
+        out.push_back(' ');
+        pending.push_back({Step::ListRest, sexp_cdr(frame.obj), frame.depth, 0, nullptr});
+        pending.push_back({Step::Value, sexp_car(frame.obj), frame.depth, 0, nullptr});
+    }
+    else
+    {
+        out += " . ";
+        pending.push_back({Step::Value, frame.obj, frame.depth, 0, nullptr});
+    }
+}
+
+void DatumPrinter::write_vector_rest(const Frame& frame, std::string& out)
+{
+    if (frame.index >= sexp_vector_length(frame.obj))
+    {
+        return;
+    }
+
+    out.push_back(' ');
+    pending.push_back({Step::VectorRest, frame.obj, frame.depth, frame.index + 1, nullptr});
+    pending.push_back({Step::Value, sexp_vector_data(frame.obj)[frame.index], frame.depth, 0, nullptr});
+}
+
+/*
+ * Escapes quotes, backslashes and control characters as write does. Stops once budget bytes are
+ * written, but never inside a UTF-8 sequence, so each chunk reaches the terminal as whole
+ * characters.
+ */
+void DatumPrinter::write_string_rest(const Frame& frame, std::string& out, size_t budget)
+{
+    const char* data = sexp_string_data(frame.obj);
+    size_t size = sexp_string_size(frame.obj);
+    size_t start = out.size();
+    size_t index = frame.index;
+
+    while (index < size)
+    {
+        auto byte = static_cast<unsigned char>(data[index]);
+        bool boundary = (byte & 0xc0) != 0x80;
+
+        if (boundary && out.size() - start >= budget)
+        {
+            break;
+        }
+
+        switch (byte)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (byte < 0x20)
+            {
+                out += fmt::format("\\x{:x};", byte);
+            }
+            else
+            {
+                out.push_back(static_cast<char>(byte));
+            }
+        }
+
+        ++index;
+    }
+
+    if (index < size)
+    {
+        pending.push_back({Step::StringRest, frame.obj, frame.depth, index, nullptr});
+    }
+}
+
+void DatumPrinter::write_atom(sexp obj, std::string& out)
+{
+    sexp text = sexp_write_to_string(ctx, obj);
+
+    if (sexp_stringp(text))
+    {
+        out.append(sexp_string_data(text), sexp_string_size(text));
+    }
+    else
+    {
+        out += "#<unprintable>";
+    }
+}
+
+void DatumPrinter::hold_pending()
+{
+    for (const auto& frame : pending)
+    {
+        if (frame.obj != nullptr && sexp_pointerp(frame.obj))
+        {
+            sexp_preserve_object(ctx, frame.obj);
+            held.push_back(frame.obj);
+        }
+    }
+}
+
+void DatumPrinter::release_held()
+{
+    for (sexp obj : held)
+    {
+        sexp_release_object(ctx, obj);
+    }
+
+    held.clear();
+}
+
+} // namespace samos::scheme
@@ -2,11 +2,13 @@
 #include "logger.hpp"
 
 #include <cassert>
+#include <fstream>
+#include <iterator>
 #include <string>
 
 namespace samos::scheme {
 
-std::string format_sexp_type(SexpType t)
+std::string_view format_sexp_type(SexpType t)
 {
     switch (t)
     {
@@ -36,14 +38,26 @@ std::string format_sexp_type(SexpType t)
     }
 }
 
-Schemer::Schemer()
+Schemer::Schemer() : Schemer(SchemerEnv::Standard)
+{
+}
+
+Schemer::Schemer(SchemerEnv env)
     :
-    registered_c_types{}
+    registered_c_types{},
+    modules{},
+    env_kind{env}
 {
     sexp_scheme_init();
 
     context = sexp_make_eval_context(NULL, NULL, NULL, 0, 0);
 
+    if (env_kind == SchemerEnv::ReaderOnly)
+    {
+        environment = sexp_context_env(context);
+        return;
+    }
+
     environment = sexp_load_standard_env(context, NULL, SEXP_SEVEN);
 
     assert(!sexp_exceptionp(environment));
@@ -63,6 +77,19 @@ sexp Schemer::eval(const std::string& input)
     return sexp_eval_string(context, input.c_str(), -1, environment);
 }
 
+sexp Schemer::eval_datum(sexp expr)
+{
+    sexp_gc_var2(expr_var, result);
+    sexp_gc_preserve2(context, expr_var, result);
+
+    expr_var = expr;
+    result = sexp_eval(context, expr_var, environment);
+
+    sexp_gc_release2(context);
+
+    return result;
+}
+
 void Schemer::load(const std::string& filename)
 {
     auto obj1 = sexp_c_string(context, filename.c_str(), -1);
@@ -72,15 +99,73 @@ void Schemer::load(const std::string& filename)
 
 SchemerResult<sexp> Schemer::read_from_file(const std::string& filename)
 {
-    /* FIXME : create file path class to handle this properly */
-    (void)filename;
-    sexp file_contents = sexp_eval_string(
-        context,
-        fmt::format("(with-input-from-file \"{}\" read)", filename).c_str(),
-        -1,
-        environment);
+    // Read on the C++ side so that this works without the standard environment's ports.
+    std::ifstream file{filename, std::ios::binary};
+
+    if (!file)
+    {
+        return SchemerResult<sexp>::err(FilenameError{});
+    }
+
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    return read(contents);
+}
+
+SchemerResult<sexp> Schemer::read(const std::string& input)
+{
+    sexp datum = sexp_read_from_string(context, input.c_str(), input.size());
+
+    if (sexp_exceptionp(datum))
+    {
+        return SchemerResult<sexp>::err(SchemeException{});
+    }
 
-    return SchemerResult<sexp>::ok(file_contents);
+    return SchemerResult<sexp>::ok(datum);
+}
+
+SchemerEnv Schemer::get_env_kind() const
+{
+    return env_kind;
+}
+
+sexp Schemer::apply(sexp proc, sexp arg)
+{
+    sexp_gc_var4(proc_var, arg_var, args, result);
+    sexp_gc_preserve4(context, proc_var, arg_var, args, result);
+
+    // arg may be reachable from nowhere else, as when it was just deserialized.
+    proc_var = proc;
+    arg_var = arg;
+    args = sexp_list1(context, arg_var);
+    result = sexp_apply(context, proc_var, args);
+
+    sexp_gc_release4(context);
+
+    return result;
+}
+
+sexp Schemer::call(sexp proc)
+{
+    sexp_gc_var2(proc_var, result);
+    sexp_gc_preserve2(context, proc_var, result);
+
+    proc_var = proc;
+    result = sexp_apply(context, proc_var, SEXP_NULL);
+
+    sexp_gc_release2(context);
+
+    return result;
+}
+
+void Schemer::preserve(sexp obj)
+{
+    sexp_preserve_object(context, obj);
+}
+
+void Schemer::release(sexp obj)
+{
+    sexp_release_object(context, obj);
 }
 
 void Schemer::print_exception(const sexp& result)
@@ -103,7 +188,54 @@ std::string Schemer::sexp_to_string(const sexp& result, bool print_exception)
         this->print_exception(result);
     }
 
-    return {sexp_string_data(sexp_write_to_string(context, result))};
+    sexp_gc_var2(obj, output);
+    sexp_gc_preserve2(context, obj, output);
+
+    obj = result;
+    output = sexp_write_to_string(context, obj);
+
+    std::string output_string{sexp_string_data(output)};
+
+    sexp_gc_release2(context);
+
+    return output_string;
+}
+
+std::unique_ptr<DatumPrinter> Schemer::printer(sexp obj, PrintLimits limits)
+{
+    return std::make_unique<DatumPrinter>(context, obj, limits);
+}
+
+SchemerResult<DatumBytes> Schemer::serialize(sexp obj)
+{
+    DatumBytes bytes;
+
+    sexp_gc_var1(obj_var);
+    sexp_gc_preserve1(context, obj_var);
+
+    obj_var = obj;
+    bool encoded = encode_datum(context, obj_var, bytes);
+
+    sexp_gc_release1(context);
+
+    if (!encoded)
+    {
+        return SchemerResult<DatumBytes>::err(DatumEncodeError{});
+    }
+
+    return SchemerResult<DatumBytes>::ok(std::move(bytes));
+}
+
+SchemerResult<sexp> Schemer::deserialize(std::span<const uint8_t> bytes)
+{
+    auto datum = decode_datum(context, bytes);
+
+    if (!datum.has_value())
+    {
+        return SchemerResult<sexp>::err(DatumDecodeError{});
+    }
+
+    return SchemerResult<sexp>::ok(datum.value());
 }
 
 SchemerResult<> Schemer::import_module(SchemeModule mod)
@@ -131,9 +263,78 @@ SchemerResult<> Schemer::import_module(SchemeModule mod)
 
     sexp_gc_release4(context);
 
+    modules.push_back(mod);
+
     return SchemerResult<>::ok({});
 }
 
+const std::vector<SchemeModule>& Schemer::imported_modules() const
+{
+    return modules;
+}
+
+void Schemer::collect_new_bindings(BindingCursor& cursor, std::vector<std::string>& names)
+{
+    bool first_look = cursor.head == nullptr;
+
+    sexp_gc_var1(name);
+    sexp_gc_preserve1(context, name);
+
+    // Parent environments never change after startup, so only the first look climbs into them.
+    for (sexp env = environment; sexp_envp(env); env = first_look ? sexp_env_parent(env) : SEXP_FALSE)
+    {
+        for (sexp ls = sexp_env_bindings(env); sexp_pairp(ls) && ls != cursor.head; ls = sexp_cdr(ls))
+        {
+            if (!sexp_pairp(sexp_car(ls)) || !sexp_symbolp(sexp_car(sexp_car(ls))))
+            {
+                continue;
+            }
+
+            name = sexp_symbol_to_string(context, sexp_car(sexp_car(ls)));
+            names.emplace_back(sexp_string_data(name), sexp_string_size(name));
+        }
+    }
+
+    sexp_gc_release1(context);
+
+    sexp head = sexp_env_bindings(environment);
+
+    if (head != cursor.head)
+    {
+        if (sexp_pairp(head))
+        {
+            preserve(head);
+        }
+        if (cursor.head != nullptr && sexp_pairp(cursor.head))
+        {
+            release(cursor.head);
+        }
+        cursor.head = head;
+    }
+}
+
+HeapStats Schemer::heap_stats() const
+{
+    HeapStats stats{};
+
+    for (sexp_heap heap = sexp_context_heap(context); heap != nullptr; heap = heap->next)
+    {
+        stats.heap_bytes += heap->size;
+
+        for (sexp_free_list free = heap->free_list; free != nullptr; free = free->next)
+        {
+            stats.free_bytes += free->size;
+        }
+    }
+
+#if SEXP_USE_TIME_GC
+    stats.collections = sexp_context_gc_count(context);
+    stats.gc_usecs = sexp_context_gc_usecs(context);
+#endif
+
+    return stats;
+}
+
 bool Schemer::sexp_equal(sexp& a, sexp& b) const
 {
     return sexp_equalp(context, a, b);
@@ -224,47 +425,39 @@ SchemerResult<SexpCppValue> Schemer::get_cpp_value(sexp& obj) const
     using SexpCppResult = SchemerResult<SexpCppValue>;
     auto stype = sexp_type(obj);
 
-    auto result_rewrapper = [](auto res) -> SexpCppResult
+    auto to_cpp_value = [](auto value)
     {
-        if (res.is_ok())
-        {
-            // Schemer
-            return SexpCppResult::ok(res.get_ok());
-        }
-        else
-        {
-            return SexpCppResult::err(res.get_err());
-        }
+        return SexpCppValue{std::move(value)};
     };
 
     switch (stype)
     {
     case SexpType::Unknown:
-        log::logger::log(LogLevel::Info, "{}, CPP value: Unknown Type", __LINE__);
+        log::logger::log<LogLevel::Trace>("{}, CPP value: Unknown Type", __LINE__);
         return SexpCppResult::err(TypeNotFound{});
 
     case SexpType::Boolean:
-        log::logger::log(LogLevel::Info, "{}, CPP value: Boolean Type", __LINE__);
-        return result_rewrapper(get_bool({obj}));
+        log::logger::log<LogLevel::Trace>("{}, CPP value: Boolean Type", __LINE__);
+        return get_bool({obj}).map(to_cpp_value);
 
     case SexpType::Integer:
-        log::logger::log(LogLevel::Info, "{}, CPP value: Integer Type", __LINE__);
-        return result_rewrapper(get_int({obj}));
+        log::logger::log<LogLevel::Trace>("{}, CPP value: Integer Type", __LINE__);
+        return get_int({obj}).map(to_cpp_value);
 
     case SexpType::Flonum:
-        log::logger::log(LogLevel::Info, "{}, CPP value: Flonum Type", __LINE__);
-        return result_rewrapper(get_flonum({obj}));
+        log::logger::log<LogLevel::Trace>("{}, CPP value: Flonum Type", __LINE__);
+        return get_flonum({obj}).map(to_cpp_value);
 
     case SexpType::String:
-        log::logger::log(LogLevel::Info, "{}, CPP value: String Type", __LINE__);
-        return result_rewrapper(get_string({obj}));
+        log::logger::log<LogLevel::Trace>("{}, CPP value: String Type", __LINE__);
+        return get_string({obj}).map(to_cpp_value);
 
     case SexpType::Symbol:
-        log::logger::log(LogLevel::Info, "{}, CPP value: Symbol Type", __LINE__);
-        return result_rewrapper(get_symbol({obj}));
+        log::logger::log<LogLevel::Trace>("{}, CPP value: Symbol Type", __LINE__);
+        return get_symbol({obj}).map(to_cpp_value);
 
     case SexpType::Pair:
-        log::logger::log(LogLevel::Info, "{}, CPP value: Pair Type", __LINE__);
+        log::logger::log<LogLevel::Trace>("{}, CPP value: Pair Type", __LINE__);
         return SexpCppResult::err(BadTypeError{});
 
     default:
@@ -341,7 +534,7 @@ SchemerResult<> Schemer::define_ffi_op_details(
     if (!sexp_opcodep(op))
     {
         sexp output = sexp_write_to_string(context, op);
-        log(LogLevel::Error, "Error registering op {}: {}", op_name, sexp_string_data(output));
+        log<LogLevel::Error>("Error registering op {}: {}", op_name, sexp_string_data(output));
         return SchemerResult<>::err(OpRegistrationError{});
     }
 
@@ -377,7 +570,7 @@ SchemerResult<> Schemer::define_ffi_op_details(
         }
     }
 
-    log(LogLevel::Info, "Registered op {}", op_name);
+    log<LogLevel::Info>("Registered op {}", op_name);
     return SchemerResult<>::ok({});
 }
 
@@ -0,0 +1,702 @@
+#include "scheme_log.hpp"
+
+#include <chibi/sexp.h>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace samos::scheme
+{
+
+namespace
+{
+
+struct DatumNode
+{
+    DatumTag tag;
+    // Pairs and vectors own children[first, first + count); a pair's are its car and cdr.
+    uint32_t first;
+    uint32_t count;
+    // Fixnum value or character code point.
+    int64_t integer;
+    double flonum;
+    // String, symbol and bytevector contents; points into the encoded bytes.
+    std::string_view text;
+};
+
+/*
+ * The arguments of one message decoded into a graph without a scheme context. A Ref becomes an
+ * edge back to the node it names, so shared structure and cycles survive decoding.
+ */
+class DatumGraph {
+public:
+    // Decodes the datum at the front of reader; std::nullopt if it is malformed.
+    std::optional<uint32_t> decode(ByteReader& reader)
+    {
+        if (!read_datum_header(reader))
+        {
+            return {};
+        }
+
+        objects.clear();
+        auto root = static_cast<uint32_t>(children.size());
+        children.push_back(0);
+        slots.assign(1, root);
+
+        while (!slots.empty())
+        {
+            uint32_t slot = slots.back();
+            slots.pop_back();
+
+            if (!decode_one(reader, slot))
+            {
+                return {};
+            }
+        }
+
+        return children[root];
+    }
+
+    std::vector<DatumNode> nodes;
+
+    std::vector<uint32_t> children;
+
+private:
+    bool decode_one(ByteReader& reader, uint32_t slot)
+    {
+        auto token = read_datum_token(reader);
+
+        if (!token.has_value())
+        {
+            return false;
+        }
+
+        if (token->tag == DatumTag::Ref)
+        {
+            if (token->ref >= objects.size())
+            {
+                return false;
+            }
+            children[slot] = objects[token->ref];
+            return true;
+        }
+
+        DatumNode node{
+            token->tag,
+            0,
+            static_cast<uint32_t>(token->count),
+            token->integer,
+            token->flonum,
+            token->text};
+        auto index = static_cast<uint32_t>(nodes.size());
+
+        if (is_numbered(node.tag))
+        {
+            objects.push_back(index);
+        }
+
+        if (node.count > 0)
+        {
+            node.first = static_cast<uint32_t>(children.size());
+            children.resize(children.size() + node.count);
+            for (uint32_t idx = node.count; idx > 0; --idx)
+            {
+                slots.push_back(node.first + idx - 1);
+            }
+        }
+
+        nodes.push_back(node);
+        children[slot] = index;
+
+        return true;
+    }
+
+    // Node of each numbered object in the datum being decoded, in the order Refs count them.
+    std::vector<uint32_t> objects;
+
+    // Positions in children still waiting for their node.
+    std::vector<uint32_t> slots;
+};
+
+/*
+ * Prints a node the way display (or write) would, with an explicit stack so long lists and deep
+ * nesting cannot overflow the C stack. Pairs and vectors being printed are marked active; meeting
+ * an active one again means a cycle, printed as "...".
+ */
+class GraphPrinter {
+public:
+    GraphPrinter(const DatumGraph& graph, fmt::memory_buffer& out, size_t limit)
+        :
+        graph{graph},
+        out{out},
+        limit{limit},
+        write{false},
+        active{},
+        tasks{}
+    {
+    }
+
+    void print(uint32_t root, bool write_form)
+    {
+        write = write_form;
+        active.assign(graph.nodes.size(), 0);
+        tasks.push_back({Step::Value, root, {}});
+
+        while (!tasks.empty() && out.size() < limit)
+        {
+            Task task = tasks.back();
+            tasks.pop_back();
+
+            switch (task.step)
+            {
+            case Step::Value:
+                value(task.node);
+                break;
+
+            case Step::Rest:
+                rest(task.node);
+                break;
+
+            case Step::Leave:
+                --active[task.node];
+                break;
+
+            case Step::Text:
+                append(task.text);
+                break;
+            }
+        }
+
+        tasks.clear();
+    }
+
+private:
+    enum class Step
+    {
+        Value,
+        // The cdr of a list whose opening parenthesis is already out.
+        Rest,
+        Leave,
+        Text,
+    };
+
+    struct Task
+    {
+        Step step;
+        uint32_t node;
+        std::string_view text;
+    };
+
+    void append(std::string_view text)
+    {
+        out.append(text.data(), text.data() + text.size());
+    }
+
+    uint32_t child(const DatumNode& node, uint32_t idx) const
+    {
+        return graph.children[node.first + idx];
+    }
+
+    void value(uint32_t index)
+    {
+        const auto& node = graph.nodes[index];
+
+        switch (node.tag)
+        {
+        case DatumTag::Null:
+            append("()");
+            break;
+
+        case DatumTag::True:
+            append("#t");
+            break;
+
+        case DatumTag::False:
+            append("#f");
+            break;
+
+        case DatumTag::Void:
+            append("#<void>");
+            break;
+
+        case DatumTag::Eof:
+            append("#<eof>");
+            break;
+
+        case DatumTag::Fixnum:
+            fmt::format_to(std::back_inserter(out), "{}", node.integer);
+            break;
+
+        case DatumTag::Flonum:
+            flonum(node.flonum);
+            break;
+
+        case DatumTag::Char:
+            character(node.integer);
+            break;
+
+        case DatumTag::String:
+            string(node.text);
+            break;
+
+        case DatumTag::Symbol:
+            append(node.text);
+            break;
+
+        case DatumTag::Bytevector:
+            append("#u8(");
+            for (size_t idx = 0; idx < node.text.size(); ++idx)
+            {
+                if (idx > 0)
+                {
+                    out.push_back(' ');
+                }
+                fmt::format_to(std::back_inserter(out), "{}", static_cast<uint8_t>(node.text[idx]));
+            }
+            append(")");
+            break;
+
+        case DatumTag::UniformVector:
+            append("#<uniform-vector>");
+            break;
+
+        case DatumTag::Pair:
+            if (active[index] != 0)
+            {
+                append("...");
+                break;
+            }
+            ++active[index];
+            append("(");
+            tasks.push_back({Step::Leave, index, {}});
+            tasks.push_back({Step::Rest, child(node, 1), {}});
+            tasks.push_back({Step::Value, child(node, 0), {}});
+            break;
+
+        case DatumTag::Vector:
+            if (active[index] != 0)
+            {
+                append("...");
+                break;
+            }
+            ++active[index];
+            append("#(");
+            tasks.push_back({Step::Leave, index, {}});
+            tasks.push_back({Step::Text, 0, ")"});
+            for (uint32_t idx = node.count; idx > 0; --idx)
+            {
+                tasks.push_back({Step::Value, child(node, idx - 1), {}});
+                if (idx > 1)
+                {
+                    tasks.push_back({Step::Text, 0, " "});
+                }
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void rest(uint32_t index)
+    {
+        const auto& node = graph.nodes[index];
+
+        if (node.tag == DatumTag::Null)
+        {
+            append(")");
+        }
+        else if (node.tag == DatumTag::Pair && active[index] != 0)
+        {
+            append(" ...)");
+        }
+        else if (node.tag == DatumTag::Pair)
+        {
+            ++active[index];
+            append(" ");
+            tasks.push_back({Step::Leave, index, {}});
+            tasks.push_back({Step::Rest, child(node, 1), {}});
+            tasks.push_back({Step::Value, child(node, 0), {}});
+        }
+        else
+        {
+            append(" . ");
+            tasks.push_back({Step::Text, 0, ")"});
+            tasks.push_back({Step::Value, index, {}});
+        }
+    }
+
+    void flonum(double value)
+    {
+        if (std::isnan(value))
+        {
+            append("+nan.0");
+        }
+        else if (std::isinf(value))
+        {
+            append(value > 0 ? "+inf.0" : "-inf.0");
+        }
+        else
+        {
+            size_t start = out.size();
+            fmt::format_to(std::back_inserter(out), "{}", value);
+            std::string_view text{out.data() + start, out.size() - start};
+
+            if (text.find_first_of(".e") == std::string_view::npos)
+            {
+                append(".0");
+            }
+        }
+    }
+
+    void character(int64_t code_point)
+    {
+        if (!write)
+        {
+            utf8(code_point);
+            return;
+        }
+
+        switch (code_point)
+        {
+        case ' ':
+            append("#\\space");
+            break;
+        case '\n':
+            append("#\\newline");
+            break;
+        case '\t':
+            append("#\\tab");
+            break;
+        case '\r':
+            append("#\\return");
+            break;
+        case 0:
+            append("#\\null");
+            break;
+        default:
+            if (code_point < 0x20 || code_point == 0x7f)
+            {
+                fmt::format_to(std::back_inserter(out), "#\\x{:x}", code_point);
+            }
+            else
+            {
+                append("#\\");
+                utf8(code_point);
+            }
+        }
+    }
+
+    void string(std::string_view text)
+    {
+        if (!write)
+        {
+            append(text);
+            return;
+        }
+
+        out.push_back('"');
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '"':
+                append("\\\"");
+                break;
+            case '\\':
+                append("\\\\");
+                break;
+            case '\n':
+                append("\\n");
+                break;
+            case '\t':
+                append("\\t");
+                break;
+            case '\r':
+                append("\\r");
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    fmt::format_to(std::back_inserter(out), "\\x{:x};", static_cast<int>(c));
+                }
+                else
+                {
+                    out.push_back(c);
+                }
+            }
+        }
+        out.push_back('"');
+    }
+
+    void utf8(int64_t code_point)
+    {
+        auto value = static_cast<uint32_t>(code_point);
+
+        if (value < 0x80)
+        {
+            out.push_back(static_cast<char>(value));
+        }
+        else if (value < 0x800)
+        {
+            out.push_back(static_cast<char>(0xc0 | (value >> 6)));
+            out.push_back(static_cast<char>(0x80 | (value & 0x3f)));
+        }
+        else if (value < 0x10000)
+        {
+            out.push_back(static_cast<char>(0xe0 | (value >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((value >> 6) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (value & 0x3f)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xf0 | ((value >> 18) & 0x07)));
+            out.push_back(static_cast<char>(0x80 | ((value >> 12) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | ((value >> 6) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (value & 0x3f)));
+        }
+    }
+
+    const DatumGraph& graph;
+
+    fmt::memory_buffer& out;
+
+    const size_t limit;
+
+    bool write;
+
+    std::vector<uint8_t> active;
+
+    std::vector<Task> tasks;
+};
+
+/*
+ * A log call from scheme: the format string followed by each argument's datum encoding, in one
+ * allocation. Capturing is a copy; the text is only built when the logger renders it.
+ */
+class SchemeLogMessage : public log::logger::DeferredMessage {
+public:
+    explicit SchemeLogMessage(std::string_view format)
+        :
+        format_size{format.size()},
+        bytes(format.begin(), format.end())
+    {
+    }
+
+    void capture(sexp ctx, sexp arg)
+    {
+        size_t mark = bytes.size();
+
+        if (encode_datum(ctx, arg, bytes))
+        {
+            return;
+        }
+
+        // Procedures, ports and the like have no datum encoding, so their printed form is taken
+        // now and logged as a symbol.
+        bytes.resize(mark);
+
+        sexp_gc_var1(text);
+        sexp_gc_preserve1(ctx, text);
+
+        text = sexp_write_to_string(ctx, arg);
+
+        ByteWriter writer{bytes};
+        writer.bytes(datum_magic, sizeof(datum_magic));
+        writer.u8(datum_version);
+        writer.u8(static_cast<uint8_t>(DatumTag::Symbol));
+        if (sexp_stringp(text))
+        {
+            writer.string({sexp_string_data(text), sexp_string_size(text)});
+        }
+        else
+        {
+            writer.string("#<unprintable>");
+        }
+
+        sexp_gc_release1(ctx);
+    }
+
+    void render(fmt::memory_buffer& out) const override
+    {
+        std::span<const uint8_t> all{bytes};
+
+        render_log_format(
+            {reinterpret_cast<const char*>(bytes.data()), format_size},
+            all.subspan(format_size),
+            out);
+    }
+
+private:
+    size_t format_size;
+
+    DatumBytes bytes;
+};
+
+sexp sexp_log_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1, sexp arg2)
+{
+    (void)n;
+
+    if (!sexp_fixnump(arg0))
+    {
+        return sexp_type_exception(ctx, self, SEXP_FIXNUM, arg0);
+    }
+
+    sexp_sint_t raw_level = sexp_unbox_fixnum(arg0);
+
+    if (raw_level < static_cast<sexp_sint_t>(LogLevel::Trace)
+        || raw_level > static_cast<sexp_sint_t>(LogLevel::Critical))
+    {
+        return sexp_user_exception(ctx, self, "invalid log level", arg0);
+    }
+
+    auto level = static_cast<LogLevel>(raw_level);
+
+    if (!log::logger::should_log(level))
+    {
+        return SEXP_VOID;
+    }
+
+    if (!sexp_stringp(arg1))
+    {
+        return sexp_type_exception(ctx, self, SEXP_STRING, arg1);
+    }
+
+    auto message = std::make_unique<SchemeLogMessage>(
+        std::string_view{sexp_string_data(arg1), sexp_string_size(arg1)});
+
+    for (sexp ls = arg2; sexp_pairp(ls); ls = sexp_cdr(ls))
+    {
+        message->capture(ctx, sexp_car(ls));
+    }
+
+    log::logger::log_deferred(level, std::move(message));
+
+    return SEXP_VOID;
+}
+
+std::string log_wrappers()
+{
+    return fmt::format(
+        "(begin"
+        " (define (log-trace fmt . args) (%log {} fmt args))"
+        " (define (log-debug fmt . args) (%log {} fmt args))"
+        " (define (log-info fmt . args) (%log {} fmt args))"
+        " (define (log-warn fmt . args) (%log {} fmt args))"
+        " (define (log-error fmt . args) (%log {} fmt args))"
+        " (define (log-critical fmt . args) (%log {} fmt args)))",
+        static_cast<int>(LogLevel::Trace),
+        static_cast<int>(LogLevel::Debug),
+        static_cast<int>(LogLevel::Info),
+        static_cast<int>(LogLevel::Warn),
+        static_cast<int>(LogLevel::Error),
+        static_cast<int>(LogLevel::Critical));
+}
+
+} // namespace
+
+void render_log_format(std::string_view format, std::span<const uint8_t> args, fmt::memory_buffer& out)
+{
+    size_t start = out.size();
+    size_t limit = start + max_log_message_size;
+    ByteReader reader{args};
+    DatumGraph graph;
+    GraphPrinter printer{graph, out, limit};
+    bool malformed = false;
+    size_t pos = 0;
+
+    while (pos < format.size() && out.size() < limit)
+    {
+        size_t tilde = format.find('~', pos);
+        std::string_view literal = format.substr(pos, tilde == std::string_view::npos ? tilde : tilde - pos);
+        out.append(literal.data(), literal.data() + literal.size());
+
+        if (tilde == std::string_view::npos || tilde + 1 == format.size())
+        {
+            if (tilde != std::string_view::npos)
+            {
+                out.push_back('~');
+            }
+            break;
+        }
+
+        char directive = format[tilde + 1];
+        pos = tilde + 2;
+
+        switch (directive)
+        {
+        case 'a':
+        case 's':
+        {
+            // Directives without an argument left are kept as written.
+            if (malformed || reader.remaining() == 0)
+            {
+                out.append(format.data() + tilde, format.data() + pos);
+                break;
+            }
+
+            auto root = graph.decode(reader);
+            if (!root.has_value())
+            {
+                malformed = true;
+                out.append(std::string_view{"#<malformed>"});
+                break;
+            }
+
+            printer.print(root.value(), directive == 's');
+            break;
+        }
+
+        case '%':
+            out.push_back('\n');
+            break;
+
+        case '~':
+            out.push_back('~');
+            break;
+
+        default:
+            out.append(format.data() + tilde, format.data() + pos);
+        }
+    }
+
+    if (out.size() >= limit)
+    {
+        // Back up to a character boundary so the cut never splits a UTF-8 sequence.
+        while (limit > start && limit < out.size() && (static_cast<unsigned char>(out[limit]) & 0xc0) == 0x80)
+        {
+            --limit;
+        }
+        out.resize(limit);
+        out.append(std::string_view{"..."});
+    }
+}
+
+SchemerResult<> install_log_ops(Schemer& schemer)
+{
+    auto res = schemer.define_ffi_op(
+        "%log",
+        SEXP_VOID,
+        {sexp_make_fixnum(SEXP_FIXNUM), sexp_make_fixnum(SEXP_STRING), sexp_make_fixnum(SEXP_OBJECT)},
+        sexp_log_stub);
+
+    if (res.is_err())
+    {
+        return res;
+    }
+
+    sexp wrappers = schemer.eval(log_wrappers());
+
+    if (sexp_exceptionp(wrappers))
+    {
+        schemer.print_exception(wrappers);
+        return SchemerResult<>::err(SchemeException{});
+    }
+
+    return SchemerResult<>::ok({});
+}
+
+} // namespace samos::scheme
@@ -1,8 +1,13 @@
 #include  "scheme.hpp"
+#include "scheme_log.hpp"
 
 #include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
 #include <vector>
 
+#include "spdlog/sinks/ostream_sink.h"
+
 #include <fmt/core.h>
 
 namespace samos::scheme {
@@ -30,7 +35,7 @@ TEST_F(TestScheme, TestCarCdr)
 
 TEST_F(TestScheme, TestAssq)
 {
-    schemer.import_module(SrfiType::Srfi_ListLibrary);
+    EXPECT_TRUE(schemer.import_module(SrfiType::Srfi_ListLibrary).is_ok());
     SchemerResult<sexp> sexp_res = schemer.read_from_file("data/tests/test_assq.scm");
 
     ASSERT_TRUE(sexp_res.is_ok());
@@ -46,6 +51,241 @@ TEST_F(TestScheme, TestAssq)
     ASSERT_TRUE(sexp_res.is_err());
 }
 
+TEST(TestSchemerEnv, TestReaderOnly)
+{
+    Schemer reader{SchemerEnv::ReaderOnly};
+
+    EXPECT_EQ(reader.get_env_kind(), SchemerEnv::ReaderOnly);
+
+    SchemerResult<sexp> sexp_res = reader.read_from_file("data/tests/test_assq.scm");
+
+    ASSERT_TRUE(sexp_res.is_ok());
+    sexp file_contents = sexp_res.get_ok();
+
+    ASSERT_EQ(reader.sexp_type(file_contents), SexpType::Pair);
+    EXPECT_TRUE(reader.assq("test-cfg", file_contents).is_ok());
+    EXPECT_TRUE(reader.assq("fake", file_contents).is_err());
+
+    EXPECT_TRUE(reader.read_from_file("data/tests/does_not_exist.scm").is_err());
+}
+
+TEST_F(TestScheme, TestSerializeRoundTrip)
+{
+    std::vector<std::string> datums{
+        "()",
+        "#t",
+        "#f",
+        "0",
+        "-1",
+        "123456789",
+        "-98765",
+        "3.25",
+        "-0.5",
+        "#\\x",
+        "\"a string\"",
+        "\"\"",
+        "a-symbol",
+        "(1 2.5 \"three\" four)",
+        "(1 . 2)",
+        "#(1 #(2 3) (4 5))",
+        "#()",
+        "#u8(0 1 2 255)",
+        "#f64(1.0 2.5)",
+        "#s16(-1 2)",
+        "((a . 1) (b . (c d)) (e . #(f)))",
+    };
+
+    for (const auto& text : datums)
+    {
+        sexp datum = schemer.eval(fmt::format("'{}", text));
+        auto bytes_res = schemer.serialize(datum);
+
+        ASSERT_TRUE(bytes_res.is_ok()) << text;
+
+        auto decoded_res = schemer.deserialize(bytes_res.get_ok());
+
+        ASSERT_TRUE(decoded_res.is_ok()) << text;
+        sexp decoded = decoded_res.get_ok();
+        EXPECT_TRUE(schemer.sexp_equal(datum, decoded)) << text;
+    }
+}
+
+TEST_F(TestScheme, TestDatumPrinter)
+{
+    auto print_all = [](DatumPrinter& printer)
+    {
+        std::string out;
+        while (printer.next_chunk(out) == PrintStatus::More)
+        {
+        }
+        return out;
+    };
+
+    sexp datum = schemer.eval("'(1 (2 \"a\\nb \\\"q\\\"\" #\\x) #(3 4.5 sym) () #() (a . b))");
+    auto printer = schemer.printer(datum);
+    EXPECT_EQ(print_all(*printer), schemer.sexp_to_string(datum));
+    EXPECT_TRUE(printer->done());
+
+    datum = schemer.eval("'(1 (2 (3 (4))) #(5 #(6)))");
+    printer = schemer.printer(datum, {2, 1024, 4096});
+    EXPECT_EQ(print_all(*printer), "(1 (2 (...)) #(5 #(...)))");
+
+    // A long list and a long string come out in chunks and pages, and nothing is lost.
+    datum = schemer.eval("(list (make-list 2000 7) (make-string 3000 #\\z))");
+    schemer.preserve(datum);
+    std::string whole = schemer.sexp_to_string(datum);
+
+    printer = schemer.printer(datum, {64, 1000, 100});
+    std::string paged;
+    size_t pages = 1;
+    PrintStatus status;
+
+    while ((status = printer->next_chunk(paged)) != PrintStatus::Done)
+    {
+        if (status == PrintStatus::PageFull)
+        {
+            ++pages;
+            printer->next_page();
+            schemer.eval("(make-vector 10000 0)");
+        }
+    }
+
+    EXPECT_EQ(paged, whole);
+    EXPECT_EQ(printer->written(), whole.size());
+    EXPECT_GE(pages, whole.size() / 1100);
+    schemer.release(datum);
+}
+
+TEST_F(TestScheme, TestSerializeAcrossSchemers)
+{
+    Schemer other;
+    sexp datum = schemer.eval("'(sweep (dv . 3.5) (name . \"hohmann\") #(1 2 3))");
+    auto bytes_res = schemer.serialize(datum);
+
+    ASSERT_TRUE(bytes_res.is_ok());
+
+    auto decoded_res = other.deserialize(bytes_res.get_ok());
+
+    ASSERT_TRUE(decoded_res.is_ok());
+    EXPECT_EQ(
+        other.sexp_to_string(decoded_res.get_ok()),
+        "(sweep (dv . 3.5) (name . \"hohmann\") #(1 2 3))");
+}
+
+TEST_F(TestScheme, TestSerializeSharing)
+{
+    sexp datum = schemer.eval("(let ((shared (list 1 2))) (list shared shared))");
+    auto bytes_res = schemer.serialize(datum);
+
+    ASSERT_TRUE(bytes_res.is_ok());
+    auto decoded_res = schemer.deserialize(bytes_res.get_ok());
+
+    ASSERT_TRUE(decoded_res.is_ok());
+    sexp decoded = decoded_res.get_ok();
+    EXPECT_TRUE(schemer.sexp_equal(datum, decoded));
+    EXPECT_EQ(sexp_car(decoded), sexp_car(sexp_cdr(decoded)));
+
+    // A circular list only terminates if the cycle is written as a back reference.
+    datum = schemer.eval("(let ((ls (list 1 2 3))) (set-cdr! (cddr ls) ls) ls)");
+    bytes_res = schemer.serialize(datum);
+
+    ASSERT_TRUE(bytes_res.is_ok());
+    decoded_res = schemer.deserialize(bytes_res.get_ok());
+
+    ASSERT_TRUE(decoded_res.is_ok());
+    decoded = decoded_res.get_ok();
+    EXPECT_EQ(sexp_cdr(sexp_cdr(sexp_cdr(decoded))), decoded);
+    EXPECT_EQ(sexp_unbox_fixnum(sexp_car(sexp_cdr(decoded))), 2);
+}
+
+TEST_F(TestScheme, TestSerializeErrors)
+{
+    sexp procedure = schemer.eval("car");
+
+    EXPECT_TRUE(schemer.serialize(procedure).is_err());
+
+    DatumBytes empty;
+    EXPECT_TRUE(schemer.deserialize(empty).is_err());
+
+    sexp datum = schemer.eval("'(1 2 3)");
+    auto bytes = schemer.serialize(datum).get_ok();
+
+    // Every proper prefix of a valid encoding is rejected.
+    for (size_t size = 0; size < bytes.size(); ++size)
+    {
+        EXPECT_TRUE(schemer.deserialize(std::span<const uint8_t>{bytes.data(), size}).is_err());
+    }
+
+    bytes.push_back(0);
+    EXPECT_TRUE(schemer.deserialize(bytes).is_err());
+
+    // A uniform vector is checked before it is allocated. Its element type, length and size
+    // bytes come just before the four bytes of data.
+    bytes = schemer.serialize(schemer.eval("'#s16(-1 2)")).get_ok();
+    size_t element_type = bytes.size() - 7;
+    ASSERT_EQ(bytes[element_type], SEXP_S16);
+    EXPECT_TRUE(schemer.deserialize(bytes).is_ok());
+
+    for (int type : {int{SEXP_NOT_A_UNIFORM_TYPE}, int{SEXP_U8}, int{SEXP_END_OF_UNIFORM_TYPES}, 255})
+    {
+        bytes[element_type] = static_cast<uint8_t>(type);
+        EXPECT_TRUE(schemer.deserialize(bytes).is_err()) << type;
+    }
+
+    bytes[element_type] = SEXP_S16;
+    bytes[element_type + 1] = 3;
+    EXPECT_TRUE(schemer.deserialize(bytes).is_err());
+}
+
+TEST_F(TestScheme, TestRenderLogFormat)
+{
+    DatumBytes args;
+    for (const char* expr : {
+        "42",
+        "\"say \\\"hi\\\"\"",
+        "\"say \\\"hi\\\"\"",
+        "'(1 2.0 #(a #\\b) . c)",
+        "(let ((ls (list 1 2))) (set-cdr! (cdr ls) ls) ls)",
+        "(let ((shared (list 'x))) (list shared shared))"})
+    {
+        auto bytes = schemer.serialize(schemer.eval(expr)).get_ok();
+        args.insert(args.end(), bytes.begin(), bytes.end());
+    }
+
+    fmt::memory_buffer out;
+    render_log_format("~a|~a|~s|~s|~a|~a|~~~%~a", args, out);
+
+    EXPECT_EQ(
+        fmt::to_string(out),
+        "42|say \"hi\"|\"say \\\"hi\\\"\"|(1 2.0 #(a #\\b) . c)|(1 2 ...)|((x) (x))|~\n~a");
+}
+
+TEST_F(TestScheme, TestLogOps)
+{
+    using namespace samos::log::logger;
+
+    std::ostringstream output;
+    auto previous = spdlog::default_logger();
+    auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(output);
+    spdlog::set_default_logger(std::make_shared<spdlog::logger>("scheme-log-test", sink));
+    spdlog::set_pattern("%l %v");
+    set_level(LogLevel::Info);
+
+    ASSERT_TRUE(install_log_ops(schemer).is_ok());
+
+    schemer.eval("(log-debug \"filtered ~a\" 1)");
+    schemer.eval("(log-info \"step ~a: ~s\" 3 '(dv . 1.5))");
+    schemer.eval("(log-error \"no encoding for ~a\" car)");
+    EXPECT_TRUE(sexp_exceptionp(schemer.eval("(%log 99 \"bad level\" '())")));
+
+    auto text = output.str();
+    EXPECT_EQ(text.find("filtered"), std::string::npos);
+    EXPECT_NE(text.find("info step 3: (dv . 1.5)\n"), std::string::npos);
+    EXPECT_NE(text.find("error no encoding for #<"), std::string::npos);
+
+    spdlog::set_default_logger(previous);
+}
+
 #if 1
 TEST_F(TestScheme, TestImportModule)
 {
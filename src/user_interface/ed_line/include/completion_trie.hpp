@@ -0,0 +1,58 @@
+#ifndef SAMOS_COMPLETION_TRIE_HPP
+#define SAMOS_COMPLETION_TRIE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace samos::user_interface::ed_line {
+
+/*
+ * Prefix tree of completion candidates. Lookups cost the length of the prefix plus the number of
+ * words returned, however many words are stored, and words can be added or removed one at a
+ * time as the environment changes.
+ */
+class CompletionTrie {
+public:
+    CompletionTrie();
+
+    // Returns false if word was already present.
+    bool insert(std::string_view word);
+
+    // Returns false if word was not present.
+    bool erase(std::string_view word);
+
+    [[nodiscard]] bool contains(std::string_view word) const;
+
+    // Up to limit words starting with prefix, in byte order.
+    [[nodiscard]] std::vector<std::string> complete(std::string_view prefix, size_t limit) const;
+
+    // The longest extension of prefix shared by every word starting with it.
+    [[nodiscard]] std::string common_prefix(std::string_view prefix) const;
+
+    [[nodiscard]] size_t size() const;
+
+private:
+    struct Node
+    {
+        // Sorted by byte value.
+        std::vector<std::pair<uint8_t, uint32_t>> children;
+        // Words ending at or below this node. Erasing leaves empty nodes in place for reuse.
+        uint32_t words;
+        bool terminal;
+    };
+
+    [[nodiscard]] std::optional<uint32_t> find(std::string_view prefix) const;
+
+    [[nodiscard]] std::optional<uint32_t> child(uint32_t node, uint8_t byte) const;
+
+    std::vector<Node> nodes;
+};
+
+} // namespace samos::user_interface::ed_line
+
+#endif // SAMOS_COMPLETION_TRIE_HPP
@@ -2,19 +2,22 @@
 #define SAMOS_ED_LINE_HPP
 
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include "completion_trie.hpp"
+#include "history_store.hpp"
+#include "scheme_highlighter.hpp"
 #include "replxx.hxx"
 
 namespace samos::user_interface::ed_line {
 
-/*
- * constexpr std::vector<std::string> keywords = {
- *  ",help",
- *  ",quit",
- *  ",exit"
- * };
- */
+// Most candidates TAB offers at once.
+constexpr int max_completions = 128;
+
+// Most recent entries loaded for Up and Down; Ctrl-R searches the whole history file.
+constexpr int history_window = 1000;
 
 class EdLine {
 public:
@@ -29,35 +32,70 @@ public:
 
     virtual void print(std::string& input);
 
+    // Writes output as is, without a newline or formatting, for text printed in pieces.
+    virtual void write(std::string_view output);
+
+    [[nodiscard]] const std::string& get_prompt() const;
+
+    // Shown from the next read on.
+    void set_prompt(std::string new_prompt);
+
+    // True once after Ctrl-C ended a read, which then returned an empty line.
+    bool take_interrupt();
+
     void add_to_history(std::string& input);
 
     void set_history_file(std::string& path);
 
+    // Opens the history file, creating it if needed, and loads its newest entries.
     void load_history();
 
+    // Entries are written as they are added; this flushes them to the disk.
     void save_history();
 
     void enable_history();
 
     void disable_history();
 
+    // Words offered by TAB completion; the owner keeps it in step with what is defined.
+    CompletionTrie& completions();
+
 private:
 
     std::optional<std::string> get_input();
 
+    replxx::Replxx::completions_t complete(const std::string& input, int& context_len);
+
+    void highlight(const std::string& input, replxx::Replxx::colors_t& colors);
+
+    replxx::Replxx::ACTION_RESULT search_history(char32_t code);
+
     replxx::Replxx editor;
 
     std::string prompt;
 
     std::string history_path;
 
-    uint16_t max_history_length;
+    std::unique_ptr<HistoryStore> history;
+
+    // Repeated Ctrl-R steps back through older matches while the line still shows the last one.
+    std::string search_query;
+
+    std::string search_match;
+
+    size_t search_before;
 
     uint8_t max_hint_rows;
 
     std::vector<std::string> keywords;
 
+    CompletionTrie completion_words;
+
+    SchemeHighlighter highlighter;
+
     bool history_enabled;
+
+    bool interrupted;
 };
 
 } // namespace samos::user_interface::ed_line
@@ -0,0 +1,118 @@
+#ifndef SAMOS_HISTORY_STORE_HPP
+#define SAMOS_HISTORY_STORE_HPP
+
+#include "result.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fmt/core.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace samos::user_interface::ed_line {
+
+/*
+ * History format, version 1. All integers are little endian.
+ *
+ *   history := "SH" version:u8 (text 0x00)*
+ *   index   := "SI" version:u8 end:u64*
+ *
+ * The index, kept beside the history as "<history>.idx", holds the offset just past each
+ * entry's terminator, so entry i spans from the end of entry i - 1 (or the header) to end[i].
+ * Both files are only ever appended to, history first; entries the index missed in a crash are
+ * recovered from the history's tail on the next open.
+ */
+constexpr uint8_t history_magic[2] = {'S', 'H'};
+
+constexpr uint8_t history_index_magic[2] = {'S', 'I'};
+
+constexpr uint8_t history_version = 1;
+
+class HistoryError
+{
+public:
+    explicit HistoryError(const std::string& reason) : reason{reason}
+    {
+    }
+
+    std::string format() const
+    {
+        return fmt::format("History error: {}", reason);
+    }
+
+private:
+    std::string reason;
+};
+
+template <typename T = std::monostate>
+using HistoryResult = result::Result<T, HistoryError>;
+
+/*
+ * Unbounded history shared by every session using the same file. Opening reads only the index,
+ * and searching scans the history through a read-only mapping, newest entries first, without
+ * decoding it. Appends from concurrent sessions are serialised with a lock on the history file
+ * and picked up by the others when they next search or append.
+ */
+class HistoryStore {
+public:
+    [[nodiscard]] static HistoryResult<std::unique_ptr<HistoryStore>> open(const std::filesystem::path& path);
+
+    ~HistoryStore();
+
+    HistoryStore(const HistoryStore&) = delete;
+
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    // Entries may not contain a NUL byte; one that does is cut short at it.
+    [[nodiscard]] HistoryResult<> append(std::string_view entry);
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] std::string entry(size_t index) const;
+
+    // The last count entries, oldest first.
+    [[nodiscard]] std::vector<std::string> recent(size_t count) const;
+
+    // The newest entry older than before that contains query. Other sessions' appends are taken in first.
+    [[nodiscard]] std::optional<size_t> find(std::string_view query, size_t before);
+
+    // Where in entry index query first occurs.
+    [[nodiscard]] size_t match_position(size_t index, std::string_view query) const;
+
+    // Flushes appended entries to the disk.
+    [[nodiscard]] HistoryResult<> sync();
+
+private:
+    HistoryStore(int history_fd, int index_fd);
+
+    // Reads index entries other sessions appended and indexes any history tail the index lacks.
+    [[nodiscard]] HistoryResult<> catch_up();
+
+    // Drops every known entry and the mapping, to index the history again from its start.
+    void forget_entries();
+
+    // Maps the history again if it has grown past the current mapping.
+    [[nodiscard]] bool map_history();
+
+    [[nodiscard]] std::string_view entry_view(size_t index) const;
+
+    int history_fd;
+
+    int index_fd;
+
+    // Offset just past each entry's terminator.
+    std::vector<uint64_t> ends;
+
+    const char* mapped;
+
+    size_t mapped_size;
+};
+
+} // namespace samos::user_interface::ed_line
+
+#endif // SAMOS_HISTORY_STORE_HPP
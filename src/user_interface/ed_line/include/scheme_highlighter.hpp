@@ -0,0 +1,97 @@
+#ifndef SAMOS_SCHEME_HIGHLIGHTER_HPP
+#define SAMOS_SCHEME_HIGHLIGHTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace samos::user_interface::ed_line {
+
+/*
+ * Classifies each byte of a line of scheme for highlighting. The lexer state entering every byte
+ * is kept, so an update only lexes from the token boundary before the first changed byte until
+ * its state lines up again with the old state after the last changed one; the tokens of the rest
+ * are kept from the previous update.
+ */
+class SchemeHighlighter {
+public:
+    enum class Token : uint8_t
+    {
+        Plain,
+        Paren,
+        // A closing parenthesis with nothing to close.
+        UnmatchedParen,
+        String,
+        Comment,
+        Number,
+        // Booleans, characters and other # syntax.
+        Literal,
+        Keyword,
+        Quote,
+    };
+
+    SchemeHighlighter();
+
+    void update(std::string_view input);
+
+    [[nodiscard]] const std::vector<Token>& tokens() const;
+
+    // Lists enclosing the byte at pos, not counting one it opens or closes.
+    [[nodiscard]] uint16_t depth(size_t pos) const;
+
+    // Bytes lexed by the last update; the rest were reused.
+    [[nodiscard]] size_t relexed() const;
+
+private:
+    enum class Mode : uint8_t
+    {
+        Normal,
+        // After a comma, which an @ extends to unquote-splicing.
+        Unquote,
+        // After a # that may start a comment, vector, character or literal.
+        Hash,
+        Atom,
+        // After #\, whose next byte belongs to the character whatever it is.
+        CharStart,
+        String,
+        StringEscape,
+        Bar,
+        BarEscape,
+        LineComment,
+        BlockComment,
+        BlockCommentBar,
+        BlockCommentHash,
+    };
+
+    struct State
+    {
+        Mode mode;
+        uint16_t depth;
+        uint16_t block_depth;
+
+        bool operator==(const State&) const = default;
+    };
+
+    // Lexes text[pos] from states[pos], setting its token and states[pos + 1].
+    void step(size_t pos);
+
+    // Classifies the atom from atom_start up to end now that its extent is known.
+    void finish_atom(size_t end);
+
+    std::string text;
+
+    std::vector<Token> token_of;
+
+    // Lexer state entering each byte, plus the state at the end.
+    std::vector<State> states;
+
+    size_t atom_start;
+
+    size_t last_relexed;
+};
+
+} // namespace samos::user_interface::ed_line
+
+#endif // SAMOS_SCHEME_HIGHLIGHTER_HPP
@@ -0,0 +1,215 @@
+#include "completion_trie.hpp"
+
+#include <algorithm>
+
+namespace samos::user_interface::ed_line {
+
+CompletionTrie::CompletionTrie() : nodes{Node{{}, 0, false}}
+{
+}
+
+bool CompletionTrie::insert(std::string_view word)
+{
+    if (contains(word))
+    {
+        return false;
+    }
+
+    uint32_t node = 0;
+    ++nodes[node].words;
+
+    for (char c : word)
+    {
+        auto byte = static_cast<uint8_t>(c);
+        auto next = child(node, byte);
+
+        if (!next.has_value())
+        {
+            next = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(Node{{}, 0, false});
+
+            auto& children = nodes[node].children;
+            auto pos = std::lower_bound(
+                children.begin(),
+                children.end(),
+                byte,
+                [](const std::pair<uint8_t, uint32_t>& entry, uint8_t value) { return entry.first < value; });
+            children.insert(pos, {byte, next.value()});
+        }
+
+        node = next.value();
+        ++nodes[node].words;
+    }
+
+    nodes[node].terminal = true;
+
+    return true;
+}
+
+bool CompletionTrie::erase(std::string_view word)
+{
+    if (!contains(word))
+    {
+        return false;
+    }
+
+    uint32_t node = 0;
+    --nodes[node].words;
+
+    for (char c : word)
+    {
+        node = child(node, static_cast<uint8_t>(c)).value();
+        --nodes[node].words;
+    }
+
+    nodes[node].terminal = false;
+
+    return true;
+}
+
+bool CompletionTrie::contains(std::string_view word) const
+{
+    auto node = find(word);
+
+    return node.has_value() && nodes[node.value()].terminal;
+}
+
+std::vector<std::string> CompletionTrie::complete(std::string_view prefix, size_t limit) const
+{
+    std::vector<std::string> words;
+    auto start = find(prefix);
+
+    if (!start.has_value() || limit == 0)
+    {
+        return words;
+    }
+
+    struct Frame
+    {
+        uint32_t node;
+        size_t next_child;
+    };
+
+    std::string word{prefix};
+    std::vector<Frame> stack{{start.value(), 0}};
+
+    if (nodes[start.value()].terminal)
+    {
+        words.push_back(word);
+    }
+
+    // Depth first in byte order, so words come out sorted and the walk stops at the limit.
+    while (!stack.empty() && words.size() < limit)
+    {
+        Frame& frame = stack.back();
+        const auto& children = nodes[frame.node].children;
+
+        if (frame.next_child == children.size())
+        {
+            stack.pop_back();
+            if (!stack.empty())
+            {
+                word.pop_back();
+            }
+            continue;
+        }
+
+        auto [byte, next] = children[frame.next_child++];
+
+        if (nodes[next].words == 0)
+        {
+            continue;
+        }
+
+        word.push_back(static_cast<char>(byte));
+        if (nodes[next].terminal)
+        {
+            words.push_back(word);
+        }
+        stack.push_back({next, 0});
+    }
+
+    return words;
+}
+
+std::string CompletionTrie::common_prefix(std::string_view prefix) const
+{
+    std::string common{prefix};
+    auto node = find(prefix);
+
+    if (!node.has_value())
+    {
+        return common;
+    }
+
+    while (!nodes[node.value()].terminal)
+    {
+        const std::pair<uint8_t, uint32_t>* only = nullptr;
+
+        for (const auto& entry : nodes[node.value()].children)
+        {
+            if (nodes[entry.second].words == 0)
+            {
+                continue;
+            }
+            if (only != nullptr)
+            {
+                return common;
+            }
+            only = &entry;
+        }
+
+        if (only == nullptr)
+        {
+            break;
+        }
+
+        common.push_back(static_cast<char>(only->first));
+        node = only->second;
+    }
+
+    return common;
+}
+
+size_t CompletionTrie::size() const
+{
+    return nodes[0].words;
+}
+
+std::optional<uint32_t> CompletionTrie::find(std::string_view prefix) const
+{
+    uint32_t node = 0;
+
+    for (char c : prefix)
+    {
+        auto next = child(node, static_cast<uint8_t>(c));
+
+        if (!next.has_value() || nodes[next.value()].words == 0)
+        {
+            return {};
+        }
+
+        node = next.value();
+    }
+
+    return node;
+}
+
+std::optional<uint32_t> CompletionTrie::child(uint32_t node, uint8_t byte) const
+{
+    const auto& children = nodes[node].children;
+    auto pos = std::lower_bound(
+        children.begin(),
+        children.end(),
+        byte,
+        [](const std::pair<uint8_t, uint32_t>& entry, uint8_t value) { return entry.first < value; });
+
+    if (pos == children.end() || pos->first != byte)
+    {
+        return {};
+    }
+
+    return pos->second;
+}
+
+} // namespace samos::user_interface::ed_line
@@ -1,35 +1,108 @@
 #include "ed_line.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <array>
 #include <fmt/core.h>
+#include <string_view>
+#include <utility>
 
 namespace samos::user_interface::ed_line {
 
+using log::logger::log;
+using log::logger::LogLevel;
+
 constexpr const char* word_break_characters = " \t.,-%!;:=*~^'\"/?<>|[](){}";
 
+namespace
+{
+
+// Characters that end a scheme identifier; unlike word_break_characters, '-', '?' and the like
+// are part of one.
+bool ends_identifier(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '(' || c == ')' || c == '[' || c == ']'
+        || c == '"' || c == ';' || c == '\'' || c == '`' || c == ',';
+}
+
+int count_code_points(std::string_view text)
+{
+    return static_cast<int>(std::count_if(
+        text.begin(),
+        text.end(),
+        [](char c) { return (static_cast<unsigned char>(c) & 0xc0) != 0x80; }));
+}
+
+using Color = replxx::Replxx::Color;
+
+// Parentheses cycle through these by depth, so each pair shares a colour.
+constexpr std::array<Color, 5> paren_colors = {
+    Color::WHITE, Color::BRIGHTCYAN, Color::BRIGHTMAGENTA, Color::BRIGHTGREEN, Color::YELLOW,
+};
+
+Color token_color(SchemeHighlighter::Token token)
+{
+    switch (token)
+    {
+    case SchemeHighlighter::Token::UnmatchedParen:
+        return Color::ERROR;
+    case SchemeHighlighter::Token::String:
+        return Color::GREEN;
+    case SchemeHighlighter::Token::Comment:
+        return Color::GRAY;
+    case SchemeHighlighter::Token::Number:
+        return Color::CYAN;
+    case SchemeHighlighter::Token::Literal:
+        return Color::MAGENTA;
+    case SchemeHighlighter::Token::Keyword:
+        return Color::BRIGHTBLUE;
+    case SchemeHighlighter::Token::Quote:
+        return Color::BROWN;
+    default:
+        return Color::DEFAULT;
+    }
+}
+
+} // namespace
+
 EdLine::EdLine(std::string prompt)
     :
     editor(),
     prompt(prompt),
     history_path(),
-    max_history_length(255),
+    history(),
+    search_query(),
+    search_match(),
+    search_before(0),
     max_hint_rows(1),
-    keywords(),
-    history_enabled(false)
+    keywords({",help", ",quit", ",exit"}),
+    completion_words(),
+    highlighter(),
+    history_enabled(false),
+    interrupted(false)
 {
     // FIXME: Only relevant for windows.
     editor.install_window_change_handler();
 
-    editor.set_max_history_size(max_history_length);
+    editor.set_max_history_size(history_window);
 
     editor.set_max_hint_rows(max_hint_rows);
 
-    // FIXME set completion, highlighter, and hint callbacks
+    for (const auto& keyword : keywords)
+    {
+        completion_words.insert(keyword);
+    }
+
+    // FIXME set hint callback
+    editor.set_highlighter_callback(
+        [this](const std::string& input, replxx::Replxx::colors_t& colors) { highlight(input, colors); });
+    editor.set_completion_callback(
+        [this](const std::string& input, int& context_len) { return complete(input, context_len); });
     editor.set_word_break_characters(word_break_characters);
-    // FIXME set these to variables
-    editor.set_completion_count_cutoff(128);
+    editor.set_completion_count_cutoff(max_completions);
     editor.set_double_tab_completion(false);
     editor.set_complete_on_empty(false);
     editor.set_beep_on_ambiguous_completion(false);
-    editor.set_no_color(true);
+    editor.set_no_color(false);
 
     // showcase key bindings
     editor.bind_key_internal(replxx::Replxx::KEY::BACKSPACE, "delete_character_left_of_cursor");
@@ -48,7 +121,8 @@ EdLine::EdLine(std::string prompt)
     editor.bind_key_internal(replxx::Replxx::KEY::control(replxx::Replxx::KEY::UP), "hint_previous");
     editor.bind_key_internal(replxx::Replxx::KEY::control(replxx::Replxx::KEY::DOWN), "hint_next");
     editor.bind_key_internal(replxx::Replxx::KEY::control(replxx::Replxx::KEY::ENTER), "commit_line");
-    editor.bind_key_internal(replxx::Replxx::KEY::control('R'), "history_incremental_search");
+    editor.bind_key(
+        replxx::Replxx::KEY::control('R'), [this](char32_t code) { return search_history(code); });
     editor.bind_key_internal(replxx::Replxx::KEY::control('W'), "kill_to_begining_of_word");
     editor.bind_key_internal(replxx::Replxx::KEY::control('U'), "kill_to_begining_of_line");
     editor.bind_key_internal(replxx::Replxx::KEY::control('K'), "kill_to_end_of_line");
@@ -81,9 +155,39 @@ void EdLine::print(std::string& input)
     editor.print("%s\n", input.c_str());
 }
 
+void EdLine::write(std::string_view output)
+{
+    editor.write(output.data(), static_cast<int>(output.size()));
+}
+
+const std::string& EdLine::get_prompt() const
+{
+    return prompt;
+}
+
+void EdLine::set_prompt(std::string new_prompt)
+{
+    prompt = std::move(new_prompt);
+}
+
+bool EdLine::take_interrupt()
+{
+    return std::exchange(interrupted, false);
+}
+
 void EdLine::add_to_history(std::string& input)
 {
     editor.history_add(input);
+
+    if (history)
+    {
+        auto append_res = history->append(input);
+
+        if (append_res.is_err())
+        {
+            log<LogLevel::Warn>("{} {}", __LINE__, append_res.get_err().format());
+        }
+    }
 }
 
 void EdLine::set_history_file(std::string& path)
@@ -93,20 +197,37 @@ void EdLine::set_history_file(std::string& path)
 
 void EdLine::load_history()
 {
-    bool result = editor.history_load(history_path);
+    history.reset();
+    auto open_res = HistoryStore::open(history_path);
+
+    if (open_res.is_err())
+    {
+        log<LogLevel::Warn>("{} History will not be kept: {}", __LINE__, open_res.get_err().format());
+        return;
+    }
 
-    // FIXME
+    history = std::move(open_res.get_ok());
+    editor.history_clear();
 
-    (void)result;
+    for (const auto& entry : history->recent(history_window))
+    {
+        editor.history_add(entry);
+    }
 }
 
 void EdLine::save_history()
 {
-    bool result = editor.history_save(history_path);
+    if (!history)
+    {
+        return;
+    }
 
-    // FIXME
+    auto sync_res = history->sync();
 
-    (void)result;
+    if (sync_res.is_err())
+    {
+        log<LogLevel::Warn>("{} {}", __LINE__, sync_res.get_err().format());
+    }
 }
 
 void EdLine::enable_history()
@@ -121,24 +242,129 @@ void EdLine::disable_history()
     history_enabled = false;
 }
 
+CompletionTrie& EdLine::completions()
+{
+    return completion_words;
+}
+
+replxx::Replxx::completions_t EdLine::complete(const std::string& input, int& context_len)
+{
+    size_t start = input.size();
+
+    while (start > 0 && !ends_identifier(input[start - 1]))
+    {
+        --start;
+    }
+
+    // A meta command keeps its leading comma.
+    if (start == 1 && input[0] == ',')
+    {
+        start = 0;
+    }
+
+    std::string_view word{input.data() + start, input.size() - start};
+    context_len = count_code_points(word);
+
+    replxx::Replxx::completions_t candidates;
+
+    if (word.empty())
+    {
+        return candidates;
+    }
+
+    for (auto& candidate : completion_words.complete(word, max_completions))
+    {
+        candidates.emplace_back(std::move(candidate));
+    }
+
+    return candidates;
+}
+
+/*
+ * replxx asks for colours on every keystroke, one per code point; each takes the colour of the
+ * token its first byte belongs to.
+ */
+void EdLine::highlight(const std::string& input, replxx::Replxx::colors_t& colors)
+{
+    highlighter.update(input);
+    const auto& tokens = highlighter.tokens();
+
+    size_t code_point = 0;
+    for (size_t pos = 0; pos < input.size() && code_point < colors.size(); ++pos)
+    {
+        if ((static_cast<unsigned char>(input[pos]) & 0xc0) == 0x80)
+        {
+            continue;
+        }
+
+        if (tokens[pos] == SchemeHighlighter::Token::Paren)
+        {
+            colors[code_point] = paren_colors[highlighter.depth(pos) % paren_colors.size()];
+        }
+        else
+        {
+            colors[code_point] = token_color(tokens[pos]);
+        }
+
+        ++code_point;
+    }
+}
+
+/*
+ * Replaces the line with the newest history entry containing what was typed, and on each repeat
+ * with the next older one. Without a history file this is replxx's own search over the entries
+ * it holds.
+ */
+replxx::Replxx::ACTION_RESULT EdLine::search_history(char32_t code)
+{
+    if (!history)
+    {
+        return editor.invoke(replxx::Replxx::ACTION::HISTORY_INCREMENTAL_SEARCH, code);
+    }
+
+    std::string current{editor.get_state().text()};
+
+    if (current != search_match || search_match.empty())
+    {
+        search_query = current;
+        search_before = history->size();
+    }
+
+    auto found = history->find(search_query, search_before);
+
+    if (!found)
+    {
+        return replxx::Replxx::ACTION_RESULT::CONTINUE;
+    }
+
+    search_before = found.value();
+    search_match = history->entry(found.value());
+
+    size_t position = history->match_position(found.value(), search_query);
+    int cursor = count_code_points(std::string_view{search_match}.substr(0, position));
+    editor.set_state(replxx::Replxx::State{search_match.c_str(), cursor});
+
+    return replxx::Replxx::ACTION_RESULT::CONTINUE;
+}
+
 std::optional<std::string> EdLine::get_input()
 {
     const char* cinput {nullptr};
 
-    do
-    {
-        cinput = editor.input(prompt);
-    } while ((nullptr == cinput) && (EAGAIN == errno));
+    errno = 0;
+    cinput = editor.input(prompt);
 
     if (cinput == nullptr)
     {
+        // replxx reports Ctrl-C as EAGAIN; the owner decides what it abandons.
+        interrupted = (EAGAIN == errno);
         return {};
     }
-    else if (history_enabled)
+    else if (history_enabled && cinput[0] != '\0')
     {
-        editor.history_add(cinput);
+        std::string entry{cinput};
+        add_to_history(entry);
     }
-    ;
 
     return {cinput};
 }
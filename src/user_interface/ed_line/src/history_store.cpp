@@ -0,0 +1,622 @@
+#include "history_store.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace samos::user_interface::ed_line {
+
+namespace
+{
+
+constexpr size_t header_size = 3;
+
+constexpr size_t end_size = sizeof(uint64_t);
+
+// Bytes of history scanned per step of a search, so the newest match is found without scanning everything.
+constexpr size_t search_block_size = 64 * 1024;
+
+// Holds an exclusive lock on the history file, which also guards its index.
+class FileLock {
+public:
+    explicit FileLock(int fd) : fd{fd}, locked{false}
+    {
+    }
+
+    ~FileLock()
+    {
+        if (locked)
+        {
+            ::flock(fd, LOCK_UN);
+        }
+    }
+
+    FileLock(const FileLock&) = delete;
+
+    FileLock& operator=(const FileLock&) = delete;
+
+    // Waits for the lock; false, with errno set, if it cannot be taken.
+    [[nodiscard]] bool acquire()
+    {
+        int res = 0;
+
+        do
+        {
+            res = ::flock(fd, LOCK_EX);
+        } while (res != 0 && errno == EINTR);
+
+        locked = res == 0;
+
+        return locked;
+    }
+
+private:
+    int fd;
+
+    bool locked;
+};
+
+void put_end(uint8_t* out, uint64_t end)
+{
+    if constexpr (std::endian::native == std::endian::little)
+    {
+        std::memcpy(out, &end, end_size);
+    }
+    else
+    {
+        for (size_t idx = 0; idx < end_size; ++idx)
+        {
+            out[idx] = static_cast<uint8_t>(end >> (8 * idx));
+        }
+    }
+}
+
+uint64_t get_end(const uint8_t* in)
+{
+    uint64_t end = 0;
+
+    for (size_t idx = 0; idx < end_size; ++idx)
+    {
+        end |= static_cast<uint64_t>(in[idx]) << (8 * idx);
+    }
+
+    return end;
+}
+
+bool write_all(int fd, const void* data, size_t size)
+{
+    const auto* bytes = static_cast<const char*>(data);
+
+    while (size > 0)
+    {
+        ssize_t written = ::write(fd, bytes, size);
+
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (written <= 0)
+        {
+            return false;
+        }
+
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+
+    return true;
+}
+
+bool read_all(int fd, void* data, size_t size, uint64_t offset)
+{
+    auto* bytes = static_cast<char*>(data);
+
+    while (size > 0)
+    {
+        ssize_t got = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (got <= 0)
+        {
+            return false;
+        }
+
+        bytes += got;
+        size -= static_cast<size_t>(got);
+        offset += static_cast<uint64_t>(got);
+    }
+
+    return true;
+}
+
+std::optional<uint64_t> file_size(int fd)
+{
+    struct stat info{};
+
+    if (::fstat(fd, &info) != 0)
+    {
+        return std::nullopt;
+    }
+
+    return static_cast<uint64_t>(info.st_size);
+}
+
+// Writes the header to an empty file, or checks the one already there. Reports whether it matched.
+HistoryResult<bool> check_header(int fd, const uint8_t (&magic)[2], const std::string& name)
+{
+    auto size = file_size(fd);
+
+    if (!size)
+    {
+        return HistoryResult<bool>::err(HistoryError{fmt::format("reading {}", name)});
+    }
+
+    uint8_t header[header_size] = {magic[0], magic[1], history_version};
+
+    if (size.value() == 0)
+    {
+        if (!write_all(fd, header, header_size))
+        {
+            return HistoryResult<bool>::err(HistoryError{fmt::format("writing {}", name)});
+        }
+
+        return HistoryResult<bool>::ok(true);
+    }
+
+    uint8_t found[header_size] = {};
+
+    if (size.value() < header_size || !read_all(fd, found, header_size, 0))
+    {
+        return HistoryResult<bool>::ok(false);
+    }
+
+    if (found[0] != magic[0] || found[1] != magic[1])
+    {
+        return HistoryResult<bool>::ok(false);
+    }
+    else if (found[2] != history_version)
+    {
+        return HistoryResult<bool>::err(
+            HistoryError{fmt::format("{} is version {}, expected {}", name, found[2], history_version)});
+    }
+
+    return HistoryResult<bool>::ok(true);
+}
+
+} // namespace
+
+HistoryResult<std::unique_ptr<HistoryStore>> HistoryStore::open(const std::filesystem::path& path)
+{
+    using OpenResult = HistoryResult<std::unique_ptr<HistoryStore>>;
+
+    std::error_code dir_error;
+
+    if (path.has_parent_path())
+    {
+        std::filesystem::create_directories(path.parent_path(), dir_error);
+    }
+
+    std::string history_name = path.string();
+    std::string index_name = history_name + ".idx";
+
+    int history_fd = ::open(history_name.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+
+    if (history_fd < 0)
+    {
+        return OpenResult::err(HistoryError{fmt::format("opening {}: {}", history_name, std::strerror(errno))});
+    }
+
+    int index_fd = ::open(index_name.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+
+    if (index_fd < 0)
+    {
+        int open_errno = errno;
+        ::close(history_fd);
+        return OpenResult::err(HistoryError{fmt::format("opening {}: {}", index_name, std::strerror(open_errno))});
+    }
+
+    std::unique_ptr<HistoryStore> store{new HistoryStore{history_fd, index_fd}};
+    FileLock lock{history_fd};
+
+    if (!lock.acquire())
+    {
+        return OpenResult::err(HistoryError{fmt::format("locking {}: {}", history_name, std::strerror(errno))});
+    }
+
+    auto history_res = check_header(history_fd, history_magic, history_name);
+
+    if (history_res.is_err())
+    {
+        return std::move(history_res).template forward_err<std::unique_ptr<HistoryStore>>();
+    }
+    else if (!history_res.get_ok())
+    {
+        return OpenResult::err(HistoryError{fmt::format("{} is not a history file", history_name)});
+    }
+
+    auto index_res = check_header(index_fd, history_index_magic, index_name);
+
+    if (index_res.is_err())
+    {
+        return std::move(index_res).template forward_err<std::unique_ptr<HistoryStore>>();
+    }
+    else if (!index_res.get_ok())
+    {
+        // The index only speeds up opening; rebuild it from the history.
+        uint8_t header[header_size] = {history_index_magic[0], history_index_magic[1], history_version};
+
+        if (::ftruncate(index_fd, 0) != 0 || !write_all(index_fd, header, header_size))
+        {
+            return OpenResult::err(HistoryError{fmt::format("rebuilding {}", index_name)});
+        }
+    }
+
+    auto catch_up_res = store->catch_up();
+
+    if (catch_up_res.is_err())
+    {
+        return std::move(catch_up_res).template forward_err<std::unique_ptr<HistoryStore>>();
+    }
+
+    return OpenResult::ok(std::move(store));
+}
+
+HistoryStore::HistoryStore(int history_fd, int index_fd)
+    :
+    history_fd{history_fd},
+    index_fd{index_fd},
+    ends{},
+    mapped{nullptr},
+    mapped_size{0}
+{
+}
+
+HistoryStore::~HistoryStore()
+{
+    if (mapped != nullptr)
+    {
+        ::munmap(const_cast<char*>(mapped), mapped_size);
+    }
+
+    ::close(index_fd);
+    ::close(history_fd);
+}
+
+HistoryResult<> HistoryStore::append(std::string_view entry)
+{
+    FileLock lock{history_fd};
+
+    if (!lock.acquire())
+    {
+        return HistoryResult<>::err(HistoryError{fmt::format("locking history: {}", std::strerror(errno))});
+    }
+
+    auto catch_up_res = catch_up();
+
+    if (catch_up_res.is_err())
+    {
+        return catch_up_res;
+    }
+
+    entry = entry.substr(0, entry.find('\0'));
+
+    std::string record{entry};
+    record.push_back('\0');
+
+    uint64_t end = (ends.empty() ? header_size : ends.back()) + record.size();
+    uint8_t encoded[end_size];
+    put_end(encoded, end);
+
+    if (!write_all(history_fd, record.data(), record.size()))
+    {
+        return HistoryResult<>::err(HistoryError{fmt::format("appending entry: {}", std::strerror(errno))});
+    }
+
+    // Should this fail, the next open finds the entry in the history's tail.
+    ends.push_back(end);
+    bool indexed = write_all(index_fd, encoded, end_size);
+
+    if (!map_history())
+    {
+        return HistoryResult<>::err(HistoryError{"mapping history"});
+    }
+    else if (!indexed)
+    {
+        return HistoryResult<>::err(HistoryError{fmt::format("indexing entry: {}", std::strerror(errno))});
+    }
+
+    return HistoryResult<>::ok({});
+}
+
+size_t HistoryStore::size() const
+{
+    return ends.size();
+}
+
+std::string HistoryStore::entry(size_t index) const
+{
+    return std::string{entry_view(index)};
+}
+
+std::vector<std::string> HistoryStore::recent(size_t count) const
+{
+    std::vector<std::string> entries;
+    size_t first = ends.size() - std::min(count, ends.size());
+
+    entries.reserve(ends.size() - first);
+
+    for (size_t index = first; index < ends.size(); ++index)
+    {
+        entries.push_back(entry(index));
+    }
+
+    return entries;
+}
+
+std::optional<size_t> HistoryStore::find(std::string_view query, size_t before)
+{
+    {
+        FileLock lock{history_fd};
+
+        // Search what is already known if other sessions' entries cannot be read.
+        if (lock.acquire())
+        {
+            auto catch_up_res = catch_up();
+            (void)catch_up_res;
+        }
+    }
+
+    query = query.substr(0, query.find('\0'));
+    size_t high = std::min(before, ends.size());
+
+    if (query.empty())
+    {
+        return high > 0 ? std::optional<size_t>{high - 1} : std::nullopt;
+    }
+
+    std::boyer_moore_horspool_searcher searcher{query.begin(), query.end()};
+
+    /*
+     * Entries are separated by NUL bytes, which the query cannot contain, so every match lies
+     * within one entry and whole runs of entries can be searched as a single string.
+     */
+    while (high > 0)
+    {
+        uint64_t block_end = ends[high - 1];
+        uint64_t floor = block_end > search_block_size ? block_end - search_block_size : 0;
+        auto low_it = std::upper_bound(ends.begin(), ends.begin() + static_cast<std::ptrdiff_t>(high - 1), floor);
+        size_t low = static_cast<size_t>(low_it - ends.begin());
+        uint64_t block_begin = low == 0 ? header_size : ends[low - 1];
+
+        // Searching forwards skips ahead far faster than rfind steps back; the last hit is the newest.
+        const char* block = mapped + block_begin;
+        const char* block_stop = mapped + block_end;
+        const char* match = nullptr;
+
+        for (const char* from = block;;)
+        {
+            const char* hit = std::search(from, block_stop, searcher);
+
+            if (hit == block_stop)
+            {
+                break;
+            }
+
+            match = hit;
+            from = hit + 1;
+        }
+
+        if (match != nullptr)
+        {
+            auto found = std::upper_bound(
+                ends.begin() + static_cast<std::ptrdiff_t>(low),
+                ends.begin() + static_cast<std::ptrdiff_t>(high),
+                static_cast<uint64_t>(match - mapped));
+
+            return static_cast<size_t>(found - ends.begin());
+        }
+
+        high = low;
+    }
+
+    return std::nullopt;
+}
+
+size_t HistoryStore::match_position(size_t index, std::string_view query) const
+{
+    size_t position = entry_view(index).find(query);
+
+    return position == std::string_view::npos ? 0 : position;
+}
+
+HistoryResult<> HistoryStore::sync()
+{
+    if (::fdatasync(history_fd) != 0 || ::fdatasync(index_fd) != 0)
+    {
+        return HistoryResult<>::err(HistoryError{fmt::format("syncing: {}", std::strerror(errno))});
+    }
+
+    return HistoryResult<>::ok({});
+}
+
+/*
+ * The history file lock must be held. The index is trusted up to its first entry that does not
+ * end past the one before it or that lies beyond the history; anything after that is rebuilt from
+ * the history itself.
+ */
+HistoryResult<> HistoryStore::catch_up()
+{
+    auto history_size = file_size(history_fd);
+    auto index_size = file_size(index_fd);
+
+    if (!history_size || !index_size)
+    {
+        return HistoryResult<>::err(HistoryError{"reading history sizes"});
+    }
+    else if (index_size.value() < header_size)
+    {
+        return HistoryResult<>::err(HistoryError{"history index lost its header"});
+    }
+
+    // The history was cut short under us; index it again from the start.
+    if (!ends.empty() && ends.back() > history_size.value())
+    {
+        forget_entries();
+
+        if (::ftruncate(index_fd, static_cast<off_t>(header_size)) != 0)
+        {
+            return HistoryResult<>::err(HistoryError{"truncating history index"});
+        }
+
+        index_size = header_size;
+    }
+
+    size_t on_disk = (index_size.value() - header_size) / end_size;
+    bool index_valid = (index_size.value() - header_size) % end_size == 0;
+
+    if (on_disk > ends.size())
+    {
+        std::vector<uint8_t> encoded((on_disk - ends.size()) * end_size);
+
+        if (!read_all(index_fd, encoded.data(), encoded.size(), header_size + ends.size() * end_size))
+        {
+            return HistoryResult<>::err(HistoryError{"reading history index"});
+        }
+
+        for (size_t offset = 0; offset < encoded.size(); offset += end_size)
+        {
+            uint64_t end = get_end(encoded.data() + offset);
+            uint64_t previous = ends.empty() ? header_size : ends.back();
+
+            if (end <= previous || end > history_size.value())
+            {
+                index_valid = false;
+                break;
+            }
+
+            ends.push_back(end);
+        }
+    }
+    else if (on_disk < ends.size())
+    {
+        // Another process replaced the files under us; start again from what is there now.
+        forget_entries();
+        return catch_up();
+    }
+
+    if (!index_valid && ::ftruncate(index_fd, static_cast<off_t>(header_size + ends.size() * end_size)) != 0)
+    {
+        return HistoryResult<>::err(HistoryError{"truncating history index"});
+    }
+
+    uint64_t indexed_end = ends.empty() ? header_size : ends.back();
+
+    if (history_size.value() > indexed_end)
+    {
+        std::string tail(history_size.value() - indexed_end, '\0');
+
+        if (!read_all(history_fd, tail.data(), tail.size(), indexed_end))
+        {
+            return HistoryResult<>::err(HistoryError{"reading history"});
+        }
+
+        // An entry cut short by a crash is kept as it stands.
+        if (tail.back() != '\0')
+        {
+            char terminator = '\0';
+
+            if (!write_all(history_fd, &terminator, 1))
+            {
+                return HistoryResult<>::err(HistoryError{"terminating history"});
+            }
+
+            tail.push_back('\0');
+        }
+
+        std::vector<uint8_t> encoded;
+
+        for (size_t offset = 0; offset < tail.size(); ++offset)
+        {
+            if (tail[offset] == '\0')
+            {
+                ends.push_back(indexed_end + offset + 1);
+                encoded.resize(encoded.size() + end_size);
+                put_end(encoded.data() + encoded.size() - end_size, ends.back());
+            }
+        }
+
+        if (!write_all(index_fd, encoded.data(), encoded.size()))
+        {
+            return HistoryResult<>::err(HistoryError{"writing history index"});
+        }
+    }
+
+    if (!map_history())
+    {
+        return HistoryResult<>::err(HistoryError{"mapping history"});
+    }
+
+    return HistoryResult<>::ok({});
+}
+
+void HistoryStore::forget_entries()
+{
+    ends.clear();
+
+    // The mapping may reach past a history that shrank, where reading it would fault.
+    if (mapped != nullptr)
+    {
+        ::munmap(const_cast<char*>(mapped), mapped_size);
+        mapped = nullptr;
+        mapped_size = 0;
+    }
+}
+
+bool HistoryStore::map_history()
+{
+    size_t wanted = ends.empty() ? 0 : ends.back();
+
+    if (wanted <= mapped_size)
+    {
+        return true;
+    }
+
+    if (mapped != nullptr)
+    {
+        ::munmap(const_cast<char*>(mapped), mapped_size);
+        mapped = nullptr;
+        mapped_size = 0;
+    }
+
+    void* region = ::mmap(nullptr, wanted, PROT_READ, MAP_SHARED, history_fd, 0);
+
+    if (region == MAP_FAILED)
+    {
+        return false;
+    }
+
+    mapped = static_cast<const char*>(region);
+    mapped_size = wanted;
+
+    return true;
+}
+
+std::string_view HistoryStore::entry_view(size_t index) const
+{
+    uint64_t begin = index == 0 ? header_size : ends[index - 1];
+
+    return std::string_view{mapped + begin, ends[index] - begin - 1};
+}
+
+} // namespace samos::user_interface::ed_line
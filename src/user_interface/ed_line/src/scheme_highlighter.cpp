@@ -0,0 +1,412 @@
+#include "scheme_highlighter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace samos::user_interface::ed_line {
+
+namespace
+{
+
+constexpr std::array<std::string_view, 38> keywords = {
+    "and", "begin", "case", "case-lambda", "cond", "cond-expand", "define", "define-library",
+    "define-record-type", "define-syntax", "define-values", "delay", "delay-force", "do", "else",
+    "guard", "if", "import", "include", "lambda", "let", "let*", "let*-values", "let-syntax",
+    "let-values", "letrec", "letrec*", "letrec-syntax", "parameterize", "quasiquote", "quote",
+    "set!", "syntax-rules", "unless", "unquote", "unquote-splicing", "when", "=>",
+};
+
+bool is_whitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool is_delimiter(char c)
+{
+    return is_whitespace(c) || c == '(' || c == ')' || c == '[' || c == ']' || c == '"' || c == ';';
+}
+
+bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+bool looks_numeric(std::string_view atom)
+{
+    if (is_digit(atom[0]))
+    {
+        return true;
+    }
+
+    if (atom.size() > 1 && (atom[0] == '+' || atom[0] == '-' || atom[0] == '.'))
+    {
+        return is_digit(atom[1]) || (atom[1] == '.' && atom.size() > 2 && is_digit(atom[2]))
+            || atom.substr(1) == "inf.0" || atom.substr(1) == "nan.0";
+    }
+
+    return false;
+}
+
+} // namespace
+
+SchemeHighlighter::SchemeHighlighter()
+    :
+    text{},
+    token_of{},
+    states{State{Mode::Normal, 0, 0}},
+    atom_start{0},
+    last_relexed{0}
+{
+}
+
+void SchemeHighlighter::update(std::string_view input)
+{
+    size_t old_size = text.size();
+    size_t new_size = input.size();
+    size_t shorter = std::min(old_size, new_size);
+
+    size_t prefix = static_cast<size_t>(
+        std::mismatch(text.begin(), text.begin() + static_cast<std::ptrdiff_t>(shorter), input.begin()).first
+        - text.begin());
+
+    size_t suffix = 0;
+    while (suffix < shorter - prefix && text[old_size - 1 - suffix] == input[new_size - 1 - suffix])
+    {
+        ++suffix;
+    }
+
+    // Resume at the token boundary before the change; nothing before it can be affected.
+    size_t start = prefix;
+    while (start > 0 && states[start].mode != Mode::Normal)
+    {
+        --start;
+    }
+
+    State entry = states[start];
+
+    // Splice the changed bytes in, so the old tokens and states of the unchanged tail line up with
+    // their bytes' new positions.
+    size_t old_changed = old_size - prefix - suffix;
+    size_t new_changed = new_size - prefix - suffix;
+    auto splice_at = static_cast<std::ptrdiff_t>(prefix);
+
+    text.replace(prefix, old_changed, input.substr(prefix, new_changed));
+
+    if (new_changed > old_changed)
+    {
+        token_of.insert(token_of.begin() + splice_at, new_changed - old_changed, Token::Plain);
+        states.insert(states.begin() + splice_at, new_changed - old_changed, entry);
+    }
+    else
+    {
+        auto removed = static_cast<std::ptrdiff_t>(old_changed - new_changed);
+        token_of.erase(token_of.begin() + splice_at, token_of.begin() + splice_at + removed);
+        states.erase(states.begin() + splice_at, states.begin() + splice_at + removed);
+    }
+
+    states[start] = entry;
+
+    size_t changed_end = prefix + new_changed;
+    last_relexed = 0;
+
+    for (size_t pos = start; pos < new_size; ++pos)
+    {
+        // Past the change this still holds the state from the last update.
+        size_t next = pos + 1;
+        State previous = states[next];
+
+        step(pos);
+        ++last_relexed;
+
+        // A token boundary reached in the same state as before means the rest lexes as it did.
+        if (next >= changed_end && states[next].mode == Mode::Normal && states[next] == previous)
+        {
+            return;
+        }
+    }
+
+    Mode end_mode = states[new_size].mode;
+    if (end_mode == Mode::Atom || end_mode == Mode::Hash || end_mode == Mode::CharStart)
+    {
+        finish_atom(new_size);
+    }
+}
+
+const std::vector<SchemeHighlighter::Token>& SchemeHighlighter::tokens() const
+{
+    return token_of;
+}
+
+uint16_t SchemeHighlighter::depth(size_t pos) const
+{
+    bool closes = token_of[pos] == Token::Paren && (text[pos] == ')' || text[pos] == ']');
+
+    return closes ? states[pos].depth - 1 : states[pos].depth;
+}
+
+size_t SchemeHighlighter::relexed() const
+{
+    return last_relexed;
+}
+
+void SchemeHighlighter::step(size_t pos)
+{
+    State state = states[pos];
+    char c = text[pos];
+    Token token = Token::Plain;
+    bool again = true;
+
+    // Runs twice only when a delimiter ends an atom and must then be lexed on its own.
+    while (again)
+    {
+        again = false;
+
+        switch (state.mode)
+        {
+        case Mode::Normal:
+            switch (c)
+            {
+            case '(':
+            case '[':
+                token = Token::Paren;
+                ++state.depth;
+                break;
+
+            case ')':
+            case ']':
+                if (state.depth == 0)
+                {
+                    token = Token::UnmatchedParen;
+                }
+                else
+                {
+                    token = Token::Paren;
+                    --state.depth;
+                }
+                break;
+
+            case '"':
+                token = Token::String;
+                state.mode = Mode::String;
+                break;
+
+            case ';':
+                token = Token::Comment;
+                state.mode = Mode::LineComment;
+                break;
+
+            case '\'':
+            case '`':
+                token = Token::Quote;
+                break;
+
+            case ',':
+                token = Token::Quote;
+                state.mode = Mode::Unquote;
+                break;
+
+            case '#':
+                token = Token::Literal;
+                state.mode = Mode::Hash;
+                atom_start = pos;
+                break;
+
+            case '|':
+                state.mode = Mode::Bar;
+                atom_start = pos;
+                break;
+
+            default:
+                if (!is_whitespace(c))
+                {
+                    state.mode = Mode::Atom;
+                    atom_start = pos;
+                }
+            }
+            break;
+
+        case Mode::Unquote:
+            state.mode = Mode::Normal;
+            if (c == '@')
+            {
+                token = Token::Quote;
+            }
+            else
+            {
+                again = true;
+            }
+            break;
+
+        case Mode::Hash:
+            if (c == '|')
+            {
+                token_of[pos - 1] = Token::Comment;
+                token = Token::Comment;
+                state.mode = Mode::BlockComment;
+                state.block_depth = 1;
+            }
+            else if (c == ';')
+            {
+                token_of[pos - 1] = Token::Comment;
+                token = Token::Comment;
+                state.mode = Mode::Normal;
+            }
+            else if (c == '\\')
+            {
+                token = Token::Literal;
+                state.mode = Mode::CharStart;
+            }
+            else if (is_delimiter(c))
+            {
+                finish_atom(pos);
+                state.mode = Mode::Normal;
+                again = true;
+            }
+            else
+            {
+                state.mode = Mode::Atom;
+            }
+            break;
+
+        case Mode::Atom:
+            if (is_delimiter(c))
+            {
+                finish_atom(pos);
+                state.mode = Mode::Normal;
+                again = true;
+            }
+            else if (c == '|')
+            {
+                state.mode = Mode::Bar;
+            }
+            break;
+
+        case Mode::CharStart:
+            token = Token::Literal;
+            state.mode = Mode::Atom;
+            break;
+
+        case Mode::String:
+            token = Token::String;
+            if (c == '\\')
+            {
+                state.mode = Mode::StringEscape;
+            }
+            else if (c == '"')
+            {
+                state.mode = Mode::Normal;
+            }
+            break;
+
+        case Mode::StringEscape:
+            token = Token::String;
+            state.mode = Mode::String;
+            break;
+
+        case Mode::Bar:
+            if (c == '\\')
+            {
+                state.mode = Mode::BarEscape;
+            }
+            else if (c == '|')
+            {
+                state.mode = Mode::Atom;
+            }
+            break;
+
+        case Mode::BarEscape:
+            state.mode = Mode::Bar;
+            break;
+
+        case Mode::LineComment:
+            token = Token::Comment;
+            if (c == '\n')
+            {
+                state.mode = Mode::Normal;
+            }
+            break;
+
+        case Mode::BlockComment:
+            token = Token::Comment;
+            if (c == '|')
+            {
+                state.mode = Mode::BlockCommentBar;
+            }
+            else if (c == '#')
+            {
+                state.mode = Mode::BlockCommentHash;
+            }
+            break;
+
+        case Mode::BlockCommentBar:
+            token = Token::Comment;
+            if (c == '#')
+            {
+                --state.block_depth;
+                state.mode = state.block_depth == 0 ? Mode::Normal : Mode::BlockComment;
+            }
+            else if (c != '|')
+            {
+                state.mode = Mode::BlockComment;
+            }
+            break;
+
+        case Mode::BlockCommentHash:
+            token = Token::Comment;
+            if (c == '|')
+            {
+                ++state.block_depth;
+                state.mode = Mode::BlockComment;
+            }
+            else if (c != '#')
+            {
+                state.mode = Mode::BlockComment;
+            }
+            break;
+        }
+    }
+
+    token_of[pos] = token;
+    states[pos + 1] = state;
+}
+
+void SchemeHighlighter::finish_atom(size_t end)
+{
+    std::string_view atom{text.data() + atom_start, end - atom_start};
+    Token token = Token::Plain;
+
+    if (atom[0] == '#')
+    {
+        bool opens_vector = end < text.size() && text[end] == '(';
+        bool radix = atom.size() > 1 && std::string_view{"xXbBoOdDeEiI"}.find(atom[1]) != std::string_view::npos;
+
+        if (opens_vector)
+        {
+            token = Token::Paren;
+        }
+        else if (radix && atom[1] != '\\')
+        {
+            token = Token::Number;
+        }
+        else
+        {
+            token = Token::Literal;
+        }
+    }
+    else if (looks_numeric(atom))
+    {
+        token = Token::Number;
+    }
+    else if (std::find(keywords.begin(), keywords.end(), atom) != keywords.end())
+    {
+        token = Token::Keyword;
+    }
+
+    std::fill(
+        token_of.begin() + static_cast<std::ptrdiff_t>(atom_start),
+        token_of.begin() + static_cast<std::ptrdiff_t>(end),
+        token);
+}
+
+} // namespace samos::user_interface::ed_line
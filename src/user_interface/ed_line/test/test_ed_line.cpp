@@ -1,9 +1,229 @@
 #include "gtest/gtest.h"
 #include "ed_line.hpp"
 
+#include <algorithm>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
 namespace ed_line = samos::user_interface::ed_line;
 
 TEST(EdLineTest, Create)
 {
     ed_line::EdLine("This is a prompt");
 }
+
+TEST(CompletionTrieTest, CompletesPrefixesInOrder)
+{
+    ed_line::CompletionTrie trie;
+
+    EXPECT_TRUE(trie.insert("call-with-values"));
+    EXPECT_TRUE(trie.insert("call-with-current-continuation"));
+    EXPECT_TRUE(trie.insert("car"));
+    EXPECT_TRUE(trie.insert("cadr"));
+    EXPECT_TRUE(trie.insert("call"));
+    EXPECT_FALSE(trie.insert("car"));
+    EXPECT_EQ(trie.size(), 5);
+
+    using Words = std::vector<std::string>;
+    EXPECT_EQ(trie.complete("ca", 10), (Words{"cadr", "call", "call-with-current-continuation", "call-with-values", "car"}));
+    EXPECT_EQ(trie.complete("ca", 2), (Words{"cadr", "call"}));
+    EXPECT_EQ(trie.complete("cdr", 10), Words{});
+    EXPECT_EQ(trie.common_prefix("call-"), "call-with-");
+    EXPECT_EQ(trie.common_prefix("c"), "ca");
+    EXPECT_EQ(trie.common_prefix("cal"), "call");
+
+    EXPECT_TRUE(trie.erase("call"));
+    EXPECT_FALSE(trie.erase("call"));
+    EXPECT_FALSE(trie.contains("call"));
+    EXPECT_TRUE(trie.contains("call-with-values"));
+    EXPECT_EQ(trie.complete("call", 10), (Words{"call-with-current-continuation", "call-with-values"}));
+
+    EXPECT_TRUE(trie.erase("cadr"));
+    EXPECT_EQ(trie.complete("cad", 10), Words{});
+    EXPECT_EQ(trie.common_prefix("ca"), "ca");
+    EXPECT_EQ(trie.size(), 3);
+}
+
+TEST(SchemeHighlighterTest, ClassifiesTokens)
+{
+    using Token = ed_line::SchemeHighlighter::Token;
+    ed_line::SchemeHighlighter highlighter;
+
+    std::string line = "(define x '(1 #t \"s\")) ; c)";
+    highlighter.update(line);
+    const auto& tokens = highlighter.tokens();
+    ASSERT_EQ(tokens.size(), line.size());
+
+    EXPECT_EQ(tokens[0], Token::Paren);
+    EXPECT_EQ(tokens[1], Token::Keyword);
+    EXPECT_EQ(tokens[6], Token::Keyword);
+    EXPECT_EQ(tokens[8], Token::Plain);
+    EXPECT_EQ(tokens[10], Token::Quote);
+    EXPECT_EQ(tokens[12], Token::Number);
+    EXPECT_EQ(tokens[14], Token::Literal);
+    EXPECT_EQ(tokens[17], Token::String);
+    EXPECT_EQ(tokens[21], Token::Paren);
+    EXPECT_EQ(tokens[line.size() - 1], Token::Comment);
+    EXPECT_EQ(highlighter.depth(0), 0);
+    EXPECT_EQ(highlighter.depth(11), 1);
+    EXPECT_EQ(highlighter.depth(20), 1);
+    EXPECT_EQ(highlighter.depth(21), 0);
+
+    highlighter.update("#u8(1)) #| ( |# #\\( ,@x");
+    EXPECT_EQ(highlighter.tokens()[0], Token::Paren);
+    EXPECT_EQ(highlighter.tokens()[3], Token::Paren);
+    EXPECT_EQ(highlighter.tokens()[6], Token::UnmatchedParen);
+    EXPECT_EQ(highlighter.tokens()[11], Token::Comment);
+    EXPECT_EQ(highlighter.tokens()[18], Token::Literal);
+    EXPECT_EQ(highlighter.tokens()[21], Token::Quote);
+    EXPECT_EQ(highlighter.tokens()[22], Token::Plain);
+}
+
+TEST(SchemeHighlighterTest, IncrementalUpdatesMatchAFreshLex)
+{
+    std::string line;
+    for (int i = 0; i < 200; ++i)
+    {
+        line += fmt::format("(let ((x{} \"a;b\")) #| {} |# (+ x{} #x1f))\n", i, i, i);
+    }
+
+    ed_line::SchemeHighlighter incremental;
+    incremental.update(line);
+
+    // Typing in the middle of a long buffer only relexes around the edit.
+    std::string edited = line;
+    edited.insert(line.size() / 2, "y");
+    incremental.update(edited);
+    EXPECT_LT(incremental.relexed(), 64);
+
+    const std::vector<std::string> inserts = {"\"", "(", ")", "#|", "|#", "#\\", ";", "\n", ",@", "|", "x"};
+    size_t seed = 7;
+
+    for (int edit = 0; edit < 300; ++edit)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        size_t pos = (seed >> 33) % (edited.size() + 1);
+        const auto& text = inserts[(seed >> 20) % inserts.size()];
+
+        if (edit % 3 == 2 && pos < edited.size())
+        {
+            edited.erase(pos, std::min<size_t>(text.size(), edited.size() - pos));
+        }
+        else
+        {
+            edited.insert(pos, text);
+        }
+
+        incremental.update(edited);
+        ed_line::SchemeHighlighter fresh;
+        fresh.update(edited);
+
+        ASSERT_EQ(incremental.tokens(), fresh.tokens()) << "after edit " << edit;
+        for (size_t i = 0; i < edited.size(); ++i)
+        {
+            ASSERT_EQ(incremental.depth(i), fresh.depth(i)) << "after edit " << edit << " at " << i;
+        }
+    }
+}
+
+TEST(HistoryStoreTest, PersistsAndSearchesAcrossSessions)
+{
+    auto dir = std::filesystem::temp_directory_path() / fmt::format("samos_history_{}", ::getpid());
+    std::filesystem::remove_all(dir);
+    auto path = dir / "history";
+
+    {
+        auto open_res = ed_line::HistoryStore::open(path);
+        ASSERT_TRUE(open_res.is_ok()) << open_res.get_err().format();
+        auto store = std::move(open_res.get_ok());
+
+        EXPECT_TRUE(store->append("(define (f x)\n  (* x 2))").is_ok());
+        EXPECT_TRUE(store->append("(f 21)").is_ok());
+        EXPECT_TRUE(store->append("(display \"hi\")").is_ok());
+        EXPECT_TRUE(store->append("(f 4)").is_ok());
+    }
+
+    auto open_res = ed_line::HistoryStore::open(path);
+    ASSERT_TRUE(open_res.is_ok()) << open_res.get_err().format();
+    auto store = std::move(open_res.get_ok());
+
+    ASSERT_EQ(store->size(), 4);
+    EXPECT_EQ(store->entry(0), "(define (f x)\n  (* x 2))");
+    EXPECT_EQ(store->recent(2), (std::vector<std::string>{"(display \"hi\")", "(f 4)"}));
+
+    EXPECT_EQ(store->find("(f ", store->size()), std::optional<size_t>{3});
+    EXPECT_EQ(store->find("(f ", 3), std::optional<size_t>{1});
+    EXPECT_EQ(store->find("(f ", 1), std::optional<size_t>{0});
+    EXPECT_EQ(store->find("(f ", 0), std::nullopt);
+    EXPECT_EQ(store->find("x 2", store->size()), std::optional<size_t>{0});
+    EXPECT_EQ(store->match_position(0, "x 2"), 19);
+
+    // Another session's entries show up without reopening.
+    auto other = std::move(ed_line::HistoryStore::open(path).get_ok());
+    EXPECT_TRUE(other->append("(g 1)").is_ok());
+    EXPECT_EQ(store->find("(g", store->size() + 1), std::optional<size_t>{4});
+
+    // An index that missed the last entry and a history cut short mid entry are both recovered.
+    std::filesystem::resize_file(dir / "history.idx", std::filesystem::file_size(dir / "history.idx") - 8);
+    {
+        std::ofstream tail{path, std::ios::app | std::ios::binary};
+        tail << "(h 2";
+    }
+
+    auto recovered = std::move(ed_line::HistoryStore::open(path).get_ok());
+    ASSERT_EQ(recovered->size(), 6);
+    EXPECT_EQ(recovered->entry(4), "(g 1)");
+    EXPECT_EQ(recovered->entry(5), "(h 2");
+    EXPECT_TRUE(recovered->append("(i 3)").is_ok());
+    EXPECT_EQ(recovered->entry(6), "(i 3)");
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(HistoryStoreTest, IndexesAShrunkHistoryAgain)
+{
+    auto dir = std::filesystem::temp_directory_path() / fmt::format("samos_history_shrunk_{}", ::getpid());
+    std::filesystem::remove_all(dir);
+    auto path = dir / "history";
+
+    auto store = std::move(ed_line::HistoryStore::open(path).get_ok());
+
+    EXPECT_TRUE(store->append("(a 1)").is_ok());
+    EXPECT_TRUE(store->append(std::string(100000, 'b')).is_ok());
+
+    // Keep the header and the first entry, as if another session had rewritten the file.
+    std::filesystem::resize_file(path, 3 + 6);
+
+    EXPECT_EQ(store->find("(a", 10), std::optional<size_t>{0});
+    EXPECT_EQ(store->size(), 1);
+    EXPECT_TRUE(store->append("(c 3)").is_ok());
+    EXPECT_EQ(store->recent(2), (std::vector<std::string>{"(a 1)", "(c 3)"}));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(HistoryStoreTest, SearchesAcrossBlocks)
+{
+    auto dir = std::filesystem::temp_directory_path() / fmt::format("samos_history_blocks_{}", ::getpid());
+    std::filesystem::remove_all(dir);
+
+    auto store = std::move(ed_line::HistoryStore::open(dir / "history").get_ok());
+
+    for (int entry = 0; entry < 20000; ++entry)
+    {
+        ASSERT_TRUE(store->append(fmt::format("(orbit-step {} (vector 1.0 2.0 3.0))", entry)).is_ok());
+    }
+
+    EXPECT_EQ(store->find("(orbit-step 7 ", store->size()), std::optional<size_t>{7});
+    EXPECT_EQ(store->find("(orbit-step 19999 ", store->size()), std::optional<size_t>{19999});
+    EXPECT_EQ(store->find("vector", 12345), std::optional<size_t>{12344});
+    EXPECT_EQ(store->find("(orbit-step 20000 ", store->size()), std::nullopt);
+    EXPECT_EQ(store->find("", 5), std::optional<size_t>{4});
+
+    std::filesystem::remove_all(dir);
+}
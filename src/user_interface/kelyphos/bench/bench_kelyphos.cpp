@@ -0,0 +1,231 @@
+#include "completion_trie.hpp"
+#include "config_manager.hpp"
+#include "ed_line.hpp"
+#include "history_store.hpp"
+#include "incremental_reader.hpp"
+#include "kelyphos.hpp"
+#include "scheme_highlighter.hpp"
+#include "scheme.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fmt/core.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace config_manager = samos::config_manager;
+namespace ed_line = samos::user_interface::ed_line;
+namespace kelyphos = samos::user_interface::kelyphos;
+namespace scheme = samos::scheme;
+
+constexpr int repetitions = 10;
+
+constexpr const char* config_source = "data/config/kelyphos.cfg.scm";
+
+double time_per_run(const std::function<void()>& run)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int rep = 0; rep < repetitions; ++rep)
+    {
+        run();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / repetitions;
+}
+
+config_manager::ConfigNest make_nest()
+{
+    config_manager::ConfigMap options;
+    auto register_res = options.register_property("ed-enable-history", true);
+
+    if (register_res.is_err())
+    {
+        fmt::print("failed to register defaults: {}\n", register_res.get_err().format());
+    }
+
+    return config_manager::ConfigNest{"kelyphos", options};
+}
+
+int main()
+{
+    double standard_seconds = time_per_run(
+        []()
+        {
+            scheme::Schemer schemer;
+        });
+
+    double reader_seconds = time_per_run(
+        []()
+        {
+            scheme::Schemer schemer{scheme::SchemerEnv::ReaderOnly};
+        });
+
+    // What startup used to cost: the shell's environment plus a second one for config loading.
+    double two_env_seconds = time_per_run(
+        []()
+        {
+            scheme::Schemer shell;
+            scheme::Schemer config;
+            auto import_res = config.import_module(scheme::SrfiType::Srfi_ListLibrary);
+            auto contents = config.read_from_file(config_source);
+            (void)import_res;
+            (void)contents;
+        });
+
+    double borrowed_seconds = time_per_run(
+        []()
+        {
+            scheme::Schemer shell;
+            config_manager::ConfigManager manager{make_nest(), shell};
+            auto map_res = manager.load_config_from_file(config_source);
+            (void)map_res;
+        });
+
+    double kelyphos_seconds = time_per_run(
+        []()
+        {
+            ed_line::EdLine editor{"bench> "};
+            kelyphos::Kelyphos shell{&editor};
+        });
+
+    fmt::print("{:>24} {:>12}\n", "startup", "ms");
+    fmt::print("{:>24} {:>12.2f}\n", "standard schemer", standard_seconds * 1e3);
+    fmt::print("{:>24} {:>12.2f}\n", "reader-only schemer", reader_seconds * 1e3);
+    fmt::print("{:>24} {:>12.2f}\n", "shell + config schemer", two_env_seconds * 1e3);
+    fmt::print("{:>24} {:>12.2f}\n", "shell, borrowed config", borrowed_seconds * 1e3);
+    fmt::print("{:>24} {:>12.2f}\n", "kelyphos", kelyphos_seconds * 1e3);
+    fmt::print("saved per start: {:.2f} ms\n", (two_env_seconds - borrowed_seconds) * 1e3);
+
+    // A pasted script: each form spans three lines, so the reader carries state between them.
+    constexpr int script_forms = 20000;
+    std::vector<std::string> script;
+    size_t script_bytes = 0;
+
+    for (int form = 0; form < script_forms; ++form)
+    {
+        script.push_back(fmt::format("(define (step-{} state)", form));
+        script.push_back("  (let ((dv \"a (string\") (c #\\)))");
+        script.push_back(fmt::format("    (+ state {}))) ; done", form));
+    }
+
+    for (const auto& line : script)
+    {
+        script_bytes += line.size() + 1;
+    }
+
+    size_t datums = 0;
+    double reader_pass_seconds = time_per_run(
+        [&script, &datums]()
+        {
+            kelyphos::IncrementalReader reader;
+            datums = 0;
+
+            for (const auto& line : script)
+            {
+                datums += reader.feed(line).size();
+            }
+        });
+
+    fmt::print(
+        "incremental reader: {} lines, {} datums in {:.2f} ms ({:.1f} MB/s)\n",
+        script.size(),
+        datums,
+        reader_pass_seconds * 1e3,
+        static_cast<double>(script_bytes) / reader_pass_seconds / 1e6);
+
+    constexpr int bound_symbols = 50000;
+    ed_line::CompletionTrie trie;
+
+    double fill_seconds = time_per_run(
+        [&trie]()
+        {
+            trie = ed_line::CompletionTrie{};
+            for (int symbol = 0; symbol < bound_symbols; ++symbol)
+            {
+                trie.insert(fmt::format("orbit-body-{}-state", symbol));
+            }
+        });
+
+    size_t candidates = 0;
+    double complete_seconds = time_per_run(
+        [&trie, &candidates]()
+        {
+            candidates = trie.complete("orbit-body-4", ed_line::max_completions).size();
+        });
+
+    fmt::print(
+        "completion: {} symbols inserted in {:.2f} ms, {} candidates in {:.1f} us\n",
+        trie.size(),
+        fill_seconds * 1e3,
+        candidates,
+        complete_seconds * 1e6);
+
+    // The whole script pasted as one buffer, then a keystroke in the middle of it.
+    std::string pasted;
+    for (const auto& line : script)
+    {
+        pasted += line;
+        pasted.push_back('\n');
+    }
+
+    ed_line::SchemeHighlighter highlighter;
+    double full_lex_seconds = time_per_run([&highlighter, &pasted]() { highlighter = {}; highlighter.update(pasted); });
+
+    std::string typed = pasted;
+    typed.insert(typed.size() / 2, "x");
+    double keystroke_seconds = time_per_run(
+        [&highlighter, &pasted, &typed]()
+        {
+            highlighter.update(typed);
+            highlighter.update(pasted);
+        });
+
+    fmt::print(
+        "highlighter: {} bytes lexed in {:.2f} ms, keystroke relexes {} bytes in {:.1f} us\n",
+        pasted.size(),
+        full_lex_seconds * 1e3,
+        highlighter.relexed(),
+        keystroke_seconds / 2 * 1e6);
+
+    // A long-lived history: opening reads only the index, and a search scans from the newest entry.
+    constexpr int history_entries = 300000;
+    auto history_dir = std::filesystem::temp_directory_path() / "samos_bench_history";
+    std::filesystem::remove_all(history_dir);
+
+    {
+        auto store = std::move(ed_line::HistoryStore::open(history_dir / "history").get_ok());
+        for (int entry = 0; entry < history_entries; ++entry)
+        {
+            auto append_res = store->append(fmt::format("(orbit-step {} (vector 1.0 2.0 3.0))", entry));
+            (void)append_res;
+        }
+    }
+
+    size_t history_size = 0;
+    double history_open_seconds = time_per_run(
+        [&history_dir, &history_size]()
+        {
+            history_size = ed_line::HistoryStore::open(history_dir / "history").get_ok()->size();
+        });
+
+    auto store = std::move(ed_line::HistoryStore::open(history_dir / "history").get_ok());
+    double recent_search_seconds = time_per_run(
+        [&store]() { auto found = store->find("(orbit-step 299990 ", store->size()); (void)found; });
+    double oldest_search_seconds = time_per_run(
+        [&store]() { auto found = store->find("(orbit-step 10 ", store->size()); (void)found; });
+
+    fmt::print(
+        "history: {} entries opened in {:.2f} ms, recent match in {:.1f} us, oldest match in {:.2f} ms\n",
+        history_size,
+        history_open_seconds * 1e3,
+        recent_search_seconds * 1e6,
+        oldest_search_seconds * 1e3);
+
+    std::filesystem::remove_all(history_dir);
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+#ifndef SAMOS_COMMAND_TABLE_HPP
+#define SAMOS_COMMAND_TABLE_HPP
+
+#include "fnv1a.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace samos::user_interface::kelyphos {
+
+enum class CommandStatus
+{
+    Continue,
+    Quit,
+};
+
+struct CommandArgs
+{
+    // Everything after the command's name.
+    std::string_view text;
+
+    // text split into datums, unevaluated.
+    std::vector<std::string> datums;
+};
+
+using CommandHandler = std::function<CommandStatus(const CommandArgs& args)>;
+
+constexpr size_t any_number_of_args = std::numeric_limits<size_t>::max();
+
+struct Command
+{
+    // Without the leading comma.
+    std::string name;
+
+    // The arguments as shown by ,help, e.g. "<expr> [n]".
+    std::string usage;
+
+    std::string help;
+
+    size_t min_args = 0;
+
+    size_t max_args = 0;
+
+    CommandHandler handler;
+};
+
+/*
+ * Shell meta commands, keyed on the word after the comma. Any line that starts with a comma
+ * is a command, so a line that does not costs the shell a single comparison. Arguments are
+ * split into datums like shell input and counted before the handler runs.
+ */
+class CommandTable {
+public:
+    using Report = std::function<void(const std::string& message)>;
+
+    // report receives the complaints about unknown commands and bad arguments.
+    explicit CommandTable(Report report);
+
+    // False if a command of that name exists.
+    bool add(Command command);
+
+    bool remove(std::string_view name);
+
+    [[nodiscard]] bool contains(std::string_view name) const;
+
+    // Runs the command on line, or returns nothing when line is not a command.
+    std::optional<CommandStatus> dispatch(std::string_view line) const;
+
+    // Every command with its usage and help, in name order.
+    [[nodiscard]] std::string help_text() const;
+
+    [[nodiscard]] std::vector<std::string> names() const;
+
+private:
+    struct NameHash
+    {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view name) const
+        {
+            return static_cast<size_t>(config_manager::fnv1a(name));
+        }
+    };
+
+    std::unordered_map<std::string, Command, NameHash, std::equal_to<>> commands;
+
+    Report report;
+};
+
+} // namespace samos::user_interface::kelyphos
+
+#endif // SAMOS_COMMAND_TABLE_HPP
@@ -0,0 +1,77 @@
+#ifndef SAMOS_INCREMENTAL_READER_HPP
+#define SAMOS_INCREMENTAL_READER_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace samos::user_interface::kelyphos {
+
+/*
+ * Splits shell input into top level datums as lines arrive. Lexer state (list depth, strings,
+ * block and datum comments) carries over between lines, so a form may span any number of them
+ * and a line may hold several forms. Each character is scanned once; only the text of an
+ * unfinished datum is kept between calls.
+ *
+ * This only finds datum boundaries. The datums themselves are left for the scheme reader, which
+ * reports anything malformed, including a stray closing parenthesis.
+ */
+class IncrementalReader {
+public:
+    IncrementalReader();
+
+    // Appends a line of input and returns the datums it completed, in order.
+    std::vector<std::string> feed(std::string_view line);
+
+    // True while a datum or block comment is open across lines.
+    [[nodiscard]] bool pending() const;
+
+    // Discards any unfinished input.
+    void reset();
+
+private:
+    enum class LexState
+    {
+        Normal,
+        Atom,
+        String,
+        // Inside |...| within a symbol.
+        Bar,
+        LineComment,
+        BlockComment,
+    };
+
+    void scan_normal(std::vector<std::string>& datums);
+
+    void begin_datum(size_t pos);
+
+    // Ends the top level datum at end, if one is open and every list in it has closed.
+    void close_datum(size_t end, std::vector<std::string>& datums);
+
+    std::string buffer;
+
+    size_t scan_pos;
+
+    // Where the open top level datum starts, including any quote prefixes.
+    size_t datum_start;
+
+    size_t atom_start;
+
+    bool in_datum;
+
+    bool escaped;
+
+    int depth;
+
+    int block_depth;
+
+    // #; prefixes seen at top level; each discards the next datum.
+    int datum_comments;
+
+    LexState state;
+};
+
+} // namespace samos::user_interface::kelyphos
+
+#endif // SAMOS_INCREMENTAL_READER_HPP
@@ -1,14 +1,133 @@
 #ifndef SAMOS_KELYPHOS_HPP
 #define SAMOS_KELYPHOS_HPP
 
+#include "command_table.hpp"
+#include "config_schema.hpp"
+#include "config_watcher.hpp"
 #include "ed_line.hpp"
+#include "incremental_reader.hpp"
 #include "scheme.hpp"
 
+#include <atomic>
 #include <chibi/eval.h>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
 
 extern "C" {
 sexp sexp_ed_enable_history_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0);
 sexp sexp_ed_disable_history_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0);
+sexp sexp_shell_define_command_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1, sexp arg2, sexp arg3);
+}
+
+namespace samos::user_interface::kelyphos {
+
+struct KelyphosConfig
+{
+    bool enable_history = true;
+
+    // Empty for kelyphos_history in the XDG state directory.
+    std::string history_file = "";
+
+    // Read once at startup; the logging mode is not changed while the shell runs.
+    bool log_async = false;
+
+    int log_queue_size = 4096;
+
+    // "block", "drop" or "drop-oldest".
+    std::string log_overflow = "block";
+
+    // Results nested deeper are elided. Both print limits apply from the next line typed.
+    int print_depth = 64;
+
+    // Result text shown before the shell pauses for ,more.
+    int print_page_bytes = 64 * 1024;
+
+    // For --serve. Empty for kelyphos.sock in $XDG_RUNTIME_DIR/samos, else in /tmp/samos-<uid>.
+    std::string server_socket = "";
+
+    // Also serve on this port of 127.0.0.1, which any local user can reach; 0 for none.
+    int server_port = 0;
+
+    // Give every client one shell rather than one each.
+    bool server_shared = false;
+
+    static constexpr std::string_view config_nest = "kelyphos";
+
+    static constexpr auto config_fields()
+    {
+        using config_manager::Field;
+        return std::tuple{
+            Field<"ed-enable-history", &KelyphosConfig::enable_history>{},
+            Field<"history-file", &KelyphosConfig::history_file>{},
+            Field<"log-async", &KelyphosConfig::log_async>{},
+            Field<"log-queue-size", &KelyphosConfig::log_queue_size>{},
+            Field<"log-overflow", &KelyphosConfig::log_overflow>{},
+            Field<"print-depth", &KelyphosConfig::print_depth>{},
+            Field<"print-page-bytes", &KelyphosConfig::print_page_bytes>{},
+            Field<"server-socket", &KelyphosConfig::server_socket>{},
+            Field<"server-port", &KelyphosConfig::server_port>{},
+            Field<"server-shared", &KelyphosConfig::server_shared>{}};
+    }
+};
+
+// Resolves the config the way a Kelyphos given the same overrides would.
+KelyphosConfig load_config(std::vector<std::string> config_overrides = {});
+
+// Watches that config for shells to share; a watcher that cannot start still holds the config.
+std::shared_ptr<config_manager::ConfigWatcher> start_config_watcher(std::vector<std::string> config_overrides = {});
+
+// Runs ,bench measures when no count is given; a tenth as many again run first as warm-up.
+constexpr int default_bench_runs = 100;
+
+// What evaluating one form cost.
+struct FormCost
+{
+    double seconds = 0.0;
+
+    uint64_t collections = 0;
+
+    uint64_t gc_usecs = 0;
+
+    // Unknown when a collection ran, since it returns memory the form may have used.
+    std::optional<size_t> allocated;
+};
+
+/*
+ * What one source of input has typed so far: a form it has not finished and a result it has not
+ * paged through. The shell keeps its own; a server sharing one shell keeps one per client.
+ */
+struct InputState
+{
+    IncrementalReader reader;
+
+    // The result paused by a full page, if any. Must not outlive the shell that made it.
+    std::unique_ptr<scheme::DatumPrinter> more_output;
+};
+
+enum class SchemeCommandStatus
+{
+    Added,
+    BadName,
+    // A command defined in C++ has the name.
+    Taken,
+};
+
+class Kelyphos;
+
+} // namespace samos::user_interface::kelyphos
+
+extern "C"
+{
+struct KelyphosPOD
+{
+    samos::user_interface::kelyphos::Kelyphos* shell;
+};
 }
 
 namespace samos::user_interface::kelyphos {
@@ -18,27 +137,115 @@ public:
 
     Kelyphos() = delete;
 
-    explicit Kelyphos(ed_line::EdLine* editor);
+    /*
+     * Config resolves from data/config/kelyphos.cfg.scm, then the user's kelyphos.cfg.scm, then
+     * SAMOS_KELYPHOS_* variables, then config_overrides ("kelyphos.key=value").
+     */
+    explicit Kelyphos(ed_line::EdLine* editor, std::vector<std::string> config_overrides = {});
+
+    /*
+     * For shells without a terminal of their own, as the REPL server makes: history is neither
+     * loaded nor recorded, and config comes from a watcher the caller started and may share.
+     */
+    Kelyphos(ed_line::EdLine* editor, std::shared_ptr<config_manager::ConfigWatcher> config_watcher);
 
     ~Kelyphos();
 
     void repl();
 
+    // Handles one line of input as if typed at the prompt; Quit after ,quit or ,exit.
+    CommandStatus feed(const std::string& line);
+
+    // As above, continuing from state rather than from the shell's own input.
+    CommandStatus feed(const std::string& line, InputState& state);
+
+    // Mid-form, so the next line continues a datum.
+    [[nodiscard]] bool pending() const;
+
+    scheme::Schemer& get_schemer();
+
+    // Adds a meta command and offers it for completion. False if the name is taken.
+    bool add_command(Command command);
+
+    // For scheme's define-shell-command, which may redefine its own commands but no others.
+    SchemeCommandStatus add_scheme_command(const std::string& name, std::string usage, std::string help);
+
 private:
 
+    Kelyphos(ed_line::EdLine* editor, std::shared_ptr<config_manager::ConfigWatcher> watcher, bool keep_history);
+
     void read();
 
-    bool check_quit(const std::string& input);
+    // feed's work, on the current input.
+    CommandStatus handle_line(const std::string& line);
 
-    bool check_help(const std::string& input);
+    void install_commands();
 
+    CommandStatus time_command();
+
+    CommandStatus bench_command(const CommandArgs& args);
+
+    CommandStatus more_command();
+
+    CommandStatus reset_command();
+
+    void evaluate(const std::string& datum);
+
+    // Evaluates datum as the body of a procedure of no arguments, for call to run.
+    sexp make_thunk(const std::string& datum);
+
+    template <typename F>
+    FormCost measure(F&& run);
+
+    // Streams result to the editor a page at a time; what does not fit waits for ,more.
     void print(const sexp& result);
 
+    void print_page();
+
+    // Applies config published since the last call, and history toggled from the watcher thread.
+    void apply_config_changes();
+
+    void set_print_limits(const KelyphosConfig& config);
+
+    // Adds whatever has been bound since the last call to the editor's completions.
+    void sync_completions();
+
     ed_line::EdLine* editor;
 
     EdLinePOD ed_pod;
 
+    std::string prompt;
+
+    // Shown while a form is open across lines.
+    std::string continuation_prompt;
+
     scheme::Schemer schemer;
+
+    scheme::PrintLimits print_limits;
+
+    InputState local_input;
+
+    // local_input, or the state passed to feed while it runs.
+    InputState* input;
+
+    scheme::BindingCursor completion_cursor;
+
+    // Set by ,time: report what each form cost after its result.
+    bool time_forms;
+
+    CommandTable commands;
+
+    std::unordered_set<std::string> scheme_commands;
+
+    KelyphosPOD shell_pod;
+
+    // Written by the config watcher thread, applied to the editor between reads. -1 when unchanged.
+    std::atomic<int> pending_history;
+
+    std::shared_ptr<config_manager::ConfigWatcher> config_watcher;
+
+    // The watcher's generation when print_limits were last set.
+    uint64_t config_generation;
 };
 
 } // namespace samos::user_interface::kelyphos
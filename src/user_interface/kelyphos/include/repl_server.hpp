@@ -0,0 +1,180 @@
+#ifndef SAMOS_REPL_SERVER_HPP
+#define SAMOS_REPL_SERVER_HPP
+
+#include "kelyphos.hpp"
+#include "result.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fmt/core.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace samos::user_interface::kelyphos {
+
+class ServerError
+{
+public:
+    explicit ServerError(const std::string& reason) : reason{reason}
+    {
+    }
+
+    std::string format() const
+    {
+        return fmt::format("REPL server error: {}", reason);
+    }
+
+private:
+    std::string reason;
+};
+
+template <typename T = std::monostate>
+using ServerResult = result::Result<T, ServerError>;
+
+// Sent after the output of each line: the shell wants a new form, or more of the current one.
+constexpr const char* server_ready = ";; ready";
+
+constexpr const char* server_more = ";; more";
+
+// Sent before the server closes a session that quit.
+constexpr const char* server_bye = ";; bye";
+
+struct ReplServerConfig
+{
+    // Unix domain socket to listen on, usable by its owner only; empty for none.
+    std::string socket_path = "";
+
+    // Port on 127.0.0.1 to listen on as well, which any local user can reach. 0 lets the kernel
+    // pick one.
+    std::optional<uint16_t> tcp_port;
+
+    // One shell for every client, each with its own half-typed form and paused output.
+    bool shared = false;
+
+    size_t max_sessions = 64;
+
+    // A client sending a longer line is disconnected.
+    size_t max_line_bytes = 1 << 20;
+
+    // Input waits while a client has this much output left unread.
+    size_t max_pending_output = 1 << 20;
+};
+
+// Default socket path: $XDG_RUNTIME_DIR/samos/kelyphos.sock, else /tmp/samos-<uid>/kelyphos.sock.
+std::string default_server_socket();
+
+/*
+ * Serves Kelyphos to local clients over a line protocol. A client sends lines as it would type
+ * them at the prompt; after each one the server sends whatever the shell printed, then
+ * server_ready or server_more. One thread waits on every socket with epoll and evaluates for
+ * each client in turn, so a long evaluation holds up the others.
+ *
+ * By default every client gets a shell of its own from make_shell. With shared set, clients
+ * take turns with a single shell under shared_lock(), which the host should also hold while it
+ * touches that shell's interpreter from another thread.
+ */
+class ReplServer {
+public:
+    using ShellFactory = std::function<std::unique_ptr<Kelyphos>(ed_line::EdLine* editor)>;
+
+    // Without a factory, shells are made headless, sharing one watcher on config_overrides' config.
+    explicit ReplServer(
+        ReplServerConfig config,
+        std::vector<std::string> config_overrides = {},
+        ShellFactory make_shell = nullptr);
+
+    ReplServer(const ReplServer&) = delete;
+
+    ReplServer& operator=(const ReplServer&) = delete;
+
+    ~ReplServer();
+
+    // Binds the sockets and starts serving on a thread of its own.
+    [[nodiscard]] ServerResult<> start();
+
+    // Closes every session and removes the socket file.
+    void stop();
+
+    // The port actually bound, 0 for none.
+    [[nodiscard]] uint16_t get_tcp_port() const;
+
+    [[nodiscard]] size_t get_session_count() const;
+
+    // nullptr unless the config is shared and the server has started.
+    Kelyphos* get_shared_shell();
+
+    [[nodiscard]] std::unique_lock<std::mutex> shared_lock();
+
+private:
+    class SessionEditor;
+
+    struct Session;
+
+    [[nodiscard]] ServerResult<> listen_unix();
+
+    [[nodiscard]] ServerResult<> listen_tcp();
+
+    [[nodiscard]] ServerResult<> watch(int fd, uint32_t events);
+
+    void serve_loop();
+
+    void accept_sessions(int listener);
+
+    void on_readable(Session& session);
+
+    // Runs whole lines from the session's input until it runs out or too much output waits.
+    void run_lines(Session& session);
+
+    void flush(Session& session);
+
+    void close_session(int fd);
+
+    void close_fds();
+
+    ReplServerConfig config;
+
+    std::vector<std::string> config_overrides;
+
+    // Started by the default factory for its first shell.
+    std::shared_ptr<config_manager::ConfigWatcher> config_watcher;
+
+    ShellFactory make_shell;
+
+    // Used only by the serving thread once it starts.
+    std::unordered_map<int, std::unique_ptr<Session>> sessions;
+
+    std::atomic<size_t> session_count;
+
+    std::mutex shared_mutex;
+
+    std::unique_ptr<SessionEditor> shared_editor;
+
+    std::unique_ptr<Kelyphos> shared_shell;
+
+    int unix_fd;
+
+    // Whether the socket file is ours to remove.
+    bool socket_bound;
+
+    int tcp_fd;
+
+    uint16_t bound_port;
+
+    int epoll_fd;
+
+    int stop_pipe[2];
+
+    std::thread server;
+};
+
+} // namespace samos::user_interface::kelyphos
+
+#endif // SAMOS_REPL_SERVER_HPP
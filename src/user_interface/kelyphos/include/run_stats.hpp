@@ -0,0 +1,41 @@
+#ifndef SAMOS_RUN_STATS_HPP
+#define SAMOS_RUN_STATS_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace samos::user_interface::kelyphos {
+
+// Summary of repeated timings, in seconds. Percentiles use the nearest rank.
+struct RunStats
+{
+    size_t runs = 0;
+
+    double mean = 0.0;
+
+    // Sample standard deviation; zero for a single run.
+    double stddev = 0.0;
+
+    double min = 0.0;
+
+    double p50 = 0.0;
+
+    double p90 = 0.0;
+
+    double p99 = 0.0;
+
+    double max = 0.0;
+};
+
+RunStats summarize_runs(std::vector<double> seconds);
+
+// "850 ns", "12.4 us", "3.21 ms" or "1.50 s".
+std::string format_seconds(double seconds);
+
+// "512 B", "12.3 KiB" or "4.00 MiB".
+std::string format_bytes(double bytes);
+
+} // namespace samos::user_interface::kelyphos
+
+#endif // SAMOS_RUN_STATS_HPP
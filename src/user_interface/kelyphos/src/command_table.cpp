@@ -0,0 +1,105 @@
+#include "command_table.hpp"
+#include "incremental_reader.hpp"
+
+#include <algorithm>
+#include <fmt/core.h>
+
+namespace samos::user_interface::kelyphos {
+
+CommandTable::CommandTable(Report report)
+    :
+    commands{},
+    report{std::move(report)}
+{
+}
+
+bool CommandTable::add(Command command)
+{
+    std::string name = command.name;
+
+    return commands.emplace(std::move(name), std::move(command)).second;
+}
+
+bool CommandTable::remove(std::string_view name)
+{
+    auto command_it = commands.find(name);
+
+    if (command_it == commands.end())
+    {
+        return false;
+    }
+
+    commands.erase(command_it);
+
+    return true;
+}
+
+bool CommandTable::contains(std::string_view name) const
+{
+    return commands.find(name) != commands.end();
+}
+
+std::optional<CommandStatus> CommandTable::dispatch(std::string_view line) const
+{
+    if (line.empty() || line[0] != ',')
+    {
+        return std::nullopt;
+    }
+
+    size_t name_end = std::min(line.find_first_of(" \t"), line.size());
+    std::string_view name = line.substr(1, name_end - 1);
+    auto command_it = commands.find(name);
+
+    if (command_it == commands.end())
+    {
+        report(fmt::format(";; unknown command ,{}; ,help lists them", name));
+        return CommandStatus::Continue;
+    }
+
+    const Command& command = command_it->second;
+    CommandArgs args{line.substr(name_end), {}};
+
+    IncrementalReader reader{};
+    args.datums = reader.feed(args.text);
+
+    bool counted = args.datums.size() >= command.min_args && args.datums.size() <= command.max_args;
+
+    if (reader.pending() || !counted)
+    {
+        report(fmt::format(";; usage: ,{} {}", command.name, command.usage));
+        return CommandStatus::Continue;
+    }
+
+    return command.handler(args);
+}
+
+std::string CommandTable::help_text() const
+{
+    std::string text;
+
+    for (const auto& name : names())
+    {
+        const Command& command = commands.find(name)->second;
+
+        text += fmt::format(",{}{}{}\n\t{}\n", command.name, command.usage.empty() ? "" : " ", command.usage, command.help);
+    }
+
+    return text;
+}
+
+std::vector<std::string> CommandTable::names() const
+{
+    std::vector<std::string> sorted;
+    sorted.reserve(commands.size());
+
+    for (const auto& [name, command] : commands)
+    {
+        sorted.push_back(name);
+    }
+
+    std::sort(sorted.begin(), sorted.end());
+
+    return sorted;
+}
+
+} // namespace samos::user_interface::kelyphos
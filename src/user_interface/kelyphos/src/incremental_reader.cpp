@@ -0,0 +1,270 @@
+#include "incremental_reader.hpp"
+
+namespace samos::user_interface::kelyphos {
+
+namespace
+{
+
+bool is_whitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool is_delimiter(char c)
+{
+    return is_whitespace(c) || c == '(' || c == ')' || c == '[' || c == ']' || c == '"' || c == ';';
+}
+
+} // namespace
+
+IncrementalReader::IncrementalReader()
+    :
+    buffer{},
+    scan_pos{0},
+    datum_start{0},
+    atom_start{0},
+    in_datum{false},
+    escaped{false},
+    depth{0},
+    block_depth{0},
+    datum_comments{0},
+    state{LexState::Normal}
+{
+}
+
+std::vector<std::string> IncrementalReader::feed(std::string_view line)
+{
+    std::vector<std::string> datums;
+
+    buffer.append(line);
+    // Every line ends in a delimiter, so an atom at the end of a line is complete.
+    buffer.push_back('\n');
+
+    for (; scan_pos < buffer.size(); ++scan_pos)
+    {
+        char c = buffer[scan_pos];
+
+        switch (state)
+        {
+        case LexState::Normal:
+            scan_normal(datums);
+            break;
+
+        case LexState::Atom:
+            if (c == '|')
+            {
+                state = LexState::Bar;
+            }
+            else if (is_delimiter(c))
+            {
+                state = LexState::Normal;
+
+                // "#(" and "#u8(" open a vector; the atom so far is its prefix.
+                if (c == '(' && buffer[atom_start] == '#')
+                {
+                    ++depth;
+                    break;
+                }
+
+                close_datum(scan_pos, datums);
+                scan_normal(datums);
+            }
+            break;
+
+        case LexState::String:
+        case LexState::Bar:
+            if (escaped)
+            {
+                escaped = false;
+            }
+            else if (c == '\\')
+            {
+                escaped = true;
+            }
+            else if (state == LexState::String && c == '"')
+            {
+                state = LexState::Normal;
+                close_datum(scan_pos + 1, datums);
+            }
+            else if (state == LexState::Bar && c == '|')
+            {
+                state = LexState::Atom;
+            }
+            break;
+
+        case LexState::LineComment:
+            if (c == '\n')
+            {
+                state = LexState::Normal;
+            }
+            break;
+
+        case LexState::BlockComment:
+            if (c == '|' && buffer[scan_pos + 1] == '#')
+            {
+                ++scan_pos;
+                if (--block_depth == 0)
+                {
+                    state = LexState::Normal;
+                }
+            }
+            else if (c == '#' && buffer[scan_pos + 1] == '|')
+            {
+                ++scan_pos;
+                ++block_depth;
+            }
+            break;
+        }
+    }
+
+    // Keep only the unfinished datum, so a long session does not grow the buffer.
+    if (in_datum)
+    {
+        buffer.erase(0, datum_start);
+        scan_pos -= datum_start;
+        atom_start -= datum_start;
+        datum_start = 0;
+    }
+    else
+    {
+        buffer.clear();
+        scan_pos = 0;
+    }
+
+    return datums;
+}
+
+bool IncrementalReader::pending() const
+{
+    return in_datum || state == LexState::BlockComment;
+}
+
+void IncrementalReader::reset()
+{
+    *this = IncrementalReader{};
+}
+
+/*
+ * Handles buffer[scan_pos] outside any atom, string or comment. The buffer always ends in a
+ * newline, so looking one character ahead never runs off its end.
+ */
+void IncrementalReader::scan_normal(std::vector<std::string>& datums)
+{
+    char c = buffer[scan_pos];
+    char next = buffer[scan_pos + 1 < buffer.size() ? scan_pos + 1 : scan_pos];
+
+    switch (c)
+    {
+    case ';':
+        state = LexState::LineComment;
+        break;
+
+    case '"':
+        begin_datum(scan_pos);
+        state = LexState::String;
+        break;
+
+    case '|':
+        begin_datum(scan_pos);
+        atom_start = scan_pos;
+        state = LexState::Bar;
+        break;
+
+    case '(':
+    case '[':
+        begin_datum(scan_pos);
+        ++depth;
+        break;
+
+    case ')':
+    case ']':
+        // A stray closer becomes a datum of its own, for the scheme reader to reject.
+        begin_datum(scan_pos);
+        if (depth > 0)
+        {
+            --depth;
+        }
+        close_datum(scan_pos + 1, datums);
+        break;
+
+    case '\'':
+    case '`':
+    case ',':
+        // Quote prefixes open the datum but only the quoted datum can close it.
+        begin_datum(scan_pos);
+        if (c == ',' && next == '@')
+        {
+            ++scan_pos;
+        }
+        break;
+
+    case '#':
+        if (next == '|')
+        {
+            state = LexState::BlockComment;
+            block_depth = 1;
+            ++scan_pos;
+        }
+        else if (next == ';')
+        {
+            // Inside a list the scheme reader drops the datum itself.
+            if (depth == 0)
+            {
+                ++datum_comments;
+            }
+            ++scan_pos;
+        }
+        else if (next == '\\')
+        {
+            // Skip the character after #\ so "#\(" or "#\ " stays a single atom.
+            begin_datum(scan_pos);
+            atom_start = scan_pos;
+            state = LexState::Atom;
+            scan_pos += 2;
+        }
+        else
+        {
+            begin_datum(scan_pos);
+            atom_start = scan_pos;
+            state = LexState::Atom;
+        }
+        break;
+
+    default:
+        if (!is_whitespace(c))
+        {
+            begin_datum(scan_pos);
+            atom_start = scan_pos;
+            state = LexState::Atom;
+        }
+    }
+}
+
+void IncrementalReader::begin_datum(size_t pos)
+{
+    if (depth == 0 && !in_datum)
+    {
+        in_datum = true;
+        datum_start = pos;
+    }
+}
+
+void IncrementalReader::close_datum(size_t end, std::vector<std::string>& datums)
+{
+    if (depth != 0 || !in_datum)
+    {
+        return;
+    }
+
+    in_datum = false;
+
+    if (datum_comments > 0)
+    {
+        --datum_comments;
+        return;
+    }
+
+    datums.emplace_back(buffer, datum_start, end - datum_start);
+}
+
+} // namespace samos::user_interface::kelyphos
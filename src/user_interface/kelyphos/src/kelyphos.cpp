@@ -1,10 +1,22 @@
 #include "kelyphos.hpp"
 #include "logger.hpp"
+#include "config_layers.hpp"
 #include "config_manager.hpp"
+#include "config_schema.hpp"
+#include "run_stats.hpp"
+#include "scheme_log.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <charconv>
 #include <chibi/sexp.h>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
 #include <fmt/core.h>
+#include <numeric>
 #include <string>
+#include <system_error>
 
 sexp sexp_ed_enable_history_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0)
 {
@@ -40,48 +52,262 @@ sexp sexp_ed_disable_history_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0)
     return res;
 }
 
+sexp sexp_shell_define_command_stub(sexp ctx, sexp self, sexp_sint_t n, sexp arg0, sexp arg1, sexp arg2, sexp arg3)
+{
+    using samos::user_interface::kelyphos::SchemeCommandStatus;
+
+    (void)n;
+
+    if (!(sexp_pointerp(arg0) && (sexp_pointer_tag(arg0) == sexp_unbox_fixnum(sexp_opcode_arg1_type(self)))))
+    {
+        return sexp_type_exception(ctx, self, sexp_unbox_fixnum(sexp_opcode_arg1_type(self)), arg0);
+    }
+
+    for (sexp arg : {arg1, arg2, arg3})
+    {
+        if (!sexp_stringp(arg))
+        {
+            return sexp_type_exception(ctx, self, SEXP_STRING, arg);
+        }
+    }
+
+    auto* shell = static_cast<KelyphosPOD*>(sexp_cpointer_value(arg0))->shell;
+    auto status = shell->add_scheme_command(sexp_string_data(arg1), sexp_string_data(arg2), sexp_string_data(arg3));
+
+    if (status == SchemeCommandStatus::BadName)
+    {
+        return sexp_user_exception(ctx, self, "shell command names may not hold spaces, quotes or parentheses", arg1);
+    }
+    else if (status == SchemeCommandStatus::Taken)
+    {
+        return sexp_user_exception(ctx, self, "a built in shell command has that name", arg1);
+    }
+
+    return SEXP_VOID;
+}
+
 namespace samos::user_interface::kelyphos {
 
-Kelyphos::Kelyphos(ed_line::EdLine* editor)
-    :
-    editor(editor),
-    ed_pod{editor},
-    schemer{}
+using log::logger::log;
+using log::logger::LogLevel;
+
+namespace
 {
-    config_manager::ConfigMap kelyphos_options;
-    config_manager::ConfigMap loadout_map;
 
-    std::vector<std::pair<std::string, config_manager::ConfigValue>> conf_pairs{
-        std::make_pair("ed-enable-history", true),
-    };
+/*
+ * Scheme commands keep their procedures on the scheme side; the shell only knows their names
+ * and calls back through %run-shell-command with the arguments as unevaluated data.
+ */
+constexpr const char* shell_command_wrappers = R"scheme(
+(begin
+  (define %shell-commands '())
+  (define (define-shell-command name usage help proc)
+    (%define-shell-command kelyphos-shell name usage help)
+    (set! %shell-commands (cons (cons name proc) %shell-commands)))
+  (define (%run-shell-command name args)
+    (apply (cdr (assoc name %shell-commands)) args)))
+)scheme";
+
+config_manager::ConfigLayers make_config_layers(std::vector<std::string> overrides)
+{
+    using config_manager::ConfigLayers;
+    using config_manager::ConfigSource;
 
-    auto register_res = kelyphos_options.register_properties(std::move(conf_pairs));
+    ConfigLayers layers{config_manager::make_config_nest<KelyphosConfig>()};
 
-    assert(register_res.is_ok());
-    config_manager::ConfigNest kelyphos_config("kelyphos", kelyphos_options);
-    config_manager::ConfigManager config_manager(kelyphos_config);
+    layers.add_file(ConfigSource::SystemFile, "data/config/kelyphos.cfg.scm")
+        .add_file(ConfigSource::UserFile, (ConfigLayers::default_user_dir() / "kelyphos.cfg.scm").string())
+        .add_environment("SAMOS_KELYPHOS")
+        .add_assignments(std::move(overrides));
 
-    auto map_res = config_manager.load_config_from_file("data/config/kelyphos.cfg.scm");
+    return layers;
+}
 
-    if (map_res.is_ok())
+std::string history_file(const KelyphosConfig& config)
+{
+    if (!config.history_file.empty())
     {
-        kelyphos_options = map_res.get_ok();
+        return config.history_file;
     }
 
-    auto enable_history_res = kelyphos_options.pop_property("ed-enable-history");
+    const char* xdg_state = std::getenv("XDG_STATE_HOME");
 
-    assert(enable_history_res.is_ok());
-    auto enable_history_var = enable_history_res.get_ok();
+    if (xdg_state != nullptr && xdg_state[0] != '\0')
+    {
+        return (std::filesystem::path{xdg_state} / "samos" / "kelyphos_history").string();
+    }
 
-    assert(std::holds_alternative<scheme::SexpCppValue>(enable_history_var));
-    auto enable_history_res2 = std::get<scheme::SexpCppValue>(enable_history_var).get_bool();
+    const char* home = std::getenv("HOME");
 
-    assert(enable_history_res2.is_ok());
-    auto enable_history = enable_history_res2.get_ok();
+    if (home != nullptr && home[0] != '\0')
+    {
+        return (std::filesystem::path{home} / ".local" / "state" / "samos" / "kelyphos_history").string();
+    }
 
-    if (enable_history)
+    return (config_manager::ConfigLayers::default_user_dir() / "kelyphos_history").string();
+}
+
+// Forms that must be evaluated at top level rather than inside a procedure.
+bool is_definition(std::string_view datum)
+{
+    if (datum.empty() || datum[0] != '(')
     {
-        editor->enable_history();
+        return false;
+    }
+
+    // Only the form's own parenthesis: ((lambda () ...)) is a call, whatever its body defines.
+    size_t head = datum.find_first_not_of(" \t\n", 1);
+
+    if (head == std::string_view::npos || datum[head] == '(')
+    {
+        return false;
+    }
+
+    std::string_view keyword = datum.substr(head, datum.find_first_of(" \t\n()", head) - head);
+
+    return keyword.starts_with("define") || keyword == "begin" || keyword == "import" || keyword == "include";
+}
+
+bool is_reset(std::string_view line)
+{
+    size_t start = line.find_first_not_of(" \t");
+    size_t end = line.find_last_not_of(" \t");
+
+    return start != std::string_view::npos && line.substr(start, end - start + 1) == ",reset";
+}
+
+// "kelyphos> " continues as "      ... ", so a form's lines stay aligned.
+std::string continuation_for(const std::string& prompt)
+{
+    constexpr std::string_view dots{"... "};
+    size_t indent = prompt.size() > dots.size() ? prompt.size() - dots.size() : 0;
+
+    return std::string(indent, ' ') + std::string{dots};
+}
+
+void configure_logging(const KelyphosConfig& config)
+{
+    // An --async-log on the command line has already switched modes.
+    if (!config.log_async || log::logger::is_async())
+    {
+        return;
+    }
+
+    log::logger::AsyncConfig async_config{};
+    async_config.queue_size = static_cast<size_t>(std::max(config.log_queue_size, 1));
+
+    if (auto overflow = log::logger::parse_overflow_policy(config.log_overflow))
+    {
+        async_config.overflow = overflow.value();
+    }
+    else
+    {
+        log<LogLevel::Warn>("{} Unknown log-overflow \"{}\", blocking instead", __LINE__, config.log_overflow);
+    }
+
+    log::logger::start_async(async_config);
+}
+
+} // namespace
+
+KelyphosConfig load_config(std::vector<std::string> config_overrides)
+{
+    KelyphosConfig config{};
+    auto resolve_res = make_config_layers(std::move(config_overrides)).resolve();
+
+    if (resolve_res.is_err())
+    {
+        log<LogLevel::Warn>("{} Using default config: {}", __LINE__, resolve_res.get_err());
+        return config;
+    }
+
+    auto config_res = config_manager::from_config_map(resolve_res.get_ok().get_map(), config);
+
+    if (config_res.is_err())
+    {
+        log<LogLevel::Warn>("{} Using default config: {}", __LINE__, config_res.get_err());
+        return KelyphosConfig{};
+    }
+
+    return config;
+}
+
+std::shared_ptr<config_manager::ConfigWatcher> start_config_watcher(std::vector<std::string> config_overrides)
+{
+    auto watcher = std::make_shared<config_manager::ConfigWatcher>(make_config_layers(std::move(config_overrides)));
+    auto watch_res = watcher->start();
+
+    if (watch_res.is_err())
+    {
+        log<LogLevel::Warn>("{} Config changes will not apply live: {}", __LINE__, watch_res.get_err());
+    }
+
+    return watcher;
+}
+
+Kelyphos::Kelyphos(ed_line::EdLine* editor, std::vector<std::string> config_overrides)
+    :
+    Kelyphos(editor, start_config_watcher(std::move(config_overrides)), true)
+{
+}
+
+Kelyphos::Kelyphos(ed_line::EdLine* editor, std::shared_ptr<config_manager::ConfigWatcher> config_watcher)
+    :
+    Kelyphos(editor, std::move(config_watcher), false)
+{
+}
+
+Kelyphos::Kelyphos(
+    ed_line::EdLine* editor,
+    std::shared_ptr<config_manager::ConfigWatcher> watcher,
+    bool keep_history)
+    :
+    editor(editor),
+    ed_pod{editor},
+    prompt{editor->get_prompt()},
+    continuation_prompt{continuation_for(prompt)},
+    schemer{},
+    print_limits{},
+    local_input{},
+    input{&local_input},
+    completion_cursor{},
+    time_forms{false},
+    commands{[this](const std::string& message)
+    {
+        std::string line = message;
+        this->editor->print(line);
+    }},
+    scheme_commands{},
+    shell_pod{this},
+    pending_history{-1},
+    config_watcher{std::move(watcher)},
+    config_generation{config_watcher->get_generation()}
+{
+    KelyphosConfig config{};
+    auto config_res = config_manager::from_config_map(*config_watcher->current(), config);
+
+    // Published configs have already been checked against the defaults.
+    assert(config_res.is_ok());
+
+    configure_logging(config);
+    set_print_limits(config);
+
+    // A shared watcher outlives its shells, so only a shell with a watcher of its own registers.
+    if (keep_history)
+    {
+        std::string history_path = history_file(config);
+        editor->set_history_file(history_path);
+        editor->load_history();
+
+        if (config.enable_history)
+        {
+            editor->enable_history();
+        }
+
+        config_watcher->on_change("ed-enable-history", [this](const config_manager::ConfigRef& value)
+        {
+            pending_history.store(value.get_bool().value_or(true) ? 1 : 0);
+        });
     }
 
     // FIXME CHECK RESULTS
@@ -117,6 +343,44 @@ Kelyphos::Kelyphos(ed_line::EdLine* editor)
         {sexp_make_fixnum(sexp_type_tag(sexp_EdLinePOD_type))},
         sexp_ed_disable_history_stub
     );
+
+    install_commands();
+
+    auto shell_type_res = schemer.register_c_type<KelyphosPOD>();
+
+    if (shell_type_res.is_err())
+    {
+        throw "Kelyphos already registered.";
+    }
+
+    res = schemer.bind_symbol_to_c_object("kelyphos-shell", &shell_pod);
+
+    if (res.is_ok())
+    {
+        res = schemer.define_ffi_op(
+            "%define-shell-command",
+            SEXP_VOID,
+            {
+                sexp_make_fixnum(sexp_type_tag(shell_type_res.get_ok())),
+                sexp_make_fixnum(SEXP_STRING),
+                sexp_make_fixnum(SEXP_STRING),
+                sexp_make_fixnum(SEXP_STRING)},
+            sexp_shell_define_command_stub);
+    }
+
+    if (res.is_err() || sexp_exceptionp(schemer.eval(shell_command_wrappers)))
+    {
+        log<LogLevel::Warn>("{} Scheme cannot define shell commands", __LINE__);
+    }
+
+    res = scheme::install_log_ops(schemer);
+
+    if (res.is_err())
+    {
+        log<LogLevel::Warn>("{} Scheme log ops unavailable: {}", __LINE__, res.get_err());
+    }
+
+    sync_completions();
 }
 
 Kelyphos::~Kelyphos()
@@ -127,63 +391,487 @@ void Kelyphos::repl()
 {
     while (true)
     {
-        std::string input = editor->read();
+        apply_config_changes();
+        editor->set_prompt(pending() ? continuation_prompt : prompt);
+
+        auto line = editor->read();
 
-        if (input.empty() || check_help(input))
+        if (editor->take_interrupt())
         {
+            local_input.reader.reset();
             continue;
         }
-        else if (check_quit(input))
+
+        if (feed(line) == CommandStatus::Quit)
         {
             break;
         }
-        else
+    }
+}
+
+CommandStatus Kelyphos::feed(const std::string& line)
+{
+    return feed(line, local_input);
+}
+
+CommandStatus Kelyphos::feed(const std::string& line, InputState& state)
+{
+    apply_config_changes();
+
+    input = &state;
+    auto status = handle_line(line);
+    input = &local_input;
+
+    return status;
+}
+
+CommandStatus Kelyphos::handle_line(const std::string& line)
+{
+    // Meta commands only apply between datums; mid-form, a leading comma is an unquote, save
+    // for ,reset, which is the way out of a form that will not close.
+    if (input->reader.pending() && is_reset(line))
+    {
+        return reset_command();
+    }
+    else if (!input->reader.pending())
+    {
+        if (line.empty())
+        {
+            return CommandStatus::Continue;
+        }
+
+        if (auto status = commands.dispatch(line))
         {
-            auto output = schemer.eval(input);
-            print(output);
-            continue;
+            return status.value();
         }
     }
+
+    auto datums = input->reader.feed(line);
+
+    for (const auto& datum : datums)
+    {
+        evaluate(datum);
+    }
+
+    if (!datums.empty())
+    {
+        sync_completions();
+    }
+
+    return CommandStatus::Continue;
+}
+
+bool Kelyphos::pending() const
+{
+    return local_input.reader.pending();
+}
+
+scheme::Schemer& Kelyphos::get_schemer()
+{
+    return schemer;
+}
+
+bool Kelyphos::add_command(Command command)
+{
+    std::string completion = "," + command.name;
+
+    if (!commands.add(std::move(command)))
+    {
+        return false;
+    }
+
+    editor->completions().insert(completion);
+
+    return true;
+}
+
+SchemeCommandStatus Kelyphos::add_scheme_command(const std::string& name, std::string usage, std::string help)
+{
+    bool valid = !name.empty() && name.find_first_of(" \t\n\"\\()") == std::string::npos;
+
+    if (!valid)
+    {
+        return SchemeCommandStatus::BadName;
+    }
+    else if (scheme_commands.contains(name))
+    {
+        // Redefining one keeps its place; the scheme side already calls the newest procedure.
+        commands.remove(name);
+    }
+    else if (commands.contains(name))
+    {
+        return SchemeCommandStatus::Taken;
+    }
+
+    Command command{name, std::move(usage), std::move(help), 0, any_number_of_args, {}};
+    command.handler = [this, name](const CommandArgs& args)
+    {
+        std::string quoted;
+
+        for (const auto& datum : args.datums)
+        {
+            quoted += datum;
+            quoted.push_back('\n');
+        }
+
+        sexp result = schemer.eval(fmt::format("(%run-shell-command \"{}\" (quote ({})))", name, quoted));
+
+        if (!sexp_voidp(result))
+        {
+            print(result);
+        }
+
+        return CommandStatus::Continue;
+    };
+
+    scheme_commands.insert(name);
+    add_command(std::move(command));
+
+    return SchemeCommandStatus::Added;
+}
+
+void Kelyphos::install_commands()
+{
+    auto quit = [this](const CommandArgs&)
+    {
+        editor->save_history();
+        return CommandStatus::Quit;
+    };
+
+    add_command({"help", "", "displays the help output", 0, 0, [this](const CommandArgs&)
+    {
+        editor->write(commands.help_text());
+        return CommandStatus::Continue;
+    }});
+    add_command({"quit", "", "exit the repl", 0, 0, quit});
+    add_command({"exit", "", "exit the repl", 0, 0, quit});
+    add_command({
+        "time",
+        "",
+        "toggle reporting the time, collections and allocation of each form",
+        0,
+        0,
+        [this](const CommandArgs&) { return time_command(); }});
+    add_command({
+        "more",
+        "",
+        "continue a result paused after a page",
+        0,
+        0,
+        [this](const CommandArgs&) { return more_command(); }});
+    add_command({
+        "reset",
+        "",
+        "discard a half-typed form and any paused result",
+        0,
+        0,
+        [this](const CommandArgs&) { return reset_command(); }});
+    add_command({
+        "bench",
+        "<expr> [n]",
+        "evaluate expr n times after warming up and summarise the timings",
+        1,
+        2,
+        [this](const CommandArgs& args) { return bench_command(args); }});
+}
+
+CommandStatus Kelyphos::time_command()
+{
+    time_forms = !time_forms;
+
+    std::string state{time_forms ? ";; timing on" : ";; timing off"};
+    editor->print(state);
+
+    return CommandStatus::Continue;
+}
+
+CommandStatus Kelyphos::reset_command()
+{
+    input->reader.reset();
+    input->more_output.reset();
+
+    return CommandStatus::Continue;
+}
+
+CommandStatus Kelyphos::more_command()
+{
+    if (!input->more_output)
+    {
+        std::string nothing{";; nothing more to print"};
+        editor->print(nothing);
+        return CommandStatus::Continue;
+    }
+
+    input->more_output->next_page();
+    print_page();
+
+    return CommandStatus::Continue;
+}
+
+CommandStatus Kelyphos::bench_command(const CommandArgs& args)
+{
+    const auto& datums = args.datums;
+    int runs = default_bench_runs;
+
+    if (datums.size() == 2)
+    {
+        const auto& count = datums[1];
+        auto [end, ec] = std::from_chars(count.data(), count.data() + count.size(), runs);
+
+        if (ec != std::errc{} || end != count.data() + count.size())
+        {
+            runs = 0;
+        }
+    }
+
+    if (runs <= 0)
+    {
+        std::string usage{";; usage: ,bench <expr> [n], with n a positive count of runs"};
+        editor->print(usage);
+        return CommandStatus::Continue;
+    }
+
+    sexp thunk = make_thunk(datums[0]);
+
+    if (sexp_exceptionp(thunk))
+    {
+        print(thunk);
+        return CommandStatus::Continue;
+    }
+
+    schemer.preserve(thunk);
+
+    int warm_up = std::max(1, runs / 10);
+    sexp result = SEXP_VOID;
+
+    for (int run = 0; run < warm_up && !sexp_exceptionp(result); ++run)
+    {
+        result = schemer.call(thunk);
+    }
+
+    std::vector<double> seconds;
+    std::vector<size_t> allocations;
+    uint64_t collections = 0;
+    uint64_t gc_usecs = 0;
+
+    for (int run = 0; run < runs && !sexp_exceptionp(result); ++run)
+    {
+        FormCost cost = measure([this, &result, thunk]() { result = schemer.call(thunk); });
+
+        seconds.push_back(cost.seconds);
+        collections += cost.collections;
+        gc_usecs += cost.gc_usecs;
+
+        if (cost.allocated)
+        {
+            allocations.push_back(cost.allocated.value());
+        }
+    }
+
+    if (sexp_exceptionp(result))
+    {
+        print(result);
+        schemer.release(thunk);
+        return CommandStatus::Continue;
+    }
+
+    schemer.release(thunk);
+
+    RunStats stats = summarize_runs(std::move(seconds));
+    std::string timings = fmt::format(
+        ";; {} runs after {} warm-up: mean {} +/- {}, min {}, p50 {}, p90 {}, p99 {}, max {}",
+        stats.runs,
+        warm_up,
+        format_seconds(stats.mean),
+        format_seconds(stats.stddev),
+        format_seconds(stats.min),
+        format_seconds(stats.p50),
+        format_seconds(stats.p90),
+        format_seconds(stats.p99),
+        format_seconds(stats.max));
+
+    // Runs that collected are left out of the allocation figure; see FormCost.
+    std::string allocated = allocations.empty()
+        ? std::string{"unknown"}
+        : format_bytes(static_cast<double>(std::accumulate(allocations.begin(), allocations.end(), size_t{0}))
+            / static_cast<double>(allocations.size()));
+    std::string memory = fmt::format(
+        ";; {} collections ({} in gc), {} allocated per run",
+        collections,
+        format_seconds(static_cast<double>(gc_usecs) / 1e6),
+        allocated);
+
+    editor->print(timings);
+    editor->print(memory);
+
+    return CommandStatus::Continue;
+}
+
+/*
+ * With ,time on, expressions run as thunks called by the root context, the only one whose
+ * collections chibi lets us count. Definitions must stay at top level, so they are evaluated as
+ * usual, in a child context, and only their time is reported.
+ */
+void Kelyphos::evaluate(const std::string& datum)
+{
+    if (!time_forms)
+    {
+        print(schemer.eval(datum));
+        return;
+    }
+
+    sexp result = SEXP_VOID;
+    FormCost cost{};
+    bool counted = !is_definition(datum);
+
+    if (!counted)
+    {
+        cost = measure([this, &result, &datum]() { result = schemer.eval(datum); });
+    }
+    else
+    {
+        sexp thunk = make_thunk(datum);
+
+        if (sexp_exceptionp(thunk))
+        {
+            print(thunk);
+            return;
+        }
+
+        schemer.preserve(thunk);
+        cost = measure([this, &result, thunk]() { result = schemer.call(thunk); });
+        schemer.release(thunk);
+    }
+
+    print(result);
+
+    std::string report = counted
+        ? fmt::format(
+            ";; {}, {} collections ({} in gc), {} allocated",
+            format_seconds(cost.seconds),
+            cost.collections,
+            format_seconds(static_cast<double>(cost.gc_usecs) / 1e6),
+            cost.allocated ? format_bytes(static_cast<double>(cost.allocated.value())) : std::string{"unknown"})
+        : fmt::format(";; {}, collections and allocation unknown", format_seconds(cost.seconds));
+    editor->print(report);
+}
+
+sexp Kelyphos::make_thunk(const std::string& datum)
+{
+    // The newline ends any comment the datum finishes with.
+    return schemer.eval(fmt::format("(lambda () {}\n)", datum));
 }
 
-bool Kelyphos::check_quit(const std::string& input)
+template <typename F>
+FormCost Kelyphos::measure(F&& run)
 {
-    auto quit_check = (
-        (input.compare(0, 5, ",quit") == 0) ||
-        (input.compare(0, 5, ",exit") == 0));
+    scheme::HeapStats before = schemer.heap_stats();
+    auto start = std::chrono::steady_clock::now();
+
+    run();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    scheme::HeapStats after = schemer.heap_stats();
+
+    FormCost cost{};
+    cost.seconds = elapsed.count();
+    cost.collections = after.collections - before.collections;
+    cost.gc_usecs = after.gc_usecs - before.gc_usecs;
 
-    if (quit_check)
+    // Without a collection, memory only leaves the free lists by being allocated.
+    if (cost.collections == 0)
     {
-        // fixme add to history
+        size_t available = before.free_bytes + (after.heap_bytes - before.heap_bytes);
+        cost.allocated = available > after.free_bytes ? available - after.free_bytes : 0;
     }
 
-    return quit_check;
+    return cost;
 }
 
-bool Kelyphos::check_help(const std::string& input)
+void Kelyphos::apply_config_changes()
 {
-    auto help_check = (input.compare(0, 5, ",help") == 0);
+    int enable_history = pending_history.exchange(-1);
 
-    if (help_check)
+    if (enable_history == 1)
     {
-        fmt::print(
-            "{}\n\t{}\n{}\n\t{}\n{}\n\t{}\n",
-            ",help",
-            "displays the help ooutput",
-            ",quit",
-            "exit the repl",
-            ",exit",
-            "exit the repl");
+        editor->enable_history();
+    }
+    else if (enable_history == 0)
+    {
+        editor->disable_history();
     }
 
-    return help_check;
+    uint64_t generation = config_watcher->get_generation();
+
+    if (generation != config_generation)
+    {
+        config_generation = generation;
+
+        KelyphosConfig config{};
+
+        if (config_manager::from_config_map(*config_watcher->current(), config).is_ok())
+        {
+            set_print_limits(config);
+        }
+    }
+}
+
+void Kelyphos::set_print_limits(const KelyphosConfig& config)
+{
+    print_limits.max_depth = static_cast<size_t>(std::max(config.print_depth, 1));
+    print_limits.page_bytes = static_cast<size_t>(std::max(config.print_page_bytes, 1));
+}
+
+void Kelyphos::sync_completions()
+{
+    std::vector<std::string> names;
+    schemer.collect_new_bindings(completion_cursor, names);
+
+    auto& completions = editor->completions();
+    for (const auto& name : names)
+    {
+        completions.insert(name);
+    }
 }
 
 void Kelyphos::print(const sexp& result)
 {
-    std::string output{schemer.sexp_to_string(result)};
+    input->more_output = schemer.printer(result, print_limits);
+    print_page();
+}
+
+void Kelyphos::print_page()
+{
+    std::string chunk;
+    auto status = input->more_output->next_chunk(chunk);
+
+    // Most results fit in a chunk and go out as a line like any other.
+    if (status != scheme::PrintStatus::Done)
+    {
+        editor->write(chunk);
+
+        while (status == scheme::PrintStatus::More)
+        {
+            chunk.clear();
+            status = input->more_output->next_chunk(chunk);
+            editor->write(chunk);
+        }
+
+        chunk.clear();
+    }
+
+    editor->print(chunk);
+
+    if (status == scheme::PrintStatus::Done)
+    {
+        input->more_output.reset();
+        return;
+    }
 
-    editor->print(output);
+    std::string paused = fmt::format(
+        ";; paused after {} of output; ,more continues",
+        format_bytes(static_cast<double>(input->more_output->written())));
+    editor->print(paused);
 }
 
 }
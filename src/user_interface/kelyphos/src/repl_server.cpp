@@ -0,0 +1,704 @@
+#include "repl_server.hpp"
+#include "logger.hpp"
+
+#include <arpa/inet.h>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace samos::user_interface::kelyphos {
+
+using log::logger::log;
+using log::logger::LogLevel;
+
+namespace
+{
+
+constexpr int max_events = 64;
+
+// Read from a client at a time.
+constexpr size_t read_bytes = 16 * 1024;
+
+// True if a server is accepting on path, so a leftover socket file can be told from a live one.
+bool socket_in_use(const std::string& path)
+{
+    int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (probe < 0)
+    {
+        return false;
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    bool in_use = ::connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    ::close(probe);
+
+    return in_use;
+}
+
+std::string errno_reason(const char* call)
+{
+    return fmt::format("{}: {}", call, std::strerror(errno));
+}
+
+} // namespace
+
+std::string default_server_socket()
+{
+    const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+
+    if (runtime_dir != nullptr && runtime_dir[0] != '\0')
+    {
+        return (std::filesystem::path{runtime_dir} / "samos" / "kelyphos.sock").string();
+    }
+
+    return fmt::format("/tmp/samos-{}/kelyphos.sock", ::getuid());
+}
+
+// Collects what the shell prints for the session it is running for.
+class ReplServer::SessionEditor : public ed_line::EdLine
+{
+public:
+    SessionEditor()
+        :
+        EdLine(""),
+        sink{nullptr}
+    {
+    }
+
+    void print(std::string& input) override
+    {
+        if (sink != nullptr)
+        {
+            sink->append(input);
+            sink->push_back('\n');
+        }
+    }
+
+    void write(std::string_view output) override
+    {
+        if (sink != nullptr)
+        {
+            sink->append(output);
+        }
+    }
+
+    // Output is dropped while nullptr, as when the host uses the shared shell itself.
+    std::string* sink;
+};
+
+struct ReplServer::Session
+{
+    int fd;
+
+    std::unique_ptr<SessionEditor> editor;
+
+    // nullptr when the server is shared.
+    std::unique_ptr<Kelyphos> shell;
+
+    // This session's place in the shared shell.
+    InputState input;
+
+    std::string in;
+
+    std::string out;
+
+    // The client has shut down its side; its remaining lines still run.
+    bool input_closed;
+
+    // Close once out is sent.
+    bool quitting;
+};
+
+ReplServer::ReplServer(ReplServerConfig config, std::vector<std::string> config_overrides, ShellFactory make_shell)
+    :
+    config{std::move(config)},
+    config_overrides{std::move(config_overrides)},
+    config_watcher{},
+    make_shell{std::move(make_shell)},
+    sessions{},
+    session_count{0},
+    shared_mutex{},
+    shared_editor{},
+    shared_shell{},
+    unix_fd{-1},
+    socket_bound{false},
+    tcp_fd{-1},
+    bound_port{0},
+    epoll_fd{-1},
+    stop_pipe{-1, -1},
+    server{}
+{
+    if (!this->make_shell)
+    {
+        this->make_shell = [this](ed_line::EdLine* editor)
+        {
+            if (!config_watcher)
+            {
+                config_watcher = start_config_watcher(this->config_overrides);
+            }
+
+            return std::make_unique<Kelyphos>(editor, config_watcher);
+        };
+    }
+}
+
+ReplServer::~ReplServer()
+{
+    stop();
+}
+
+ServerResult<> ReplServer::start()
+{
+    if (server.joinable())
+    {
+        return ServerResult<>::ok({});
+    }
+
+    if (config.socket_path.empty() && !config.tcp_port)
+    {
+        return ServerResult<>::err(ServerError{"neither a socket path nor a port to listen on"});
+    }
+
+    epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+
+    if (epoll_fd < 0 || ::pipe2(stop_pipe, O_CLOEXEC) < 0)
+    {
+        auto reason = errno_reason(epoll_fd < 0 ? "epoll_create1" : "pipe2");
+        close_fds();
+        return ServerResult<>::err(ServerError{reason});
+    }
+
+    auto res = watch(stop_pipe[0], EPOLLIN);
+
+    if (res.is_ok() && !config.socket_path.empty())
+    {
+        res = listen_unix();
+    }
+
+    if (res.is_ok() && config.tcp_port)
+    {
+        res = listen_tcp();
+    }
+
+    if (res.is_err())
+    {
+        close_fds();
+        return res;
+    }
+
+    if (config.shared)
+    {
+        try
+        {
+            shared_editor = std::make_unique<SessionEditor>();
+            shared_shell = make_shell(shared_editor.get());
+        }
+        catch (...)
+        {
+            close_fds();
+            return ServerResult<>::err(ServerError{"could not make the shared shell"});
+        }
+    }
+
+    server = std::thread{&ReplServer::serve_loop, this};
+
+    log<LogLevel::Info>(
+        "{} Serving Kelyphos on {}{}",
+        __LINE__,
+        config.socket_path,
+        bound_port == 0 ? std::string{} : fmt::format(" 127.0.0.1:{}", bound_port));
+
+    return ServerResult<>::ok({});
+}
+
+void ReplServer::stop()
+{
+    if (server.joinable())
+    {
+        char wake = 0;
+        [[maybe_unused]] auto written = ::write(stop_pipe[1], &wake, 1);
+        server.join();
+    }
+
+    while (!sessions.empty())
+    {
+        close_session(sessions.begin()->first);
+    }
+
+    shared_shell.reset();
+    shared_editor.reset();
+    close_fds();
+}
+
+uint16_t ReplServer::get_tcp_port() const
+{
+    return bound_port;
+}
+
+size_t ReplServer::get_session_count() const
+{
+    return session_count.load();
+}
+
+Kelyphos* ReplServer::get_shared_shell()
+{
+    return shared_shell.get();
+}
+
+std::unique_lock<std::mutex> ReplServer::shared_lock()
+{
+    return std::unique_lock<std::mutex>{shared_mutex};
+}
+
+ServerResult<> ReplServer::listen_unix()
+{
+    std::filesystem::path path{config.socket_path};
+    sockaddr_un address{};
+
+    if (config.socket_path.size() >= sizeof(address.sun_path))
+    {
+        return ServerResult<>::err(ServerError{fmt::format("socket path too long: {}", config.socket_path)});
+    }
+
+    std::error_code error;
+
+    // Whoever can connect can run code as this process, so only its owner may. A directory made
+    // here is closed to others too, which covers the moment between bind and chmod.
+    if (path.has_parent_path() && std::filesystem::create_directories(path.parent_path(), error))
+    {
+        std::filesystem::permissions(path.parent_path(), std::filesystem::perms::owner_all, error);
+    }
+
+    // A socket left by a server that died is replaced; a live server's is not.
+    if (std::filesystem::is_socket(path, error))
+    {
+        if (socket_in_use(config.socket_path))
+        {
+            return ServerResult<>::err(ServerError{fmt::format("{} is already being served", config.socket_path)});
+        }
+
+        std::filesystem::remove(path, error);
+    }
+
+    unix_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (unix_fd < 0)
+    {
+        return ServerResult<>::err(ServerError{errno_reason("socket")});
+    }
+
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, config.socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    if (::bind(unix_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        return ServerResult<>::err(ServerError{errno_reason("bind")});
+    }
+
+    socket_bound = true;
+
+    if (::chmod(config.socket_path.c_str(), S_IRUSR | S_IWUSR) < 0)
+    {
+        return ServerResult<>::err(ServerError{errno_reason("chmod")});
+    }
+
+    if (::listen(unix_fd, SOMAXCONN) < 0)
+    {
+        return ServerResult<>::err(ServerError{errno_reason("listen")});
+    }
+
+    return watch(unix_fd, EPOLLIN);
+}
+
+ServerResult<> ReplServer::listen_tcp()
+{
+    tcp_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (tcp_fd < 0)
+    {
+        return ServerResult<>::err(ServerError{errno_reason("socket")});
+    }
+
+    int reuse = 1;
+    ::setsockopt(tcp_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config.tcp_port.value());
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (::bind(tcp_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        return ServerResult<>::err(ServerError{errno_reason("bind")});
+    }
+
+    socklen_t length = sizeof(address);
+
+    if (::listen(tcp_fd, SOMAXCONN) < 0 || ::getsockname(tcp_fd, reinterpret_cast<sockaddr*>(&address), &length) < 0)
+    {
+        return ServerResult<>::err(ServerError{errno_reason("listen")});
+    }
+
+    bound_port = ntohs(address.sin_port);
+
+    return watch(tcp_fd, EPOLLIN);
+}
+
+ServerResult<> ReplServer::watch(int fd, uint32_t events)
+{
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        return ServerResult<>::err(ServerError{errno_reason("epoll_ctl")});
+    }
+
+    return ServerResult<>::ok({});
+}
+
+void ReplServer::serve_loop()
+{
+    std::array<epoll_event, max_events> events{};
+
+    while (true)
+    {
+        int ready = ::epoll_wait(epoll_fd, events.data(), max_events, -1);
+
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            log<LogLevel::Error>("{} Stopped serving: {}", __LINE__, std::strerror(errno));
+            return;
+        }
+
+        for (int idx = 0; idx < ready; ++idx)
+        {
+            int fd = events[idx].data.fd;
+            uint32_t flags = events[idx].events;
+
+            if (fd == stop_pipe[0])
+            {
+                return;
+            }
+            else if (fd == unix_fd || fd == tcp_fd)
+            {
+                accept_sessions(fd);
+                continue;
+            }
+
+            auto session_it = sessions.find(fd);
+
+            // Closed earlier in this batch.
+            if (session_it == sessions.end())
+            {
+                continue;
+            }
+
+            Session& session = *session_it->second;
+
+            if ((flags & EPOLLIN) != 0)
+            {
+                on_readable(session);
+            }
+            else if ((flags & (EPOLLHUP | EPOLLERR)) != 0)
+            {
+                close_session(fd);
+                continue;
+            }
+
+            if (sessions.contains(fd) && (flags & EPOLLOUT) != 0)
+            {
+                flush(session);
+            }
+        }
+    }
+}
+
+void ReplServer::accept_sessions(int listener)
+{
+    while (true)
+    {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                log<LogLevel::Warn>("{} Could not accept a client: {}", __LINE__, std::strerror(errno));
+            }
+            if (errno != EINTR)
+            {
+                return;
+            }
+            continue;
+        }
+
+        if (sessions.size() >= config.max_sessions)
+        {
+            std::string full = fmt::format(";; server full: {} sessions\n", config.max_sessions);
+            [[maybe_unused]] auto sent = ::send(fd, full.data(), full.size(), MSG_NOSIGNAL);
+            ::close(fd);
+            continue;
+        }
+
+        auto session = std::make_unique<Session>();
+        session->fd = fd;
+        session->input_closed = false;
+        session->quitting = false;
+
+        if (!config.shared)
+        {
+            try
+            {
+                session->editor = std::make_unique<SessionEditor>();
+                session->editor->sink = &session->out;
+                session->shell = make_shell(session->editor.get());
+            }
+            catch (...)
+            {
+                log<LogLevel::Error>("{} Could not make a shell for a client", __LINE__);
+                ::close(fd);
+                continue;
+            }
+        }
+
+        if (watch(fd, EPOLLIN | EPOLLRDHUP).is_err())
+        {
+            ::close(fd);
+            continue;
+        }
+
+        session->out = fmt::format("{}\n", server_ready);
+        Session& added = *sessions.emplace(fd, std::move(session)).first->second;
+        session_count.store(sessions.size());
+
+        flush(added);
+    }
+}
+
+void ReplServer::on_readable(Session& session)
+{
+    std::array<char, read_bytes> buffer{};
+
+    // Stopping at a line's worth keeps a client that sends faster than it reads from growing
+    // in without bound; epoll reports the rest once run_lines has caught up.
+    while (session.in.size() <= config.max_line_bytes)
+    {
+        ssize_t length = ::read(session.fd, buffer.data(), buffer.size());
+
+        if (length > 0)
+        {
+            session.in.append(buffer.data(), static_cast<size_t>(length));
+            continue;
+        }
+        else if (length == 0)
+        {
+            // A last line without a newline still runs.
+            if (!session.in.empty() && session.in.back() != '\n')
+            {
+                session.in.push_back('\n');
+            }
+
+            session.input_closed = true;
+            break;
+        }
+        else if (errno == EINTR)
+        {
+            continue;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+
+        close_session(session.fd);
+        return;
+    }
+
+    if (session.in.find('\n') == std::string::npos && session.in.size() > config.max_line_bytes)
+    {
+        session.out += fmt::format(";; line longer than {} bytes\n", config.max_line_bytes);
+        session.in.clear();
+        session.quitting = true;
+    }
+
+    flush(session);
+}
+
+void ReplServer::run_lines(Session& session)
+{
+    size_t start = 0;
+    size_t end;
+
+    while (!session.quitting
+        && session.out.size() < config.max_pending_output
+        && (end = session.in.find('\n', start)) != std::string::npos)
+    {
+        std::string line = session.in.substr(start, end - start);
+        start = end + 1;
+
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        CommandStatus status;
+        bool pending;
+
+        if (config.shared)
+        {
+            std::lock_guard<std::mutex> lock{shared_mutex};
+            shared_editor->sink = &session.out;
+            status = shared_shell->feed(line, session.input);
+            shared_editor->sink = nullptr;
+            pending = session.input.reader.pending();
+        }
+        else
+        {
+            status = session.shell->feed(line);
+            pending = session.shell->pending();
+        }
+
+        if (status == CommandStatus::Quit)
+        {
+            session.out += fmt::format("{}\n", server_bye);
+            session.quitting = true;
+        }
+        else
+        {
+            session.out += fmt::format("{}\n", pending ? server_more : server_ready);
+        }
+    }
+
+    session.in.erase(0, start);
+}
+
+/*
+ * Sends what the socket will take, then runs any lines that were held back while output waited,
+ * until either the socket is full or no whole line is left.
+ */
+void ReplServer::flush(Session& session)
+{
+    while (true)
+    {
+        size_t sent = 0;
+        bool blocked = false;
+
+        while (sent < session.out.size())
+        {
+            ssize_t length = ::send(session.fd, session.out.data() + sent, session.out.size() - sent, MSG_NOSIGNAL);
+
+            if (length < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                blocked = true;
+                break;
+            }
+            else if (length < 0)
+            {
+                close_session(session.fd);
+                return;
+            }
+
+            sent += static_cast<size_t>(length);
+        }
+
+        session.out.erase(0, sent);
+
+        size_t unread = session.in.size();
+        run_lines(session);
+
+        if (session.input_closed && session.in.find('\n') == std::string::npos)
+        {
+            session.quitting = true;
+        }
+
+        if (session.out.empty() && session.quitting)
+        {
+            close_session(session.fd);
+            return;
+        }
+        else if (blocked || session.in.size() == unread)
+        {
+            break;
+        }
+    }
+
+    epoll_event event{};
+    event.events = session.out.empty() ? 0 : static_cast<uint32_t>(EPOLLOUT);
+
+    if (!session.input_closed && session.out.size() < config.max_pending_output)
+    {
+        event.events |= EPOLLIN | EPOLLRDHUP;
+    }
+
+    event.data.fd = session.fd;
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, session.fd, &event);
+}
+
+void ReplServer::close_session(int fd)
+{
+    auto session_it = sessions.find(fd);
+
+    if (session_it == sessions.end())
+    {
+        return;
+    }
+
+    if (config.shared)
+    {
+        // Its paused output belongs to the shared shell's interpreter.
+        std::lock_guard<std::mutex> lock{shared_mutex};
+        session_it->second->input.more_output.reset();
+    }
+
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    sessions.erase(session_it);
+    session_count.store(sessions.size());
+}
+
+void ReplServer::close_fds()
+{
+    if (socket_bound)
+    {
+        std::error_code error;
+        std::filesystem::remove(config.socket_path, error);
+        socket_bound = false;
+    }
+
+    for (int* fd : {&unix_fd, &tcp_fd, &epoll_fd, &stop_pipe[0], &stop_pipe[1]})
+    {
+        if (*fd >= 0)
+        {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+
+    bound_port = 0;
+}
+
+} // namespace samos::user_interface::kelyphos
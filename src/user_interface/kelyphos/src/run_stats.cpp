@@ -0,0 +1,89 @@
+#include "run_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <numeric>
+
+namespace samos::user_interface::kelyphos {
+
+namespace
+{
+
+double nearest_rank(const std::vector<double>& sorted, double percentile)
+{
+    auto rank = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(sorted.size())));
+
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+} // namespace
+
+RunStats summarize_runs(std::vector<double> seconds)
+{
+    RunStats stats{};
+
+    if (seconds.empty())
+    {
+        return stats;
+    }
+
+    std::sort(seconds.begin(), seconds.end());
+
+    stats.runs = seconds.size();
+    stats.mean = std::accumulate(seconds.begin(), seconds.end(), 0.0) / static_cast<double>(seconds.size());
+
+    if (seconds.size() > 1)
+    {
+        double squares = 0.0;
+
+        for (double run : seconds)
+        {
+            squares += (run - stats.mean) * (run - stats.mean);
+        }
+
+        stats.stddev = std::sqrt(squares / static_cast<double>(seconds.size() - 1));
+    }
+
+    stats.min = seconds.front();
+    stats.p50 = nearest_rank(seconds, 50.0);
+    stats.p90 = nearest_rank(seconds, 90.0);
+    stats.p99 = nearest_rank(seconds, 99.0);
+    stats.max = seconds.back();
+
+    return stats;
+}
+
+std::string format_seconds(double seconds)
+{
+    if (seconds < 1e-6)
+    {
+        return fmt::format("{:.0f} ns", seconds * 1e9);
+    }
+    else if (seconds < 1e-3)
+    {
+        return fmt::format("{:.1f} us", seconds * 1e6);
+    }
+    else if (seconds < 1.0)
+    {
+        return fmt::format("{:.2f} ms", seconds * 1e3);
+    }
+
+    return fmt::format("{:.2f} s", seconds);
+}
+
+std::string format_bytes(double bytes)
+{
+    if (bytes < 1024.0)
+    {
+        return fmt::format("{:.0f} B", bytes);
+    }
+    else if (bytes < 1024.0 * 1024.0)
+    {
+        return fmt::format("{:.1f} KiB", bytes / 1024.0);
+    }
+
+    return fmt::format("{:.2f} MiB", bytes / (1024.0 * 1024.0));
+}
+
+} // namespace samos::user_interface::kelyphos
@@ -1,5 +1,18 @@
 #include "gtest/gtest.h"
 #include "kelyphos.hpp"
+#include "command_table.hpp"
+#include "incremental_reader.hpp"
+#include "repl_server.hpp"
+#include "run_stats.hpp"
+#include <arpa/inet.h>
+#include <cstring>
+#include <filesystem>
+#include <netinet/in.h>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #include <vector>
 
 namespace samos_ed = samos::user_interface::ed_line;
@@ -43,6 +56,11 @@ public:
         out_buffer.push_back(input);
     }
 
+    void write(std::string_view output) override
+    {
+        streamed += output;
+    }
+
     std::string read() override
     {
         if (in_buffer.size() > 0)
@@ -62,11 +80,61 @@ public:
         return out_buffer.size();
     }
 
+    std::string streamed;
+
 private:
     std::vector<std::string> in_buffer;
     std::vector<std::string> out_buffer;
 };
 
+namespace
+{
+
+// Points every shell's config and history at a scratch directory and hides SAMOS_KELYPHOS_
+// variables, so the tests neither depend on nor touch the user's own files.
+class HermeticEnvironment : public ::testing::Environment
+{
+public:
+    void SetUp() override
+    {
+        dir = std::filesystem::temp_directory_path() / fmt::format("samos_kelyphos_test_{}", ::getpid());
+        std::filesystem::create_directories(dir);
+        ::setenv("XDG_CONFIG_HOME", (dir / "config").c_str(), 1);
+        ::setenv("XDG_STATE_HOME", (dir / "state").c_str(), 1);
+
+        std::vector<std::string> names;
+
+        for (char** entry = environ; *entry != nullptr; ++entry)
+        {
+            std::string_view name{*entry};
+            name = name.substr(0, name.find('='));
+
+            if (name.starts_with("SAMOS_KELYPHOS_"))
+            {
+                names.emplace_back(name);
+            }
+        }
+
+        for (const auto& name : names)
+        {
+            ::unsetenv(name.c_str());
+        }
+    }
+
+    void TearDown() override
+    {
+        std::error_code error;
+        std::filesystem::remove_all(dir, error);
+    }
+
+private:
+    std::filesystem::path dir;
+};
+
+[[maybe_unused]] const auto* hermetic_environment = ::testing::AddGlobalTestEnvironment(new HermeticEnvironment);
+
+} // namespace
+
 TEST(TestKelyphos, CheckQuit)
 {
     TestEdLine editor("test ");
@@ -95,3 +163,369 @@ TEST(TestKelyphos, CheckHelp)
 
     EXPECT_EQ(editor.out_size(), 5);
 }
+
+TEST(TestKelyphos, MultiLineForms)
+{
+    TestEdLine editor("test ");
+    kelyphos::Kelyphos shell(&editor);
+
+    editor.push(",quit");
+    editor.push("(* x 2)");
+    editor.push("  2)");
+    editor.push("(define x (+ 1");
+    editor.push("1 2");
+
+    shell.repl();
+
+    ASSERT_EQ(editor.out_size(), 4);
+    EXPECT_EQ(editor.pop(), "6");
+}
+
+TEST(TestKelyphos, ResetsAPendingForm)
+{
+    TestEdLine editor("test> ");
+    kelyphos::Kelyphos shell(&editor);
+
+    EXPECT_EQ(shell.feed("(define y (list 1"), kelyphos::CommandStatus::Continue);
+    EXPECT_TRUE(shell.pending());
+
+    EXPECT_EQ(shell.feed(" ,reset "), kelyphos::CommandStatus::Continue);
+    EXPECT_FALSE(shell.pending());
+
+    shell.feed("(+ 2 3)");
+    EXPECT_EQ(editor.pop(), "5");
+
+    shell.feed(",reset");
+    EXPECT_FALSE(shell.pending());
+}
+
+TEST(TestKelyphos, HeadlessShellsShareAWatcher)
+{
+    auto watcher = kelyphos::start_config_watcher();
+    TestEdLine first_editor("");
+    TestEdLine second_editor("");
+    kelyphos::Kelyphos first(&first_editor, watcher);
+    kelyphos::Kelyphos second(&second_editor, watcher);
+
+    EXPECT_EQ(watcher.use_count(), 3);
+
+    first.feed("(define z 4)");
+    second.feed("(define z 5)");
+    first.feed("z");
+    second.feed("z");
+
+    EXPECT_EQ(first_editor.pop(), "4");
+    EXPECT_EQ(second_editor.pop(), "5");
+}
+
+TEST(TestKelyphos, CompletesBoundSymbols)
+{
+    TestEdLine editor("test ");
+    kelyphos::Kelyphos shell(&editor);
+
+    EXPECT_TRUE(editor.completions().contains("call-with-current-continuation"));
+    EXPECT_TRUE(editor.completions().contains("log-info"));
+    EXPECT_TRUE(editor.completions().contains(",quit"));
+    EXPECT_FALSE(editor.completions().contains("orbit-period"));
+
+    editor.push("(define (orbit-period a) a)");
+    shell.repl();
+
+    EXPECT_EQ(editor.completions().complete("orbit-", 4), std::vector<std::string>{"orbit-period"});
+}
+
+TEST(TestKelyphos, TimesAndBenchesForms)
+{
+    TestEdLine editor("test ");
+    kelyphos::Kelyphos shell(&editor);
+
+    editor.push(",quit");
+    editor.push(",bench 1 x");
+    editor.push(",bench (make-vector 64 0) 20");
+    editor.push("(+ 2 2)");
+    editor.push(",time");
+    editor.push("(+ 1 2)");
+    editor.push(",time");
+
+    shell.repl();
+
+    ASSERT_EQ(editor.out_size(), 8);
+    EXPECT_EQ(editor.pop().rfind(";; usage: ,bench", 0), 0);
+    EXPECT_NE(editor.pop().find("allocated per run"), std::string::npos);
+    EXPECT_EQ(editor.pop().rfind(";; 20 runs after 2 warm-up: mean ", 0), 0);
+    EXPECT_EQ(editor.pop(), "4");
+    EXPECT_EQ(editor.pop(), ";; timing off");
+    EXPECT_NE(editor.pop().find("allocated"), std::string::npos);
+    EXPECT_EQ(editor.pop(), "3");
+    EXPECT_EQ(editor.pop(), ";; timing on");
+}
+
+TEST(TestKelyphos, TimesDefinitionsWithoutCounts)
+{
+    TestEdLine editor("test ");
+    kelyphos::Kelyphos shell(&editor);
+
+    shell.feed(",time");
+    shell.feed("(define w 3)");
+    EXPECT_NE(editor.pop().find("collections and allocation unknown"), std::string::npos);
+
+    shell.feed("((lambda () (define v 4) v))");
+    EXPECT_NE(editor.pop().find(" allocated"), std::string::npos);
+    EXPECT_EQ(editor.pop(), "4");
+}
+
+TEST(TestKelyphos, PagesLargeResults)
+{
+    TestEdLine editor("test ");
+    kelyphos::Kelyphos shell(&editor, {"kelyphos.print-page-bytes=200"});
+
+    editor.push(",quit");
+    editor.push(",more");
+    editor.push(",more");
+    editor.push(",more");
+    editor.push("(make-list 250 1)");
+
+    shell.repl();
+
+    std::string expected = "(1";
+    for (int idx = 1; idx < 250; ++idx)
+    {
+        expected += " 1";
+    }
+    expected += ")";
+
+    ASSERT_EQ(editor.out_size(), 6);
+    EXPECT_EQ(editor.pop(), ";; nothing more to print");
+    EXPECT_EQ(editor.streamed + editor.pop(), expected);
+    EXPECT_EQ(editor.pop().rfind(";; paused after ", 0), 0);
+    EXPECT_EQ(editor.pop(), "");
+    EXPECT_EQ(editor.pop().rfind(";; paused after ", 0), 0);
+    EXPECT_EQ(editor.streamed.size(), 400);
+}
+
+TEST(TestKelyphos, RunsSchemeCommands)
+{
+    TestEdLine editor("test ");
+    kelyphos::Kelyphos shell(&editor);
+
+    editor.push(",quit");
+    editor.push(",twice");
+    editor.push(",twice 21");
+    editor.push("(define-shell-command \"twice\" \"<n>\" \"doubles n\" (lambda (n) (* 2 n)))");
+
+    shell.repl();
+
+    EXPECT_TRUE(editor.completions().contains(",twice"));
+    ASSERT_EQ(editor.out_size(), 2);
+    EXPECT_NE(editor.pop().find("exception"), std::string::npos);
+    EXPECT_EQ(editor.pop(), "42");
+}
+
+TEST(TestCommandTable, DispatchesAndChecksArguments)
+{
+    std::vector<std::string> reports;
+    kelyphos::CommandTable table{[&reports](const std::string& message) { reports.push_back(message); }};
+    std::vector<std::string> seen;
+
+    auto record = [&seen](const kelyphos::CommandArgs& args)
+    {
+        seen = args.datums;
+        return kelyphos::CommandStatus::Continue;
+    };
+
+    EXPECT_TRUE(table.add({"echo", "<x> [y]", "records its arguments", 1, 2, record}));
+    EXPECT_TRUE(table.add({"bye", "", "quits", 0, 0, [](const kelyphos::CommandArgs&) { return kelyphos::CommandStatus::Quit; }}));
+    EXPECT_FALSE(table.add({"bye", "", "again", 0, 0, {}}));
+
+    EXPECT_EQ(table.dispatch("(+ 1 2)"), std::nullopt);
+    EXPECT_EQ(table.dispatch(",bye"), kelyphos::CommandStatus::Quit);
+    EXPECT_EQ(table.dispatch(",echo (a \"b c\") 2"), kelyphos::CommandStatus::Continue);
+    EXPECT_EQ(seen, (std::vector<std::string>{"(a \"b c\")", "2"}));
+    EXPECT_TRUE(reports.empty());
+
+    EXPECT_EQ(table.dispatch(",echo"), kelyphos::CommandStatus::Continue);
+    EXPECT_EQ(table.dispatch(",echo (open"), kelyphos::CommandStatus::Continue);
+    EXPECT_EQ(table.dispatch(",nope"), kelyphos::CommandStatus::Continue);
+    EXPECT_EQ(reports, (std::vector<std::string>{
+        ";; usage: ,echo <x> [y]",
+        ";; usage: ,echo <x> [y]",
+        ";; unknown command ,nope; ,help lists them"}));
+
+    EXPECT_EQ(table.help_text(), ",bye\n\tquits\n,echo <x> [y]\n\trecords its arguments\n");
+    EXPECT_TRUE(table.remove("bye"));
+    EXPECT_FALSE(table.contains("bye"));
+}
+
+namespace
+{
+
+int connect_unix(const std::string& path)
+{
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    return ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 ? fd : -1;
+}
+
+int connect_tcp(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    return ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 ? fd : -1;
+}
+
+// Everything the server sends up to and including its next ready, more or bye line.
+std::string read_reply(int fd)
+{
+    std::string reply;
+    char byte;
+
+    while (::read(fd, &byte, 1) == 1)
+    {
+        reply.push_back(byte);
+
+        for (const char* marker : {kelyphos::server_ready, kelyphos::server_more, kelyphos::server_bye})
+        {
+            std::string line = std::string{marker} + "\n";
+
+            if (reply.ends_with(line) && (reply.size() == line.size() || reply[reply.size() - line.size() - 1] == '\n'))
+            {
+                return reply;
+            }
+        }
+    }
+
+    return reply;
+}
+
+std::string exchange(int fd, const std::string& line)
+{
+    std::string sent = line + "\n";
+    EXPECT_EQ(::write(fd, sent.data(), sent.size()), static_cast<ssize_t>(sent.size()));
+
+    return read_reply(fd);
+}
+
+std::string test_socket_path(const char* name)
+{
+    return (std::filesystem::temp_directory_path() / fmt::format("{}-{}.sock", name, ::getpid())).string();
+}
+
+} // namespace
+
+TEST(TestReplServer, GivesEachClientItsOwnShell)
+{
+    kelyphos::ReplServerConfig config{};
+    config.socket_path = test_socket_path("kelyphos-own");
+    config.tcp_port = 0;
+
+    kelyphos::ReplServer server{config};
+    ASSERT_TRUE(server.start().is_ok());
+    ASSERT_NE(server.get_tcp_port(), 0);
+
+    int first = connect_unix(config.socket_path);
+    int second = connect_tcp(server.get_tcp_port());
+    ASSERT_GE(first, 0);
+    ASSERT_GE(second, 0);
+    EXPECT_EQ(read_reply(first), ";; ready\n");
+    EXPECT_EQ(read_reply(second), ";; ready\n");
+
+    exchange(first, "(define x 20)");
+    exchange(second, "(define x 5)");
+    EXPECT_EQ(exchange(first, "(+ x"), ";; more\n");
+    EXPECT_EQ(exchange(first, "1)"), "21\n;; ready\n");
+    EXPECT_EQ(exchange(second, "x"), "5\n;; ready\n");
+    EXPECT_EQ(server.get_session_count(), 2);
+
+    EXPECT_EQ(exchange(first, ",quit"), ";; bye\n");
+    char byte;
+    EXPECT_EQ(::read(first, &byte, 1), 0);
+    ::close(first);
+    ::close(second);
+
+    server.stop();
+    EXPECT_FALSE(std::filesystem::exists(config.socket_path));
+}
+
+TEST(TestReplServer, SharesOneShellAcrossClients)
+{
+    kelyphos::ReplServerConfig config{};
+    config.socket_path = test_socket_path("kelyphos-shared");
+    config.shared = true;
+
+    kelyphos::ReplServer server{config};
+    ASSERT_TRUE(server.start().is_ok());
+    ASSERT_NE(server.get_shared_shell(), nullptr);
+
+    int first = connect_unix(config.socket_path);
+    int second = connect_unix(config.socket_path);
+    ASSERT_GE(first, 0);
+    ASSERT_GE(second, 0);
+    read_reply(first);
+    read_reply(second);
+
+    exchange(first, "(define y 7)");
+    EXPECT_EQ(exchange(first, "(* y"), ";; more\n");
+
+    // The second client's input is its own, though the definitions are not.
+    EXPECT_EQ(exchange(second, "y"), "7\n;; ready\n");
+    EXPECT_EQ(exchange(first, "2)"), "14\n;; ready\n");
+
+    {
+        auto lock = server.shared_lock();
+        server.get_shared_shell()->feed("(define y 8)");
+    }
+    EXPECT_EQ(exchange(second, "y"), "8\n;; ready\n");
+
+    ::close(first);
+    ::close(second);
+}
+
+TEST(TestRunStats, SummarizesTimings)
+{
+    auto stats = kelyphos::summarize_runs({5.0, 1.0, 4.0, 2.0, 3.0});
+
+    EXPECT_EQ(stats.runs, 5);
+    EXPECT_DOUBLE_EQ(stats.mean, 3.0);
+    EXPECT_NEAR(stats.stddev, 1.5811, 1e-4);
+    EXPECT_DOUBLE_EQ(stats.min, 1.0);
+    EXPECT_DOUBLE_EQ(stats.p50, 3.0);
+    EXPECT_DOUBLE_EQ(stats.p90, 5.0);
+    EXPECT_DOUBLE_EQ(stats.max, 5.0);
+    EXPECT_EQ(kelyphos::summarize_runs({}).runs, 0);
+
+    EXPECT_EQ(kelyphos::format_seconds(0.0025), "2.50 ms");
+    EXPECT_EQ(kelyphos::format_seconds(12.4e-6), "12.4 us");
+    EXPECT_EQ(kelyphos::format_bytes(1536.0), "1.5 KiB");
+}
+
+TEST(TestIncrementalReader, SplitsDatumsAcrossLines)
+{
+    using Datums = std::vector<std::string>;
+    kelyphos::IncrementalReader reader;
+
+    EXPECT_EQ(reader.feed("(define (f x)"), Datums{});
+    EXPECT_TRUE(reader.pending());
+    EXPECT_EQ(reader.feed("  (* x \")\" #\\) 2)) 42 'sym"), (Datums{"(define (f x)\n  (* x \")\" #\\) 2))", "42", "'sym"}));
+    EXPECT_FALSE(reader.pending());
+
+    EXPECT_EQ(reader.feed("'"), Datums{});
+    EXPECT_EQ(reader.feed("#(1 2) ; (not a form"), Datums{"'\n#(1 2)"});
+
+    EXPECT_EQ(reader.feed("#| a block (comment"), Datums{});
+    EXPECT_TRUE(reader.pending());
+    EXPECT_EQ(reader.feed("#| nested |# still |# #;(skipped) #u8(1 2) |a b| \"x"), (Datums{"#u8(1 2)", "|a b|"}));
+    EXPECT_EQ(reader.feed("y\" ,@z)"), (Datums{"\"x\ny\"", ",@z", ")"}));
+    EXPECT_FALSE(reader.pending());
+
+    EXPECT_EQ(reader.feed("(unfinished"), Datums{});
+    reader.reset();
+    EXPECT_FALSE(reader.pending());
+    EXPECT_EQ(reader.feed("done"), Datums{"done"});
+}
@@ -1,5 +1,6 @@
 #include "metaforeas.hpp"
 #include "logger.hpp"
+#include "scheme_log.hpp"
 
 #include <fmt/core.h>
 #include <string>
@@ -21,14 +22,14 @@ void Metaforeas::run()
 
     if (res.is_err())
     {
-        log::logger::log(log::logger::LogLevel::Error, "Error: {}", res.get_err().format());
+        log::logger::log<log::logger::LogLevel::Error>("Error: {}", res.get_err());
         return;
     }
 
     res = option_parser.parse();
     if (res.is_err())
     {
-        log::logger::log(log::logger::LogLevel::Error, "Error: {}", res.get_err().format());
+        log::logger::log<log::logger::LogLevel::Error>("Error: {}", res.get_err());
         return;
     }
 
@@ -39,11 +40,18 @@ void Metaforeas::run()
         filenames = filenames_opt.value();
     }
 
-    log::logger::log(log::logger::LogLevel::Debug, "files: {}", filenames.size());
+    log::logger::log<log::logger::LogLevel::Debug>("files: {}", filenames.size());
+
+    auto log_res = scheme::install_log_ops(schemer);
+
+    if (log_res.is_err())
+    {
+        log::logger::log<log::logger::LogLevel::Warn>("Scheme log ops unavailable: {}", log_res.get_err());
+    }
 
     for (auto filename : filenames)
     {
-        log::logger::log(log::logger::LogLevel::Info, "Info string {}", filename);
+        log::logger::log<log::logger::LogLevel::Info>("Info string {}", filename);
         schemer.load(filename);
     }
 }
@@ -107,7 +107,7 @@ public:
         }
         catch (const cxxopts::OptionException& e)
         {
-            log::logger::log(log::logger::LogLevel::Critical, "Error adding arguments: {}", e.what());
+            log::logger::log<log::logger::LogLevel::Critical>("Error adding arguments: {}", e.what());
             return OptParserResult::err(ExceptionError{e.what()});
         }
 
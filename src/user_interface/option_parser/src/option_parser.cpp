@@ -59,27 +59,9 @@ std::string ExceptionError::format() const
 
 std::string OptParserError::format() const
 {
-    if (std::holds_alternative<InvalidUtf8Error>(*this))
-    {
-        return std::get<InvalidUtf8Error>(*this).format();
-    }
-    else if (std::holds_alternative<FlagSizeError>(*this))
-    {
-        return std::get<FlagSizeError>(*this).format();
-    }
-    else if (std::holds_alternative<OptSizeError>(*this))
-    {
-        return std::get<OptSizeError>(*this).format();
-    }
-    else if (std::holds_alternative<DocSizeError>(*this))
-    {
-        return std::get<DocSizeError>(*this).format();
-    }
-    else
-    {
-        assert(std::holds_alternative<ExceptionError>(*this));
-        return std::get<ExceptionError>(*this).format();
-    }
+    return std::visit(
+        [](const auto& error) { return error.format(); },
+        static_cast<const OptParserError::variant&>(*this));
 }
 
 OptionParser::OptionParser(int argc, char** argv, const std::string& name, const std::string& summary)
@@ -162,7 +144,7 @@ OptParserResult OptionParser::add_flag_set(std::vector<FlagSet>&& flag_set)
     }
     catch (const cxxopts::OptionException& e)
     {
-        slog::log(LogLevel::Critical, "Error adding arguments: {}", e.what());
+        slog::log<LogLevel::Critical>("Error adding arguments: {}", e.what());
         return OptParserResult::err(ExceptionError{e.what()});
     }
 
@@ -180,7 +162,7 @@ OptParserResult OptionParser::parse()
     }
     catch (const cxxopts::OptionException& e)
     {
-        slog::log(LogLevel::Error, "Error parsing: {}", e.what());
+        slog::log<LogLevel::Error>("Error parsing: {}", e.what());
         std::cout << options_impl.help() << std::endl;
         return OptParserResult::err(ExceptionError{e.what()});
     }